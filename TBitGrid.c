@@ -4,24 +4,43 @@
 
 #include "TBitGrid.h"
 
-typedef union TBitGridChannelPtr {
-            uint8_t     *b8;
-            uint16_t    *b16;
-            uint32_t    *b32;
-            uint64_t    *b64;
-} TBitGridChannelPtr;
+#include <limits.h>
 
-//
-
-typedef struct {
-    TBitGridIterator        base;
-    unsigned int            channelIdx;
-} TBitGridIterator_1C;
+#if defined(HAVE_IMMINTRIN_H) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#   define TBITGRID_HAVE_BMI2_KERNEL
+#   define TBITGRID_HAVE_AVX2_KERNEL
+#   include <immintrin.h>
+#   include <cpuid.h>
+#endif
 
-typedef struct {
-    TBitGridIterator        base;
-    TCell                   channelMask;
-} TBitGridIterator_NC;
+/*
+ * @defined TBITGRID_HASH_ROW_MULTIPLIER
+ *
+ * The odd multiplier P of the board hash:  logical row j's key is weighted
+ * by P^j (see TBitGridGetHash()).
+ */
+#define TBITGRID_HASH_ROW_MULTIPLIER 0xD6E8FEB86659FD93ULL
+
+/*
+ * @function __TBitGridIteratorSeekRow
+ *
+ * Point the iterator's channel pointers at the first word of its current
+ * row.  Rows are not contiguous in storage, so this happens each time the
+ * iterator moves to a new row.
+ */
+static inline void
+__TBitGridIteratorSeekRow(
+    TBitGridIterator    *iterator
+)
+{
+    size_t              offset = TBitGridGetRowWordOffset(iterator->bitGrid, iterator->j) * iterator->dimensions.nBytesPerWord;
+    unsigned int        channelIdx = 0;
+    
+    while ( channelIdx < iterator->dimensions.nChannels ) {
+        iterator->grid[channelIdx].b8 = iterator->bitGrid->grid[channelIdx].b8 + offset;
+        channelIdx++;
+    }
+}
 
 //
 
@@ -32,7 +51,6 @@ __TBitGridIteratorNext_8b_1C(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         if ( iterator->isStarted ) {
@@ -44,19 +62,18 @@ __TBitGridIteratorNext_8b_1C(
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
                 
-                iterator->grid[ITERATOR->channelIdx].b8++;
-            } else if ( (iterator->i % 8) == 0 ) {
-                iterator->grid[ITERATOR->channelIdx].b8++;
+                __TBitGridIteratorSeekRow(iterator);
+            } else if ( ((iterator->i + iterator->dimensions.nBorderCols) % 8) == 0 ) {
+                iterator->grid[iterator->channelIdx].b8++;
             }   
         } else {
             iterator->isStarted = true;
         }
-        *value = (*iterator->grid[ITERATOR->channelIdx].b8 & (1 << (iterator->i % 8))) ? (1 << ITERATOR->channelIdx) : 0;
+        *value = (*iterator->grid[iterator->channelIdx].b8 & (1 << ((iterator->i + iterator->dimensions.nBorderCols) % 8))) ? (1 << iterator->channelIdx) : 0;
         outP->i = iterator->i, outP->j = iterator->j;
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -65,7 +82,6 @@ __TBitGridIteratorNextFullRow_8b_1C(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords;
@@ -76,11 +92,12 @@ __TBitGridIteratorNextFullRow_8b_1C(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
-            if ( *iterator->grid[ITERATOR->channelIdx].b8++ != 0xFF ) break;
+            if ( *iterator->grid[iterator->channelIdx].b8++ != 0xFF ) break;
             nFullWords--;
         }
         if ( nFullWords == 0 ) {
@@ -91,17 +108,14 @@ __TBitGridIteratorNextFullRow_8b_1C(
                 // Examine any partial word:
                 uint8_t         mask = (1 << iterator->nPartialBits) - 1;
             
-                if ( (*iterator->grid[ITERATOR->channelIdx].b8++ & mask) == mask ) {
+                if ( (*iterator->grid[iterator->channelIdx].b8++ & mask) == mask ) {
                     *outJ = iterator->j;
                     return true;
                 }
             }
-        } else {
-            iterator->grid[ITERATOR->channelIdx].b8 += (nFullWords - 1) + (iterator->nPartialBits != 0);
         }
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -111,7 +125,6 @@ __TBitGridIteratorNext_8b_NC(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         TCell       channelMask, channelIdx, localValue;
@@ -125,12 +138,12 @@ __TBitGridIteratorNext_8b_NC(
                 
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
-                incPtrs = true;
+                __TBitGridIteratorSeekRow(iterator);
             } else {
-                incPtrs = ( (iterator->i % 8) == 0 );
+                incPtrs = ( ((iterator->i + iterator->dimensions.nBorderCols) % 8) == 0 );
             }
             if ( incPtrs ) {
-                channelIdx = 0, channelMask = ITERATOR->channelMask;
+                channelIdx = 0, channelMask = iterator->channelMask;
                 while ( channelMask ) {
                     if ( channelMask & 0x1 )
                         iterator->grid[channelIdx].b8++;
@@ -142,8 +155,8 @@ __TBitGridIteratorNext_8b_NC(
         }
         localValue = 0, channelIdx = iterator->dimensions.nChannels - 1, channelMask = 1 << (iterator->dimensions.nChannels - 1);
         while ( channelMask ) {
-            if ( (channelMask & ITERATOR->channelMask) &&
-                 (*iterator->grid[channelIdx].b8 & (1 << (iterator->i % 8))) )
+            if ( (channelMask & iterator->channelMask) &&
+                 (*iterator->grid[channelIdx].b8 & (1 << ((iterator->i + iterator->dimensions.nBorderCols) % 8))) )
             {
                 localValue |= channelMask;
             }
@@ -155,7 +168,6 @@ __TBitGridIteratorNext_8b_NC(
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -164,7 +176,6 @@ __TBitGridIteratorNextFullRow_8b_NC(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords, channelIdx, channelMask;
@@ -175,13 +186,14 @@ __TBitGridIteratorNextFullRow_8b_NC(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
             uint8_t     combined = 0xFF;
             
-            channelMask = ITERATOR->channelMask;
+            channelMask = iterator->channelMask;
             channelIdx = 0;
             while ( channelMask ) {
                 if ( (1 << channelIdx) & channelMask ) {
@@ -202,7 +214,7 @@ __TBitGridIteratorNextFullRow_8b_NC(
                 uint8_t         mask = (1 << iterator->nPartialBits) - 1;
                 uint8_t         combined = 0xFF & mask;
             
-                channelMask = ITERATOR->channelMask;
+                channelMask = iterator->channelMask;
                 channelIdx = 0;
                 while ( channelMask ) {
                     if ( (1 << channelIdx) & channelMask ) {
@@ -216,21 +228,9 @@ __TBitGridIteratorNextFullRow_8b_NC(
                     return true;
                 }
             }
-        } else {
-            channelMask = ITERATOR->channelMask;
-            channelIdx = 0;
-            while ( channelMask ) {
-                if ( (1 << channelIdx) & channelMask ) {
-                    iterator->grid[channelIdx].b8 += (nFullWords - 1) + (iterator->nPartialBits != 0);
-                    channelMask &= ~(1 << channelIdx);
-                }
-                channelIdx++;
-            }
-            
         }
     }
     return false;
-#undef ITERATOR
 }
 
 //
@@ -242,7 +242,6 @@ __TBitGridIteratorNext_16b_1C(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         if ( iterator->isStarted ) {
@@ -254,19 +253,18 @@ __TBitGridIteratorNext_16b_1C(
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
                 
-                iterator->grid[ITERATOR->channelIdx].b16++;
-            } else if ( (iterator->i % 16) == 0 ) {
-                iterator->grid[ITERATOR->channelIdx].b16++;
+                __TBitGridIteratorSeekRow(iterator);
+            } else if ( ((iterator->i + iterator->dimensions.nBorderCols) % 16) == 0 ) {
+                iterator->grid[iterator->channelIdx].b16++;
             }   
         } else {
             iterator->isStarted = true;
         }
-        *value = (*iterator->grid[ITERATOR->channelIdx].b16 & (1 << (iterator->i % 16))) ? (1 << ITERATOR->channelIdx) : 0;
+        *value = (*iterator->grid[iterator->channelIdx].b16 & (1 << ((iterator->i + iterator->dimensions.nBorderCols) % 16))) ? (1 << iterator->channelIdx) : 0;
         outP->i = iterator->i, outP->j = iterator->j;
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -275,7 +273,6 @@ __TBitGridIteratorNextFullRow_16b_1C(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords;
@@ -286,11 +283,12 @@ __TBitGridIteratorNextFullRow_16b_1C(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
-            if ( *iterator->grid[ITERATOR->channelIdx].b16++ != 0xFFFF ) break;
+            if ( *iterator->grid[iterator->channelIdx].b16++ != 0xFFFF ) break;
             nFullWords--;
         }
         if ( nFullWords == 0 ) {
@@ -301,17 +299,14 @@ __TBitGridIteratorNextFullRow_16b_1C(
                 // Examine any partial word:
                 uint16_t        mask = (1 << iterator->nPartialBits) - 1;
             
-                if ( (*iterator->grid[ITERATOR->channelIdx].b16++ & mask) == mask ) {
+                if ( (*iterator->grid[iterator->channelIdx].b16++ & mask) == mask ) {
                     *outJ = iterator->j;
                     return true;
                 }
             }
-        } else {
-            iterator->grid[ITERATOR->channelIdx].b16 += (nFullWords - 1) + (iterator->nPartialBits != 0);
         }
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -321,7 +316,6 @@ __TBitGridIteratorNext_16b_NC(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         TCell       channelMask, channelIdx, localValue;
@@ -335,12 +329,12 @@ __TBitGridIteratorNext_16b_NC(
                 
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
-                incPtrs = true;
+                __TBitGridIteratorSeekRow(iterator);
             } else {
-                incPtrs = ( (iterator->i % 16) == 0 );
+                incPtrs = ( ((iterator->i + iterator->dimensions.nBorderCols) % 16) == 0 );
             }
             if ( incPtrs ) {
-                channelIdx = 0, channelMask = ITERATOR->channelMask;
+                channelIdx = 0, channelMask = iterator->channelMask;
                 while ( channelMask ) {
                     if ( channelMask & 0x1 )
                         iterator->grid[channelIdx].b16++;
@@ -352,8 +346,8 @@ __TBitGridIteratorNext_16b_NC(
         }
         localValue = 0, channelIdx = iterator->dimensions.nChannels - 1, channelMask = 1 << (iterator->dimensions.nChannels - 1);
         while ( channelMask ) {
-            if ( (channelMask & ITERATOR->channelMask) &&
-                 (*iterator->grid[channelIdx].b16 & (1 << (iterator->i % 16))) )
+            if ( (channelMask & iterator->channelMask) &&
+                 (*iterator->grid[channelIdx].b16 & (1 << ((iterator->i + iterator->dimensions.nBorderCols) % 16))) )
             {
                 localValue |= channelMask;
             }
@@ -365,7 +359,6 @@ __TBitGridIteratorNext_16b_NC(
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -374,7 +367,6 @@ __TBitGridIteratorNextFullRow_16b_NC(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords, channelIdx, channelMask;
@@ -385,13 +377,14 @@ __TBitGridIteratorNextFullRow_16b_NC(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
             uint16_t    combined = 0xFFFF;
             
-            channelMask = ITERATOR->channelMask;
+            channelMask = iterator->channelMask;
             channelIdx = 0;
             while ( channelMask ) {
                 if ( (1 << channelIdx) & channelMask ) {
@@ -412,7 +405,7 @@ __TBitGridIteratorNextFullRow_16b_NC(
                 uint16_t        mask = (1 << iterator->nPartialBits) - 1;
                 uint16_t        combined = 0xFFFF & mask;
             
-                channelMask = ITERATOR->channelMask;
+                channelMask = iterator->channelMask;
                 channelIdx = 0;
                 while ( channelMask ) {
                     if ( (1 << channelIdx) & channelMask ) {
@@ -426,21 +419,9 @@ __TBitGridIteratorNextFullRow_16b_NC(
                     return true;
                 }
             }
-        } else {
-            channelMask = ITERATOR->channelMask;
-            channelIdx = 0;
-            while ( channelMask ) {
-                if ( (1 << channelIdx) & channelMask ) {
-                    iterator->grid[channelIdx].b16 += (nFullWords - 1) + (iterator->nPartialBits != 0);
-                    channelMask &= ~(1 << channelIdx);
-                }
-                channelIdx++;
-            }
-            
         }
     }
     return false;
-#undef ITERATOR
 }
 
 //
@@ -452,7 +433,6 @@ __TBitGridIteratorNext_32b_1C(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         if ( iterator->isStarted ) {
@@ -464,19 +444,18 @@ __TBitGridIteratorNext_32b_1C(
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
                 
-                iterator->grid[ITERATOR->channelIdx].b32++;
-            } else if ( (iterator->i % 32) == 0 ) {
-                iterator->grid[ITERATOR->channelIdx].b32++;
+                __TBitGridIteratorSeekRow(iterator);
+            } else if ( ((iterator->i + iterator->dimensions.nBorderCols) % 32) == 0 ) {
+                iterator->grid[iterator->channelIdx].b32++;
             }   
         } else {
             iterator->isStarted = true;
         }
-        *value = (*iterator->grid[ITERATOR->channelIdx].b32 & (1 << (iterator->i % 32))) ? (1 << ITERATOR->channelIdx) : 0;
+        *value = (*iterator->grid[iterator->channelIdx].b32 & ((uint32_t)1 << ((iterator->i + iterator->dimensions.nBorderCols) % 32))) ? (1 << iterator->channelIdx) : 0;
         outP->i = iterator->i, outP->j = iterator->j;
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -485,7 +464,6 @@ __TBitGridIteratorNextFullRow_32b_1C(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords;
@@ -496,11 +474,12 @@ __TBitGridIteratorNextFullRow_32b_1C(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
-            if ( *iterator->grid[ITERATOR->channelIdx].b32++ != 0xFFFFFFFF ) break;
+            if ( *iterator->grid[iterator->channelIdx].b32++ != 0xFFFFFFFF ) break;
             nFullWords--;
         }
         if ( nFullWords == 0 ) {
@@ -509,19 +488,16 @@ __TBitGridIteratorNextFullRow_32b_1C(
                 return true;
             } else {
                 // Examine any partial word:
-                uint32_t        mask = (1 << iterator->nPartialBits) - 1;
+                uint32_t        mask = ((uint32_t)1 << iterator->nPartialBits) - 1;
             
-                if ( (*iterator->grid[ITERATOR->channelIdx].b32++ & mask) == mask ) {
+                if ( (*iterator->grid[iterator->channelIdx].b32++ & mask) == mask ) {
                     *outJ = iterator->j;
                     return true;
                 }
             }
-        } else {
-            iterator->grid[ITERATOR->channelIdx].b32 += (nFullWords - 1) + (iterator->nPartialBits != 0);
         }
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -531,7 +507,6 @@ __TBitGridIteratorNext_32b_NC(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         TCell       channelMask, channelIdx, localValue;
@@ -545,12 +520,12 @@ __TBitGridIteratorNext_32b_NC(
                 
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
-                incPtrs = true;
+                __TBitGridIteratorSeekRow(iterator);
             } else {
-                incPtrs = ( (iterator->i % 32) == 0 );
+                incPtrs = ( ((iterator->i + iterator->dimensions.nBorderCols) % 32) == 0 );
             }
             if ( incPtrs ) {
-                channelIdx = 0, channelMask = ITERATOR->channelMask;
+                channelIdx = 0, channelMask = iterator->channelMask;
                 while ( channelMask ) {
                     if ( channelMask & 0x1 )
                         iterator->grid[channelIdx].b32++;
@@ -562,8 +537,8 @@ __TBitGridIteratorNext_32b_NC(
         }
         localValue = 0, channelIdx = iterator->dimensions.nChannels - 1, channelMask = 1 << (iterator->dimensions.nChannels - 1);
         while ( channelMask ) {
-            if ( (channelMask & ITERATOR->channelMask) &&
-                 (*iterator->grid[channelIdx].b32 & (1 << (iterator->i % 32))) )
+            if ( (channelMask & iterator->channelMask) &&
+                 (*iterator->grid[channelIdx].b32 & ((uint32_t)1 << ((iterator->i + iterator->dimensions.nBorderCols) % 32))) )
             {
                 localValue |= channelMask;
             }
@@ -575,7 +550,6 @@ __TBitGridIteratorNext_32b_NC(
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -584,7 +558,6 @@ __TBitGridIteratorNextFullRow_32b_NC(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords, channelIdx, channelMask;
@@ -595,13 +568,14 @@ __TBitGridIteratorNextFullRow_32b_NC(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
             uint32_t    combined = 0xFFFFFFFF;
             
-            channelMask = ITERATOR->channelMask;
+            channelMask = iterator->channelMask;
             channelIdx = 0;
             while ( channelMask ) {
                 if ( (1 << channelIdx) & channelMask ) {
@@ -619,10 +593,10 @@ __TBitGridIteratorNextFullRow_32b_NC(
                 return true;
             } else {
                 // Examine any partial word:
-                uint32_t        mask = (1 << iterator->nPartialBits) - 1;
+                uint32_t        mask = ((uint32_t)1 << iterator->nPartialBits) - 1;
                 uint32_t        combined = 0xFFFFFFFF & mask;
             
-                channelMask = ITERATOR->channelMask;
+                channelMask = iterator->channelMask;
                 channelIdx = 0;
                 while ( channelMask ) {
                     if ( (1 << channelIdx) & channelMask ) {
@@ -636,21 +610,9 @@ __TBitGridIteratorNextFullRow_32b_NC(
                     return true;
                 }
             }
-        } else {
-            channelMask = ITERATOR->channelMask;
-            channelIdx = 0;
-            while ( channelMask ) {
-                if ( (1 << channelIdx) & channelMask ) {
-                    iterator->grid[channelIdx].b32 += (nFullWords - 1) + (iterator->nPartialBits != 0);
-                    channelMask &= ~(1 << channelIdx);
-                }
-                channelIdx++;
-            }
-            
         }
     }
     return false;
-#undef ITERATOR
 }
 
 //
@@ -662,7 +624,6 @@ __TBitGridIteratorNext_64b_1C(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         if ( iterator->isStarted ) {
@@ -674,19 +635,18 @@ __TBitGridIteratorNext_64b_1C(
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
                 
-                iterator->grid[ITERATOR->channelIdx].b64++;
-            } else if ( (iterator->i % 64) == 0 ) {
-                iterator->grid[ITERATOR->channelIdx].b64++;
+                __TBitGridIteratorSeekRow(iterator);
+            } else if ( ((iterator->i + iterator->dimensions.nBorderCols) % 64) == 0 ) {
+                iterator->grid[iterator->channelIdx].b64++;
             }   
         } else {
             iterator->isStarted = true;
         }
-        *value = (*iterator->grid[ITERATOR->channelIdx].b64 & (1 << (iterator->i % 64))) ? (1 << ITERATOR->channelIdx) : 0;
+        *value = (*iterator->grid[iterator->channelIdx].b64 & ((uint64_t)1 << ((iterator->i + iterator->dimensions.nBorderCols) % 64))) ? (1 << iterator->channelIdx) : 0;
         outP->i = iterator->i, outP->j = iterator->j;
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -695,7 +655,6 @@ __TBitGridIteratorNextFullRow_64b_1C(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_1C*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords;
@@ -706,11 +665,12 @@ __TBitGridIteratorNextFullRow_64b_1C(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
-            if ( *iterator->grid[ITERATOR->channelIdx].b64++ != 0xFFFFFFFFFFFFFFFF ) break;
+            if ( *iterator->grid[iterator->channelIdx].b64++ != 0xFFFFFFFFFFFFFFFF ) break;
             nFullWords--;
         }
         if ( nFullWords == 0 ) {
@@ -719,19 +679,16 @@ __TBitGridIteratorNextFullRow_64b_1C(
                 return true;
             } else {
                 // Examine any partial word:
-                uint64_t        mask = (1 << iterator->nPartialBits) - 1;
+                uint64_t        mask = ((uint64_t)1 << iterator->nPartialBits) - 1;
             
-                if ( (*iterator->grid[ITERATOR->channelIdx].b64++ & mask) == mask ) {
+                if ( (*iterator->grid[iterator->channelIdx].b64++ & mask) == mask ) {
                     *outJ = iterator->j;
                     return true;
                 }
             }
-        } else {
-            iterator->grid[ITERATOR->channelIdx].b64 += (nFullWords - 1) + (iterator->nPartialBits != 0);
         }
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -741,7 +698,6 @@ __TBitGridIteratorNext_64b_NC(
     TCell               *value
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     if ( iterator->j < iterator->jMax ) {
         TCell       channelMask, channelIdx, localValue;
@@ -755,12 +711,12 @@ __TBitGridIteratorNext_64b_NC(
                 
                 //  We just incremented out of our grid dimensions, all done!
                 if ( iterator->j >= iterator->jMax ) return false;
-                incPtrs = true;
+                __TBitGridIteratorSeekRow(iterator);
             } else {
-                incPtrs = ( (iterator->i % 64) == 0 );
+                incPtrs = ( ((iterator->i + iterator->dimensions.nBorderCols) % 64) == 0 );
             }
             if ( incPtrs ) {
-                channelIdx = 0, channelMask = ITERATOR->channelMask;
+                channelIdx = 0, channelMask = iterator->channelMask;
                 while ( channelMask ) {
                     if ( channelMask & 0x1 )
                         iterator->grid[channelIdx].b64++;
@@ -772,8 +728,8 @@ __TBitGridIteratorNext_64b_NC(
         }
         localValue = 0, channelIdx = iterator->dimensions.nChannels - 1, channelMask = 1 << (iterator->dimensions.nChannels - 1);
         while ( channelMask ) {
-            if ( (channelMask & ITERATOR->channelMask) &&
-                 (*iterator->grid[channelIdx].b64 & (1 << (iterator->i % 64))) )
+            if ( (channelMask & iterator->channelMask) &&
+                 (*iterator->grid[channelIdx].b64 & ((uint64_t)1 << ((iterator->i + iterator->dimensions.nBorderCols) % 64))) )
             {
                 localValue |= channelMask;
             }
@@ -785,7 +741,6 @@ __TBitGridIteratorNext_64b_NC(
         return true;
     }
     return false;
-#undef ITERATOR
 }
 
 bool
@@ -794,7 +749,6 @@ __TBitGridIteratorNextFullRow_64b_NC(
     unsigned int        *outJ
 )
 {
-#define ITERATOR    ((TBitGridIterator_NC*)iterator)
 
     while ( iterator->j < iterator->jMax ) {
         unsigned int    nFullWords, channelIdx, channelMask;
@@ -805,13 +759,14 @@ __TBitGridIteratorNextFullRow_64b_NC(
         } else {
             iterator->isStarted = true;
         }
+        __TBitGridIteratorSeekRow(iterator);
         
         // Examine all whole words in the row:
         nFullWords = iterator->nFullWords;
         while ( nFullWords ) {
             uint64_t    combined = 0xFFFFFFFFFFFFFFFF;
             
-            channelMask = ITERATOR->channelMask;
+            channelMask = iterator->channelMask;
             channelIdx = 0;
             while ( channelMask ) {
                 if ( (1 << channelIdx) & channelMask ) {
@@ -829,10 +784,10 @@ __TBitGridIteratorNextFullRow_64b_NC(
                 return true;
             } else {
                 // Examine any partial word:
-                uint64_t        mask = (1 << iterator->nPartialBits) - 1;
+                uint64_t        mask = ((uint64_t)1 << iterator->nPartialBits) - 1;
                 uint64_t        combined = 0xFFFFFFFFFFFFFFFF & mask;
             
-                channelMask = ITERATOR->channelMask;
+                channelMask = iterator->channelMask;
                 channelIdx = 0;
                 while ( channelMask ) {
                     if ( (1 << channelIdx) & channelMask ) {
@@ -846,27 +801,87 @@ __TBitGridIteratorNextFullRow_64b_NC(
                     return true;
                 }
             }
-        } else {
-            channelMask = ITERATOR->channelMask;
-            channelIdx = 0;
-            while ( channelMask ) {
-                if ( (1 << channelIdx) & channelMask ) {
-                    iterator->grid[channelIdx].b64 += (nFullWords - 1) + (iterator->nPartialBits != 0);
-                    channelMask &= ~(1 << channelIdx);
-                }
-                channelIdx++;
-            }
-            
         }
     }
     return false;
-#undef ITERATOR
 }
 
 //
 ////
 //
 
+/*
+ * @function __TBitGridAdjustRowFillCount
+ *
+ * Account for a change to the channel 0 bit at index I in the row fill
+ * counts of bitGrid.
+ */
+static inline void
+__TBitGridAdjustRowFillCount(
+    TBitGrid        *bitGrid,
+    TGridIndex      I,
+    bool            wasSet,
+    bool            isSet
+)
+{
+    if ( wasSet != isSet ) {
+        unsigned int    j = I.W / bitGrid->dimensions.nWordsPerRow;
+        
+        if ( isSet )
+            bitGrid->rowFillCounts[j]++;
+        else
+            bitGrid->rowFillCounts[j]--;
+    }
+}
+
+/*
+ * @function __TBitGridSetBorderInRow
+ *
+ * Set the guard bits to the left and right of the cells in physical row
+ * physRow of every channel of a grid with a sentinel border.  Bordered
+ * grids only exist on little-endian hosts, so the row is treated as a
+ * string of bytes.
+ */
+static void
+__TBitGridSetBorderInRow(
+    TBitGrid        *bitGrid,
+    unsigned int    physRow
+)
+{
+    size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+    unsigned int    rightBit = bitGrid->dimensions.nBorderCols + bitGrid->dimensions.w;
+    unsigned int    rightByte = rightBit / 8;
+    unsigned int    channelIdx = bitGrid->dimensions.nChannels;
+    
+    while ( channelIdx-- ) {
+        uint8_t     *p = bitGrid->grid[channelIdx].b8 + physRow * nBytesPerRow;
+        
+        p[0] |= (1 << bitGrid->dimensions.nBorderCols) - 1;
+        p[rightByte] |= 0xFF << (rightBit % 8);
+        if ( rightByte + 1 < nBytesPerRow ) memset(p + rightByte + 1, 0xFF, nBytesPerRow - (rightByte + 1));
+    }
+}
+
+/*
+ * @function __TBitGridSetGuardRow
+ *
+ * Set every bit of the guard row in every channel of a grid with a sentinel
+ * border.
+ */
+static void
+__TBitGridSetGuardRow(
+    TBitGrid        *bitGrid
+)
+{
+    size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+    unsigned int    channelIdx = bitGrid->dimensions.nChannels;
+    
+    while ( channelIdx-- )
+        memset(bitGrid->grid[channelIdx].b8 + bitGrid->dimensions.h * nBytesPerRow, 0xFF, nBytesPerRow);
+}
+
+//
+
 TCell  
 __TBitGridGetCellValueAtIndex_8b_1C(
     TBitGrid        *bitGrid,
@@ -905,6 +920,7 @@ __TBitGridSetCellValueAtIndex_8b_1C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b8[I.W] & (1 << I.b)) != 0, value != 0);
     if ( value )
         bitGrid->grid[0].b8[I.W] |= (1 << I.b);
     else
@@ -917,6 +933,7 @@ __TBitGridSetCellValueAtIndex_8b_2C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b8[I.W] & (1 << I.b)) != 0, (value & 0x1) != 0);
     if ( value & 0x1 )
         bitGrid->grid[0].b8[I.W] |= (1 << I.b);
     else
@@ -935,6 +952,7 @@ __TBitGridSetCellValueAtIndex_8b_NC(
 {
     unsigned int    c = 0;
     
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b8[I.W] & (1 << I.b)) != 0, (value & 0x1) != 0);
     while ( c < bitGrid->dimensions.nChannels ) {
         if ( value & 0x1 )
             bitGrid->grid[c].b8[I.W] |= (1 << I.b);
@@ -985,6 +1003,7 @@ __TBitGridSetCellValueAtIndex_16b_1C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b16[I.W] & (1 << I.b)) != 0, value != 0);
     if ( value )
         bitGrid->grid[0].b16[I.W] |= (1 << I.b);
     else
@@ -997,6 +1016,7 @@ __TBitGridSetCellValueAtIndex_16b_2C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b16[I.W] & (1 << I.b)) != 0, (value & 0x1) != 0);
     if ( value & 0x1 )
         bitGrid->grid[0].b16[I.W] |= (1 << I.b);
     else
@@ -1015,6 +1035,7 @@ __TBitGridSetCellValueAtIndex_16b_NC(
 {
     unsigned int    c = 0;
     
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b16[I.W] & (1 << I.b)) != 0, (value & 0x1) != 0);
     while ( c < bitGrid->dimensions.nChannels ) {
         if ( value & 0x1 )
             bitGrid->grid[c].b16[I.W] |= (1 << I.b);
@@ -1033,7 +1054,7 @@ __TBitGridGetCellValueAtIndex_32b_1C(
     TGridIndex      I
 )
 {
-    return ((bitGrid->grid[0].b32[I.W]) & (1 << I.b)) != 0;
+    return ((bitGrid->grid[0].b32[I.W]) & ((uint32_t)1 << I.b)) != 0;
 }
 TCell  
 __TBitGridGetCellValueAtIndex_32b_2C(
@@ -1041,8 +1062,8 @@ __TBitGridGetCellValueAtIndex_32b_2C(
     TGridIndex      I
 )
 {
-    return ((((bitGrid->grid[1].b32[I.W]) & (1 << I.b)) != 0) << 1) |
-            (((bitGrid->grid[0].b32[I.W]) & (1 << I.b)) != 0);
+    return ((((bitGrid->grid[1].b32[I.W]) & ((uint32_t)1 << I.b)) != 0) << 1) |
+            (((bitGrid->grid[0].b32[I.W]) & ((uint32_t)1 << I.b)) != 0);
 }
 TCell  
 __TBitGridGetCellValueAtIndex_32b_NC(
@@ -1054,7 +1075,7 @@ __TBitGridGetCellValueAtIndex_32b_NC(
     unsigned int    c = bitGrid->dimensions.nChannels;
     
     while ( c-- )
-        outValue = (outValue << 1) | (((bitGrid->grid[c].b32[I.W]) & (1 << I.b)) != 0);
+        outValue = (outValue << 1) | (((bitGrid->grid[c].b32[I.W]) & ((uint32_t)1 << I.b)) != 0);
     return outValue;
 }
 
@@ -1065,10 +1086,11 @@ __TBitGridSetCellValueAtIndex_32b_1C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b32[I.W] & ((uint32_t)1 << I.b)) != 0, value != 0);
     if ( value )
-        bitGrid->grid[0].b32[I.W] |= (1 << I.b);
+        bitGrid->grid[0].b32[I.W] |= ((uint32_t)1 << I.b);
     else
-        bitGrid->grid[0].b32[I.W] &= ~(1 << I.b);
+        bitGrid->grid[0].b32[I.W] &= ~((uint32_t)1 << I.b);
 }
 void
 __TBitGridSetCellValueAtIndex_32b_2C(
@@ -1077,14 +1099,15 @@ __TBitGridSetCellValueAtIndex_32b_2C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b32[I.W] & ((uint32_t)1 << I.b)) != 0, (value & 0x1) != 0);
     if ( value & 0x1 )
-        bitGrid->grid[0].b32[I.W] |= (1 << I.b);
+        bitGrid->grid[0].b32[I.W] |= ((uint32_t)1 << I.b);
     else
-        bitGrid->grid[0].b32[I.W] &= ~(1 << I.b);
+        bitGrid->grid[0].b32[I.W] &= ~((uint32_t)1 << I.b);
     if ( value & 0x2 )
-        bitGrid->grid[1].b32[I.W] |= (1 << I.b);
+        bitGrid->grid[1].b32[I.W] |= ((uint32_t)1 << I.b);
     else
-        bitGrid->grid[1].b32[I.W] &= ~(1 << I.b);
+        bitGrid->grid[1].b32[I.W] &= ~((uint32_t)1 << I.b);
 }
 void
 __TBitGridSetCellValueAtIndex_32b_NC(
@@ -1095,11 +1118,12 @@ __TBitGridSetCellValueAtIndex_32b_NC(
 {
     unsigned int    c = 0;
     
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b32[I.W] & ((uint32_t)1 << I.b)) != 0, (value & 0x1) != 0);
     while ( c < bitGrid->dimensions.nChannels ) {
         if ( value & 0x1 )
-            bitGrid->grid[c].b32[I.W] |= (1 << I.b);
+            bitGrid->grid[c].b32[I.W] |= ((uint32_t)1 << I.b);
         else
-            bitGrid->grid[c].b32[I.W] &= ~(1 << I.b);
+            bitGrid->grid[c].b32[I.W] &= ~((uint32_t)1 << I.b);
         value >>= 1;
         c++;
     }
@@ -1113,7 +1137,7 @@ __TBitGridGetCellValueAtIndex_64b_1C(
     TGridIndex      I
 )
 {
-    return ((bitGrid->grid[0].b64[I.W]) & (1 << I.b)) != 0;
+    return ((bitGrid->grid[0].b64[I.W]) & ((uint64_t)1 << I.b)) != 0;
 }
 TCell  
 __TBitGridGetCellValueAtIndex_64b_2C(
@@ -1121,8 +1145,8 @@ __TBitGridGetCellValueAtIndex_64b_2C(
     TGridIndex      I
 )
 {
-    return ((((bitGrid->grid[1].b64[I.W]) & (1 << I.b)) != 0) << 1) |
-            (((bitGrid->grid[0].b64[I.W]) & (1 << I.b)) != 0);
+    return ((((bitGrid->grid[1].b64[I.W]) & ((uint64_t)1 << I.b)) != 0) << 1) |
+            (((bitGrid->grid[0].b64[I.W]) & ((uint64_t)1 << I.b)) != 0);
 }
 TCell  
 __TBitGridGetCellValueAtIndex_64b_NC(
@@ -1134,7 +1158,7 @@ __TBitGridGetCellValueAtIndex_64b_NC(
     unsigned int    c = bitGrid->dimensions.nChannels;
     
     while ( c-- )
-        outValue = (outValue << 1) | (((bitGrid->grid[c].b64[I.W]) & (1 << I.b)) != 0);
+        outValue = (outValue << 1) | (((bitGrid->grid[c].b64[I.W]) & ((uint64_t)1 << I.b)) != 0);
     return outValue;
 }
 
@@ -1145,10 +1169,11 @@ __TBitGridSetCellValueAtIndex_64b_1C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b64[I.W] & ((uint64_t)1 << I.b)) != 0, value != 0);
     if ( value )
-        bitGrid->grid[0].b64[I.W] |= (1 << I.b);
+        bitGrid->grid[0].b64[I.W] |= ((uint64_t)1 << I.b);
     else
-        bitGrid->grid[0].b64[I.W] &= ~(1 << I.b);
+        bitGrid->grid[0].b64[I.W] &= ~((uint64_t)1 << I.b);
 }
 void
 __TBitGridSetCellValueAtIndex_64b_2C(
@@ -1157,14 +1182,15 @@ __TBitGridSetCellValueAtIndex_64b_2C(
     TCell           value
 )
 {
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b64[I.W] & ((uint64_t)1 << I.b)) != 0, (value & 0x1) != 0);
     if ( value & 0x1 )
-        bitGrid->grid[0].b64[I.W] |= (1 << I.b);
+        bitGrid->grid[0].b64[I.W] |= ((uint64_t)1 << I.b);
     else
-        bitGrid->grid[0].b64[I.W] &= ~(1 << I.b);
+        bitGrid->grid[0].b64[I.W] &= ~((uint64_t)1 << I.b);
     if ( value & 0x2 )
-        bitGrid->grid[1].b64[I.W] |= (1 << I.b);
+        bitGrid->grid[1].b64[I.W] |= ((uint64_t)1 << I.b);
     else
-        bitGrid->grid[1].b64[I.W] &= ~(1 << I.b);
+        bitGrid->grid[1].b64[I.W] &= ~((uint64_t)1 << I.b);
 }
 void
 __TBitGridSetCellValueAtIndex_64b_NC(
@@ -1175,11 +1201,12 @@ __TBitGridSetCellValueAtIndex_64b_NC(
 {
     unsigned int    c = 0;
     
+    __TBitGridAdjustRowFillCount(bitGrid, I, (bitGrid->grid[0].b64[I.W] & ((uint64_t)1 << I.b)) != 0, (value & 0x1) != 0);
     while ( c < bitGrid->dimensions.nChannels ) {
         if ( value & 0x1 )
-            bitGrid->grid[c].b64[I.W] |= (1 << I.b);
+            bitGrid->grid[c].b64[I.W] |= ((uint64_t)1 << I.b);
         else
-            bitGrid->grid[c].b64[I.W] &= ~(1 << I.b);
+            bitGrid->grid[c].b64[I.W] &= ~((uint64_t)1 << I.b);
         value >>= 1;
         c++;
     }
@@ -1187,6 +1214,87 @@ __TBitGridSetCellValueAtIndex_64b_NC(
 
 //
 
+/*
+ * @function __TBitGridSetCellCallbacks
+ *
+ * Set the cell accessor callbacks of bitGrid for its word size and channel
+ * count.
+ */
+static void
+__TBitGridSetCellCallbacks(
+    TBitGrid        *bitGrid
+)
+{
+    switch ( bitGrid->dimensions.nBitsPerWord ) {
+        case 8:
+            switch ( bitGrid->dimensions.nChannels ) {
+                case 1:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_8b_1C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_8b_1C;
+                    break;
+                case 2:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_8b_2C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_8b_2C;
+                    break;
+                default:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_8b_NC;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_8b_NC;
+                    break;
+            }
+            break;
+        case 16:
+            switch ( bitGrid->dimensions.nChannels ) {
+                case 1:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_16b_1C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_16b_1C;
+                    break;
+                case 2:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_16b_2C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_16b_2C;
+                    break;
+                default:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_16b_NC;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_16b_NC;
+                    break;
+            }
+            break;
+        case 32:
+            switch ( bitGrid->dimensions.nChannels ) {
+                case 1:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_32b_1C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_32b_1C;
+                    break;
+                case 2:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_32b_2C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_32b_2C;
+                    break;
+                default:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_32b_NC;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_32b_NC;
+                    break;
+            }
+            break;
+        case 64:
+            switch ( bitGrid->dimensions.nChannels ) {
+                case 1:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_64b_1C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_64b_1C;
+                    break;
+                case 2:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_64b_2C;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_64b_2C;
+                    break;
+                default:
+                    bitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_64b_NC;
+                    bitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_64b_NC;
+                    break;
+            }
+            break;
+    }
+}
+
+//
+
 TBitGrid*
 TBitGridCreate(
     TBitGridWordSize    wordSize,
@@ -1194,31 +1302,57 @@ TBitGridCreate(
     unsigned int        w,
     unsigned int        h
 )
+{
+    return TBitGridCreateWithOptions(wordSize, nChannels, w, h, TBitGridOptionNone);
+}
+
+//
+
+TBitGrid*
+TBitGridCreateWithOptions(
+    TBitGridWordSize    wordSize,
+    unsigned int        nChannels,
+    unsigned int        w,
+    unsigned int        h,
+    TBitGridOptions     options
+)
 {
     TBitGrid        *newBitGrid = NULL;
     unsigned int    nBitsPerWord, nWordsTotal, nWordsPerRow;
-    size_t          channelBytes, gridBytes;
+    unsigned int    nBorderCols = 0, rowBits = w, nRows = h;
+    size_t          channelBytes, gridBytes, countsBytes, topsBytes, rowMapBytes;
+    size_t          holesBytes, transitionsBytes, hashesBytes;
     
-    if ( nChannels > 8 || nChannels < 1 ) return NULL;
+    if ( nChannels > TBITGRID_MAX_CHANNELS || nChannels < 1 ) return NULL;
     
     if ( (w < 8) || (h < 12) ) return NULL;
     
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // The bordered extraction kernels treat a row as a little-endian bit
+    // string:
+    if ( options & TBitGridOptionSentinelBorder ) {
+        nBorderCols = TBITGRID_SENTINEL_BORDER_COLS;
+        rowBits = w + 2 * nBorderCols;
+        nRows = h + 1;
+    }
+#endif
+    
     switch ( wordSize ) {
         case TBitGridWordSizeForce8Bit:
             nBitsPerWord = 8;
-            nWordsPerRow = (w + 7) / 8;
+            nWordsPerRow = (rowBits + 7) / 8;
             break;
         case TBitGridWordSizeForce16Bit:
             nBitsPerWord = 16;
-            nWordsPerRow = (w + 15) / 16;
+            nWordsPerRow = (rowBits + 15) / 16;
             break;
         case TBitGridWordSizeForce32Bit:
             nBitsPerWord = 32;
-            nWordsPerRow = (w + 31) / 32;
+            nWordsPerRow = (rowBits + 31) / 32;
             break;
         case TBitGridWordSizeForce64Bit:
             nBitsPerWord = 64;
-            nWordsPerRow = (w + 63) / 64;
+            nWordsPerRow = (rowBits + 63) / 64;
             break;
             
         default:
@@ -1226,7 +1360,7 @@ TBitGridCreate(
             //
             // Determine the optimal word size for the grid width:
             //
-            switch ( (w - 1) / 8 ) {
+            switch ( (rowBits - 1) / 8 ) {
                 case 0:
                     nBitsPerWord = 8;
                     nWordsPerRow = 1;
@@ -1264,10 +1398,10 @@ TBitGridCreate(
                         unsigned int    nWord;
                         unsigned int    nExtraBits;
                     } swap, byWordSize[4] = {
-                                                {  8,  (w + 7) / 8,  (((w + 7) / 8) << 3) - w },
-                                                { 16, (w + 15) / 16, (((w + 15) / 16) << 4) - w },
-                                                { 32, (w + 31) / 32, (((w + 31) / 32) << 5) - w },
-                                                { 64, (w + 63) / 64, (((w + 63) / 64) << 6) - w },
+                                                {  8,  (rowBits + 7) / 8,  (((rowBits + 7) / 8) << 3) - rowBits },
+                                                { 16, (rowBits + 15) / 16, (((rowBits + 15) / 16) << 4) - rowBits },
+                                                { 32, (rowBits + 31) / 32, (((rowBits + 31) / 32) << 5) - rowBits },
+                                                { 64, (rowBits + 63) / 64, (((rowBits + 63) / 64) << 6) - rowBits },
                                             };
 #define COMPARE_AND_SWAP(I,J) \
                     if ( (byWordSize[I].nExtraBits > byWordSize[J].nExtraBits) || \
@@ -1296,12 +1430,24 @@ TBitGridCreate(
             break;
         }
     }
-    nWordsTotal = nWordsPerRow * h;
+    nWordsTotal = nWordsPerRow * nRows;
     
     channelBytes = nWordsTotal * (nBitsPerWord / 8);
     gridBytes = nChannels * sizeof(TBitGridChannelPtr);
 
-    newBitGrid = (TBitGrid*)malloc(sizeof(TBitGrid) + gridBytes + nChannels * channelBytes);
+    // The row weights, row fill counts, column tops, board features and row
+    // map sit between the channel pointers and the channels themselves; keep
+    // the channels aligned to the largest word size:
+    countsBytes = (h * sizeof(unsigned int) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    topsBytes = (w * sizeof(unsigned int) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    holesBytes = topsBytes;
+    transitionsBytes = countsBytes;
+    hashesBytes = h * sizeof(uint64_t);
+    rowMapBytes = ((2 * h + 1) * sizeof(unsigned int) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+    // A trailing word of slop lets extraction kernels use unaligned loads that
+    // overrun the final row:
+    newBitGrid = (TBitGrid*)malloc(sizeof(TBitGrid) + gridBytes + countsBytes + topsBytes + holesBytes + transitionsBytes + 2 * hashesBytes + rowMapBytes + countsBytes + nChannels * channelBytes + sizeof(uint64_t));
     if ( newBitGrid ) {
         void            *p = (void*)newBitGrid + sizeof(TBitGrid);
         unsigned int    c;
@@ -1309,6 +1455,7 @@ TBitGridCreate(
         newBitGrid->dimensions.nChannels = nChannels;
         newBitGrid->dimensions.w = w;
         newBitGrid->dimensions.h = h;
+        newBitGrid->dimensions.nBorderCols = nBorderCols;
         newBitGrid->dimensions.nBitsPerWord = nBitsPerWord;
         newBitGrid->dimensions.nBytesPerWord = nBitsPerWord / 8;
         newBitGrid->dimensions.nWordsTotal = nWordsTotal;
@@ -1316,8 +1463,55 @@ TBitGridCreate(
         
         newBitGrid->grid = (TBitGridStorage)p; p += gridBytes;
         
+        // The row weights never change, so they precede the block of state
+        // that TBitGridCopyInto() copies:
+        newBitGrid->rowWeights = (uint64_t*)p; p += hashesBytes;
+        newBitGrid->rowWeights[0] = 1;
+        c = 1;
+        while ( c < h ) {
+            newBitGrid->rowWeights[c] = newBitGrid->rowWeights[c - 1] * TBITGRID_HASH_ROW_MULTIPLIER;
+            c++;
+        }
+        
+        // All rows start empty:
+        newBitGrid->rowFillCounts = (unsigned int*)p;
+        memset(p, 0, countsBytes); p += countsBytes;
+        
+        // ...and all columns empty:
+        newBitGrid->columnTops = (unsigned int*)p; p += topsBytes;
+        c = 0;
+        while ( c < w ) newBitGrid->columnTops[c++] = h;
+        
+        // ...so there are no holes, and each row's only transitions are at
+        // the walls:
+        newBitGrid->columnHoles = (unsigned int*)p;
+        memset(p, 0, holesBytes); p += holesBytes;
+        newBitGrid->nHoles = 0;
+        newBitGrid->rowTransitions = (unsigned int*)p; p += transitionsBytes;
+        c = 0;
+        while ( c < h ) newBitGrid->rowTransitions[c++] = 2;
+        newBitGrid->nRowTransitions = 2 * h;
+        
+        // ...and every row key (and so the hash) is zero:
+        newBitGrid->rowHashes = (uint64_t*)p;
+        memset(p, 0, hashesBytes); p += hashesBytes;
+        newBitGrid->hash = 0;
+        
+        // Rows start out in physical order:
+        newBitGrid->rowMap = (unsigned int*)p; p += rowMapBytes;
+        newBitGrid->rowSlots = (unsigned int*)p; p += countsBytes;
+        newBitGrid->rowBase = 0;
+        c = 0;
+        while ( c < h ) {
+            newBitGrid->rowMap[c] = newBitGrid->rowMap[c + h] = c;
+            newBitGrid->rowSlots[c] = c;
+            c++;
+        }
+        newBitGrid->rowMap[2 * h] = h;
+        newBitGrid->dirtyRect = TGridRectMakeEmpty();
+        
         // Clear all channel memory:
-        memset(p, 0x00, nChannels * channelBytes);
+        memset(p, 0x00, nChannels * channelBytes + sizeof(uint64_t));
         
         // Initialize each channel's storage pointer:
         c = 0;
@@ -1326,73 +1520,17 @@ TBitGridCreate(
             p += channelBytes;
         }
         
-        // Set the callbacks:
-        switch ( nBitsPerWord ) {
-            case 8:
-                switch ( nChannels ) {
-                    case 1:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_8b_1C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_8b_1C;
-                        break;
-                    case 2:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_8b_2C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_8b_2C;
-                        break;
-                    default:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_8b_NC;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_8b_NC;
-                        break;
-                }
-                break;
-            case 16:
-                switch ( nChannels ) {
-                    case 1:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_16b_1C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_16b_1C;
-                        break;
-                    case 2:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_16b_2C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_16b_2C;
-                        break;
-                    default:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_16b_NC;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_16b_NC;
-                        break;
-                }
-                break;
-            case 32:
-                switch ( nChannels ) {
-                    case 1:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_32b_1C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_32b_1C;
-                        break;
-                    case 2:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_32b_2C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_32b_2C;
-                        break;
-                    default:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_32b_NC;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_32b_NC;
-                        break;
-                }
-                break;
-            case 64:
-                switch ( nChannels ) {
-                    case 1:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_64b_1C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_64b_1C;
-                        break;
-                    case 2:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_64b_2C;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_64b_2C;
-                        break;
-                    default:
-                        newBitGrid->callbacks.getCellValueAtIndex = __TBitGridGetCellValueAtIndex_64b_NC;
-                        newBitGrid->callbacks.setCellValueAtIndex = __TBitGridSetCellValueAtIndex_64b_NC;
-                        break;
-                }
-                break;
+        // Raise the walls:
+        if ( nBorderCols ) {
+            c = 0;
+            while ( c < h ) __TBitGridSetBorderInRow(newBitGrid, c++);
+            __TBitGridSetGuardRow(newBitGrid);
         }
+        
+        // Set the callbacks:
+        __TBitGridSetCellCallbacks(newBitGrid);
+        TBitGridSetExtractKernel(newBitGrid, TBitGridExtractKernelDefault);
+        TBitGridSetFeaturesKernel(newBitGrid, TBitGridFeaturesKernelDefault);
 #ifdef TBITGRID_DEBUG
         printf("(w,h) = (%u,%u), nBitsPerWord = %u, nWords = %u, nWordsPerRow = %u, nBytesPerWord = %u\n",
                 newBitGrid->dimensions.w, newBitGrid->dimensions.h,
@@ -1417,145 +1555,796 @@ TBitGridDestroy(
 
 //
 
-void
-TBitGridFillCells(
-    TBitGrid    *bitGrid,
-    TCell       value
+/*
+ * @function __TBitGridGetCacheBytes
+ *
+ * Returns the size of the block of bitGrid's storage that runs from the row
+ * fill counts through the inverse row map (the column tops, hole counts, row
+ * transitions, row hashes and row map lie between).  Channel 0 immediately
+ * follows it; the constant row weights precede it.
+ */
+static inline size_t
+__TBitGridGetCacheBytes(
+    TBitGrid        *bitGrid
+)
+{
+    return (size_t)(bitGrid->grid[0].b8 - (uint8_t*)bitGrid->rowFillCounts);
+}
+
+/*
+ * @function __TBitGridGetCloneChannelCount
+ *
+ * Returns the number of channels a clone of bitGrid needs to hold channel 0
+ * and the channels of bitGrid selected by channelMask.
+ */
+static inline unsigned int
+__TBitGridGetCloneChannelCount(
+    TBitGrid        *bitGrid,
+    TCell           channelMask
 )
 {
-    unsigned int    channelIdx = 0, channelMask = 1;
+    unsigned int    nChannels = 1;
     
-    while ( channelIdx < bitGrid->dimensions.nChannels ) {
-        if ( value & channelMask )
-            memset(bitGrid->grid[channelIdx].b8, 0xFF, bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord);
-        else
-            memset(bitGrid->grid[channelIdx].b8, 0x00, bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord);
-        channelIdx++;
-        channelMask <<= 1;
-    }
+    channelMask &= (1 << bitGrid->dimensions.nChannels) - 1;
+    while ( channelMask >> nChannels ) nChannels++;
+    return nChannels;
 }
 
 //
 
-void
-TBitGridSetChannelInRowRange(
+size_t
+TBitGridGetCloneSize(
     TBitGrid        *bitGrid,
-    unsigned int    channelIdx,
-    unsigned int    jLow,
-    unsigned int    jHigh,
-    bool            value
+    TCell           channelMask
 )
 {
-    if ( channelIdx < bitGrid->dimensions.nChannels ) {
-        size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
-        unsigned int    nWholeBytes = bitGrid->dimensions.w / 8, nPartialBits = (1 << (bitGrid->dimensions.w % 8)) - 1;
-        uint8_t         *p = bitGrid->grid[channelIdx].b8 + jLow * nBytesPerRow,
-                        *pEnd = bitGrid->grid[channelIdx].b8 + (jHigh + 1) * nBytesPerRow;
-        
-        while ( p < pEnd ) {
-            if ( nWholeBytes ) memset(p, 0xFF, nWholeBytes);
-            if ( nPartialBits ) p[nWholeBytes] = nPartialBits;
-            p += nBytesPerRow;
+    unsigned int    nChannels = __TBitGridGetCloneChannelCount(bitGrid, channelMask);
+    size_t          channelBytes = bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord;
+    
+    return sizeof(TBitGrid) + nChannels * sizeof(TBitGridChannelPtr) + bitGrid->dimensions.h * sizeof(uint64_t) + __TBitGridGetCacheBytes(bitGrid) + nChannels * channelBytes + sizeof(uint64_t);
+}
+
+//
+
+TBitGrid*
+TBitGridCloneInit(
+    void            *storage,
+    TBitGrid        *bitGrid,
+    TCell           channelMask
+)
+{
+    TBitGrid        *clone = (TBitGrid*)storage;
+    unsigned int    nChannels = __TBitGridGetCloneChannelCount(bitGrid, channelMask);
+    size_t          cacheBytes = __TBitGridGetCacheBytes(bitGrid);
+    size_t          channelBytes = bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord;
+    uint8_t         *p = (uint8_t*)storage + sizeof(TBitGrid);
+    unsigned int    c = 0;
+    bool            isBorderNeeded = false;
+    
+    // Dimensions, scalar state and kernels come across as-is:
+    *clone = *bitGrid;
+    clone->dimensions.nChannels = nChannels;
+    
+    // The feature cache and row map keep their relative layout:
+    clone->grid = (TBitGridStorage)p; p += nChannels * sizeof(TBitGridChannelPtr);
+    clone->rowWeights = (uint64_t*)p;
+    memcpy(p, bitGrid->rowWeights, bitGrid->dimensions.h * sizeof(uint64_t));
+    p += bitGrid->dimensions.h * sizeof(uint64_t);
+    memcpy(p, bitGrid->rowFillCounts, cacheBytes);
+#define REBASE(F) clone->F = (void*)(p + ((uint8_t*)bitGrid->F - (uint8_t*)bitGrid->rowFillCounts))
+    REBASE(rowFillCounts);
+    REBASE(columnTops);
+    REBASE(columnHoles);
+    REBASE(rowTransitions);
+    REBASE(rowHashes);
+    REBASE(rowMap);
+    REBASE(rowSlots);
+#undef REBASE
+    p += cacheBytes;
+    
+    // Channel 0 and the selected channels are copied, the rest are emptied:
+    while ( c < nChannels ) {
+        clone->grid[c].b8 = p;
+        if ( (c == 0) || (channelMask & (1 << c)) ) {
+            memcpy(p, bitGrid->grid[c].b8, channelBytes);
+        } else {
+            memset(p, 0, channelBytes);
+            isBorderNeeded = true;
         }
+        p += channelBytes;
+        c++;
+    }
+    memset(p, 0, sizeof(uint64_t));
+    
+    // Emptied channels of a bordered grid need their walls back:
+    if ( isBorderNeeded && clone->dimensions.nBorderCols ) {
+        c = 0;
+        while ( c < clone->dimensions.h ) __TBitGridSetBorderInRow(clone, c++);
+        __TBitGridSetGuardRow(clone);
     }
+    
+    // The cell accessors depend on the channel count:
+    __TBitGridSetCellCallbacks(clone);
+    return clone;
 }
 
 //
 
-void
-TBitGridScroll(
+TBitGrid*
+TBitGridClone(
     TBitGrid        *bitGrid
 )
 {
-    size_t          nBytesMove = (bitGrid->dimensions.nWordsTotal - bitGrid->dimensions.nWordsPerRow) * bitGrid->dimensions.nBytesPerWord;
-    size_t          nBytesSet = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
-    unsigned int    channelIdx = bitGrid->dimensions.nChannels;
+    TCell           allChannels = (1 << bitGrid->dimensions.nChannels) - 1;
+    void            *storage = malloc(TBitGridGetCloneSize(bitGrid, allChannels));
     
-    while ( channelIdx-- ) {
-        void        *src = (void*)bitGrid->grid[channelIdx].b8, *dst = src + bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
-        memmove(dst, src, nBytesMove);
-        memset(src, 0, nBytesSet);
-    }
+    if ( storage ) return TBitGridCloneInit(storage, bitGrid, allChannels);
+    return NULL;
 }
 
 //
 
-void
-TBitGridClearLines(
-    TBitGrid        *bitGrid,
-    unsigned int    jLow,
-    unsigned int    jHigh
+bool
+TBitGridCopyInto(
+    TBitGrid        *dstGrid,
+    TBitGrid        *srcGrid,
+    TCell           channelMask
 )
 {
-    if ( jHigh < jLow ) return;
+    size_t          channelBytes = srcGrid->dimensions.nWordsTotal * srcGrid->dimensions.nBytesPerWord;
+    unsigned int    c = 1;
     
-    if ( jLow >= bitGrid->dimensions.h ) jLow = bitGrid->dimensions.h - 1;
-    if ( jHigh >= bitGrid->dimensions.h ) jHigh = bitGrid->dimensions.h - 1;
+    if ( (dstGrid->dimensions.w != srcGrid->dimensions.w) || (dstGrid->dimensions.h != srcGrid->dimensions.h) ||
+         (dstGrid->dimensions.nBitsPerWord != srcGrid->dimensions.nBitsPerWord) ||
+         (dstGrid->dimensions.nBorderCols != srcGrid->dimensions.nBorderCols) ) return false;
     
-    // Is it the entire bitGrid?
-    if ( (jLow == 0) && (jHigh >= bitGrid->dimensions.h - 1) ) {
-        unsigned int    channelIdx = bitGrid->dimensions.nChannels;
-        
-        while ( channelIdx-- )
-            memset((void*)bitGrid->grid[channelIdx].b8, 0, bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord);
-    } else {
-        if ( jLow == 0 ) {
-            // The region starts at the top row and extends down through the
-            // jHigh row.  It's just a memset:
-            unsigned int    channelIdx = bitGrid->dimensions.nChannels;
-        
-            while ( channelIdx-- )
-                memset((void*)bitGrid->grid[channelIdx].b8, 0, bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord * (jHigh - jLow + 1));
-        } else {
-            unsigned int    channelIdx = bitGrid->dimensions.nChannels;
-        
-            while ( channelIdx-- ) {
-                void        *dst = (void*)bitGrid->grid[channelIdx].b8 + (bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord * ((jHigh + 1) - jLow));
-            
-                // We will start by moving the leading rows (up to jLow) down above
-                // jHigh:
-                memmove(dst, (void*)bitGrid->grid[channelIdx].b8, bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord * jLow);
-            
-                // Then we have to zero-out everything up to dst:
-                memset((void*)bitGrid->grid[channelIdx].b8, 0, dst - (void*)bitGrid->grid[channelIdx].b8);
-            }
-        }
+    // The feature cache, the row map (and its inverse) and channel 0 are
+    // contiguous; the row weights are the same in both grids:
+    memcpy(dstGrid->rowFillCounts, srcGrid->rowFillCounts, __TBitGridGetCacheBytes(srcGrid) + channelBytes);
+    while ( (c < dstGrid->dimensions.nChannels) && (c < srcGrid->dimensions.nChannels) ) {
+        if ( channelMask & (1 << c) ) memcpy(dstGrid->grid[c].b8, srcGrid->grid[c].b8, channelBytes);
+        c++;
     }
+    dstGrid->nHoles = srcGrid->nHoles;
+    dstGrid->nRowTransitions = srcGrid->nRowTransitions;
+    dstGrid->hash = srcGrid->hash;
+    dstGrid->rowBase = srcGrid->rowBase;
+    dstGrid->dirtyRect = srcGrid->dirtyRect;
+    return true;
 }
 
 //
 
-static inline uint16_t
-__TBitGridExtract4x4AtPosition_8b(
+/*
+ * @function __TBitGridSnapshotPoolGetSnapshot
+ *
+ * Returns the snapshot in slot idx of pool's arena.
+ */
+static inline TBitGrid*
+__TBitGridSnapshotPoolGetSnapshot(
+    TBitGridSnapshotPool    *pool,
+    unsigned int            idx
+)
+{
+    return (TBitGrid*)(pool->arena + idx * pool->nBytesPerSnapshot);
+}
+
+//
+
+TBitGridSnapshotPool*
+TBitGridSnapshotPoolCreate(
     TBitGrid        *bitGrid,
-    unsigned int    channelIdx,
-    int             j0,
-    int             j4,
-    int             i0,
-    int             i4,
-    int             baseW,
-    int             baseb
+    TCell           channelMask,
+    unsigned int    nSnapshots
 )
 {
-    uint16_t        out4x4;
-    unsigned int    nRow = j4 - j0, nCol = i4 - i0, inRowbHi = baseb + nCol;
+    // Keep each snapshot on its own cache lines:
+    size_t                  nBytesPerSnapshot = (TBitGridGetCloneSize(bitGrid, channelMask) + 63) & ~(size_t)63;
+    size_t                  poolBytes = (sizeof(TBitGridSnapshotPool) + 63) & ~(size_t)63;
+    TBitGridSnapshotPool    *newPool = NULL;
     
-    // Extract nRow x nCol bits at W,b
-    if ( inRowbHi <= 8 ) {
-        //  All in a single word:
-        uint8_t     *grid = bitGrid->grid[channelIdx].b8 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
-        uint8_t     selectMask = (((uint8_t)1 << inRowbHi) - 1) ^ ((1 << baseb) - 1);
+    if ( nSnapshots < 1 ) return NULL;
+    if ( posix_memalign((void**)&newPool, 64, poolBytes + nSnapshots * nBytesPerSnapshot) == 0 ) {
+        unsigned int        idx = 0;
         
-        if ( nRow-- > 0 ) {
-            out4x4 = (*grid & selectMask) >> baseb;
-            if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
-                out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
-                if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+        newPool->channelMask = channelMask;
+        newPool->nSnapshots = nSnapshots;
+        newPool->nInUse = 0;
+        newPool->nBytesPerSnapshot = nBytesPerSnapshot;
+        newPool->arena = (uint8_t*)newPool + poolBytes;
+        
+        // Every slot starts out as a clone, so pushing a snapshot is only
+        // a copy of the grid's storage:
+        while ( idx < nSnapshots ) TBitGridCloneInit(__TBitGridSnapshotPoolGetSnapshot(newPool, idx++), bitGrid, channelMask);
+    }
+    return newPool;
+}
+
+//
+
+void
+TBitGridSnapshotPoolDestroy(
+    TBitGridSnapshotPool    *pool
+)
+{
+    free((void*)pool);
+}
+
+//
+
+TBitGrid*
+TBitGridSnapshotPoolPush(
+    TBitGridSnapshotPool    *pool,
+    TBitGrid                *bitGrid
+)
+{
+    TBitGrid                *snapshot;
+    
+    if ( pool->nInUse >= pool->nSnapshots ) return NULL;
+    snapshot = __TBitGridSnapshotPoolGetSnapshot(pool, pool->nInUse);
+    if ( ! TBitGridCopyInto(snapshot, bitGrid, pool->channelMask) ) return NULL;
+    pool->nInUse++;
+    return snapshot;
+}
+
+//
+
+bool
+TBitGridSnapshotPoolPop(
+    TBitGridSnapshotPool    *pool,
+    TBitGrid                *bitGrid
+)
+{
+    if ( pool->nInUse == 0 ) return false;
+    pool->nInUse--;
+    if ( bitGrid ) return TBitGridCopyInto(bitGrid, __TBitGridSnapshotPoolGetSnapshot(pool, pool->nInUse), pool->channelMask);
+    return true;
+}
+
+//
+
+/*
+ * @function __TBitGridIsSetAtPosition
+ *
+ * Returns true if the channel 0 bit of the cell at column i of row j of
+ * bitGrid is set.  Columns left and right of the grid are the walls, which
+ * count as set.
+ */
+static inline bool
+__TBitGridIsSetAtPosition(
+    TBitGrid        *bitGrid,
+    int             i,
+    unsigned int    j
+)
+{
+    if ( (i < 0) || (i >= (int)bitGrid->dimensions.w) ) return true;
+    return bitGrid->callbacks.getCellValueAtIndex(bitGrid, TBitGridPosToIndex(bitGrid, TGridPosMake(i, j))) & 0x1;
+}
+
+/*
+ * @function __TBitGridExtract6x4AtPosition
+ *
+ * Returns the channel 0 bits of columns P.i - 1 through P.i + 4 of rows P.j
+ * through P.j + 3 of bitGrid:  six bits per row, with column P.i - 1 in the
+ * low bit of each row's window.  Two overlapping 4x4s are extracted, so
+ * cells off the grid (the walls) are set.
+ */
+static inline uint32_t
+__TBitGridExtract6x4AtPosition(
+    TBitGrid        *bitGrid,
+    TGridPos        P
+)
+{
+    uint16_t        left4x4 = TBitGridExtract4x4AtPosition(bitGrid, 0, TGridPosMake(P.i - 1, P.j));
+    uint16_t        right4x4 = TBitGridExtract4x4AtPosition(bitGrid, 0, TGridPosMake(P.i + 2, P.j));
+    uint32_t        out6x4 = 0;
+    int             r = 0;
+    
+    while ( r < 4 ) {
+        out6x4 |= (uint32_t)((((left4x4 >> (4 * r)) & 0xF) | (((right4x4 >> (4 * r)) & 0x7) << 3))) << (6 * r);
+        r++;
+    }
+    return out6x4;
+}
+
+/*
+ * @function __TBitGridGetWindowTransitions
+ *
+ * Returns the number of neighboring bits that differ in a six-bit row
+ * window from __TBitGridExtract6x4AtPosition().
+ */
+static inline unsigned int
+__TBitGridGetWindowTransitions(
+    unsigned int    window
+)
+{
+    return __builtin_popcount((window ^ (window >> 1)) & 0x1F);
+}
+
+/*
+ * @function __TBitGridAddCellsToColumn
+ *
+ * Account for newly-set cells of a column in its top and hole count.  The
+ * cells are the bits of col4x4 (a column of a 4x4, i.e. any of bits 0, 4,
+ * 8 and 12) with the 4x4's first row at row jBase.  Each cell above the
+ * top turns the empty cells between it and the top into holes; each cell
+ * below the top fills a hole.
+ */
+static inline void
+__TBitGridAddCellsToColumn(
+    unsigned int    *top,
+    unsigned int    *holes,
+    int             jBase,
+    uint16_t        col4x4
+)
+{
+    while ( col4x4 ) {
+        unsigned int    j = jBase + __builtin_ctz(col4x4) / 4;
+        
+        if ( j > *top ) {
+            (*holes)--;
+        } else {
+            *holes += *top - j - 1;
+            *top = j;
+        }
+        col4x4 &= col4x4 - 1;
+    }
+}
+
+/*
+ * @function __TBitGridRescanColumnHoles
+ *
+ * Recount the holes below the top of column i of bitGrid.  The column is
+ * extracted four rows at a time; rows below the grid extract as set, so
+ * they are not counted.
+ */
+static void
+__TBitGridRescanColumnHoles(
+    TBitGrid        *bitGrid,
+    unsigned int    i
+)
+{
+    unsigned int    j = bitGrid->columnTops[i] + 1, nHoles = 0;
+    
+    while ( j < bitGrid->dimensions.h ) {
+        nHoles += 4 - __builtin_popcount(TBitGridExtract4x4AtPosition(bitGrid, 0, TGridPosMake(i, j)) & 0x1111);
+        j += 4;
+    }
+    bitGrid->nHoles += nHoles - bitGrid->columnHoles[i];
+    bitGrid->columnHoles[i] = nHoles;
+}
+
+//
+
+/*
+ * @function __TBitGridGetColumnKey
+ *
+ * Returns the Zobrist key of column i:  the SplitMix64 output for i, so the
+ * keys are the same in every grid without a table to initialize.
+ */
+static inline uint64_t
+__TBitGridGetColumnKey(
+    unsigned int    i
+)
+{
+    uint64_t        z = (uint64_t)(i + 1) * 0x9E3779B97F4A7C15ULL;
+    
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * @function __TBitGridGetFullRowKey
+ *
+ * Returns the key of a row of bitGrid with every column set.
+ */
+static uint64_t
+__TBitGridGetFullRowKey(
+    TBitGrid        *bitGrid
+)
+{
+    uint64_t        rowKey = 0;
+    unsigned int    i = 0;
+    
+    while ( i < bitGrid->dimensions.w ) rowKey ^= __TBitGridGetColumnKey(i++);
+    return rowKey;
+}
+
+/*
+ * @function __TBitGridSetRowKey
+ *
+ * Replace the key of logical row j (held in physical row physRow) of bitGrid
+ * and update the board hash to match.
+ */
+static inline void
+__TBitGridSetRowKey(
+    TBitGrid        *bitGrid,
+    unsigned int    j,
+    unsigned int    physRow,
+    uint64_t        rowKey
+)
+{
+    bitGrid->hash += (rowKey - bitGrid->rowHashes[physRow]) * bitGrid->rowWeights[j];
+    bitGrid->rowHashes[physRow] = rowKey;
+}
+
+//
+
+void
+TBitGridUpdateCellFeatures(
+    TBitGrid        *bitGrid,
+    TGridPos        P,
+    bool            wasSet,
+    bool            isSet
+)
+{
+    unsigned int    *top = &bitGrid->columnTops[P.i], *holes = &bitGrid->columnHoles[P.i];
+    unsigned int    physRow = TBitGridGetPhysicalRow(bitGrid, P.j);
+    bool            neighbors[2];
+    int             n = 0;
+    
+    if ( wasSet == isSet ) return;
+    
+    __TBitGridSetRowKey(bitGrid, P.j, physRow, bitGrid->rowHashes[physRow] ^ __TBitGridGetColumnKey(P.i));
+    
+    bitGrid->nHoles -= *holes;
+    if ( isSet ) {
+        __TBitGridAddCellsToColumn(top, holes, P.j, 0x1);
+    } else if ( (unsigned int)P.j > *top ) {
+        (*holes)++;
+    } else {
+        // The top was cleared; the holes between it and the next set cell
+        // down are open now:
+        TBitGridRescanColumnTop(bitGrid, P.i);
+        *holes -= *top - P.j - 1;
+    }
+    bitGrid->nHoles += *holes;
+    
+    // A neighbor that now matches the cell was a transition and no longer
+    // is, and vice versa:
+    neighbors[0] = __TBitGridIsSetAtPosition(bitGrid, P.i - 1, P.j);
+    neighbors[1] = __TBitGridIsSetAtPosition(bitGrid, P.i + 1, P.j);
+    while ( n < 2 ) {
+        if ( neighbors[n] == isSet ) {
+            bitGrid->rowTransitions[physRow]--;
+            bitGrid->nRowTransitions--;
+        } else {
+            bitGrid->rowTransitions[physRow]++;
+            bitGrid->nRowTransitions++;
+        }
+        n++;
+    }
+}
+
+//
+
+/*
+ * @function __TBitGridSetColumnTopsInRowRange
+ *
+ * Account for the channel 0 bits of every cell in rows [jLow,jHigh] of
+ * bitGrid having been set to value in the column tops and hole counts.
+ * Any column can gain or lose holes, so every column is rescanned; this
+ * is not meant for hot paths.
+ */
+static void
+__TBitGridSetColumnTopsInRowRange(
+    TBitGrid        *bitGrid,
+    unsigned int    jLow,
+    unsigned int    jHigh,
+    bool            value
+)
+{
+    unsigned int    i = 0;
+    
+    if ( jHigh >= bitGrid->dimensions.h ) jHigh = bitGrid->dimensions.h - 1;
+    while ( i < bitGrid->dimensions.w ) {
+        if ( value ) {
+            if ( jLow < bitGrid->columnTops[i] ) bitGrid->columnTops[i] = jLow;
+        } else if ( (bitGrid->columnTops[i] >= jLow) && (bitGrid->columnTops[i] <= jHigh) ) {
+            bitGrid->columnTops[i] = jHigh + 1;
+            TBitGridRescanColumnTop(bitGrid, i);
+        }
+        __TBitGridRescanColumnHoles(bitGrid, i);
+        i++;
+    }
+}
+
+//
+
+void
+TBitGridFillCells(
+    TBitGrid    *bitGrid,
+    TCell       value
+)
+{
+    unsigned int    channelIdx = 0, channelMask = 1, j = 0;
+    unsigned int    rowFillCount = (value & 0x1) ? bitGrid->dimensions.w : 0;
+    unsigned int    columnTop = (value & 0x1) ? 0 : bitGrid->dimensions.h, i = 0;
+    unsigned int    rowTransitions = (value & 0x1) ? 0 : 2;
+    uint64_t        rowKey = (value & 0x1) ? __TBitGridGetFullRowKey(bitGrid) : 0;
+    
+    bitGrid->hash = 0;
+    while ( channelIdx < bitGrid->dimensions.nChannels ) {
+        if ( value & channelMask )
+            memset(bitGrid->grid[channelIdx].b8, 0xFF, bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord);
+        else
+            memset(bitGrid->grid[channelIdx].b8, 0x00, bitGrid->dimensions.nWordsTotal * bitGrid->dimensions.nBytesPerWord);
+        channelIdx++;
+        channelMask <<= 1;
+    }
+    while ( j < bitGrid->dimensions.h ) {
+        bitGrid->rowFillCounts[j] = rowFillCount;
+        bitGrid->rowTransitions[j] = rowTransitions;
+        bitGrid->rowHashes[j] = rowKey;
+        bitGrid->hash += rowKey * bitGrid->rowWeights[j++];
+    }
+    bitGrid->nRowTransitions = rowTransitions * bitGrid->dimensions.h;
+    memset(bitGrid->columnHoles, 0, bitGrid->dimensions.w * sizeof(unsigned int));
+    bitGrid->nHoles = 0;
+    while ( i < bitGrid->dimensions.w ) bitGrid->columnTops[i++] = columnTop;
+    TBitGridAddDirtyRect(bitGrid, TGridRectMake(0, 0, bitGrid->dimensions.w - 1, bitGrid->dimensions.h - 1));
+    
+    // Restore the walls:
+    if ( bitGrid->dimensions.nBorderCols ) {
+        j = 0;
+        while ( j < bitGrid->dimensions.h ) __TBitGridSetBorderInRow(bitGrid, j++);
+        __TBitGridSetGuardRow(bitGrid);
+    }
+}
+
+//
+
+void
+TBitGridSetChannelInRowRange(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    unsigned int    jLow,
+    unsigned int    jHigh,
+    bool            value
+)
+{
+    if ( channelIdx < bitGrid->dimensions.nChannels ) {
+        size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+        unsigned int    nWholeBytes = bitGrid->dimensions.w / 8, nPartialBits = (1 << (bitGrid->dimensions.w % 8)) - 1;
+        unsigned int    jStart = jLow;
+        uint64_t        rowKey = (value && (channelIdx == 0)) ? __TBitGridGetFullRowKey(bitGrid) : 0;
+        
+        if ( jLow <= jHigh ) TBitGridAddDirtyRect(bitGrid, TGridRectMake(0, jLow, bitGrid->dimensions.w - 1, jHigh));
+        while ( jLow <= jHigh ) {
+            unsigned int    physRow = TBitGridGetPhysicalRow(bitGrid, jLow);
+            uint8_t         *p = bitGrid->grid[channelIdx].b8 + physRow * nBytesPerRow;
+            
+            if ( bitGrid->dimensions.nBorderCols ) {
+                // The guard bits are set, too:
+                memset(p, value ? 0xFF : 0x00, nBytesPerRow);
+                if ( ! value ) __TBitGridSetBorderInRow(bitGrid, physRow);
+            } else if ( value ) {
+                if ( nWholeBytes ) memset(p, 0xFF, nWholeBytes);
+                if ( nPartialBits ) p[nWholeBytes] = nPartialBits;
+            } else {
+                memset(p, 0x00, nBytesPerRow);
+            }
+            if ( channelIdx == 0 ) {
+                bitGrid->rowFillCounts[physRow] = value ? bitGrid->dimensions.w : 0;
+                bitGrid->nRowTransitions -= bitGrid->rowTransitions[physRow];
+                bitGrid->rowTransitions[physRow] = value ? 0 : 2;
+                bitGrid->nRowTransitions += bitGrid->rowTransitions[physRow];
+                __TBitGridSetRowKey(bitGrid, jLow, physRow, rowKey);
+            }
+            jLow++;
+        }
+        if ( (channelIdx == 0) && (jStart <= jHigh) ) __TBitGridSetColumnTopsInRowRange(bitGrid, jStart, jHigh, value);
+    }
+}
+
+//
+
+void
+TBitGridRescanColumnTop(
+    TBitGrid        *bitGrid,
+    unsigned int    i
+)
+{
+    unsigned int    j = bitGrid->columnTops[i];
+    
+    while ( (j < bitGrid->dimensions.h) && ! (bitGrid->callbacks.getCellValueAtIndex(bitGrid, TBitGridPosToIndex(bitGrid, TGridPosMake(i, j))) & 0x1) ) j++;
+    bitGrid->columnTops[i] = j;
+}
+
+//
+
+void
+TBitGridScroll(
+    TBitGrid        *bitGrid
+)
+{
+    // Scrolling is just the removal of the bottom row:
+    TBitGridClearLines(bitGrid, bitGrid->dimensions.h - 1, bitGrid->dimensions.h - 1);
+}
+
+//
+
+/*
+ * @function __TBitGridRowMapReverse
+ *
+ * Reverse the order of logical rows [jLow,jHigh] in the row map of bitGrid,
+ * keeping the mirror half of the ring and the inverse map in step.
+ */
+static inline void
+__TBitGridRowMapReverse(
+    TBitGrid        *bitGrid,
+    unsigned int    jLow,
+    unsigned int    jHigh
+)
+{
+    unsigned int    h = bitGrid->dimensions.h;
+    unsigned int    *rowMap = bitGrid->rowMap;
+    
+    while ( jLow < jHigh ) {
+        unsigned int    sLow = bitGrid->rowBase + jLow, sHigh = bitGrid->rowBase + jHigh;
+        unsigned int    swap;
+        
+        // Work in ring slots [0,h); the mirror entries are h further on:
+        if ( sLow >= h ) sLow -= h;
+        if ( sHigh >= h ) sHigh -= h;
+        swap = rowMap[sLow];
+        rowMap[sLow] = rowMap[sLow + h] = rowMap[sHigh];
+        rowMap[sHigh] = rowMap[sHigh + h] = swap;
+        
+        // Update the inverse map:
+        bitGrid->rowSlots[rowMap[sLow]] = sLow;
+        bitGrid->rowSlots[swap] = sHigh;
+        jLow++, jHigh--;
+    }
+}
+
+void
+TBitGridClearLines(
+    TBitGrid        *bitGrid,
+    unsigned int    jLow,
+    unsigned int    jHigh
+)
+{
+    unsigned int    h = bitGrid->dimensions.h, nRows, j;
+    size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+    
+    if ( jHigh < jLow ) return;
+    
+    if ( jLow >= h ) jLow = h - 1;
+    if ( jHigh >= h ) jHigh = h - 1;
+    nRows = jHigh - jLow + 1;
+    
+    // Every row from the head of the grid through jHigh changes:
+    TBitGridAddDirtyRect(bitGrid, TGridRectMake(0, 0, bitGrid->dimensions.w - 1, jHigh));
+    
+    // The removed rows drop out of the hash and the rows above them move down
+    // nRows, which multiplies their part of the hash by P^nRows.  Sum the
+    // removed rows and whichever side of them is shorter:
+    {
+        uint64_t    removedHash = 0, sideHash = 0;
+        
+        j = jLow;
+        while ( j <= jHigh ) {
+            removedHash += bitGrid->rowHashes[TBitGridGetPhysicalRow(bitGrid, j)] * bitGrid->rowWeights[j];
+            j++;
+        }
+        if ( jLow <= h - 1 - jHigh ) {
+            j = 0;
+            while ( j < jLow ) {
+                sideHash += bitGrid->rowHashes[TBitGridGetPhysicalRow(bitGrid, j)] * bitGrid->rowWeights[j];
+                j++;
+            }
+            bitGrid->hash -= removedHash;
+            if ( jLow > 0 ) bitGrid->hash += sideHash * (bitGrid->rowWeights[nRows] - 1);
+        } else {
+            j = jHigh + 1;
+            while ( j < h ) {
+                sideHash += bitGrid->rowHashes[TBitGridGetPhysicalRow(bitGrid, j)] * bitGrid->rowWeights[j];
+                j++;
+            }
+            bitGrid->hash = (bitGrid->hash - removedHash - sideHash) * bitGrid->rowWeights[nRows] + sideHash;
+        }
+    }
+    
+    // Empty the physical rows being removed; they will be reused as the rows
+    // of zeroes introduced at the head of the grid.  The empty cells of a
+    // removed row were holes in every column topped above it (a full row has
+    // none):
+    j = jLow;
+    while ( j <= jHigh ) {
+        unsigned int    physRow = TBitGridGetPhysicalRow(bitGrid, j);
+        unsigned int    channelIdx = bitGrid->dimensions.nChannels;
+        
+        if ( bitGrid->rowFillCounts[physRow] < bitGrid->dimensions.w ) {
+            unsigned int    i = 0;
+            
+            while ( i < bitGrid->dimensions.w ) {
+                if ( (bitGrid->columnTops[i] < jLow) && ! __TBitGridIsSetAtPosition(bitGrid, i, j) ) {
+                    bitGrid->columnHoles[i]--;
+                    bitGrid->nHoles--;
+                }
+                i++;
+            }
+        }
+        while ( channelIdx-- )
+            memset((void*)bitGrid->grid[channelIdx].b8 + physRow * nBytesPerRow, 0, nBytesPerRow);
+        if ( bitGrid->dimensions.nBorderCols ) __TBitGridSetBorderInRow(bitGrid, physRow);
+        bitGrid->rowFillCounts[physRow] = 0;
+        bitGrid->nRowTransitions += 2 - bitGrid->rowTransitions[physRow];
+        bitGrid->rowTransitions[physRow] = 2;
+        bitGrid->rowHashes[physRow] = 0;
+        j++;
+    }
+    
+    // Rotate the emptied rows to the head of the grid.  If fewer rows lie above
+    // the range than below it, rotate [0,jHigh] so the emptied rows come first.
+    // Otherwise rotate [jLow,h-1] so the emptied rows come last and then turn
+    // the ring back by nRows so they wrap around to the head:
+    if ( jLow == 0 ) {
+        __TBitGridSetColumnTopsInRowRange(bitGrid, jLow, jHigh, false);
+        return;
+    }
+    if ( jLow <= h - 1 - jHigh ) {
+        __TBitGridRowMapReverse(bitGrid, 0, jHigh);
+        __TBitGridRowMapReverse(bitGrid, 0, nRows - 1);
+        __TBitGridRowMapReverse(bitGrid, nRows, jHigh);
+    } else {
+        __TBitGridRowMapReverse(bitGrid, jLow, h - 1);
+        __TBitGridRowMapReverse(bitGrid, jLow, h - 1 - nRows);
+        __TBitGridRowMapReverse(bitGrid, h - nRows, h - 1);
+        bitGrid->rowBase = (bitGrid->rowBase + h - nRows) % h;
+    }
+    
+    // Column tops above the removed rows move down with their rows; a top
+    // inside the removed rows is rescanned from below them, along with the
+    // column's holes:
+    j = 0;
+    while ( j < bitGrid->dimensions.w ) {
+        if ( bitGrid->columnTops[j] < jLow ) {
+            bitGrid->columnTops[j] += nRows;
+        } else if ( bitGrid->columnTops[j] <= jHigh ) {
+            bitGrid->columnTops[j] = jHigh + 1;
+            TBitGridRescanColumnTop(bitGrid, j);
+            __TBitGridRescanColumnHoles(bitGrid, j);
+        }
+        j++;
+    }
+}
+
+//
+
+static inline uint16_t
+__TBitGridExtract4x4AtPosition_8b(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    int             j0,
+    int             j4,
+    int             i0,
+    int             i4,
+    int             baseW,
+    int             baseb
+)
+{
+    uint16_t        out4x4;
+    unsigned int    nRow = j4 - j0, nCol = i4 - i0, inRowbHi = baseb + nCol;
+    
+    // Extract nRow x nCol bits at W,b
+    if ( inRowbHi <= 8 ) {
+        //  All in a single word:
+        uint8_t     *channel = bitGrid->grid[channelIdx].b8 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
+        uint8_t     selectMask = (((uint8_t)1 << inRowbHi) - 1) ^ ((1 << baseb) - 1);
+        
+        if ( nRow-- > 0 ) {
+            out4x4 = (*grid & selectMask) >> baseb;
+            if ( nRow-- > 0 ) {
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
+                out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
+                if ( nRow-- > 0 ) {
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     }
                 }
@@ -1563,20 +2352,20 @@ __TBitGridExtract4x4AtPosition_8b(
         }
     } else {
         // Split across two words:
-        uint8_t     *grid = bitGrid->grid[channelIdx].b8 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
+        uint8_t     *channel = bitGrid->grid[channelIdx].b8 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
         uint8_t     selectMask0 = ((uint8_t)0xFF << baseb), selectMask1 = ((uint8_t)0xFF >> (8 - (inRowbHi - 8)));
         int         shift1 = nCol - (inRowbHi - 8);
         
         if ( nRow-- > 0 ) {
             out4x4 = ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     }
                 }
@@ -1604,19 +2393,19 @@ __TBitGridExtract4x4AtPosition_16b(
     // Extract nRow x nCol bits at W,b
     if ( inRowbHi <= 16 ) {
         //  All in a single word:
-        uint16_t    *grid = bitGrid->grid[channelIdx].b16 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
+        uint16_t    *channel = bitGrid->grid[channelIdx].b16 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
         uint16_t    selectMask = (((uint8_t)1 << inRowbHi) - 1) ^ ((1 << baseb) - 1);
         
         if ( nRow-- > 0 ) {
             out4x4 = (*grid & selectMask) >> baseb;
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     }
                 }
@@ -1624,20 +2413,20 @@ __TBitGridExtract4x4AtPosition_16b(
         }
     } else {
         // Split across two words:
-        uint16_t    *grid = bitGrid->grid[channelIdx].b16 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
+        uint16_t    *channel = bitGrid->grid[channelIdx].b16 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
         uint16_t     selectMask0 = ((uint16_t)0xFFFF << baseb), selectMask1 = ((uint16_t)0xFFFF >> (16 - (inRowbHi - 16)));
         int         shift1 = nCol - (inRowbHi - 16);
         
         if ( nRow-- > 0 ) {
             out4x4 = ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     }
                 }
@@ -1665,19 +2454,19 @@ __TBitGridExtract4x4AtPosition_32b(
     // Extract nRow x nCol bits at W,b
     if ( inRowbHi <= 32 ) {
         //  All in a single word:
-        uint32_t    *grid = bitGrid->grid[channelIdx].b32 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
-        uint32_t    selectMask = (((uint32_t)1 << inRowbHi) - 1) ^ ((1 << baseb) - 1);
+        uint32_t    *channel = bitGrid->grid[channelIdx].b32 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
+        uint32_t    selectMask = ((inRowbHi < 32) ? (((uint32_t)1 << inRowbHi) - 1) : ~(uint32_t)0) ^ (((uint32_t)1 << baseb) - 1);
         
         if ( nRow-- > 0 ) {
             out4x4 = (*grid & selectMask) >> baseb;
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     }
                 }
@@ -1685,20 +2474,20 @@ __TBitGridExtract4x4AtPosition_32b(
         }
     } else {
         // Split across two words:
-        uint32_t    *grid = bitGrid->grid[channelIdx].b32 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
+        uint32_t    *channel = bitGrid->grid[channelIdx].b32 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
         uint32_t    selectMask0 = ((uint32_t)0xFFFFFFFF << baseb), selectMask1 = ((uint32_t)0xFFFFFFFF >> (32 - (inRowbHi - 32)));
         int         shift1 = nCol - (inRowbHi - 32);
         
         if ( nRow-- > 0 ) {
             out4x4 = ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     }
                 }
@@ -1726,19 +2515,19 @@ __TBitGridExtract4x4AtPosition_64b(
     // Extract nRow x nCol bits at W,b
     if ( inRowbHi <= 64 ) {
         //  All in a single word:
-        uint64_t    *grid = bitGrid->grid[channelIdx].b64 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
-        uint64_t    selectMask = (((uint64_t)1 << inRowbHi) - 1) ^ ((1 << baseb) - 1);
+        uint64_t    *channel = bitGrid->grid[channelIdx].b64 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
+        uint64_t    selectMask = ((inRowbHi < 64) ? (((uint64_t)1 << inRowbHi) - 1) : ~(uint64_t)0) ^ (((uint64_t)1 << baseb) - 1);
         
         if ( nRow-- > 0 ) {
             out4x4 = (*grid & selectMask) >> baseb;
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | (*grid & selectMask) >> baseb;
                     }
                 }
@@ -1746,20 +2535,20 @@ __TBitGridExtract4x4AtPosition_64b(
         }
     } else {
         // Split across two words:
-        uint64_t    *grid = bitGrid->grid[channelIdx].b64 + baseW + ((nRow - 1) * bitGrid->dimensions.nWordsPerRow);
+        uint64_t    *channel = bitGrid->grid[channelIdx].b64 + baseW, *grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
         uint64_t    selectMask0 = ((uint64_t)0xFFFFFFFFFFFFFFFF << baseb), selectMask1 = ((uint64_t)0xFFFFFFFFFFFFFFFF >> (64 - (inRowbHi - 64)));
         int         shift1 = nCol - (inRowbHi - 64);
         
         if ( nRow-- > 0 ) {
             out4x4 = ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
             if ( nRow-- > 0 ) {
-                grid -= bitGrid->dimensions.nWordsPerRow;
+                grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                 out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                 if ( nRow-- > 0 ) {
-                    grid -= bitGrid->dimensions.nWordsPerRow;
+                    grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                     out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     if ( nRow-- > 0 ) {
-                        grid -= bitGrid->dimensions.nWordsPerRow;
+                        grid = channel + TBitGridGetRowWordOffset(bitGrid, --j4);
                         out4x4 = (out4x4 << 4) | ((*grid & selectMask0) >> baseb) | ((*(grid+1) & selectMask1) << shift1);
                     }
                 }
@@ -1769,8 +2558,8 @@ __TBitGridExtract4x4AtPosition_64b(
     return out4x4;
 }
 
-uint16_t
-TBitGridExtract4x4AtPosition(
+static uint16_t
+__TBitGridExtract4x4AtPosition_Portable(
     TBitGrid        *bitGrid,
     unsigned int    channelIdx,
     TGridPos        P
@@ -1780,7 +2569,7 @@ TBitGridExtract4x4AtPosition(
     int         baseW, baseb;
     int         i0, i4, j0, j4;
     
-    if ( channelIdx > bitGrid->dimensions.nChannels ) return 0xFFFF;
+    if ( channelIdx >= bitGrid->dimensions.nChannels ) return 0xFFFF;
     
     // Off-grid:
     if ( P.i < -3 || P.j < -3 ) return 0xFFFF;
@@ -1793,9 +2582,9 @@ TBitGridExtract4x4AtPosition(
     i4 = P.i + 4; if ( i4 > bitGrid->dimensions.w ) i4 = bitGrid->dimensions.w;
     i0 = (P.i < 0) ? 0 : P.i;
     
-    // Calculate the word/bit offset at which we'll start extracting bits:
-    baseW  = j0 * bitGrid->dimensions.nWordsPerRow +
-             i0 / bitGrid->dimensions.nBitsPerWord;
+    // Calculate the word/bit offset within each row at which we'll start
+    // extracting bits (the kernels locate each row through the row map):
+    baseW  = i0 / bitGrid->dimensions.nBitsPerWord;
     baseb = i0 % bitGrid->dimensions.nBitsPerWord;
     
     switch ( bitGrid->dimensions.nBitsPerWord ) {
@@ -1838,13 +2627,243 @@ TBitGridExtract4x4AtPosition(
     return out4x4;
 }
 
-//
-
-void
-__TBitGridSet4x4AtPosition_8b(
+#ifdef TBITGRID_HAVE_BMI2_KERNEL
+
+/*
+ * @function __TBitGridExtract4x4AtPosition_BMI2
+ *
+ * On x86-64 the bits of a row are a little-endian bit string regardless of
+ * the word size, so the four bits at column i of a row are always found in
+ * the 16-bit value at byte i / 8 of the row.  Each row's 16 bits are loaded
+ * into a 16-bit lane of a 64-bit word and a single PEXT packs the four
+ * nibbles.  Off-grid rows and columns are then set with a couple of masks
+ * rather than by loops.
+ *
+ * A 16-bit load at the last byte of a row reads one byte beyond it; that
+ * byte only ever feeds columns past the right edge (which are forced on)
+ * and the channel storage is padded so the read never leaves the grid's
+ * allocation.
+ */
+static uint16_t __attribute__((target("bmi2")))
+__TBitGridExtract4x4AtPosition_BMI2(
     TBitGrid        *bitGrid,
     unsigned int    channelIdx,
-    int             iLo,
+    TGridPos        P
+)
+{
+    int             w = bitGrid->dimensions.w, h = bitGrid->dimensions.h;
+    size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+    unsigned int    *rows = bitGrid->rowMap + bitGrid->rowBase;
+    unsigned int    i0, r = 0;
+    uint8_t         *channel;
+    uint64_t        gathered = 0;
+    uint16_t        out4x4, offGrid4x4 = 0;
+    
+    if ( channelIdx >= bitGrid->dimensions.nChannels ) return 0xFFFF;
+    
+    // Off-grid:
+    if ( P.i < -3 || P.j < -3 || P.i >= w || P.j >= h ) return 0xFFFF;
+    
+    i0 = (P.i < 0) ? 0 : P.i;
+    channel = bitGrid->grid[channelIdx].b8 + i0 / 8;
+    
+    // Gather the rows; rows off the top or bottom are entirely set:
+    while ( r < 4 ) {
+        int         j = P.j + r;
+        
+        if ( j >= 0 && j < h ) {
+            uint16_t    rowBits;
+            
+            memcpy(&rowBits, channel + rows[j] * nBytesPerRow, sizeof(rowBits));
+            gathered |= (uint64_t)rowBits << (16 * r);
+        } else {
+            offGrid4x4 |= 0xF << (4 * r);
+        }
+        r++;
+    }
+    out4x4 = _pext_u64(gathered, 0x000F000F000F000FULL << (i0 % 8));
+    
+    // Columns off the left edge:  shift each row right on the board and fill
+    // in set bits:
+    if ( P.i < 0 ) {
+        unsigned int    s = -P.i;
+        
+        out4x4 = ((out4x4 << s) & (0x1111 * ((0xF << s) & 0xF))) | (0x1111 * ((1 << s) - 1));
+    }
+    
+    // Columns off the right edge:
+    if ( P.i + 4 > w ) out4x4 |= 0x1111 * ((0xF << (w - P.i)) & 0xF);
+    
+    return out4x4 | offGrid4x4;
+}
+
+#endif /* TBITGRID_HAVE_BMI2_KERNEL */
+
+/*
+ * @function __TBitGridExtract4x4AtPosition_Bordered
+ *
+ * Extraction for a grid with a sentinel border.  Every position from (-3,-3)
+ * on has its four columns within the guard columns of each row, and any row
+ * above or below the grid is read from the guard row, so the walls come
+ * straight out of storage.  The rows are read as little-endian bit strings
+ * (bordered grids only exist on little-endian hosts) using 16-bit loads that
+ * may overrun a row by one byte, as in the BMI2 kernel.
+ */
+static uint16_t
+__TBitGridExtract4x4AtPosition_Bordered(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    TGridPos        P
+)
+{
+    unsigned int    h = bitGrid->dimensions.h;
+    size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+    unsigned int    *rowMap = bitGrid->rowMap;
+    unsigned int    bit, r = 0;
+    uint8_t         *channel;
+    uint16_t        out4x4 = 0;
+    
+    if ( channelIdx >= bitGrid->dimensions.nChannels ) return 0xFFFF;
+    
+    // Off-grid:
+    if ( P.i < -3 || P.j < -3 || P.i >= (int)bitGrid->dimensions.w || P.j >= (int)h ) return 0xFFFF;
+    
+    bit = P.i + bitGrid->dimensions.nBorderCols;
+    channel = bitGrid->grid[channelIdx].b8 + bit / 8;
+    while ( r < 4 ) {
+        // Rows above the top wrap around to huge values and select the guard
+        // row just as rows below the bottom do:
+        unsigned int    j = P.j + r;
+        uint16_t        rowBits;
+        
+        memcpy(&rowBits, channel + rowMap[(j < h) ? bitGrid->rowBase + j : 2 * h] * nBytesPerRow, sizeof(rowBits));
+        out4x4 |= ((rowBits >> (bit % 8)) & 0xF) << (4 * r);
+        r++;
+    }
+    return out4x4;
+}
+
+#ifdef TBITGRID_HAVE_BMI2_KERNEL
+
+/*
+ * @function __TBitGridExtract4x4AtPosition_BorderedBMI2
+ *
+ * The bordered kernel with the four rows packed by a single PEXT.
+ */
+static uint16_t __attribute__((target("bmi2")))
+__TBitGridExtract4x4AtPosition_BorderedBMI2(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    TGridPos        P
+)
+{
+    unsigned int    h = bitGrid->dimensions.h;
+    size_t          nBytesPerRow = bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
+    unsigned int    *rowMap = bitGrid->rowMap;
+    unsigned int    bit, r = 0;
+    uint8_t         *channel;
+    uint64_t        gathered = 0;
+    
+    if ( channelIdx >= bitGrid->dimensions.nChannels ) return 0xFFFF;
+    
+    // Off-grid:
+    if ( P.i < -3 || P.j < -3 || P.i >= (int)bitGrid->dimensions.w || P.j >= (int)h ) return 0xFFFF;
+    
+    bit = P.i + bitGrid->dimensions.nBorderCols;
+    channel = bitGrid->grid[channelIdx].b8 + bit / 8;
+    while ( r < 4 ) {
+        unsigned int    j = P.j + r;
+        uint16_t        rowBits;
+        
+        memcpy(&rowBits, channel + rowMap[(j < h) ? bitGrid->rowBase + j : 2 * h] * nBytesPerRow, sizeof(rowBits));
+        gathered |= (uint64_t)rowBits << (16 * r);
+        r++;
+    }
+    return _pext_u64(gathered, 0x000F000F000F000FULL << (bit % 8));
+}
+
+/*
+ * @function __TBitGridBMI2IsFast
+ *
+ * Returns true if the processor implements BMI2 and PEXT is not one of
+ * the microcoded (very slow) implementations of AMD's cores before Zen 3
+ * (family 19h).
+ */
+static bool
+__TBitGridBMI2IsFast(void)
+{
+    unsigned int    eax, ebx, ecx, edx, family;
+    
+    if ( ! __builtin_cpu_supports("bmi2") ) return false;
+    if ( __builtin_cpu_is("amd") ) {
+        if ( ! __get_cpuid(1, &eax, &ebx, &ecx, &edx) ) return false;
+        family = (eax >> 8) & 0xF;
+        if ( family == 0xF ) family += (eax >> 20) & 0xFF;
+        if ( family < 0x19 ) return false;
+    }
+    return true;
+}
+
+#endif /* TBITGRID_HAVE_BMI2_KERNEL */
+
+//
+
+bool
+TBitGridSetExtractKernel(
+    TBitGrid                *bitGrid,
+    TBitGridExtractKernel   kernel
+)
+{
+    bool        isBordered = (bitGrid->dimensions.nBorderCols != 0);
+    
+    switch ( kernel ) {
+        case TBitGridExtractKernelDefault:
+#ifdef TBITGRID_HAVE_BMI2_KERNEL
+            if ( __TBitGridBMI2IsFast() ) {
+                bitGrid->callbacks.extract4x4AtPosition = isBordered ? __TBitGridExtract4x4AtPosition_BorderedBMI2 : __TBitGridExtract4x4AtPosition_BMI2;
+                return true;
+            }
+#endif
+            bitGrid->callbacks.extract4x4AtPosition = isBordered ? __TBitGridExtract4x4AtPosition_Bordered : __TBitGridExtract4x4AtPosition_Portable;
+            return true;
+            
+        case TBitGridExtractKernelPortable:
+            bitGrid->callbacks.extract4x4AtPosition = isBordered ? __TBitGridExtract4x4AtPosition_Bordered : __TBitGridExtract4x4AtPosition_Portable;
+            return true;
+            
+        case TBitGridExtractKernelBMI2:
+#ifdef TBITGRID_HAVE_BMI2_KERNEL
+            if ( __builtin_cpu_supports("bmi2") ) {
+                bitGrid->callbacks.extract4x4AtPosition = isBordered ? __TBitGridExtract4x4AtPosition_BorderedBMI2 : __TBitGridExtract4x4AtPosition_BMI2;
+                return true;
+            }
+#endif
+            break;
+    }
+    return false;
+}
+
+//
+
+TBitGridExtractKernel
+TBitGridGetExtractKernel(
+    TBitGrid        *bitGrid
+)
+{
+#ifdef TBITGRID_HAVE_BMI2_KERNEL
+    if ( bitGrid->callbacks.extract4x4AtPosition == __TBitGridExtract4x4AtPosition_BMI2 ||
+         bitGrid->callbacks.extract4x4AtPosition == __TBitGridExtract4x4AtPosition_BorderedBMI2 ) return TBitGridExtractKernelBMI2;
+#endif
+    return TBitGridExtractKernelPortable;
+}
+
+//
+
+void
+__TBitGridSet4x4AtPosition_8b(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    int             iLo,
     int             iHi,
     int             jLo,
     int             jHi,
@@ -1853,7 +2872,7 @@ __TBitGridSet4x4AtPosition_8b(
     uint16_t        in4x4
 )
 {
-    uint8_t         *grid = bitGrid->grid[channelIdx].b8 + baseW;
+    uint8_t         *channel = bitGrid->grid[channelIdx].b8 + baseW, *grid;
     unsigned int    nBitsInRow = iHi - iLo;
     uint16_t        in4x4Mask = (((uint16_t)1 << nBitsInRow) - 1);
     
@@ -1862,11 +2881,11 @@ __TBitGridSet4x4AtPosition_8b(
         
         // All in the same word:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift <= 0 )
                 *grid |= ((in4x4 & in4x4Mask) >> -shift);
             else
                 *grid |= ((in4x4 & in4x4Mask) << shift);
-            grid += bitGrid->dimensions.nWordsPerRow;
             in4x4Mask <<= 4;
             shift -= 4;
             jLo++;
@@ -1876,6 +2895,7 @@ __TBitGridSet4x4AtPosition_8b(
         
         // Split between two consecutive words:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift0 <= 0)
                 *grid |= (in4x4 & in4x4Mask) >> -shift0;
             else
@@ -1884,7 +2904,6 @@ __TBitGridSet4x4AtPosition_8b(
                 *(grid + 1) |= (in4x4 & in4x4Mask) >> -shift1;
             else
                 *(grid + 1) |= (in4x4 & in4x4Mask) << shift1;
-            grid += bitGrid->dimensions.nWordsPerRow;
             in4x4Mask <<= 4;
             shift0 -= 4;
             shift1 -= 4;
@@ -1906,7 +2925,7 @@ __TBitGridSet4x4AtPosition_16b(
     uint16_t        in4x4
 )
 {
-    uint16_t        *grid = bitGrid->grid[channelIdx].b16 + baseW;
+    uint16_t        *channel = bitGrid->grid[channelIdx].b16 + baseW, *grid;
     unsigned int    nBitsInRow = iHi - iLo;
     uint16_t        in4x4Mask = (((uint16_t)1 << nBitsInRow) - 1);
     
@@ -1915,11 +2934,11 @@ __TBitGridSet4x4AtPosition_16b(
         
         // All in the same word:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift <= 0 )
                 *grid |= ((in4x4 & in4x4Mask) >> -shift);
             else
                 *grid |= ((in4x4 & in4x4Mask) << shift);
-            grid += bitGrid->dimensions.nWordsPerRow;
             in4x4Mask <<= 4;
             shift -= 4;
             jLo++;
@@ -1929,6 +2948,7 @@ __TBitGridSet4x4AtPosition_16b(
         
         // Split between two consecutive words:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift0 <= 0)
                 *grid |= (in4x4 & in4x4Mask) >> -shift0;
             else
@@ -1937,7 +2957,6 @@ __TBitGridSet4x4AtPosition_16b(
                 *(grid + 1) |= (in4x4 & in4x4Mask) >> -shift1;
             else
                 *(grid + 1) |= (in4x4 & in4x4Mask) << shift1;
-            grid += bitGrid->dimensions.nWordsPerRow;
             in4x4Mask <<= 4;
             shift0 -= 4;
             shift1 -= 4;
@@ -1959,7 +2978,7 @@ __TBitGridSet4x4AtPosition_32b(
     uint16_t        in4x4
 )
 {
-    uint32_t        *grid = bitGrid->grid[channelIdx].b32 + baseW;
+    uint32_t        *channel = bitGrid->grid[channelIdx].b32 + baseW, *grid;
     unsigned int    nBitsInRow = iHi - iLo;
     uint16_t        in4x4Mask = (((uint16_t)1 << nBitsInRow) - 1);
     
@@ -1968,11 +2987,11 @@ __TBitGridSet4x4AtPosition_32b(
         
         // All in the same word:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift <= 0 )
                 *grid |= ((in4x4 & in4x4Mask) >> -shift);
             else
-                *grid |= ((in4x4 & in4x4Mask) << shift);
-            grid += bitGrid->dimensions.nWordsPerRow;
+                *grid |= ((uint32_t)(in4x4 & in4x4Mask) << shift);
             in4x4Mask <<= 4;
             shift -= 4;
             jLo++;
@@ -1982,15 +3001,15 @@ __TBitGridSet4x4AtPosition_32b(
         
         // Split between two consecutive words:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift0 <= 0)
                 *grid |= (in4x4 & in4x4Mask) >> -shift0;
             else
-                *grid |= (in4x4 & in4x4Mask) << shift0;
+                *grid |= (uint32_t)(in4x4 & in4x4Mask) << shift0;
             if ( shift1 <= 0 )
                 *(grid + 1) |= (in4x4 & in4x4Mask) >> -shift1;
             else
-                *(grid + 1) |= (in4x4 & in4x4Mask) << shift1;
-            grid += bitGrid->dimensions.nWordsPerRow;
+                *(grid + 1) |= (uint32_t)(in4x4 & in4x4Mask) << shift1;
             in4x4Mask <<= 4;
             shift0 -= 4;
             shift1 -= 4;
@@ -2012,7 +3031,7 @@ __TBitGridSet4x4AtPosition_64b(
     uint16_t        in4x4
 )
 {
-    uint64_t        *grid = bitGrid->grid[channelIdx].b64 + baseW;
+    uint64_t        *channel = bitGrid->grid[channelIdx].b64 + baseW, *grid;
     unsigned int    nBitsInRow = iHi - iLo;
     uint16_t        in4x4Mask = (((uint16_t)1 << nBitsInRow) - 1);
     
@@ -2021,11 +3040,11 @@ __TBitGridSet4x4AtPosition_64b(
         
         // All in the same word:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift <= 0 )
                 *grid |= ((in4x4 & in4x4Mask) >> -shift);
             else
-                *grid |= ((in4x4 & in4x4Mask) << shift);
-            grid += bitGrid->dimensions.nWordsPerRow;
+                *grid |= ((uint64_t)(in4x4 & in4x4Mask) << shift);
             in4x4Mask <<= 4;
             shift -= 4;
             jLo++;
@@ -2035,15 +3054,15 @@ __TBitGridSet4x4AtPosition_64b(
         
         // Split between two consecutive words:
         while ( jLo < jHi ) {
+            grid = channel + TBitGridGetRowWordOffset(bitGrid, jLo);
             if ( shift0 <= 0)
                 *grid |= (in4x4 & in4x4Mask) >> -shift0;
             else
-                *grid |= (in4x4 & in4x4Mask) << shift0;
+                *grid |= (uint64_t)(in4x4 & in4x4Mask) << shift0;
             if ( shift1 <= 0 )
                 *(grid + 1) |= (in4x4 & in4x4Mask) >> -shift1;
             else
-                *(grid + 1) |= (in4x4 & in4x4Mask) << shift1;
-            grid += bitGrid->dimensions.nWordsPerRow;
+                *(grid + 1) |= (uint64_t)(in4x4 & in4x4Mask) << shift1;
             in4x4Mask <<= 4;
             shift0 -= 4;
             shift1 -= 4;
@@ -2070,6 +3089,66 @@ TBitGridSet4x4AtPosition(
     //  Off the right-bottom of the board:
     if ( iLo >= (int)bitGrid->dimensions.w || jLo >= (int)bitGrid->dimensions.h ) return;
     
+    //  Only the cells under the set bits of in4x4 can change:
+    TBitGridAddDirtyRect(bitGrid, TGridRectMakeWith4x4(P, in4x4));
+    
+    //  Columns and rows off the right-bottom of the board are never written
+    //  (they would land in the next row or past the end of the channel):
+    if ( iHi > (int)bitGrid->dimensions.w ) iHi = bitGrid->dimensions.w;
+    if ( jHi > (int)bitGrid->dimensions.h ) jHi = bitGrid->dimensions.h;
+    
+    if ( channelIdx == 0 ) {
+        // Count the bits that will be newly-set in each row, the
+        // transitions they add or remove and the keys they add to the row
+        // keys.  Cells that are off the board extract as set, so they drop
+        // out of the count:
+        uint32_t    old6x4 = __TBitGridExtract6x4AtPosition(bitGrid, P);
+        uint16_t    added4x4 = 0, rows4x4;
+        int         j = P.j, r = 0, c = 0;
+        
+        while ( r < 4 ) {
+            added4x4 |= ((in4x4 >> (4 * r)) & ~(old6x4 >> (6 * r + 1)) & 0xF) << (4 * r);
+            r++;
+        }
+        rows4x4 = added4x4;
+        while ( rows4x4 ) {
+            if ( rows4x4 & 0xF ) {
+                unsigned int    physRow = TBitGridGetPhysicalRow(bitGrid, j);
+                unsigned int    window = old6x4 & 0x3F;
+                unsigned int    oldTransitions = __TBitGridGetWindowTransitions(window);
+                unsigned int    newTransitions = __TBitGridGetWindowTransitions(window | ((rows4x4 & 0xF) << 1));
+                unsigned int    addedCols = rows4x4 & 0xF;
+                uint64_t        rowKey = bitGrid->rowHashes[physRow];
+                
+                bitGrid->rowFillCounts[physRow] += __builtin_popcount(rows4x4 & 0xF);
+                bitGrid->rowTransitions[physRow] += newTransitions - oldTransitions;
+                bitGrid->nRowTransitions += newTransitions - oldTransitions;
+                while ( addedCols ) {
+                    rowKey ^= __TBitGridGetColumnKey(P.i + __builtin_ctz(addedCols));
+                    addedCols &= addedCols - 1;
+                }
+                __TBitGridSetRowKey(bitGrid, j, physRow, rowKey);
+            }
+            rows4x4 >>= 4;
+            old6x4 >>= 6;
+            j++;
+        }
+        
+        // Each newly-set cell raises its column's top or fills a hole:
+        while ( c < 4 ) {
+            uint16_t    col4x4 = (added4x4 >> c) & 0x1111;
+            
+            if ( col4x4 ) {
+                unsigned int    i = P.i + c;
+                
+                bitGrid->nHoles -= bitGrid->columnHoles[i];
+                __TBitGridAddCellsToColumn(&bitGrid->columnTops[i], &bitGrid->columnHoles[i], P.j, col4x4);
+                bitGrid->nHoles += bitGrid->columnHoles[i];
+            }
+            c++;
+        }
+    }
+    
     // Shift away any rows that are off the top of the board:
     while ( jLo < 0 ) {
         in4x4 >>= 4;
@@ -2083,9 +3162,10 @@ TBitGridSet4x4AtPosition(
     }
     
     // At this point (iLo,jLo) is the starting coordinate on the
-    // grid.  Go ahead and calculate the word/bit offset:
-    baseW = (jLo * bitGrid->dimensions.nWordsPerRow) + (iLo / bitGrid->dimensions.nBitsPerWord);
-    baseb = (iLo % bitGrid->dimensions.nBitsPerWord);
+    // grid.  Go ahead and calculate the word/bit offset within the
+    // row (the kernels locate each row through the row map):
+    baseW = (iLo + bitGrid->dimensions.nBorderCols) / bitGrid->dimensions.nBitsPerWord;
+    baseb = (iLo + bitGrid->dimensions.nBorderCols) % bitGrid->dimensions.nBitsPerWord;
     
     switch ( bitGrid->dimensions.nBitsPerWord ) {
         case 8:
@@ -2106,6 +3186,576 @@ TBitGridSet4x4AtPosition(
 
 //
 
+void
+TBitGridGetFeatures(
+    TBitGrid            *bitGrid,
+    TBitGridFeatures    *features
+)
+{
+    unsigned int        h = bitGrid->dimensions.h, i = 0;
+    
+    features->aggregateHeight = features->bumpiness = features->wellDepths = 0;
+    features->holes = bitGrid->nHoles;
+    features->rowTransitions = bitGrid->nRowTransitions;
+    features->completedLines = 0;
+    while ( i < bitGrid->dimensions.w ) {
+        unsigned int    top = bitGrid->columnTops[i];
+        
+        features->aggregateHeight += h - top;
+        features->wellDepths += TBitGridGetWellDepth(bitGrid, i);
+        if ( i + 1 < bitGrid->dimensions.w ) {
+            unsigned int    nextTop = bitGrid->columnTops[i + 1];
+            
+            features->bumpiness += (top > nextTop) ? (top - nextTop) : (nextTop - top);
+        }
+        i++;
+    }
+}
+
+//
+
+/*
+ * @typedef __TBitGridPlacement
+ *
+ * The working state of TBitGridGetFeaturesWith4x4AtPosition():  the cells
+ * of the 4x4 at P that are not already set, the rows they complete (bit r
+ * for row P.j + r) and the top and hole count of each of the 4x4's columns
+ * once its cells are set.
+ */
+typedef struct {
+    TGridPos        P;
+    uint16_t        added4x4;
+    unsigned int    completedRows, nCompletedRows;
+    unsigned int    tops[4], holes[4];
+} __TBitGridPlacement;
+
+/*
+ * @function __TBitGridGetColumnAfterPlacement
+ *
+ * Returns the height of column i of bitGrid once the cells of placement are
+ * set and the rows it completes are removed, and sets *holes to the
+ * column's hole count.
+ *
+ * Every completed row lies at or below a column's top.  If the top is in a
+ * completed row, the column is scanned down past the completed rows to its
+ * next set cell (extracting four rows at a time); the empty cells passed on
+ * the way are no longer holes.
+ */
+static inline unsigned int
+__TBitGridGetColumnAfterPlacement(
+    TBitGrid            *bitGrid,
+    __TBitGridPlacement *placement,
+    unsigned int        i,
+    unsigned int        *holes
+)
+{
+    unsigned int        h = bitGrid->dimensions.h, top;
+    int                 c = (int)i - placement->P.i, r;
+    uint16_t            col4x4 = ((c >= 0) && (c < 4)) ? ((placement->added4x4 >> c) & 0x1111) : 0;
+    
+    if ( col4x4 ) {
+        top = placement->tops[c];
+        *holes = placement->holes[c];
+    } else {
+        top = bitGrid->columnTops[i];
+        *holes = bitGrid->columnHoles[i];
+    }
+    if ( ! placement->nCompletedRows ) return h - top;
+    
+    r = (int)top - placement->P.j;
+    if ( (r >= 0) && (r < 4) && (placement->completedRows & (1 << r)) ) {
+        int         jColumn4 = -4;
+        uint16_t    column4 = 0;
+        
+        while ( ++top < h ) {
+            r = (int)top - placement->P.j;
+            if ( (r >= 0) && (r < 4) ) {
+                if ( placement->completedRows & (1 << r) ) continue;
+                if ( col4x4 & (1 << (4 * r)) ) break;
+            }
+            if ( (int)top >= jColumn4 + 4 ) {
+                jColumn4 = top;
+                column4 = TBitGridExtract4x4AtPosition(bitGrid, 0, TGridPosMake(i, top)) & 0x1111;
+            }
+            if ( column4 & (1 << (4 * (top - jColumn4))) ) break;
+            (*holes)--;
+        }
+    }
+    
+    // The completed rows below the top come out of the height:
+    r = (int)top - placement->P.j;
+    if ( r < 0 ) return h - top - placement->nCompletedRows;
+    if ( r < 3 ) return h - top - __builtin_popcount(placement->completedRows & (0xF << (r + 1)));
+    return h - top;
+}
+
+/*
+ * @function __TBitGridGetWellDepthOfHeights
+ *
+ * Returns the well depth of the column with height heights[1] between
+ * neighbors of heights heights[0] and heights[2] (UINT_MAX for a missing
+ * neighbor).
+ */
+static inline unsigned int
+__TBitGridGetWellDepthOfHeights(
+    const unsigned int  heights[3]
+)
+{
+    unsigned int        neighborHeight = (heights[0] < heights[2]) ? heights[0] : heights[2];
+    
+    return (neighborHeight > heights[1]) ? (neighborHeight - heights[1]) : 0;
+}
+
+void
+TBitGridGetFeaturesWith4x4AtPosition(
+    TBitGrid                *bitGrid,
+    const TBitGridFeatures  *features,
+    TGridPos                P,
+    uint16_t                in4x4,
+    TBitGridFeatures        *outFeatures
+)
+{
+    unsigned int            w = bitGrid->dimensions.w, h = bitGrid->dimensions.h;
+    uint32_t                old6x4 = __TBitGridExtract6x4AtPosition(bitGrid, P);
+    __TBitGridPlacement     placement = { .P = P, .added4x4 = 0 };
+    TBitGridFeatures        out = *features;
+    unsigned int            before[3], after[3], i, iLow, iHigh, holes;
+    int                     r = 0, c = 0;
+    
+    out.completedLines = 0;
+    
+    // Cells off the board extract as set, so only cells on the board remain:
+    while ( r < 4 ) {
+        placement.added4x4 |= ((in4x4 >> (4 * r)) & ~(old6x4 >> (6 * r + 1)) & 0xF) << (4 * r);
+        r++;
+    }
+    if ( ! placement.added4x4 ) {
+        *outFeatures = out;
+        return;
+    }
+    r = 0;
+    
+    // A completed row is replaced by an empty row (with its two transitions)
+    // at the head of the grid; in the other rows only the pairs of cells
+    // around the new cells can change:
+    while ( r < 4 ) {
+        unsigned int        row4 = (placement.added4x4 >> (4 * r)) & 0xF;
+        
+        if ( row4 ) {
+            unsigned int    j = P.j + r, physRow = TBitGridGetPhysicalRow(bitGrid, j);
+            
+            if ( bitGrid->rowFillCounts[physRow] + __builtin_popcount(row4) == w ) {
+                placement.completedRows |= 1 << r;
+                placement.nCompletedRows++;
+                out.rowTransitions += 2 - bitGrid->rowTransitions[physRow];
+            } else {
+                unsigned int    window = (old6x4 >> (6 * r)) & 0x3F;
+                
+                out.rowTransitions += __TBitGridGetWindowTransitions(window | (row4 << 1)) - __TBitGridGetWindowTransitions(window);
+            }
+        }
+        r++;
+    }
+    out.completedLines = placement.nCompletedRows;
+    
+    while ( c < 4 ) {
+        uint16_t            col4x4 = (placement.added4x4 >> c) & 0x1111;
+        
+        if ( col4x4 ) {
+            placement.tops[c] = bitGrid->columnTops[P.i + c];
+            placement.holes[c] = bitGrid->columnHoles[P.i + c];
+            __TBitGridAddCellsToColumn(&placement.tops[c], &placement.holes[c], P.j, col4x4);
+        }
+        c++;
+    }
+    
+    // Without completed rows only the 4x4's columns change height, which
+    // changes the wells of their neighbors, too; completed rows change every
+    // column:
+    if ( placement.nCompletedRows ) {
+        iLow = 0;
+        iHigh = w - 1;
+    } else {
+        iLow = (P.i > 0) ? P.i - 1 : 0;
+        iHigh = (P.i + 4 < (int)w) ? P.i + 4 : w - 1;
+    }
+    
+    // Swap the features of columns [iLow,iHigh] for their new values; the
+    // neighbors outside the range do not change:
+    before[0] = after[0] = (iLow > 0) ? h - bitGrid->columnTops[iLow - 1] : UINT_MAX;
+    before[1] = h - bitGrid->columnTops[iLow];
+    after[1] = __TBitGridGetColumnAfterPlacement(bitGrid, &placement, iLow, &holes);
+    out.holes += holes - bitGrid->columnHoles[iLow];
+    i = iLow;
+    while ( i <= iHigh ) {
+        if ( i + 1 >= w ) {
+            before[2] = after[2] = UINT_MAX;
+        } else {
+            before[2] = h - bitGrid->columnTops[i + 1];
+            if ( i + 1 <= iHigh ) {
+                after[2] = __TBitGridGetColumnAfterPlacement(bitGrid, &placement, i + 1, &holes);
+                out.holes += holes - bitGrid->columnHoles[i + 1];
+            } else {
+                after[2] = before[2];
+            }
+        }
+        out.aggregateHeight += after[1] - before[1];
+        out.wellDepths += __TBitGridGetWellDepthOfHeights(after) - __TBitGridGetWellDepthOfHeights(before);
+        if ( i < iHigh ) {
+            out.bumpiness += (after[1] > after[2]) ? (after[1] - after[2]) : (after[2] - after[1]);
+            out.bumpiness -= (before[1] > before[2]) ? (before[1] - before[2]) : (before[2] - before[1]);
+        }
+        before[0] = before[1], before[1] = before[2];
+        after[0] = after[1], after[1] = after[2];
+        i++;
+    }
+    *outFeatures = out;
+}
+
+//
+
+/*
+ * @defined TBITGRID_FEATURES_BLOCK_ROWS
+ *
+ * TBitGridComputeFeatures() gathers this many row slices at a time (on
+ * the stack) before handing them to the features kernel.
+ */
+#define TBITGRID_FEATURES_BLOCK_ROWS 64
+
+/*
+ * @function __TBitGridGetRowSlice
+ *
+ * Returns the slice of row (the first word of a row of bitGrid) that
+ * starts at column i0:  bit 0 is column i0 - 1 and bits 1 through 63 are
+ * columns i0 through i0 + 62.  The walls to the left of column 0 and right
+ * of column w - 1 are set; any bits past the right wall are zero.
+ */
+static inline uint64_t
+__TBitGridGetRowSlice(
+    TBitGrid            *bitGrid,
+    TBitGridChannelPtr  row,
+    unsigned int        i0
+)
+{
+    unsigned int        nBitsPerWord = bitGrid->dimensions.nBitsPerWord;
+    unsigned int        w = bitGrid->dimensions.w;
+    unsigned int        nCols = (w - i0 < 63) ? (w - i0) : 63;
+    int                 first = (int)(bitGrid->dimensions.nBorderCols + i0) - 1;
+    unsigned int        end = bitGrid->dimensions.nBorderCols + i0 + nCols;
+    unsigned int        W = (first < 0) ? 0 : (first / nBitsPerWord);
+    uint64_t            slice = 0, word;
+    
+    // Gather the words that hold columns i0 - 1 through i0 + nCols - 1:
+    while ( W * nBitsPerWord < end ) {
+        int             shift = (int)(W * nBitsPerWord) - first;
+        
+        switch ( nBitsPerWord ) {
+            case 8:
+                word = row.b8[W];
+                break;
+            case 16:
+                word = row.b16[W];
+                break;
+            case 32:
+                word = row.b32[W];
+                break;
+            default:
+                word = row.b64[W];
+                break;
+        }
+        if ( shift < 0 ) slice |= word >> -shift;
+        else slice |= word << shift;
+        W++;
+    }
+    
+    // Drop border and unused bits, then put up the walls:
+    slice &= ((((uint64_t)1 << nCols) - 1) << 1) | (i0 > 0);
+    if ( i0 == 0 ) slice |= 1;
+    if ( nCols < 63 ) slice |= (uint64_t)1 << (nCols + 1);
+    return slice;
+}
+
+/*
+ * @function __TBitGridSumRowSlices_Portable
+ *
+ * The portable features kernel.
+ */
+static void
+__TBitGridSumRowSlices_Portable(
+    const uint64_t  *slices,
+    unsigned int    nSlices,
+    uint64_t        columnMask,
+    uint64_t        pairMask,
+    unsigned int    sums[3]
+)
+{
+    uint64_t        above = slices[-1];
+    unsigned int    k = 0;
+    
+    while ( k < nSlices ) {
+        uint64_t    slice = slices[k];
+        
+        sums[0] += __builtin_popcountll(slice & columnMask);
+        sums[1] += __builtin_popcountll((slice ^ (slice >> 1)) & pairMask);
+        sums[2] += __builtin_popcountll((slice ^ above) & columnMask);
+        above = slice;
+        k++;
+    }
+}
+
+#ifdef TBITGRID_HAVE_AVX2_KERNEL
+
+/*
+ * @function __TBitGridPopcount_AVX2
+ *
+ * Returns the population count of each 64-bit lane of v.  Each nibble is
+ * counted with a byte shuffle of a 16-entry table, and the byte counts are
+ * summed per lane with a sum of absolute differences against zero.
+ */
+static inline __m256i __attribute__((target("avx2")))
+__TBitGridPopcount_AVX2(
+    __m256i         v
+)
+{
+    const __m256i   nibbleCounts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i   lowNibbles = _mm256_set1_epi8(0x0F);
+    __m256i         counts = _mm256_add_epi8(
+                                    _mm256_shuffle_epi8(nibbleCounts, _mm256_and_si256(v, lowNibbles)),
+                                    _mm256_shuffle_epi8(nibbleCounts, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibbles))
+                                );
+    
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+/*
+ * @function __TBitGridSumRowSlices_AVX2
+ *
+ * The AVX2 features kernel:  four slices (and, with an unaligned load one
+ * slice back, the four slices above them) per iteration.  Any remaining
+ * slices go through the portable kernel.
+ */
+static void __attribute__((target("avx2,popcnt")))
+__TBitGridSumRowSlices_AVX2(
+    const uint64_t  *slices,
+    unsigned int    nSlices,
+    uint64_t        columnMask,
+    uint64_t        pairMask,
+    unsigned int    sums[3]
+)
+{
+    const __m256i   columns = _mm256_set1_epi64x(columnMask), pairs = _mm256_set1_epi64x(pairMask);
+    __m256i         cells = _mm256_setzero_si256(), rowTransitions = cells, columnTransitions = cells;
+    uint64_t        lanes[4];
+    unsigned int    k = 0;
+    
+    while ( k + 4 <= nSlices ) {
+        __m256i     slice = _mm256_loadu_si256((const __m256i*)(slices + k));
+        __m256i     above = _mm256_loadu_si256((const __m256i*)(slices + k - 1));
+        
+        cells = _mm256_add_epi64(cells, __TBitGridPopcount_AVX2(_mm256_and_si256(slice, columns)));
+        rowTransitions = _mm256_add_epi64(rowTransitions, __TBitGridPopcount_AVX2(_mm256_and_si256(_mm256_xor_si256(slice, _mm256_srli_epi64(slice, 1)), pairs)));
+        columnTransitions = _mm256_add_epi64(columnTransitions, __TBitGridPopcount_AVX2(_mm256_and_si256(_mm256_xor_si256(slice, above), columns)));
+        k += 4;
+    }
+    _mm256_storeu_si256((__m256i*)lanes, cells);
+    sums[0] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm256_storeu_si256((__m256i*)lanes, rowTransitions);
+    sums[1] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm256_storeu_si256((__m256i*)lanes, columnTransitions);
+    sums[2] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    if ( k < nSlices ) __TBitGridSumRowSlices_Portable(slices + k, nSlices - k, columnMask, pairMask, sums);
+}
+
+#endif /* TBITGRID_HAVE_AVX2_KERNEL */
+
+//
+
+void
+TBitGridComputeFeatures(
+    TBitGrid            *bitGrid,
+    unsigned int        channelIdx,
+    TBitGridFeatures    *features,
+    unsigned int        *columnTransitions,
+    unsigned int        *heights
+)
+{
+    unsigned int        w = bitGrid->dimensions.w, h = bitGrid->dimensions.h;
+    unsigned int        i0 = 0, sums[3] = { 0, 0, 0 };
+    unsigned int        leftTop = 0, midTop = 0;
+    TBitGridFeatures    out = { 0, 0, 0, 0, 0, 0 };
+    uint64_t            slices[1 + TBITGRID_FEATURES_BLOCK_ROWS];
+    
+    if ( channelIdx >= bitGrid->dimensions.nChannels ) {
+        *features = out;
+        if ( columnTransitions ) *columnTransitions = 0;
+        if ( heights ) memset(heights, 0, w * sizeof(unsigned int));
+        return;
+    }
+    
+    // Each slice covers up to 63 columns and the transitions between them
+    // and the column (or wall) to the left; the last slice also covers the
+    // transition to the right wall, so it may hold no columns at all:
+    while ( i0 <= w ) {
+        unsigned int    nCols = (w - i0 < 63) ? (w - i0) : 63;
+        uint64_t        columnMask = (((uint64_t)1 << nCols) - 1) << 1;
+        uint64_t        pairMask = ((uint64_t)1 << ((nCols < 63) ? (nCols + 1) : 63)) - 1;
+        uint64_t        seen = 0;
+        unsigned int    tops[63], c = 0, j = 0;
+        
+        while ( c < nCols ) tops[c++] = h;
+        
+        // The row above the top is empty:
+        slices[0] = 0;
+        while ( j < h ) {
+            unsigned int    n = 0, r = 0;
+            
+            while ( (n < TBITGRID_FEATURES_BLOCK_ROWS) && (j + n < h) ) {
+                slices[1 + n] = __TBitGridGetRowSlice(bitGrid, TBitGridGetRowWords(bitGrid, channelIdx, j + n), i0);
+                n++;
+            }
+            bitGrid->callbacks.sumRowSlices(slices + 1, n, columnMask, pairMask, sums);
+            
+            // Columns first seen in this block have their tops here:
+            while ( (seen != columnMask) && (r < n) ) {
+                uint64_t    newBits = slices[1 + r] & columnMask & ~seen;
+                
+                seen |= newBits;
+                while ( newBits ) {
+                    tops[__builtin_ctzll(newBits) - 1] = j + r;
+                    newBits &= newBits - 1;
+                }
+                r++;
+            }
+            slices[0] = slices[n];
+            j += n;
+        }
+        
+        // The floor below the bottom is set:
+        sums[2] += __builtin_popcountll(~slices[0] & columnMask);
+        
+        // Fold in the column tops; a column's well depth is known once the
+        // top of the column to its right is:
+        c = 0;
+        while ( c < nCols ) {
+            unsigned int    top = tops[c], i = i0 + c;
+            
+            out.aggregateHeight += h - top;
+            if ( heights ) heights[i] = h - top;
+            if ( i > 0 ) {
+                unsigned int    neighborTop = (leftTop > top) ? leftTop : top;
+                
+                out.bumpiness += (midTop > top) ? (midTop - top) : (top - midTop);
+                if ( midTop > neighborTop ) out.wellDepths += midTop - neighborTop;
+            }
+            leftTop = (i > 0) ? midTop : 0;
+            midTop = top;
+            c++;
+        }
+        i0 += 63;
+    }
+    
+    // The rightmost column's only neighbor is to its left:
+    if ( w > 0 && midTop > leftTop ) out.wellDepths += midTop - leftTop;
+    
+    out.holes = out.aggregateHeight - sums[0];
+    out.rowTransitions = sums[1];
+    *features = out;
+    if ( columnTransitions ) *columnTransitions = sums[2];
+}
+
+//
+
+bool
+TBitGridSetFeaturesKernel(
+    TBitGrid                *bitGrid,
+    TBitGridFeaturesKernel  kernel
+)
+{
+    switch ( kernel ) {
+        case TBitGridFeaturesKernelDefault:
+#ifdef TBITGRID_HAVE_AVX2_KERNEL
+            if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") ) {
+                bitGrid->callbacks.sumRowSlices = __TBitGridSumRowSlices_AVX2;
+                return true;
+            }
+#endif
+            bitGrid->callbacks.sumRowSlices = __TBitGridSumRowSlices_Portable;
+            return true;
+            
+        case TBitGridFeaturesKernelPortable:
+            bitGrid->callbacks.sumRowSlices = __TBitGridSumRowSlices_Portable;
+            return true;
+            
+        case TBitGridFeaturesKernelAVX2:
+#ifdef TBITGRID_HAVE_AVX2_KERNEL
+            if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") ) {
+                bitGrid->callbacks.sumRowSlices = __TBitGridSumRowSlices_AVX2;
+                return true;
+            }
+#endif
+            break;
+    }
+    return false;
+}
+
+//
+
+TBitGridFeaturesKernel
+TBitGridGetFeaturesKernel(
+    TBitGrid        *bitGrid
+)
+{
+#ifdef TBITGRID_HAVE_AVX2_KERNEL
+    if ( bitGrid->callbacks.sumRowSlices == __TBitGridSumRowSlices_AVX2 ) return TBitGridFeaturesKernelAVX2;
+#endif
+    return TBitGridFeaturesKernelPortable;
+}
+
+//
+
+uint64_t
+TBitGridGetRowBits(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    unsigned int    j
+)
+{
+    TBitGridChannelPtr  row = TBitGridGetRowWords(bitGrid, channelIdx, j);
+    unsigned int        nBitsPerWord = bitGrid->dimensions.nBitsPerWord;
+    unsigned int        nCols = (bitGrid->dimensions.w < 64) ? bitGrid->dimensions.w : 64;
+    unsigned int        W = 0, bit = 0;
+    int                 shift;
+    uint64_t            bits = 0, word;
+    
+    // Gather whole words, dropping the left border bits off the first:
+    while ( (bit < bitGrid->dimensions.nBorderCols + nCols) && (W < bitGrid->dimensions.nWordsPerRow) ) {
+        switch ( nBitsPerWord ) {
+            case 8:
+                word = row.b8[W];
+                break;
+            case 16:
+                word = row.b16[W];
+                break;
+            case 32:
+                word = row.b32[W];
+                break;
+            default:
+                word = row.b64[W];
+                break;
+        }
+        shift = (int)bit - (int)bitGrid->dimensions.nBorderCols;
+        if ( shift < 0 ) bits |= word >> -shift;
+        else bits |= word << shift;
+        bit += nBitsPerWord;
+        W++;
+    }
+    if ( nCols < 64 ) bits &= ((uint64_t)1 << nCols) - 1;
+    return bits;
+}
+
+//
+
 void
 TBitGridChannelSummary(
     TBitGrid                    *bitGrid,
@@ -2162,12 +3812,13 @@ TBitGridChannelSummary(
                 );
             switch ( bitGrid->dimensions.nBitsPerWord ) {
                 case 8: {
-                    uint8_t         *grid = bitGrid->grid[channelIdx].b8;
+                    uint8_t         *grid;
                     unsigned int    i, j = 0;
                     
                     while ( j < bitGrid->dimensions.h ) {
+                        grid = bitGrid->grid[channelIdx].b8 + TBitGridGetRowWordOffset(bitGrid, j);
                         i = bitGrid->dimensions.nWordsPerRow;
-                        printf("            %4u : ", j * bitGrid->dimensions.nWordsPerRow);
+                        printf("            %4u : ", TBitGridGetRowWordOffset(bitGrid, j));
                         while ( i-- > 0 ) printf("0x%02hhX, ", *grid++);
                         printf("\n");
                         j++;
@@ -2175,12 +3826,13 @@ TBitGridChannelSummary(
                     break;
                 }
                 case 16: {
-                    uint16_t        *grid = bitGrid->grid[channelIdx].b16;
+                    uint16_t        *grid;
                     unsigned int    i, j = 0;
                     
                     while ( j < bitGrid->dimensions.h ) {
+                        grid = bitGrid->grid[channelIdx].b16 + TBitGridGetRowWordOffset(bitGrid, j);
                         i = bitGrid->dimensions.nWordsPerRow;
-                        printf("            %4u : ", j * bitGrid->dimensions.nWordsPerRow);
+                        printf("            %4u : ", TBitGridGetRowWordOffset(bitGrid, j));
                         while ( i-- > 0 ) printf("0x%04hX, ", *grid++);
                         printf("\n");
                         j++;
@@ -2188,12 +3840,13 @@ TBitGridChannelSummary(
                     break;
                 }
                 case 32: {
-                    uint32_t        *grid = bitGrid->grid[channelIdx].b32;
+                    uint32_t        *grid;
                     unsigned int    i, j = 0;
                     
                     while ( j < bitGrid->dimensions.h ) {
+                        grid = bitGrid->grid[channelIdx].b32 + TBitGridGetRowWordOffset(bitGrid, j);
                         i = bitGrid->dimensions.nWordsPerRow;
-                        printf("            %4u : ", j * bitGrid->dimensions.nWordsPerRow);
+                        printf("            %4u : ", TBitGridGetRowWordOffset(bitGrid, j));
                         while ( i-- > 0 ) printf("0x%08X, ", *grid++);
                         printf("\n");
                         j++;
@@ -2201,12 +3854,13 @@ TBitGridChannelSummary(
                     break;
                 }
                 case 64: {
-                    uint64_t        *grid = bitGrid->grid[channelIdx].b64;
+                    uint64_t        *grid;
                     unsigned int    i, j = 0;
                     
                     while ( j < bitGrid->dimensions.h ) {
+                        grid = bitGrid->grid[channelIdx].b64 + TBitGridGetRowWordOffset(bitGrid, j);
                         i = bitGrid->dimensions.nWordsPerRow;
-                        printf("            %4u : ", j * bitGrid->dimensions.nWordsPerRow);
+                        printf("            %4u : ", TBitGridGetRowWordOffset(bitGrid, j));
                         while ( i-- > 0 ) printf("0x%016llX, ", *grid++);
                         printf("\n");
                         j++;
@@ -2224,14 +3878,27 @@ TBitGridChannelSummary(
 ////
 //
 
-TBitGridIterator*
-TBitGridIteratorCreate(
-    TBitGrid    *bitGrid,
-    TCell       channelMask
+bool
+TBitGridIteratorInit(
+    TBitGridIterator    *iterator,
+    TBitGrid            *bitGrid,
+    TCell               channelMask
+)
+{
+    return TBitGridIteratorInitWithRowRange(iterator, bitGrid, channelMask, 0, bitGrid->dimensions.h - 1);
+}
+
+//
+
+bool
+TBitGridIteratorInitWithRowRange(
+    TBitGridIterator    *iterator,
+    TBitGrid            *bitGrid,
+    TCell               channelMask,
+    unsigned int        startRow,
+    unsigned int        endRow
 )
 {
-    size_t              gridBytes = bitGrid->dimensions.nChannels * sizeof(TBitGridChannelPtr);
-    TBitGridIterator    *iterator = NULL;
     unsigned int        nChannelsEnabled = 0;
     TCell               channelMaskCopy;
     uint16_t            validChannelsMask = (1 << bitGrid->dimensions.nChannels) - 1;
@@ -2239,79 +3906,88 @@ TBitGridIteratorCreate(
     channelMask &= validChannelsMask;
     channelMaskCopy = channelMask;
     
-    if ( channelMask == 0 ) return NULL;
+    if ( channelMask == 0 ) return false;
+    
+    if ( endRow >= bitGrid->dimensions.h ) endRow = bitGrid->dimensions.h - 1;
+    if ( startRow > endRow ) startRow = endRow;
     
     while ( channelMask ) {
         if ( channelMask & 0x1 ) nChannelsEnabled++;
         channelMask >>= 1;
     }
-    if ( nChannelsEnabled ) {
-        if ( nChannelsEnabled == 1 ) {
-            TBitGridIterator_1C *ITERATOR = (TBitGridIterator_1C*)malloc(sizeof(TBitGridIterator_1C) + gridBytes);
-            
-            if ( ITERATOR ) {
-                ITERATOR->base.grid = (void*)ITERATOR + sizeof(TBitGridIterator_1C);
-                channelMask = 0;
-                while ( (1 << channelMask) != channelMaskCopy ) channelMask++;
-                ITERATOR->channelIdx = channelMask;
-                iterator = (TBitGridIterator*)ITERATOR;
-                switch ( bitGrid->dimensions.nBitsPerWord ) {
-                    case 8:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_8b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_8b_1C;
-                        break;
-                    case 16:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_16b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_16b_1C;
-                        break;
-                    case 32:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_32b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_32b_1C;
-                        break;
-                    case 64:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_64b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_64b_1C;
-                        break;
-                }
-            }
-        } else {
-            TBitGridIterator_NC *ITERATOR = (TBitGridIterator_NC*)malloc(sizeof(TBitGridIterator_NC) + gridBytes);
-            
-            if ( ITERATOR ) {
-                ITERATOR->base.grid = (void*)ITERATOR + sizeof(TBitGridIterator_NC);
-                ITERATOR->channelMask = channelMaskCopy;
-                iterator = (TBitGridIterator*)ITERATOR;
-                switch ( bitGrid->dimensions.nBitsPerWord ) {
-                    case 8:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_8b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_8b_NC;
-                        break;
-                    case 16:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_16b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_16b_NC;
-                        break;
-                    case 32:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_32b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_32b_NC;
-                        break;
-                    case 64:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_64b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_64b_NC;
-                        break;
-                }
-            }
+    iterator->channelMask = channelMaskCopy;
+    if ( nChannelsEnabled == 1 ) {
+        channelMask = 0;
+        while ( (1 << channelMask) != channelMaskCopy ) channelMask++;
+        iterator->channelIdx = channelMask;
+        switch ( bitGrid->dimensions.nBitsPerWord ) {
+            case 8:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_8b_1C;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_8b_1C;
+                break;
+            case 16:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_16b_1C;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_16b_1C;
+                break;
+            case 32:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_32b_1C;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_32b_1C;
+                break;
+            case 64:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_64b_1C;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_64b_1C;
+                break;
         }
-        if ( iterator ) {
-            iterator->dimensions = bitGrid->dimensions;
-            iterator->i = iterator->j = 0;
-            iterator->jMax = bitGrid->dimensions.h;
-            iterator->nFullWords = bitGrid->dimensions.w / bitGrid->dimensions.nBitsPerWord;
-            iterator->nPartialBits = bitGrid->dimensions.w % bitGrid->dimensions.nBitsPerWord;
-            iterator->isStarted = false;
-            memcpy(iterator->grid, bitGrid->grid, gridBytes);
+    } else {
+        iterator->channelIdx = 0;
+        switch ( bitGrid->dimensions.nBitsPerWord ) {
+            case 8:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_8b_NC;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_8b_NC;
+                break;
+            case 16:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_16b_NC;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_16b_NC;
+                break;
+            case 32:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_32b_NC;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_32b_NC;
+                break;
+            case 64:
+                iterator->callbacks.nextFn = __TBitGridIteratorNext_64b_NC;
+                iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_64b_NC;
+                break;
         }
     }
-    return iterator;
+    iterator->bitGrid = bitGrid;
+    iterator->dimensions = bitGrid->dimensions;
+    iterator->i = 0;
+    iterator->j = startRow;
+    iterator->jMax = endRow + 1;
+    if ( bitGrid->dimensions.nBorderCols ) {
+        // Guard bits are always set, so a full row is all ones:
+        iterator->nFullWords = bitGrid->dimensions.nWordsPerRow;
+        iterator->nPartialBits = 0;
+    } else {
+        iterator->nFullWords = bitGrid->dimensions.w / bitGrid->dimensions.nBitsPerWord;
+        iterator->nPartialBits = bitGrid->dimensions.w % bitGrid->dimensions.nBitsPerWord;
+    }
+    iterator->isStarted = false;
+    
+    // Start at the first row of the range:
+    __TBitGridIteratorSeekRow(iterator);
+    return true;
+}
+
+//
+
+TBitGridIterator*
+TBitGridIteratorCreate(
+    TBitGrid    *bitGrid,
+    TCell       channelMask
+)
+{
+    return TBitGridIteratorCreateWithRowRange(bitGrid, channelMask, 0, bitGrid->dimensions.h - 1);
 }
 
 //
@@ -2324,98 +4000,11 @@ TBitGridIteratorCreateWithRowRange(
     unsigned int    endRow
 )
 {
-    size_t              gridBytes = bitGrid->dimensions.nChannels * sizeof(TBitGridChannelPtr);
-    TBitGridIterator    *iterator = NULL;
-    unsigned int        nChannelsEnabled = 0;
-    TCell               channelMaskCopy;
-    uint16_t            validChannelsMask = (1 << bitGrid->dimensions.nChannels) - 1;
+    TBitGridIterator    *iterator = (TBitGridIterator*)malloc(sizeof(TBitGridIterator));
     
-    channelMask &= validChannelsMask;
-    channelMaskCopy = channelMask;
-    
-    if ( channelMask == 0 ) return NULL;
-    
-    if ( endRow >= bitGrid->dimensions.h ) endRow = bitGrid->dimensions.h - 1;
-    if ( startRow > endRow ) startRow = endRow;
-    
-    while ( channelMask ) {
-        if ( channelMask & 0x1 ) nChannelsEnabled++;
-        channelMask >>= 1;
-    }
-    if ( nChannelsEnabled ) {
-        if ( nChannelsEnabled == 1 ) {
-            TBitGridIterator_1C *ITERATOR = (TBitGridIterator_1C*)malloc(sizeof(TBitGridIterator_1C) + gridBytes);
-            
-            if ( ITERATOR ) {
-                ITERATOR->base.grid = (void*)ITERATOR + sizeof(TBitGridIterator_1C);
-                channelMask = 0;
-                while ( (1 << channelMask) != channelMaskCopy ) channelMask++;
-                ITERATOR->channelIdx = channelMask;
-                iterator = (TBitGridIterator*)ITERATOR;
-                switch ( bitGrid->dimensions.nBitsPerWord ) {
-                    case 8:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_8b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_8b_1C;
-                        break;
-                    case 16:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_16b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_16b_1C;
-                        break;
-                    case 32:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_32b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_32b_1C;
-                        break;
-                    case 64:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_64b_1C;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_64b_1C;
-                        break;
-                }
-            }
-        } else {
-            TBitGridIterator_NC *ITERATOR = (TBitGridIterator_NC*)malloc(sizeof(TBitGridIterator_NC) + gridBytes);
-            
-            if ( ITERATOR ) {
-                ITERATOR->base.grid = (void*)ITERATOR + sizeof(TBitGridIterator_NC);
-                ITERATOR->channelMask = channelMaskCopy;
-                iterator = (TBitGridIterator*)ITERATOR;
-                switch ( bitGrid->dimensions.nBitsPerWord ) {
-                    case 8:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_8b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_8b_NC;
-                        break;
-                    case 16:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_16b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_16b_NC;
-                        break;
-                    case 32:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_32b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_32b_NC;
-                        break;
-                    case 64:
-                        iterator->callbacks.nextFn = __TBitGridIteratorNext_64b_NC;
-                        iterator->callbacks.nextFullRowFn = __TBitGridIteratorNextFullRow_64b_NC;
-                        break;
-                }
-            }
-        }
-        if ( iterator ) {
-            iterator->dimensions = bitGrid->dimensions;
-            iterator->i = 0;
-            iterator->j = startRow;
-            iterator->jMax = endRow + 1;
-            iterator->nFullWords = bitGrid->dimensions.w / bitGrid->dimensions.nBitsPerWord;
-            iterator->nPartialBits = bitGrid->dimensions.w % bitGrid->dimensions.nBitsPerWord;
-            iterator->isStarted = false;
-            memcpy(iterator->grid, bitGrid->grid, gridBytes);
-            
-            // Fast-forward to starting row:
-            if ( startRow > 0 ) {
-                unsigned int    channel = 0;
-                
-                while ( channel < bitGrid->dimensions.nChannels )
-                    iterator->grid[channel++].b8 += startRow * bitGrid->dimensions.nWordsPerRow * bitGrid->dimensions.nBytesPerWord;
-            }
-        }
+    if ( iterator && ! TBitGridIteratorInitWithRowRange(iterator, bitGrid, channelMask, startRow, endRow) ) {
+        free((void*)iterator);
+        iterator = NULL;
     }
     return iterator;
 }
@@ -60,6 +60,41 @@
 	0xFFFF for 16-bit words) and the possible final partial word has the lowest
 	N bits set.  If the game board is 16 squares wide, then a full row is
 	established by bitwise-AND'ing a single 16-bit word with 0xFFFF.
+	
+	The grid also maintains a count of the set bits in each row of channel 0
+	(the occupancy channel of the game board).  Every function that alters the
+	grid keeps the counts current, so testing whether a row is full is a
+	single comparison against the width rather than a scan of the row's words
+	(see TBitGridIsRowFull()).
+	
+	The features a bot weighs when it evaluates a board are kept current the
+	same way:  the topmost occupied row of each column (its height), the
+	number of holes in each column, and the number of occupied/empty
+	transitions along each row.  A write updates only the columns and rows it
+	touches, and the features of the board that would result from adding a
+	tetromino (and removing the rows it completes) can be had without
+	writing it (see TBitGridGetFeaturesWith4x4AtPosition()).
+	
+	A 64-bit hash of channel 0 is kept current as well, so a search can
+	recognize boards it has already seen (see TBitGridGetHash()).
+	
+	Rows are not stored in on-screen order.  Each logical row j maps to a
+	physical row of storage through a ring of row indices, so removing k
+	completed rows touches only the k physical rows being emptied and the
+	ring entries on one side of them (whichever side is smaller) instead of
+	moving every word of every row above them.  All functions take logical
+	positions; the grid index (W,b) of a position addresses physical storage.
+	
+	A grid can optionally be created with a sentinel border (see
+	TBitGridCreateWithOptions()):  every row carries permanently-set guard
+	bits to the left and right of its w columns, and a permanently-set guard
+	row stands in for every row above the top or below the bottom of the
+	grid.  Extracting a 4x4 that hangs off an edge then reads the walls
+	straight out of storage, with no edge fixups.
+	
+	Every write to the grid also grows a dirty rectangle that bounds the cells
+	written since the rectangle was last reset (see TBitGridGetDirtyRect()), so
+	a consumer can find what changed without comparing the grid to a copy.
 */
 
 #ifndef __TBITGRID_H__
@@ -80,14 +115,20 @@
  * units.  If the width (w) is not on a nBitsPerWord boundary then
  * some number of the most-significant bits of the final word will
  * be unused.
+ *
+ * A grid with a sentinel border has nBorderCols guard bits ahead of
+ * column 0 in each row (column i is bit i + nBorderCols of the row)
+ * and all bits past column w - 1 are guard bits, too.  A single guard
+ * row follows the h rows of the grid.
  */
 typedef struct {
     unsigned int        nChannels;          // Number of independent bits per cell
     unsigned int        nBitsPerWord;       // Number of bits in this instance's word
     unsigned int        nBytesPerWord;      // Number ofr bytes in this instance's word
     unsigned int        w, h;               // Nominal width and height of the grid
+    unsigned int        nBorderCols;        // Guard columns to either side of the grid
     unsigned int        nWordsPerRow;       // Number of words per row of the grid
-    unsigned int        nWordsTotal;        // Total words in the grid
+    unsigned int        nWordsTotal;        // Total words in the grid (including any guard row)
 } TBitGridDimensions;
 
 /* Forward declaration for the sake of declaring the callback
@@ -112,29 +153,303 @@ typedef TCell (*TBitGridGetCellValueAtIndexFn)(struct TBitGrid *theGrid, TGridIn
  */
 typedef void (*TBitGridSetCellValueAtIndexFn)(struct TBitGrid *theGrid, TGridIndex theIndex, TCell theValue);
 
+/*
+ * @typedef TBitGridExtract4x4AtPositionFn
+ *
+ * The type of a function that extracts the 4x4 sub-grid of channel
+ * channelIdx of theGrid at position P (see TBitGridExtract4x4AtPosition()).
+ */
+typedef uint16_t (*TBitGridExtract4x4AtPositionFn)(struct TBitGrid *theGrid, unsigned int channelIdx, TGridPos P);
+
+/*
+ * @typedef TBitGridSumRowSlicesFn
+ *
+ * The type of a features kernel (see TBitGridComputeFeatures()):  a
+ * function that adds to sums[0] the set cells of nSlices row slices under
+ * columnMask, to sums[1] their row transitions under pairMask, and to
+ * sums[2] their column transitions under columnMask.  Each slice's column
+ * transitions are counted against the slice before it, so slices[-1] must
+ * be the slice of the row above the first.
+ */
+typedef void (*TBitGridSumRowSlicesFn)(const uint64_t *slices, unsigned int nSlices, uint64_t columnMask, uint64_t pairMask, unsigned int sums[3]);
+
+/*
+ * @constant TBITGRID_MAX_CHANNELS
+ *
+ * The largest number of channels a TBitGrid can have.
+ */
+#define TBITGRID_MAX_CHANNELS 8
+
+/*
+ * @typedef TBitGridChannelPtr
+ *
+ * A pointer into the words of a channel; which member is valid depends
+ * on the grid's nBitsPerWord.
+ */
+typedef union TBitGridChannelPtr {
+            uint8_t     *b8;
+            uint16_t    *b16;
+            uint32_t    *b32;
+            uint64_t    *b64;
+} TBitGridChannelPtr;
+
 /*
  * @typedef TBitGridStorage
  *
- * Opaque pointer to a data structure that represents the underlying
- * storage associated with a TBitGrid.
+ * Pointer to the array of channel pointers that represents the
+ * underlying storage associated with a TBitGrid.
  */
-typedef union TBitGridChannelPtr * TBitGridStorage;
+typedef TBitGridChannelPtr * TBitGridStorage;
 
 /*
  * @typedef TBitGrid
  *
  * Semi-opaque data structure the contains a TBitGrid object created by
  * the TBitGridCreate() function.
+ *
+ * The rowFillCounts array holds the number of set bits in each physical
+ * row of channel 0.
+ *
+ * The columnTops array holds the (logical) row of the topmost set bit of
+ * channel 0 in each column, or h if the column is empty.  Every write to the
+ * grid keeps it current; only clearing a column's topmost cell requires the
+ * column to be scanned (downward from that cell).
+ *
+ * The columnHoles array holds the number of cells in each column below its
+ * top whose channel 0 bit is not set; nHoles is their sum.  The
+ * rowTransitions array holds the number of neighboring cells in each physical
+ * row of channel 0 (with the walls to either side counted as set) that
+ * differ; nRowTransitions is their sum.  They are kept current alongside the
+ * column tops.
+ *
+ * The rowHashes array holds the Zobrist key of each physical row of channel
+ * 0 (the exclusive OR of the keys of its set columns) and rowWeights[j] the
+ * multiplier of logical row j in the board hash (see TBitGridGetHash()).
+ *
+ * The rowMap ring has 2h entries:  logical row j is stored in physical row
+ * rowMap[rowBase + j].  The second half mirrors the first, so a lookup never
+ * needs to wrap.  Entry 2h holds the physical row of the guard row (in a grid
+ * with a sentinel border).  The rowSlots array is its inverse:  physical row
+ * r is held in slot rowSlots[r] (in [0,h)) of the ring, so it is logical row
+ * rowSlots[r] - rowBase modulo h.
+ *
+ * The dirtyRect bounds the (logical) cells written since it was last reset
+ * (see TBitGridGetDirtyRect()).
  */
 typedef struct TBitGrid {
     TBitGridDimensions  dimensions;
     TBitGridStorage     grid;
+    unsigned int        *rowFillCounts;
+    unsigned int        *columnTops;
+    unsigned int        *columnHoles;
+    unsigned int        *rowTransitions;
+    unsigned int        nHoles, nRowTransitions;
+    uint64_t            *rowHashes;
+    uint64_t            *rowWeights;
+    uint64_t            hash;
+    unsigned int        *rowMap;
+    unsigned int        *rowSlots;
+    unsigned int        rowBase;
+    TGridRect           dirtyRect;
     struct {
         TBitGridGetCellValueAtIndexFn   getCellValueAtIndex;
         TBitGridSetCellValueAtIndexFn   setCellValueAtIndex;
+        TBitGridExtract4x4AtPositionFn  extract4x4AtPosition;
+        TBitGridSumRowSlicesFn          sumRowSlices;
     } callbacks;
 } TBitGrid;
 
+/*
+ * @function TBitGridGetPhysicalRow
+ *
+ * Returns the physical row of storage that holds logical row j of bitGrid.
+ */
+static inline unsigned int
+TBitGridGetPhysicalRow(
+    TBitGrid        *bitGrid,
+    unsigned int    j
+)
+{
+    return bitGrid->rowMap[bitGrid->rowBase + j];
+}
+
+/*
+ * @function TBitGridGetRowWordOffset
+ *
+ * Returns the offset (in words) from the start of a channel to the first
+ * word of logical row j of bitGrid.
+ */
+static inline unsigned int
+TBitGridGetRowWordOffset(
+    TBitGrid        *bitGrid,
+    unsigned int    j
+)
+{
+    return bitGrid->rowMap[bitGrid->rowBase + j] * bitGrid->dimensions.nWordsPerRow;
+}
+
+/*
+ * @function TBitGridGetLogicalRow
+ *
+ * Returns the logical row of bitGrid held in physical row physRow, or h
+ * for a row past the cells (the guard row of a grid with a sentinel border).
+ */
+static inline unsigned int
+TBitGridGetLogicalRow(
+    TBitGrid        *bitGrid,
+    unsigned int    physRow
+)
+{
+    unsigned int    slot;
+    
+    if ( physRow >= bitGrid->dimensions.h ) return bitGrid->dimensions.h;
+    slot = bitGrid->rowSlots[physRow];
+    return (slot >= bitGrid->rowBase) ? (slot - bitGrid->rowBase) : (slot + bitGrid->dimensions.h - bitGrid->rowBase);
+}
+
+/*
+ * @function TBitGridAddDirtyRect
+ *
+ * Grow the dirty rectangle of bitGrid to include the cells of R that lie on
+ * the grid.  Every function that alters the grid does this on its own;
+ * consumers that alter storage directly (e.g. through TBitGridGetRowWords())
+ * should, too.
+ */
+static inline void
+TBitGridAddDirtyRect(
+    TBitGrid        *bitGrid,
+    TGridRect       R
+)
+{
+    R = TGridRectIntersect(R, TGridRectMake(0, 0, bitGrid->dimensions.w - 1, bitGrid->dimensions.h - 1));
+    if ( ! TGridRectIsEmpty(R) ) bitGrid->dirtyRect = TGridRectUnion(bitGrid->dirtyRect, R);
+}
+
+/*
+ * @function TBitGridGetDirtyRect
+ *
+ * Returns the bounds of the cells of bitGrid that have been written since
+ * the grid was created or TBitGridResetDirtyRect() was last called.  Removing
+ * rows dirties every row that shifted.  The bounds are in logical rows, so
+ * they stay meaningful across row removal.
+ */
+static inline TGridRect
+TBitGridGetDirtyRect(
+    TBitGrid        *bitGrid
+)
+{
+    return bitGrid->dirtyRect;
+}
+
+/*
+ * @function TBitGridResetDirtyRect
+ *
+ * Empty the dirty rectangle of bitGrid.
+ */
+static inline void
+TBitGridResetDirtyRect(
+    TBitGrid        *bitGrid
+)
+{
+    bitGrid->dirtyRect = TGridRectMakeEmpty();
+}
+
+/*
+ * @function TBitGridGetColumnTop
+ *
+ * Returns the row of the topmost cell of column i of bitGrid that has its
+ * channel 0 bit set, or the grid height if no cell in the column is set.
+ */
+static inline unsigned int
+TBitGridGetColumnTop(
+    TBitGrid        *bitGrid,
+    unsigned int    i
+)
+{
+    return bitGrid->columnTops[i];
+}
+
+/*
+ * @function TBitGridRescanColumnTop
+ *
+ * The topmost set cell of column i of bitGrid has been cleared:  advance
+ * the column's recorded top down past any cells whose channel 0 bit is
+ * no longer set.
+ */
+void TBitGridRescanColumnTop(TBitGrid *bitGrid, unsigned int i);
+
+/*
+ * @function TBitGridUpdateCellFeatures
+ *
+ * Account for the channel 0 bit of the cell at position P of bitGrid having
+ * been written (changing from wasSet to isSet) in the column tops, hole
+ * counts and row transitions.
+ */
+void TBitGridUpdateCellFeatures(TBitGrid *bitGrid, TGridPos P, bool wasSet, bool isSet);
+
+/*
+ * @function TBitGridGetColumnHoles
+ *
+ * Returns the number of cells of column i of bitGrid below its topmost set
+ * cell that do not have their channel 0 bit set.
+ */
+static inline unsigned int
+TBitGridGetColumnHoles(
+    TBitGrid        *bitGrid,
+    unsigned int    i
+)
+{
+    return bitGrid->columnHoles[i];
+}
+
+/*
+ * @function TBitGridGetWellDepth
+ *
+ * Returns how far column i of bitGrid lies below the lower of its neighbors
+ * (the one neighbor of an edge column; the walls do not count), or zero if
+ * it is not below both.
+ */
+static inline unsigned int
+TBitGridGetWellDepth(
+    TBitGrid        *bitGrid,
+    unsigned int    i
+)
+{
+    unsigned int    top = bitGrid->columnTops[i], neighborTop = 0;
+    
+    if ( i > 0 ) neighborTop = bitGrid->columnTops[i - 1];
+    if ( (i + 1 < bitGrid->dimensions.w) && (bitGrid->columnTops[i + 1] > neighborTop) ) neighborTop = bitGrid->columnTops[i + 1];
+    return (top > neighborTop) ? (top - neighborTop) : 0;
+}
+
+/*
+ * @function TBitGridGetHash
+ *
+ * Returns the 64-bit hash of channel 0 of bitGrid.  Grids of the same
+ * width and height whose channel 0 cells are the same have the same hash,
+ * however they came to be (and whatever their word size or border), so the
+ * hash can key a transposition table shared by every grid of a search.
+ *
+ * Each column has a fixed random key and each row's key is the exclusive
+ * OR of the keys of its set columns, as in Zobrist hashing.  The board hash
+ * is the sum of the row keys with row j's multiplied by P^j for a fixed
+ * odd P (mod 2^64).  Setting or clearing a cell changes one row key; line
+ * removal multiplies the part of the hash belonging to the rows above the
+ * removed ones by P^n, where a position-keyed Zobrist hash would have to
+ * rehash every row that moves.  The hash is kept current by every function
+ * that alters channel 0.
+ *
+ * The low bits of the hash are weaker than the high bits; mix it before
+ * using it as a table index (as TTranspositionTable does).
+ */
+static inline uint64_t
+TBitGridGetHash(
+    TBitGrid        *bitGrid
+)
+{
+    return bitGrid->hash;
+}
+
 /*
  * @function TBitGridMakeGridPosWithIndex
  *
@@ -149,8 +464,8 @@ TBitGridMakeGridPosWithIndex(
 )
 {
     TGridPos        P = {
-                        .i = (W % bitGrid->dimensions.nWordsPerRow) + b,
-                        .j = W / bitGrid->dimensions.nWordsPerRow
+                        .i = (W % bitGrid->dimensions.nWordsPerRow) * bitGrid->dimensions.nBitsPerWord + b - bitGrid->dimensions.nBorderCols,
+                        .j = TBitGridGetLogicalRow(bitGrid, W / bitGrid->dimensions.nWordsPerRow)
                     };
     return P;
 }
@@ -159,8 +474,7 @@ TBitGridMakeGridPosWithIndex(
  * @function TBitGridMakeGridIndexWithPos
  *
  * Given a bit grid and i,j positions, initialize and return the
- * corresponding grid index.  Negative values for i and j will not
- * produce useful results.
+ * corresponding grid index.  The position must lie on the grid.
  */
 static inline TGridIndex
 TBitGridMakeGridIndexWithPos(
@@ -169,10 +483,11 @@ TBitGridMakeGridIndexWithPos(
     int         j
 )
 {
-    unsigned int    offsetH = j * bitGrid->dimensions.nWordsPerRow;
+    unsigned int    offsetH = TBitGridGetRowWordOffset(bitGrid, j);
+    unsigned int    bit = i + bitGrid->dimensions.nBorderCols;
     TGridIndex      I = {
-                        .W = offsetH + i / bitGrid->dimensions.nBitsPerWord,
-                        .b = i % bitGrid->dimensions.nBitsPerWord
+                        .W = offsetH + bit / bitGrid->dimensions.nBitsPerWord,
+                        .b = bit % bitGrid->dimensions.nBitsPerWord
                     };
     return I;
 }
@@ -181,8 +496,7 @@ TBitGridMakeGridIndexWithPos(
  * @function TBitGridPosToIndex
  *
  * Given a game board and grid position P, initialize and return
- * the corresponding grid index.  Negative values for P.i and P.j
- *  will not produce useful results.
+ * the corresponding grid index.  The position must lie on the grid.
  */
 static inline TGridIndex
 TBitGridPosToIndex(
@@ -190,10 +504,11 @@ TBitGridPosToIndex(
     TGridPos        P
 )
 {
-    int    offsetH = P.j * bitGrid->dimensions.nWordsPerRow;
+    unsigned int    offsetH = TBitGridGetRowWordOffset(bitGrid, P.j);
+    unsigned int    bit = P.i + bitGrid->dimensions.nBorderCols;
     TGridIndex      I = {
-                        .W = offsetH + P.i / bitGrid->dimensions.nBitsPerWord,
-                        .b = P.i % bitGrid->dimensions.nBitsPerWord
+                        .W = offsetH + bit / bitGrid->dimensions.nBitsPerWord,
+                        .b = bit % bitGrid->dimensions.nBitsPerWord
                     };
     return I;
 }
@@ -212,8 +527,8 @@ TBitGridIndexToPos(
 {
     unsigned int    remnant = I.W % bitGrid->dimensions.nWordsPerRow;
     TGridPos        P = {
-                        .j = I.W / bitGrid->dimensions.nWordsPerRow,
-                        .i = ((remnant * bitGrid->dimensions.nBitsPerWord) + I.b)
+                        .j = TBitGridGetLogicalRow(bitGrid, I.W / bitGrid->dimensions.nWordsPerRow),
+                        .i = ((remnant * bitGrid->dimensions.nBitsPerWord) + I.b) - bitGrid->dimensions.nBorderCols
                     };
     return P;
 }
@@ -238,6 +553,9 @@ TBitGridGetValueAtIndex(
  *
  * Given a bit grid and grid index I, set the bits across all
  * channels at that location using the sequence of bits in value.
+ *
+ * Marking the cell dirty maps I back to a logical row (a search of the
+ * row map); prefer TBitGridSetValueAtPosition() on hot paths.
  */
 static inline void
 TBitGridSetValueAtIndex(
@@ -246,7 +564,12 @@ TBitGridSetValueAtIndex(
     TCell           value
 )
 {
-    return bitGrid->callbacks.setCellValueAtIndex(bitGrid, I, value);
+    TGridPos        P = TBitGridIndexToPos(bitGrid, I);
+    bool            wasSet = bitGrid->callbacks.getCellValueAtIndex(bitGrid, I) & 0x1;
+    
+    TBitGridAddDirtyRect(bitGrid, TGridRectMake(P.i, P.j, P.i, P.j));
+    bitGrid->callbacks.setCellValueAtIndex(bitGrid, I, value);
+    if ( wasSet != (value & 0x1) ) TBitGridUpdateCellFeatures(bitGrid, P, wasSet, value & 0x1);
 }
 
 /*
@@ -279,7 +602,12 @@ TBitGridSetValueAtPosition(
     TCell           value
 )
 {
-    return bitGrid->callbacks.setCellValueAtIndex(bitGrid, TBitGridPosToIndex(bitGrid, P), value);
+    TGridIndex      I = TBitGridPosToIndex(bitGrid, P);
+    bool            wasSet = bitGrid->callbacks.getCellValueAtIndex(bitGrid, I) & 0x1;
+    
+    TBitGridAddDirtyRect(bitGrid, TGridRectMake(P.i, P.j, P.i, P.j));
+    bitGrid->callbacks.setCellValueAtIndex(bitGrid, I, value);
+    if ( wasSet != (value & 0x1) ) TBitGridUpdateCellFeatures(bitGrid, P, wasSet, value & 0x1);
 }
 
 /*
@@ -326,6 +654,47 @@ typedef unsigned int TBitGridWordSize;
  */
 TBitGrid* TBitGridCreate(TBitGridWordSize wordSize, unsigned int nChannels, unsigned int w, unsigned int h);
 
+/*
+ * @enum TBitGrid options
+ *
+ * Flags that alter the layout of a TBitGrid:
+ *
+ * - sentinel border:  surround the grid with permanently-set guard bits (3
+ *       columns to the left and right, a guard row above and below) so that
+ *       4x4 extraction at any position from (-3,-3) to (w-1,h-1) needs no
+ *       edge handling; ignored on big-endian hosts
+ */
+enum {
+    TBitGridOptionNone              = 0,
+    TBitGridOptionSentinelBorder    = 1 << 0
+};
+
+/*
+ * @typedef TBitGridOptions
+ *
+ * The type of a bit vector of TBitGrid options.
+ */
+typedef unsigned int TBitGridOptions;
+
+/*
+ * @constant TBITGRID_SENTINEL_BORDER_COLS
+ *
+ * The number of guard columns to either side of the cells of a grid
+ * created with TBitGridOptionSentinelBorder.
+ */
+#define TBITGRID_SENTINEL_BORDER_COLS 3
+
+/*
+ * @function TBitGridCreateWithOptions
+ *
+ * Allocate a new TBitGrid instance as with TBitGridCreate() but with the
+ * layout altered by options.  The guard bits of a sentinel border are
+ * invisible to every other TBitGrid function:  positions, iterators and fill
+ * counts cover only the w x h cells of the grid.  When the word size is
+ * chosen automatically the guard columns are included in the row width.
+ */
+TBitGrid* TBitGridCreateWithOptions(TBitGridWordSize wordSize, unsigned int nChannels, unsigned int w, unsigned int h, TBitGridOptions options);
+
 /*
  * @function TBitGridDestroy
  *
@@ -333,6 +702,124 @@ TBitGrid* TBitGridCreate(TBitGridWordSize wordSize, unsigned int nChannels, unsi
  */
 void TBitGridDestroy(TBitGrid* bitGrid);
 
+/*
+ * @function TBitGridGetCloneSize
+ *
+ * Returns the number of bytes of storage TBitGridCloneInit() needs for a
+ * clone of bitGrid holding channel 0 and the channels selected by
+ * channelMask.
+ */
+size_t TBitGridGetCloneSize(TBitGrid *bitGrid, TCell channelMask);
+
+/*
+ * @function TBitGridCloneInit
+ *
+ * Initialize a copy of bitGrid in caller-provided storage (at least
+ * TBitGridGetCloneSize() bytes, aligned to 8 bytes) and return it.  The
+ * clone has the same dimensions, feature cache, row map and kernels as
+ * bitGrid.  Channel 0 is always copied; of the other channels only those
+ * selected by channelMask are, and the clone has only as many channels as
+ * the highest of them needs (any unselected channels below it are empty).
+ * E.g. a mask of 0x1 copies just the occupancy of a game board, leaving
+ * out its completed-row and color channels.
+ *
+ * The clone owns no allocation of its own:  it must not be passed to
+ * TBitGridDestroy().
+ */
+TBitGrid* TBitGridCloneInit(void *storage, TBitGrid *bitGrid, TCell channelMask);
+
+/*
+ * @function TBitGridClone
+ *
+ * Allocate a copy of bitGrid with all of its channels.  The returned
+ * TBitGrid pointer is owned by the caller and should eventually be
+ * deallocated using the TBitGridDestroy() function.  Returns NULL on
+ * failure.
+ */
+TBitGrid* TBitGridClone(TBitGrid *bitGrid);
+
+/*
+ * @function TBitGridCopyInto
+ *
+ * Copy the state of srcGrid into dstGrid (e.g. a clone of it) without any
+ * allocation.  The grids must have the same dimensions, word size and
+ * border, or false is returned and nothing is copied.
+ *
+ * Channel 0, the feature cache and the row map are contiguous in storage
+ * and are copied together (the row weights depend only on the height, so
+ * they are left alone); the other channels selected by channelMask that
+ * both grids have are copied after them.  dstGrid's remaining channels keep
+ * their previous contents.
+ */
+bool TBitGridCopyInto(TBitGrid *dstGrid, TBitGrid *srcGrid, TCell channelMask);
+
+/*
+ * @typedef TBitGridSnapshotPool
+ *
+ * A stack of snapshots of a bit grid in a single arena, for lookahead
+ * search and undo.  Every slot of the arena is set up as a clone of the
+ * grid when the pool is created, so taking a snapshot is a copy of the
+ * grid's storage (see TBitGridCopyInto()) with no allocation.  The pool's
+ * channelMask selects the channels copied beside channel 0.
+ */
+typedef struct {
+    TCell           channelMask;
+    unsigned int    nSnapshots, nInUse;
+    size_t          nBytesPerSnapshot;
+    uint8_t         *arena;
+} TBitGridSnapshotPool;
+
+/*
+ * @function TBitGridSnapshotPoolCreate
+ *
+ * Allocate a pool of nSnapshots snapshots of grids shaped like bitGrid,
+ * holding channel 0 and the channels selected by channelMask.  Returns NULL
+ * on failure, otherwise the pool is owned by the caller and should
+ * eventually be deallocated using TBitGridSnapshotPoolDestroy().
+ */
+TBitGridSnapshotPool* TBitGridSnapshotPoolCreate(TBitGrid *bitGrid, TCell channelMask, unsigned int nSnapshots);
+
+/*
+ * @function TBitGridSnapshotPoolDestroy
+ *
+ * Deallocate pool and all of its snapshots.
+ */
+void TBitGridSnapshotPoolDestroy(TBitGridSnapshotPool *pool);
+
+/*
+ * @function TBitGridSnapshotPoolPush
+ *
+ * Take a snapshot of bitGrid in the next free slot of pool and return it.
+ * The snapshot is a TBitGrid in its own right:  a search can play moves on
+ * it (and push further snapshots of it) while bitGrid is left alone.
+ * Returns NULL if every slot is in use or bitGrid is not shaped like the
+ * grid the pool was created for.
+ */
+TBitGrid* TBitGridSnapshotPoolPush(TBitGridSnapshotPool *pool, TBitGrid *bitGrid);
+
+/*
+ * @function TBitGridSnapshotPoolPop
+ *
+ * Release the most recent snapshot in pool.  If bitGrid is not NULL the
+ * snapshot is first copied back into it (undoing whatever was done to
+ * bitGrid since the snapshot was taken).  Returns false if pool has no
+ * snapshots in use.
+ */
+bool TBitGridSnapshotPoolPop(TBitGridSnapshotPool *pool, TBitGrid *bitGrid);
+
+/*
+ * @function TBitGridSnapshotPoolReset
+ *
+ * Release every snapshot in pool.
+ */
+static inline void
+TBitGridSnapshotPoolReset(
+    TBitGridSnapshotPool    *pool
+)
+{
+    pool->nInUse = 0;
+}
+
 /*
  * @function TBitGridScroll
  *
@@ -366,6 +853,81 @@ void TBitGridFillCells(TBitGrid *bitGrid, TCell value);
  */
 void TBitGridSetChannelInRowRange(TBitGrid *bitGrid, unsigned int channelIdx, unsigned int jLow, unsigned int jHigh, bool value);
 
+/*
+ * @function TBitGridGetRowFillCount
+ *
+ * Returns the number of cells in row j of bitGrid that have their channel 0
+ * bit set.
+ */
+static inline unsigned int
+TBitGridGetRowFillCount(
+    TBitGrid        *bitGrid,
+    unsigned int    j
+)
+{
+    return bitGrid->rowFillCounts[TBitGridGetPhysicalRow(bitGrid, j)];
+}
+
+/*
+ * @function TBitGridIsRowFull
+ *
+ * Returns true if every cell in row j of bitGrid has its channel 0 bit set.
+ */
+static inline bool
+TBitGridIsRowFull(
+    TBitGrid        *bitGrid,
+    unsigned int    j
+)
+{
+    return (bitGrid->rowFillCounts[TBitGridGetPhysicalRow(bitGrid, j)] == bitGrid->dimensions.w);
+}
+
+/*
+ * @function TBitGridGetRowTransitions
+ *
+ * Returns the number of pairs of neighboring cells in row j of bitGrid
+ * whose channel 0 bits differ, counting the walls to either side of the
+ * row as set.  An empty row has two transitions, a full row none.
+ */
+static inline unsigned int
+TBitGridGetRowTransitions(
+    TBitGrid        *bitGrid,
+    unsigned int    j
+)
+{
+    return bitGrid->rowTransitions[TBitGridGetPhysicalRow(bitGrid, j)];
+}
+
+/*
+ * @function TBitGridGetRowWords
+ *
+ * Returns a pointer to the first word of logical row j in channel channelIdx
+ * of bitGrid; the row continues through nWordsPerRow words.  Column i is bit
+ * (nBorderCols + i) of the row, counting from the least-significant bit of
+ * the first word.
+ */
+static inline TBitGridChannelPtr
+TBitGridGetRowWords(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    unsigned int    j
+)
+{
+    TBitGridChannelPtr  row = {
+                            .b8 = bitGrid->grid[channelIdx].b8 + TBitGridGetRowWordOffset(bitGrid, j) * bitGrid->dimensions.nBytesPerWord
+                        };
+    return row;
+}
+
+/*
+ * @function TBitGridGetRowBits
+ *
+ * Returns the bits of logical row j in channel channelIdx of bitGrid with
+ * column i in bit i of the result.  Only the first 64 columns of a wider
+ * grid are returned; bits beyond the grid width are zero.
+ */
+uint64_t TBitGridGetRowBits(TBitGrid *bitGrid, unsigned int channelIdx, unsigned int j);
+
 /*
  * @function TBitGridExtract4x4AtPosition
  *
@@ -398,8 +960,63 @@ void TBitGridSetChannelInRowRange(TBitGrid *bitGrid, unsigned int channelIdx, un
  *      V  12 XXXX 15       12 .... 15
  *
  *           0xFE40    &     0x0132        = 0x0000  => no collision
+ *
+ * Cells that lie off the grid extract as set.  The extraction kernel is
+ * chosen when the grid is created (see TBitGridSetExtractKernel()).
  */
-uint16_t TBitGridExtract4x4AtPosition(TBitGrid *bitGrid, unsigned int channelIdx, TGridPos P);
+static inline uint16_t
+TBitGridExtract4x4AtPosition(
+    TBitGrid        *bitGrid,
+    unsigned int    channelIdx,
+    TGridPos        P
+)
+{
+    return bitGrid->callbacks.extract4x4AtPosition(bitGrid, channelIdx, P);
+}
+
+/*
+ * @enum TBitGrid extract kernel
+ *
+ * The 4x4 extraction kernels:
+ *
+ * - default:  the fastest kernel the processor supports
+ * - portable:  plain C code that works everywhere (per-word-size code, or
+ *       the straight-line bordered kernel for a grid with a sentinel border)
+ * - BMI2:  gathers the four rows with unaligned loads and packs the 4x4 with a
+ *       single PEXT instruction (x86-64 processors with BMI2 only)
+ */
+enum {
+    TBitGridExtractKernelDefault = 0,
+    TBitGridExtractKernelPortable,
+    TBitGridExtractKernelBMI2
+};
+
+/*
+ * @typedef TBitGridExtractKernel
+ *
+ * The type of a value from the TBitGrid extract kernel enumeration.
+ */
+typedef unsigned int TBitGridExtractKernel;
+
+/*
+ * @function TBitGridSetExtractKernel
+ *
+ * Select the 4x4 extraction kernel used by bitGrid.  A grid is created using
+ * TBitGridExtractKernelDefault, which on x86-64 consults the processor's cpuid
+ * features to determine whether BMI2 is present and fast.
+ *
+ * Returns false (and leaves the kernel unchanged) if the processor or build
+ * does not support the requested kernel.
+ */
+bool TBitGridSetExtractKernel(TBitGrid *bitGrid, TBitGridExtractKernel kernel);
+
+/*
+ * @function TBitGridGetExtractKernel
+ *
+ * Returns the 4x4 extraction kernel in use by bitGrid (never
+ * TBitGridExtractKernelDefault).
+ */
+TBitGridExtractKernel TBitGridGetExtractKernel(TBitGrid *bitGrid);
 
 /*
  * @function TBitGridSet4x4AtPosition
@@ -419,6 +1036,123 @@ uint16_t TBitGridExtract4x4AtPosition(TBitGrid *bitGrid, unsigned int channelIdx
  */
 void TBitGridSet4x4AtPosition(TBitGrid *bitGrid, unsigned int channelIdx, TGridPos P, uint16_t in4x4);
 
+/*
+ * @typedef TBitGridFeatures
+ *
+ * Board features of channel 0 of a bit grid, as a bot would weigh them:
+ *
+ * - aggregateHeight:  the sum of the column heights (a column's height is
+ *   the number of rows from its topmost set cell to the bottom)
+ * - holes:  the number of unset cells below the top of their column
+ * - bumpiness:  the sum of the height differences of neighboring columns
+ * - rowTransitions:  the sum of TBitGridGetRowTransitions() over all rows
+ * - wellDepths:  the sum of TBitGridGetWellDepth() over all columns
+ * - completedLines:  the number of rows completed (and removed) by the
+ *   tetromino added in TBitGridGetFeaturesWith4x4AtPosition()
+ */
+typedef struct {
+    unsigned int    aggregateHeight;
+    unsigned int    holes;
+    unsigned int    bumpiness;
+    unsigned int    rowTransitions;
+    unsigned int    wellDepths;
+    unsigned int    completedLines;
+} TBitGridFeatures;
+
+/*
+ * @function TBitGridGetFeatures
+ *
+ * Fill-in features with the board features of bitGrid.  The hole and
+ * transition counts are kept by the grid; the height-based features are
+ * summed over the column tops.
+ */
+void TBitGridGetFeatures(TBitGrid *bitGrid, TBitGridFeatures *features);
+
+/*
+ * @function TBitGridGetFeaturesWith4x4AtPosition
+ *
+ * Fill-in outFeatures with the board features bitGrid would have if in4x4
+ * were merged into channel 0 at grid position P and the rows it completes
+ * were removed; features must be the grid's current features (from
+ * TBitGridGetFeatures()).  The grid is not altered.
+ *
+ * Only the columns and rows under in4x4 (and the neighbors of those
+ * columns) are examined unless rows are completed; then the column
+ * heights are adjusted for the removed rows, and a column whose top lies
+ * in a removed row is scanned down to its next set cell.  Cells of in4x4
+ * off the grid are ignored.
+ */
+void TBitGridGetFeaturesWith4x4AtPosition(TBitGrid *bitGrid, const TBitGridFeatures *features, TGridPos P, uint16_t in4x4, TBitGridFeatures *outFeatures);
+
+/*
+ * @function TBitGridComputeFeatures
+ *
+ * Fill-in features with the board features of channel channelIdx of
+ * bitGrid, computed from the channel's storage rather than the grid's
+ * feature cache.  The cache only follows channel 0 and is bypassed by
+ * consumers that write storage directly; this is the fallback for those
+ * cases.  completedLines is set to zero, as are all features if channelIdx
+ * is not a channel of bitGrid.
+ *
+ * If columnTransitions is not NULL it is set to the number of vertically
+ * neighboring cells that differ, with the cells above the top of the grid
+ * counted as unset and those below the bottom as set (so an empty column
+ * has one transition).  If heights is not NULL it receives the height of
+ * each of the w columns.
+ *
+ * The channel is read a word at a time, one row slice of up to 63 columns
+ * (plus the column or wall to either side) at a time.  The set cells and
+ * the row and column transitions of a run of slices are summed with
+ * population counts by the grid's features kernel (see
+ * TBitGridSetFeaturesKernel()).  The holes follow from the set cells and
+ * the column heights; those are found by OR-ing slices down from the top
+ * until every column of the slice has been seen.
+ */
+void TBitGridComputeFeatures(TBitGrid *bitGrid, unsigned int channelIdx, TBitGridFeatures *features, unsigned int *columnTransitions, unsigned int *heights);
+
+/*
+ * @enum TBitGrid features kernel
+ *
+ * The kernels that sum row slices for TBitGridComputeFeatures():
+ *
+ * - default:  the fastest kernel the processor supports
+ * - portable:  plain C code, one slice at a time
+ * - AVX2:  four slices at a time, with the population counts done by
+ *       nibble table lookups (x86-64 processors with AVX2 only)
+ */
+enum {
+    TBitGridFeaturesKernelDefault = 0,
+    TBitGridFeaturesKernelPortable,
+    TBitGridFeaturesKernelAVX2
+};
+
+/*
+ * @typedef TBitGridFeaturesKernel
+ *
+ * The type of a value from the TBitGrid features kernel enumeration.
+ */
+typedef unsigned int TBitGridFeaturesKernel;
+
+/*
+ * @function TBitGridSetFeaturesKernel
+ *
+ * Select the features kernel used by bitGrid.  A grid is created using
+ * TBitGridFeaturesKernelDefault, which on x86-64 consults the processor's
+ * cpuid features to determine whether AVX2 is present.
+ *
+ * Returns false (and leaves the kernel unchanged) if the processor or build
+ * does not support the requested kernel.
+ */
+bool TBitGridSetFeaturesKernel(TBitGrid *bitGrid, TBitGridFeaturesKernel kernel);
+
+/*
+ * @function TBitGridGetFeaturesKernel
+ *
+ * Returns the features kernel in use by bitGrid (never
+ * TBitGridFeaturesKernelDefault).
+ */
+TBitGridFeaturesKernel TBitGridGetFeaturesKernel(TBitGrid *bitGrid);
+
 /*
  * @enum TBitGrid channel summary kind
  *
@@ -481,25 +1215,53 @@ typedef bool (*TBitGridIteratorNextFullRowFn)(struct TBitGridIterator *iterator,
 /*
  * @typedef TBitGridIterator
  *
- * Data structure that is dynamically-allocated and initialized by the
- * TBitGridIteratorCreate() function in order to iterate of the cells of
- * a TBitGrid.
+ * Data structure that is initialized by the TBitGridIteratorInit() function
+ * (in storage provided by the caller, e.g. on the stack) or dynamically-
+ * allocated and initialized by the TBitGridIteratorCreate() function in order
+ * to iterate of the cells of a TBitGrid.
  *
  * Consumers of the TBitGridIterator functionality should not attempt to
  * alter the contents of this data structure directly.
  */
 typedef struct TBitGridIterator {
+    TBitGrid                            *bitGrid;
     TBitGridDimensions                  dimensions;
     unsigned int                        i, j, jMax;
     unsigned int                        nFullWords, nPartialBits;
     bool                                isStarted;
-    TBitGridStorage                     grid;
+    unsigned int                        channelIdx;     // the channel when only one is selected
+    TCell                               channelMask;
+    TBitGridChannelPtr                  grid[TBITGRID_MAX_CHANNELS];
     struct {
         TBitGridIteratorNextFn          nextFn;
         TBitGridIteratorNextFullRowFn   nextFullRowFn;
     } callbacks;
 } TBitGridIterator;
 
+/*
+ * @function TBitGridIteratorInit
+ *
+ * Initialize the iterator at iterator to enumerate (in the forward direction)
+ * the cells in bitGrid.  Only the bit values in the channels selected by
+ * channelMask will be enumerated.  No memory is allocated, so an iterator
+ * initialized this way needs no disposal.
+ *
+ * Returns false if channelMask selects none of the channels of bitGrid.
+ */
+bool TBitGridIteratorInit(TBitGridIterator *iterator, TBitGrid *bitGrid, TCell channelMask);
+
+/*
+ * @function TBitGridIteratorInitWithRowRange
+ *
+ * Initialize the iterator at iterator to enumerate (in the forward direction)
+ * the cells in rows startRow through endRow of bitGrid.  Only the bit values in
+ * the channels selected by channelMask will be enumerated.  No memory is
+ * allocated, so an iterator initialized this way needs no disposal.
+ *
+ * Returns false if channelMask selects none of the channels of bitGrid.
+ */
+bool TBitGridIteratorInitWithRowRange(TBitGridIterator *iterator, TBitGrid *bitGrid, TCell channelMask, unsigned int startRow, unsigned int endRow);
+
 /*
  * @function TBitGridIteratorCreate
  *
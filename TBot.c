@@ -0,0 +1,269 @@
+/*	TBot.c
+	Copyright (c) 2024, J T Frey
+*/
+
+#include "TBot.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+
+const TBotWeights TBotWeightsDefault = {
+                    .aggregateHeight = -0.510066,
+                    .completedLines = 0.760666,
+                    .holes = -0.35663,
+                    .bumpiness = -0.184483,
+                    .rowTransitions = 0.0,
+                    .wellDepths = 0.0
+                };
+
+//
+
+/*
+ * @function __TBotWeightsNameMatches
+ *
+ * Returns true if name is featureName ignoring case, with any of a
+ * space, hyphen or underscore standing for the spaces in featureName.
+ */
+static bool
+__TBotWeightsNameMatches(
+    const char  *name,
+    const char  *featureName
+)
+{
+    while ( *name && *featureName ) {
+        if ( *featureName == ' ' ) {
+            if ( (*name != ' ') && (*name != '-') && (*name != '_') ) return false;
+        } else if ( toupper(*name) != *featureName ) {
+            return false;
+        }
+        name++, featureName++;
+    }
+    return ! *name && ! *featureName;
+}
+
+//
+
+TBotWeights*
+TBotWeightsInitWithFile(
+    TBotWeights     *weights,
+    const char      *filepath
+)
+{
+    FILE            *fptr = fopen(filepath, "r");
+    char            line[256];
+    unsigned int    lineNo = 0;
+
+    if ( ! fptr ) {
+        fprintf(stderr, "ERROR:  unable to read weights file '%s' (errno = %d)\n", filepath, errno);
+        exit(EINVAL);
+    }
+    TBotWeightsInit(weights);
+    while ( fgets(line, sizeof(line), fptr) ) {
+        char        *name = line, *value, *end;
+        double      *weight;
+        double      v;
+
+        lineNo++;
+        if ( ! strchr(line, '\n') && ! feof(fptr) ) {
+            fprintf(stderr, "ERROR:  line %u of '%s' is too long\n", lineNo, filepath);
+            exit(EINVAL);
+        }
+        // Drop any comment and trailing whitespace; skip blank lines:
+        if ( (end = strchr(line, '#')) ) *end = '\0';
+        end = line + strlen(line);
+        while ( (end > line) && isspace(*(end - 1)) ) *(--end) = '\0';
+        while ( isspace(*name) ) name++;
+        if ( ! *name ) continue;
+
+        if ( ! (value = strchr(name, '=')) ) {
+            fprintf(stderr, "ERROR:  no '=' on line %u of '%s'\n", lineNo, filepath);
+            exit(EINVAL);
+        }
+        end = value;
+        *value++ = '\0';
+        while ( (end > name) && isspace(*(end - 1)) ) *(--end) = '\0';
+
+        if ( __TBotWeightsNameMatches(name, "AGGREGATE HEIGHT") ) weight = &weights->aggregateHeight;
+        else if ( __TBotWeightsNameMatches(name, "COMPLETED LINES") ) weight = &weights->completedLines;
+        else if ( __TBotWeightsNameMatches(name, "HOLES") ) weight = &weights->holes;
+        else if ( __TBotWeightsNameMatches(name, "BUMPINESS") ) weight = &weights->bumpiness;
+        else if ( __TBotWeightsNameMatches(name, "ROW TRANSITIONS") ) weight = &weights->rowTransitions;
+        else if ( __TBotWeightsNameMatches(name, "WELL DEPTHS") ) weight = &weights->wellDepths;
+        else {
+            fprintf(stderr, "ERROR:  invalid feature '%s' on line %u of '%s'\n", name, lineNo, filepath);
+            exit(EINVAL);
+        }
+        while ( isspace(*value) ) value++;
+        v = strtod(value, &end);
+        while ( isspace(*end) ) end++;
+        if ( (end == value) || *end || ! isfinite(v) ) {
+            fprintf(stderr, "ERROR:  invalid weight '%s' for '%s' on line %u of '%s'\n", value, name, lineNo, filepath);
+            exit(EINVAL);
+        }
+        *weight = v;
+    }
+    fclose(fptr);
+    return weights;
+}
+
+//
+////
+//
+
+TBot*
+TBotCreate(
+    const TBotWeights   *weights,
+    unsigned int        w,
+    unsigned int        h
+)
+{
+    TBot                *newBot = (TBot*)malloc(sizeof(TBot));
+
+    if ( newBot ) {
+        newBot->moveGen = TMoveGenCreate(w, h);
+        if ( ! newBot->moveGen ) {
+            free((void*)newBot);
+            return NULL;
+        }
+        newBot->weights = weights ? *weights : TBotWeightsDefault;
+        newBot->pieceCount = ULONG_MAX;
+        newBot->target = TSpriteMakeEmpty();
+        newBot->isTuck = false;
+    }
+    return newBot;
+}
+
+//
+
+void
+TBotDestroy(
+    TBot    *bot
+)
+{
+    TMoveGenDestroy(bot->moveGen);
+    free((void*)bot);
+}
+
+//
+
+/*
+ * @function __TBotScorePlacement
+ *
+ * Score the board gameBoard would be left with by placement, given the
+ * board's current features.  Sets *isOverTop if any cell of the placement
+ * lies above the board.
+ */
+static double
+__TBotScorePlacement(
+    TBot                    *bot,
+    TBitGrid                *gameBoard,
+    const TBitGridFeatures  *features,
+    TSprite                 *placement,
+    bool                    *isOverTop
+)
+{
+    uint16_t                shape = TSpriteGet4x4(placement);
+    TBitGridFeatures        after;
+
+    // Rows above the board are the low-order rows of the 4x4:
+    *isOverTop = (placement->P.j < 0) && ((placement->P.j <= -4) || (shape & ((1 << (4 * -placement->P.j)) - 1)));
+    TBitGridGetFeaturesWith4x4AtPosition(gameBoard, features, placement->P, shape, &after);
+    return bot->weights.aggregateHeight * after.aggregateHeight + bot->weights.completedLines * after.completedLines +
+           bot->weights.holes * after.holes + bot->weights.bumpiness * after.bumpiness +
+           bot->weights.rowTransitions * after.rowTransitions + bot->weights.wellDepths * after.wellDepths;
+}
+
+//
+
+bool
+TBotChoosePlacement(
+    TBot            *bot,
+    TGameEngine     *gameEngine,
+    TSprite         *placement
+)
+{
+    unsigned int        nPlacements = TMoveGenGeneratePlacements(bot->moveGen, gameEngine->gameBoard, &gameEngine->currentSprite);
+    unsigned int        placementIdx = 0, bestIdx = 0;
+    double              bestScore = -INFINITY;
+    bool                isBestOverTop = true;
+    TBitGridFeatures    features;
+
+    if ( ! nPlacements ) return false;
+
+    TBitGridGetFeatures(gameEngine->gameBoard, &features);
+    while ( placementIdx < nPlacements ) {
+        bool            isOverTop;
+        double          score = __TBotScorePlacement(bot, gameEngine->gameBoard, &features, &bot->moveGen->placements[placementIdx], &isOverTop);
+
+        // Anything that stays on the board beats anything that does not:
+        if ( (isBestOverTop && ! isOverTop) || ((isBestOverTop == isOverTop) && (score > bestScore)) ) {
+            bestScore = score;
+            bestIdx = placementIdx;
+            isBestOverTop = isOverTop;
+        }
+        placementIdx++;
+    }
+    *placement = bot->moveGen->placements[bestIdx];
+    return true;
+}
+
+//
+
+bool
+TBotNextPlacement(
+    TGameEngine     *gameEngine,
+    void            *context,
+    TSprite         *placement
+)
+{
+    return TBotChoosePlacement((TBot*)context, gameEngine, placement);
+}
+
+//
+
+TGameEngineEvent
+TBotNextEvent(
+    TGameEngine     *gameEngine,
+    void            *context
+)
+{
+#define THE_BOT ((TBot*)context)
+    unsigned long       pieceCount = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+    TGameEngineEvent    events[1];
+    int                 nEvents = -1, landingRow;
+
+    // Choose where a new tetromino goes (a new game's count can match the
+    // last game's, so check the tetromino, too); the path from where it is
+    // now is then found on every call:
+    if ( (pieceCount != THE_BOT->pieceCount) || (THE_BOT->target.tetrominoId != gameEngine->currentSprite.tetrominoId) ) {
+        THE_BOT->pieceCount = pieceCount;
+        if ( ! TBotChoosePlacement(THE_BOT, gameEngine, &THE_BOT->target) ) return TGameEngineEventHardDrop;
+        
+        // As in TGameEngineApplyRestingPlacement(), a target that a rotation,
+        // shifts and hard drop reach from here is hard dropped to, and any
+        // other is a tuck or slide, soft dropped all the way:
+        nEvents = TGameEngineFindPlacementPath(gameEngine, THE_BOT->target.orientation, THE_BOT->target.P.i, &landingRow, events, 1);
+        THE_BOT->isTuck = (nEvents < 0) || (landingRow != THE_BOT->target.P.j);
+    }
+    
+    // Rotate and shift where the tetromino is, then hard drop:
+    if ( ! THE_BOT->isTuck ) {
+        nEvents = TGameEngineFindPlacementPath(gameEngine, THE_BOT->target.orientation, THE_BOT->target.P.i, &landingRow, events, 1);
+        if ( (nEvents >= 0) && (landingRow == THE_BOT->target.P.j) ) return nEvents ? events[0] : TGameEngineEventHardDrop;
+        THE_BOT->isTuck = true;
+    }
+    
+    // Otherwise follow the shortest path:
+    nEvents = TMoveGenFindPath(THE_BOT->moveGen, &gameEngine->currentSprite, &THE_BOT->target, events, 1);
+    if ( nEvents < 0 ) {
+        // Carried out of reach by gravity -- choose again from here:
+        if ( ! TBotChoosePlacement(THE_BOT, gameEngine, &THE_BOT->target) ) return TGameEngineEventHardDrop;
+        nEvents = TMoveGenFindPath(THE_BOT->moveGen, &gameEngine->currentSprite, &THE_BOT->target, events, 1);
+        if ( nEvents < 0 ) return TGameEngineEventHardDrop;
+    }
+    
+    // At the target, the hard drop only locks the tetromino:
+    return nEvents ? events[0] : TGameEngineEventHardDrop;
+#undef THE_BOT
+}
@@ -0,0 +1,171 @@
+/*	TBot.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Built-in player
+	The bot plays a TGameEngine by itself.  For each tetromino it finds
+	every reachable resting position with the placement generator, scores
+	the board that each would leave behind, and goes for the best one.
+
+	A board is scored by a weighted sum of features of the board after
+	any completed lines have been removed:
+
+	    AGGREGATE HEIGHT    sum of the heights of the columns
+	    COMPLETED LINES     number of lines the placement completes
+	    HOLES               empty cells with an occupied cell above them
+	                        in the same column
+	    BUMPINESS           sum of the differences in height of
+	                        neighboring columns
+	    ROW TRANSITIONS     number of neighboring cells (and walls) in
+	                        each row that differ in occupancy
+	    WELL DEPTHS         sum of the depths of columns lying below
+	                        both of their neighbors
+
+	The features come from the game board's incrementally-maintained
+	feature cache (see TBitGridGetFeaturesWith4x4AtPosition()), so each
+	placement is scored without rescanning the board.  The last two
+	features have zero weight unless a weights file gives them one.
+
+	A placement that leaves cells above the top of the board is only
+	chosen if there is no other.
+
+	The weights can be read from a text file, so they can be tuned
+	without rebuilding.  Like a keymap file, hash symbols delineate
+	comments and each line is of the form
+
+	    <feature> = <weight>
+
+	Features that are not mentioned keep their default weights (see
+	example-weights.txt).
+
+	The bot can drive the engine one placement at a time (for the
+	headless driver's placement mode) or one event at a time (for the
+	TUI and the headless driver's event mode):  rotations and shifts at
+	the height the tetromino is at followed by a hard drop, or the
+	shortest path of moves for a tuck or slide.
+*/
+
+#ifndef __TBOT_H__
+#define __TBOT_H__
+
+#include "tetrominotris_config.h"
+#include "TGameEngine.h"
+#include "TMoveGen.h"
+
+/*
+ * @typedef TBotWeights
+ *
+ * The weight of each board feature in a placement's score; the
+ * placement with the highest score is chosen, so features that make
+ * a board worse should have negative weights.
+ */
+typedef struct {
+    double      aggregateHeight;
+    double      completedLines;
+    double      holes;
+    double      bumpiness;
+    double      rowTransitions;
+    double      wellDepths;
+} TBotWeights;
+
+/*
+ * @constant TBotWeightsDefault
+ *
+ * The default weights.
+ */
+extern const TBotWeights TBotWeightsDefault;
+
+/*
+ * @function TBotWeightsInit
+ *
+ * Initialize the TBotWeights at pointer weights to the default
+ * weights.
+ */
+static inline TBotWeights*
+TBotWeightsInit(
+    TBotWeights     *weights
+)
+{
+    *weights = TBotWeightsDefault;
+    return weights;
+}
+
+/*
+ * @function TBotWeightsInitWithFile
+ *
+ * Initialize weights to the defaults and replace the weights of the
+ * features listed in the text file at filepath.
+ *
+ * If the file cannot be read or any error occurs while parsing it, an
+ * error message is displayed and the program exits with EINVAL.
+ */
+TBotWeights* TBotWeightsInitWithFile(TBotWeights *weights, const char *filepath);
+
+/*
+ * @typedef TBot
+ *
+ * A bot for boards of a fixed size:  its weights, its placement
+ * generator, and the placement it has chosen for the in-play
+ * tetromino (with the tetromino count at the time it was chosen, and
+ * whether it is a tuck or slide rather than a rotate, shift and hard
+ * drop from where the tetromino spawned).
+ */
+typedef struct {
+    TBotWeights         weights;
+    TMoveGen            *moveGen;
+    unsigned long       pieceCount;
+    TSprite             target;
+    bool                isTuck;
+} TBot;
+
+/*
+ * @function TBotCreate
+ *
+ * Create a bot that plays w x h boards with the given weights (the
+ * defaults if weights is NULL).  Returns NULL if the board is too wide
+ * for the placement generator or memory could not be allocated.
+ */
+TBot* TBotCreate(const TBotWeights *weights, unsigned int w, unsigned int h);
+
+/*
+ * @function TBotDestroy
+ *
+ * Dispose of bot.
+ */
+void TBotDestroy(TBot *bot);
+
+/*
+ * @function TBotChoosePlacement
+ *
+ * Generate the resting positions of the in-play tetromino of
+ * gameEngine and set *placement to the one with the best score.
+ * Returns false if the tetromino has nowhere to go.
+ */
+bool TBotChoosePlacement(TBot *bot, TGameEngine *gameEngine, TSprite *placement);
+
+/*
+ * @function TBotNextPlacement
+ *
+ * A THeadlessPlacementFn that plays the bot; context must be a
+ * pointer to a TBot.
+ */
+bool TBotNextPlacement(TGameEngine *gameEngine, void *context, TSprite *placement);
+
+/*
+ * @function TBotNextEvent
+ *
+ * A THeadlessPlayerFn that plays the bot one event at a time; context
+ * must be a pointer to a TBot.  A placement is chosen when a new
+ * tetromino comes into play.  If rotating and shifting the tetromino
+ * where it is and hard dropping it lands it on the placement (see
+ * TGameEngineFindPlacementPath()), each call returns the next of those
+ * events; only tucks and slides are reached by the shortest path of
+ * moves (soft drops included) from the placement generator.  The path
+ * is found from where the tetromino is now on every call, so gravity
+ * moving it in between calls does no harm; should gravity carry it past
+ * where it can reach the chosen placement, another is chosen.
+ */
+TGameEngineEvent TBotNextEvent(TGameEngine *gameEngine, void *context);
+
+#endif /* __TBOT_H__ */
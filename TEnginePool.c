@@ -0,0 +1,321 @@
+/*	TEnginePool.c
+	Copyright (c) 2024, J T Frey
+*/
+
+#include "TEnginePool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * A worker's remaining range of game indices, [begin, end), packed
+ * into a single 64-bit word:  begin in the low 32 bits, end in the
+ * high 32 bits.
+ */
+#define TENGINEPOOL_RANGE_MAKE(B, E)    (((uint64_t)(E) << 32) | (uint64_t)(B))
+#define TENGINEPOOL_RANGE_BEGIN(R)      ((uint32_t)(R))
+#define TENGINEPOOL_RANGE_END(R)        ((uint32_t)((R) >> 32))
+
+/*
+ * Each worker's state is padded out to a cache line so the ranges
+ * being hammered by compare-and-swap do not share lines.
+ */
+typedef struct {
+    _Atomic uint64_t    range;
+    TEnginePool         *enginePool;
+    unsigned int        workerIdx;
+    TGameEngine         *gameEngine;
+    pthread_t           thread;
+} __attribute__((aligned(64))) TEnginePoolWorker;
+
+struct TEnginePool {
+    unsigned int        nThreads;
+    TEnginePoolWorker   *workers;
+
+    // The batch in progress:
+    TEnginePoolGameFn   gameFn;
+    void                *context;
+    THeadlessGameResult *results;
+};
+
+//
+
+TEnginePool*
+TEnginePoolCreate(
+    unsigned int        nThreads,
+    TBitGridWordSize    wordSize,
+    bool                useColor,
+    unsigned int        w,
+    unsigned int        h,
+    unsigned int        startingLevel
+)
+{
+    TEnginePool         *newPool;
+
+    if ( nThreads == 0 ) {
+        long            nCPU = sysconf(_SC_NPROCESSORS_ONLN);
+
+        nThreads = (nCPU > 0) ? (unsigned int)nCPU : 1;
+    }
+    newPool = (TEnginePool*)malloc(sizeof(TEnginePool));
+    if ( newPool ) {
+        newPool->workers = (TEnginePoolWorker*)aligned_alloc(64, nThreads * sizeof(TEnginePoolWorker));
+        if ( newPool->workers ) {
+            unsigned int    workerIdx = 0;
+
+            memset(newPool->workers, 0, nThreads * sizeof(TEnginePoolWorker));
+            newPool->nThreads = nThreads;
+            while ( workerIdx < nThreads ) {
+                TEnginePoolWorker   *worker = &newPool->workers[workerIdx];
+
+                worker->enginePool = newPool;
+                worker->workerIdx = workerIdx;
+                worker->gameEngine = TGameEngineCreate(wordSize, useColor, w, h, startingLevel);
+                if ( ! worker->gameEngine ) {
+                    TEnginePoolDestroy(newPool);
+                    return NULL;
+                }
+                TGameEngineSetClockSource(worker->gameEngine, TGameEngineClockSourceVirtual);
+                atomic_init(&worker->range, TENGINEPOOL_RANGE_MAKE(0, 0));
+                workerIdx++;
+            }
+        } else {
+            free((void*)newPool);
+            newPool = NULL;
+        }
+    }
+    return newPool;
+}
+
+//
+
+void
+TEnginePoolDestroy(
+    TEnginePool     *enginePool
+)
+{
+    unsigned int    workerIdx = 0;
+
+    while ( workerIdx < enginePool->nThreads ) {
+        TGameEngine *gameEngine = enginePool->workers[workerIdx++].gameEngine;
+
+        if ( gameEngine ) {
+            TBitGridDestroy(gameEngine->gameBoard);
+            free((void*)gameEngine);
+        }
+    }
+    free((void*)enginePool->workers);
+    free((void*)enginePool);
+}
+
+//
+
+unsigned int
+TEnginePoolGetThreadCount(
+    TEnginePool     *enginePool
+)
+{
+    return enginePool->nThreads;
+}
+
+//
+
+/*
+ * @function __TEnginePoolTakeGame
+ *
+ * Take the first game index from worker's own range.  Returns false
+ * if the range is empty.
+ */
+static bool
+__TEnginePoolTakeGame(
+    TEnginePoolWorker   *worker,
+    uint32_t            *gameIdx
+)
+{
+    uint64_t            range = atomic_load_explicit(&worker->range, memory_order_relaxed);
+
+    while ( TENGINEPOOL_RANGE_BEGIN(range) < TENGINEPOOL_RANGE_END(range) ) {
+        uint64_t        newRange = TENGINEPOOL_RANGE_MAKE(TENGINEPOOL_RANGE_BEGIN(range) + 1, TENGINEPOOL_RANGE_END(range));
+
+        if ( atomic_compare_exchange_weak_explicit(&worker->range, &range, newRange, memory_order_acq_rel, memory_order_relaxed) ) {
+            *gameIdx = TENGINEPOOL_RANGE_BEGIN(range);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @function __TEnginePoolStealGames
+ *
+ * Move the back half of the largest range held by another worker into
+ * thief's (empty) range.  Returns false if there is nothing left to
+ * steal anywhere in the pool.
+ */
+static bool
+__TEnginePoolStealGames(
+    TEnginePoolWorker   *thief
+)
+{
+    TEnginePool         *enginePool = thief->enginePool;
+
+    while ( 1 ) {
+        TEnginePoolWorker   *victim = NULL;
+        uint64_t            victimRange = 0;
+        uint32_t            victimSize = 0;
+        unsigned int        workerIdx = 0;
+
+        // Find the worker with the most games left:
+        while ( workerIdx < enginePool->nThreads ) {
+            TEnginePoolWorker   *worker = &enginePool->workers[workerIdx++];
+
+            if ( worker != thief ) {
+                uint64_t        range = atomic_load_explicit(&worker->range, memory_order_relaxed);
+                uint32_t        size = TENGINEPOOL_RANGE_END(range) - TENGINEPOOL_RANGE_BEGIN(range);
+
+                if ( TENGINEPOOL_RANGE_BEGIN(range) < TENGINEPOOL_RANGE_END(range) && size > victimSize ) {
+                    victim = worker;
+                    victimRange = range;
+                    victimSize = size;
+                }
+            }
+        }
+        if ( ! victim ) return false;
+
+        // Split the victim's range; a single game is taken whole.  If the
+        // victim's range changed in the meantime, look again:
+        {
+            uint32_t    begin = TENGINEPOOL_RANGE_BEGIN(victimRange);
+            uint32_t    end = TENGINEPOOL_RANGE_END(victimRange);
+            uint32_t    split = end - (victimSize + 1) / 2;
+
+            if ( atomic_compare_exchange_strong_explicit(&victim->range, &victimRange, TENGINEPOOL_RANGE_MAKE(begin, split), memory_order_acq_rel, memory_order_relaxed) ) {
+                atomic_store_explicit(&thief->range, TENGINEPOOL_RANGE_MAKE(split, end), memory_order_release);
+                return true;
+            }
+        }
+    }
+}
+
+/*
+ * @function __TEnginePoolWorkerMain
+ *
+ * Thread entry point for a worker:  play games from the worker's own
+ * range, steal when it runs dry, and exit when no work remains.
+ */
+static void*
+__TEnginePoolWorkerMain(
+    void                *context
+)
+{
+#define WORKER ((TEnginePoolWorker*)context)
+    TEnginePool         *enginePool = WORKER->enginePool;
+    uint32_t            gameIdx;
+
+    do {
+        while ( __TEnginePoolTakeGame(WORKER, &gameIdx) ) {
+            enginePool->gameFn(WORKER->gameEngine, gameIdx, enginePool->context, &enginePool->results[gameIdx]);
+        }
+    } while ( __TEnginePoolStealGames(WORKER) );
+    return NULL;
+#undef WORKER
+}
+
+//
+
+bool
+TEnginePoolRun(
+    TEnginePool         *enginePool,
+    unsigned long       nGames,
+    TEnginePoolGameFn   gameFn,
+    void                *context,
+    THeadlessGameResult *results
+)
+{
+    unsigned int        workerIdx = 0, nStarted;
+
+    if ( nGames > UINT32_MAX ) return false;
+
+    enginePool->gameFn = gameFn;
+    enginePool->context = context;
+    enginePool->results = results;
+
+    // Deal the games out in equal contiguous ranges:
+    while ( workerIdx < enginePool->nThreads ) {
+        uint32_t        begin = (uint32_t)((nGames * workerIdx) / enginePool->nThreads);
+        uint32_t        end = (uint32_t)((nGames * (workerIdx + 1)) / enginePool->nThreads);
+
+        atomic_store_explicit(&enginePool->workers[workerIdx].range, TENGINEPOOL_RANGE_MAKE(begin, end), memory_order_relaxed);
+        workerIdx++;
+    }
+
+    // The calling thread acts as worker zero.  If a thread cannot be started
+    // its range is simply stolen by the workers that did start:
+    nStarted = 1;
+    while ( nStarted < enginePool->nThreads ) {
+        TEnginePoolWorker   *worker = &enginePool->workers[nStarted];
+
+        if ( pthread_create(&worker->thread, NULL, __TEnginePoolWorkerMain, worker) != 0 ) break;
+        nStarted++;
+    }
+    __TEnginePoolWorkerMain(&enginePool->workers[0]);
+    workerIdx = 1;
+    while ( workerIdx < nStarted ) pthread_join(enginePool->workers[workerIdx++].thread, NULL);
+    return true;
+}
+
+//
+////
+//
+
+void
+TEnginePoolRandomGame(
+    TGameEngine         *gameEngine,
+    unsigned long       gameIdx,
+    void                *context,
+    THeadlessGameResult *result
+)
+{
+#define RANDOM_GAME ((TEnginePoolRandomGameContext*)context)
+    THeadlessRandomPlayer   thePlayer;
+    uint64_t                seed = RANDOM_GAME->baseSeed + gameIdx;
+
+    TGameEngineResetWithSeed(gameEngine, seed);
+    THeadlessRandomPlayerInit(&thePlayer, ~seed);
+    if ( RANDOM_GAME->shouldUsePlacements ) {
+        if ( RANDOM_GAME->shouldUseMoveGen )
+            thePlayer.moveGen = TMoveGenCreate(gameEngine->gameBoard->dimensions.w, gameEngine->gameBoard->dimensions.h);
+        THeadlessDriverPlayGameWithPlacements(gameEngine, THeadlessRandomPlayerNextPlacement, &thePlayer, &RANDOM_GAME->options, result);
+        if ( thePlayer.moveGen ) TMoveGenDestroy(thePlayer.moveGen);
+    } else
+        THeadlessDriverPlayGame(gameEngine, THeadlessRandomPlayerNextEvent, &thePlayer, &RANDOM_GAME->options, result);
+#undef RANDOM_GAME
+}
+
+//
+
+void
+TEnginePoolBotGame(
+    TGameEngine         *gameEngine,
+    unsigned long       gameIdx,
+    void                *context,
+    THeadlessGameResult *result
+)
+{
+#define BOT_GAME ((TEnginePoolBotGameContext*)context)
+    TBot                    *theBot = TBotCreate(&BOT_GAME->weights, gameEngine->gameBoard->dimensions.w, gameEngine->gameBoard->dimensions.h);
+    uint64_t                seed = BOT_GAME->baseSeed + gameIdx;
+
+    TGameEngineResetWithSeed(gameEngine, seed);
+    if ( ! theBot ) {
+        memset(result, 0, sizeof(*result));
+        result->seed = seed;
+        return;
+    }
+    if ( BOT_GAME->shouldUsePlacements )
+        THeadlessDriverPlayGameWithPlacements(gameEngine, TBotNextPlacement, theBot, &BOT_GAME->options, result);
+    else
+        THeadlessDriverPlayGame(gameEngine, TBotNextEvent, theBot, &BOT_GAME->options, result);
+    TBotDestroy(theBot);
+#undef BOT_GAME
+}
@@ -0,0 +1,148 @@
+/*	TEnginePool.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Engine pool
+	A pool of worker threads that play batches of headless games.  Each
+	worker owns a single TGameEngine (created once with the pool and
+	reset before every game), so the cost of a game is purely the cost
+	of playing it.
+
+	The games in a batch are identified by index 0 through N-1.  Each
+	worker starts with an equal, contiguous range of indices and plays
+	them from the front of its range.  A worker whose range is exhausted
+	steals the back half of the largest remaining range of another
+	worker.  Ranges are a pair of 32-bit indices packed in a single
+	atomic 64-bit word, so both taking and stealing are a lock-free
+	compare-and-swap; workers never wait on each other while there is
+	work left.
+
+	What a "game" means is up to the consumer:  a TEnginePoolGameFn is
+	called with the worker's engine and the game index and fills-in
+	the result record for that index.  TEnginePoolRandomGame() plays
+	a game with the headless driver's random player, TEnginePoolBotGame()
+	with the built-in bot.
+*/
+
+#ifndef __TENGINEPOOL_H__
+#define __TENGINEPOOL_H__
+
+#include "tetrominotris_config.h"
+#include "TGameEngine.h"
+#include "THeadlessDriver.h"
+#include "TBot.h"
+
+/*
+ * @typedef TEnginePoolGameFn
+ *
+ * The type of a function that plays game number gameIdx on gameEngine
+ * and fills-in *result.  The context is the opaque pointer passed to
+ * TEnginePoolRun().  The function is called concurrently from all
+ * workers, so any state in context must be read-only or otherwise
+ * thread-safe.
+ */
+typedef void (*TEnginePoolGameFn)(TGameEngine *gameEngine, unsigned long gameIdx, void *context, THeadlessGameResult *result);
+
+/*
+ * @typedef TEnginePool
+ *
+ * Opaque type of an engine pool.
+ */
+typedef struct TEnginePool TEnginePool;
+
+/*
+ * @function TEnginePoolCreate
+ *
+ * Create a pool of nThreads workers, each with a game engine created
+ * with the given parameters (see TGameEngineCreate()).  If nThreads is
+ * zero, one worker per online processor is created.
+ *
+ * Returns NULL if any engine could not be created.
+ */
+TEnginePool* TEnginePoolCreate(unsigned int nThreads, TBitGridWordSize wordSize, bool useColor, unsigned int w, unsigned int h, unsigned int startingLevel);
+
+/*
+ * @function TEnginePoolDestroy
+ *
+ * Dispose of enginePool and all of its game engines.
+ */
+void TEnginePoolDestroy(TEnginePool *enginePool);
+
+/*
+ * @function TEnginePoolGetThreadCount
+ *
+ * Returns the number of workers in enginePool.
+ */
+unsigned int TEnginePoolGetThreadCount(TEnginePool *enginePool);
+
+/*
+ * @function TEnginePoolRun
+ *
+ * Play nGames games across the workers in enginePool, calling gameFn
+ * with context for each.  The result of game i is written to
+ * results[i], so results must have room for nGames records.  Returns
+ * when all games have been played.
+ *
+ * The calling thread acts as one of the workers.  Should a worker
+ * thread fail to start, its games are stolen by the others.
+ *
+ * Returns false (having played no games) if nGames exceeds the range
+ * of a 32-bit index.
+ */
+bool TEnginePoolRun(TEnginePool *enginePool, unsigned long nGames, TEnginePoolGameFn gameFn, void *context, THeadlessGameResult *results);
+
+/*
+ * @typedef TEnginePoolRandomGameContext
+ *
+ * Context for TEnginePoolRandomGame():  game i resets the engine with
+ * seed baseSeed + i and plays using the driver options.  With
+ * shouldUsePlacements the random player places each tetromino with a
+ * single TGameEngineApplyPlacement() rather than sending events; with
+ * shouldUseMoveGen as well it chooses among all of the tetromino's
+ * reachable resting positions.
+ */
+typedef struct {
+    uint64_t                baseSeed;
+    THeadlessDriverOptions  options;
+    bool                    shouldUsePlacements;
+    bool                    shouldUseMoveGen;
+} TEnginePoolRandomGameContext;
+
+/*
+ * @function TEnginePoolRandomGame
+ *
+ * A TEnginePoolGameFn that plays a game with the headless driver's
+ * random player; context must point to a TEnginePoolRandomGameContext.
+ * The engine and player seeds depend only on the game index, so the
+ * results of a batch do not depend on the number of workers.
+ */
+void TEnginePoolRandomGame(TGameEngine *gameEngine, unsigned long gameIdx, void *context, THeadlessGameResult *result);
+
+/*
+ * @typedef TEnginePoolBotGameContext
+ *
+ * Context for TEnginePoolBotGame():  game i resets the engine with
+ * seed baseSeed + i and plays using the driver options and the bot
+ * with the given weights.  With shouldUsePlacements the bot places
+ * each tetromino with a single TGameEngineApplyRestingPlacement();
+ * otherwise it sends one event per tick.
+ */
+typedef struct {
+    uint64_t                baseSeed;
+    THeadlessDriverOptions  options;
+    TBotWeights             weights;
+    bool                    shouldUsePlacements;
+} TEnginePoolBotGameContext;
+
+/*
+ * @function TEnginePoolBotGame
+ *
+ * A TEnginePoolGameFn that plays a game with the built-in bot; context
+ * must point to a TEnginePoolBotGameContext.  The result->didFinish
+ * field is false (as for the piece limit) if the bot could not be
+ * created.
+ */
+void TEnginePoolBotGame(TGameEngine *gameEngine, unsigned long gameIdx, void *context, THeadlessGameResult *result);
+
+#endif /* __TENGINEPOOL_H__ */
@@ -3,11 +3,16 @@
 */
 
 #include "TGameEngine.h"
+#include "TMoveGen.h"
 
 struct timespec TGameEngineZeroTime = { .tv_sec = 0, .tv_nsec = 0 };
 
 struct timespec TGameEngine500ms = { .tv_sec = 0, .tv_nsec = 500000000 };
 
+struct timespec TGameEngineFlashInterval = { .tv_sec = 0, .tv_nsec = 50000000 };
+
+struct timespec TGameEngineOneNanosecond = { .tv_sec = 0, .tv_nsec = 1 };
+
 //
 
 enum {
@@ -19,6 +24,315 @@ enum {
 
 //
 
+/*
+ * @function __TGameEngineExtractBoard4x4
+ *
+ * Extract the 4x4 occupancy (channel 0) of the game board at P; every
+ * collision test goes through here.
+ */
+static inline uint16_t
+__TGameEngineExtractBoard4x4(
+    TGameEngine     *gameEngine,
+    TGridPos        P
+)
+{
+    return TBitGridExtract4x4AtPosition(gameEngine->gameBoard, TGameEngineBitGridChannelIsOccupied, P);
+}
+
+/*
+ * @function __TGameEngineUpdateDirtyRect
+ *
+ * Called at the end of a tick:  fill-in the gameEngine's dirty rectangle from
+ * the cells the game board recorded as written, the old and new bounds of the
+ * in-play sprite (if it changed), and the completed rows if their flash
+ * toggled.  Any state change other than the one into or out of the hold on
+ * completed lines changes what the whole board displays.
+ */
+static void
+__TGameEngineUpdateDirtyRect(
+    TGameEngine         *gameEngine,
+    TGameEngineState    startState,
+    TSprite             *startSprite,
+    int                 startLandingRow,
+    unsigned int        startFlashIdx
+)
+{
+    TBitGrid            *gameBoard = gameEngine->gameBoard;
+    TGridRect           dirtyRect = TBitGridGetDirtyRect(gameBoard);
+    uint16_t            start4x4 = TSpriteGet4x4(startSprite);
+    uint16_t            piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
+    
+    if ( (gameEngine->gameState != startState) &&
+         ! ((startState == TGameEngineStateGameHasStarted) && (gameEngine->gameState == TGameEngineStateHoldClearedLines)) &&
+         ! ((startState == TGameEngineStateHoldClearedLines) && (gameEngine->gameState == TGameEngineStateGameHasStarted))
+    ) {
+        dirtyRect = TGridRectMake(0, 0, gameBoard->dimensions.w - 1, gameBoard->dimensions.h - 1);
+    } else {
+        if ( (start4x4 != piece4x4) || (startSprite->colorIdx != gameEngine->currentSprite.colorIdx) ||
+             (startSprite->P.i != gameEngine->currentSprite.P.i) || (startSprite->P.j != gameEngine->currentSprite.P.j)
+        ) {
+            dirtyRect = TGridRectUnion(dirtyRect, TSpriteGetRect(startSprite));
+            dirtyRect = TGridRectUnion(dirtyRect, TSpriteGetRect(&gameEngine->currentSprite));
+        }
+        if ( gameEngine->shouldShowGhost ) {
+            // The ghost is only displayed while a piece is in play:
+            TSprite     startGhost = *startSprite, ghost = TGameEngineGetGhostSprite(gameEngine);
+            bool        wasShown = (startState == TGameEngineStateGameHasStarted);
+            bool        isShown = (gameEngine->gameState == TGameEngineStateGameHasStarted);
+            
+            startGhost.P.j = startLandingRow;
+            if ( (wasShown != isShown) || (start4x4 != piece4x4) || (startGhost.colorIdx != ghost.colorIdx) ||
+                 (startGhost.P.i != ghost.P.i) || (startGhost.P.j != ghost.P.j)
+            ) {
+                if ( wasShown ) dirtyRect = TGridRectUnion(dirtyRect, TSpriteGetRect(&startGhost));
+                if ( isShown ) dirtyRect = TGridRectUnion(dirtyRect, TSpriteGetRect(&ghost));
+            }
+        }
+        if ( (gameEngine->gameState == TGameEngineStateHoldClearedLines) && (gameEngine->completionFlashIdx != startFlashIdx) ) {
+            // The completed rows all lie under the sprite that completed them:
+            int         j = gameEngine->currentSprite.P.j, jEnd = j + 4;
+            
+            if ( j < 0 ) j = 0;
+            if ( jEnd > (int)gameBoard->dimensions.h ) jEnd = gameBoard->dimensions.h;
+            while ( j < jEnd ) {
+                if ( TBitGridIsRowFull(gameBoard, j) ) dirtyRect = TGridRectUnion(dirtyRect, TGridRectMake(0, j, gameBoard->dimensions.w - 1, j));
+                j++;
+            }
+        }
+        dirtyRect = TGridRectIntersect(dirtyRect, TGridRectMake(0, 0, gameBoard->dimensions.w - 1, gameBoard->dimensions.h - 1));
+    }
+    gameEngine->dirtyRect = dirtyRect;
+}
+
+//
+
+/*
+ * @function __TGameEngineFindLandingRow
+ *
+ * Returns the row at which sprite would come to rest if dropped straight down
+ * the game board.  While every column of the sprite hangs above the top of
+ * the board's stack in that column, the drop is limited by the column whose
+ * stack top sits closest to the sprite's bottom cell in it:  the landing row
+ * is the least of (column top - 1 - column bottom) over the sprite's columns.
+ * A sprite tucked beneath an overhang is dropped a row at a time instead.
+ */
+static int
+__TGameEngineFindLandingRow(
+    TGameEngine         *gameEngine,
+    TSprite             *sprite
+)
+{
+    const TTetrominoShapeInfo   *shapeInfo = TSpriteGetShapeInfo(sprite);
+    int                         landingRow = gameEngine->gameBoard->dimensions.h, c = shapeInfo->iLo;
+    
+    if ( shapeInfo->iLo > shapeInfo->iHi ) return sprite->P.j;
+    while ( c <= shapeInfo->iHi ) {
+        if ( shapeInfo->columnBottom[c] >= 0 ) {
+            int     columnTop = TBitGridGetColumnTop(gameEngine->gameBoard, sprite->P.i + c);
+            
+            if ( sprite->P.j + shapeInfo->columnBottom[c] >= columnTop ) break;
+            if ( columnTop - 1 - shapeInfo->columnBottom[c] < landingRow ) landingRow = columnTop - 1 - shapeInfo->columnBottom[c];
+        }
+        c++;
+    }
+    if ( c <= shapeInfo->iHi ) {
+        uint16_t    piece4x4 = TSpriteGet4x4(sprite);
+        TGridPos    newP = sprite->P;
+        
+        newP.j++;
+        while ( (__TGameEngineExtractBoard4x4(gameEngine, newP) & piece4x4) == 0 ) newP.j++;
+        landingRow = newP.j - 1;
+    }
+    return landingRow;
+}
+
+//
+
+/*
+ * @function __TGameEngineLockSprite
+ *
+ * Write the in-play tetromino's cells (and color) into the game board.
+ */
+static void
+__TGameEngineLockSprite(
+    TGameEngine         *gameEngine
+)
+{
+    uint16_t            piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
+    
+    TBitGridSet4x4AtPosition(gameEngine->gameBoard, TGameEngineBitGridChannelIsOccupied, gameEngine->currentSprite.P, piece4x4);
+    if ( gameEngine->doesUseColor ) {
+        TBitGridSet4x4AtPosition(gameEngine->gameBoard, TGameEngineBitGridChannelColorIndexBit0, gameEngine->currentSprite.P, (gameEngine->currentSprite.colorIdx & 0x1) ? piece4x4 : 0x0000);
+        TBitGridSet4x4AtPosition(gameEngine->gameBoard, TGameEngineBitGridChannelColorIndexBit1, gameEngine->currentSprite.P, (gameEngine->currentSprite.colorIdx & 0x2) ? piece4x4 : 0x0000);
+    }
+}
+
+/*
+ * @function __TGameEngineSpawnNextPiece
+ *
+ * Award the extra points accrued by the locked tetromino, bring the next
+ * tetromino into play and check whether it fits on the board; if not, the
+ * game is over.
+ */
+static void
+__TGameEngineSpawnNextPiece(
+    TGameEngine         *gameEngine
+)
+{
+    gameEngine->scoreboard.score += gameEngine->extraPoints;
+    gameEngine->extraPoints = 0;
+    gameEngine->isInSoftDrop = false;
+    TGameEngineChooseNextPiece(gameEngine);
+    
+    // Test for game over:
+    if ( (__TGameEngineExtractBoard4x4(gameEngine, gameEngine->currentSprite.P) & TSpriteGet4x4(&gameEngine->currentSprite)) == 0 ) {
+        gameEngine->gameState = TGameEngineStateGameHasStarted;
+    } else {
+        gameEngine->gameState = TGameEngineStateCheckHighScore;
+        gameEngine->currentSprite = gameEngine->nextSprite = TSpriteMakeEmpty();
+        TBitGridFillCells(gameEngine->gameBoard, 1);
+    }
+}
+
+//
+
+/*
+ * @function __TGameEngineRotateSpriteTo
+ *
+ * Rotate *sprite one step at a time (clockwise or not) until it has the given
+ * orientation, failing if any step collides with the board.  On success the
+ * rotated sprite is written back to *sprite.
+ */
+static bool
+__TGameEngineRotateSpriteTo(
+    TGameEngine         *gameEngine,
+    TSprite             *sprite,
+    unsigned int        orientation,
+    bool                isClockwise
+)
+{
+    TSprite             rotated = *sprite;
+    
+    while ( rotated.orientation != orientation ) {
+        rotated = isClockwise ? TSpriteMakeRotated(&rotated) : TSpriteMakeRotatedAnti(&rotated);
+        if ( __TGameEngineExtractBoard4x4(gameEngine, rotated.P) & TSpriteGet4x4(&rotated) ) return false;
+    }
+    *sprite = rotated;
+    return true;
+}
+
+/*
+ * @function __TGameEngineShiftSpriteTo
+ *
+ * Shift *sprite one column at a time until its 4x4 cell is at the given
+ * column, failing if any step collides with the board (the sentinel border
+ * stops it at the walls).  On success the shifted sprite is written back to
+ * *sprite.
+ */
+static bool
+__TGameEngineShiftSpriteTo(
+    TGameEngine         *gameEngine,
+    TSprite             *sprite,
+    int                 column
+)
+{
+    uint16_t            piece4x4 = TSpriteGet4x4(sprite);
+    TGridPos            P = sprite->P;
+    int                 dI = (column < P.i) ? -1 : 1;
+    
+    while ( P.i != column ) {
+        P.i += dI;
+        if ( __TGameEngineExtractBoard4x4(gameEngine, P) & piece4x4 ) return false;
+    }
+    sprite->P = P;
+    return true;
+}
+
+/*
+ * @function __TGameEngineRotateSpriteEitherWayTo
+ *
+ * Rotate *sprite to the given orientation in the shorter direction or, if
+ * that collides, the longer.  On success *isClockwise is set to the
+ * direction that worked.
+ */
+static bool
+__TGameEngineRotateSpriteEitherWayTo(
+    TGameEngine         *gameEngine,
+    TSprite             *sprite,
+    unsigned int        orientation,
+    bool                *isClockwise
+)
+{
+    bool                isClockwiseShorter = ((orientation - sprite->orientation) & 3) <= 2;
+    
+    if ( __TGameEngineRotateSpriteTo(gameEngine, sprite, orientation, isClockwiseShorter) ) {
+        *isClockwise = isClockwiseShorter;
+        return true;
+    }
+    if ( __TGameEngineRotateSpriteTo(gameEngine, sprite, orientation, ! isClockwiseShorter) ) {
+        *isClockwise = ! isClockwiseShorter;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * @function __TGameEngineRotateAndShiftSpriteTo
+ *
+ * Try the rotations in the shorter direction then the longer, first before
+ * the shifts then after them.  If isShiftFirst and isClockwise are not NULL
+ * they are set to the route that succeeded.
+ */
+static bool
+__TGameEngineRotateAndShiftSpriteTo(
+    TGameEngine         *gameEngine,
+    TSprite             *sprite,
+    unsigned int        orientation,
+    int                 column,
+    bool                *isShiftFirst,
+    bool                *isClockwise
+)
+{
+    TSprite             moved = *sprite;
+    bool                didShiftFirst = false, didRotateClockwise = true;
+    
+    if ( ! __TGameEngineRotateSpriteEitherWayTo(gameEngine, &moved, orientation, &didRotateClockwise) ||
+         ! __TGameEngineShiftSpriteTo(gameEngine, &moved, column)
+    ) {
+        moved = *sprite;
+        didShiftFirst = true;
+        if ( ! __TGameEngineShiftSpriteTo(gameEngine, &moved, column) ||
+             ! __TGameEngineRotateSpriteEitherWayTo(gameEngine, &moved, orientation, &didRotateClockwise)
+        ) return false;
+    }
+    *sprite = moved;
+    if ( isShiftFirst ) *isShiftFirst = didShiftFirst;
+    if ( isClockwise ) *isClockwise = didRotateClockwise;
+    return true;
+}
+
+/*
+ * @function __TGameEngineLockAndSpawn
+ *
+ * Lock placed as the in-play tetromino without a hold on the rows it
+ * completes:  they are cleared straight away before the next tetromino
+ * is spawned.
+ */
+static void
+__TGameEngineLockAndSpawn(
+    TGameEngine         *gameEngine,
+    TSprite             *placed
+)
+{
+    gameEngine->currentSprite = *placed;
+    __TGameEngineLockSprite(gameEngine);
+    TGameEngineCheckForCompleteRowsInRange(gameEngine, false, placed->P.j, placed->P.j + 3);
+    __TGameEngineSpawnNextPiece(gameEngine);
+    gameEngine->dirtyRect = TGridRectMake(0, 0, gameEngine->gameBoard->dimensions.w - 1, gameEngine->gameBoard->dimensions.h - 1);
+}
+
+//
+
 TGameEngine*
 TGameEngineCreate(
     TBitGridWordSize    wordSize, 
@@ -29,7 +343,7 @@ TGameEngineCreate(
 )
 {
     TGameEngine     *newEngine = NULL;
-    TBitGrid        *gameBoard = TBitGridCreate(wordSize, useColor ? 4 : 2, w, h);
+    TBitGrid        *gameBoard = TBitGridCreateWithOptions(wordSize, useColor ? 4 : 2, w, h, TBitGridOptionSentinelBorder);
     
     if ( gameBoard ) {
         newEngine = (TGameEngine*)malloc(sizeof(TGameEngine));    
@@ -39,6 +353,11 @@ TGameEngineCreate(
             
             // Using color?
             newEngine->doesUseColor = useColor;
+            newEngine->shouldShowGhost = false;
+            
+            // Real-time clock by default:
+            newEngine->clockSource = TGameEngineClockSourceRealTime;
+            newEngine->tVirtual = TGameEngineZeroTime;
             
             // Fill-in the starting level:
             newEngine->startingLevel = (startingLevel <= 9) ? startingLevel : 9;
@@ -70,22 +389,56 @@ TGameEngineCreate(
 
 //
 
+void
+TGameEngineSetClockSource(
+    TGameEngine             *gameEngine,
+    TGameEngineClockSource  clockSource
+)
+{
+    gameEngine->clockSource = clockSource;
+    gameEngine->tVirtual = TGameEngineZeroTime;
+}
+
+//
+
 void
 TGameEngineReset(
     TGameEngine *gameEngine
 )
+{
+    struct timespec     t;
+    
+    // Seed from the real-time clock; mixing-in the engine's address keeps
+    // engines reset in the same instant from sharing a sequence:
+    clock_gettime(CLOCK_REALTIME, &t);
+    TGameEngineResetWithSeed(gameEngine, ((uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec) ^ (uint64_t)(uintptr_t)gameEngine);
+}
+
+//
+
+void
+TGameEngineResetWithSeed(
+    TGameEngine *gameEngine,
+    uint64_t    seed
+)
 {
     // Initialize the PRNG:
-    initstate(time(NULL), gameEngine->randomState, TGAMEENGINE_RANDOM_NSTATE);
+    gameEngine->randomSeed = seed;
+    TRandomSeed(&gameEngine->randomState, seed);
     
     // Ensure an empty game board to start:
     TBitGridFillCells(gameEngine->gameBoard, 0);
+    gameEngine->dirtyRect = TBitGridGetDirtyRect(gameEngine->gameBoard);
             
     //  Fill-in the rest of the game engine fields:
     gameEngine->gameState = TGameEngineStateStartup;
     gameEngine->startingPos = TGridPosMake(gameEngine->gameBoard->dimensions.w / 2, 0);
             
-    // Shift two pieces into the engine, current and next:
+    // Shift two pieces into the engine, current and next.  The shifting
+    // tallies whatever piece ids were present, so make them valid (the
+    // tally is discarded when the scoreboard is reset below):
+    gameEngine->currentTetrominoId = gameEngine->nextTetrominoId = 0;
+    gameEngine->nextSprite = TSpriteMakeEmpty();
     TGameEngineChooseNextPiece(gameEngine);
     TGameEngineChooseNextPiece(gameEngine);
     
@@ -94,6 +447,7 @@ TGameEngineReset(
     gameEngine->scoreboard.level = gameEngine->startingLevel;
     gameEngine->extraPoints = 0;
     gameEngine->isInSoftDrop = 0;
+    gameEngine->completionFlashIdx = 0;
             
     // Timings:
     gameEngine->tickCount = 0UL;
@@ -101,6 +455,7 @@ TGameEngineReset(
     gameEngine->tElapsed = TGameEngineZeroTime;
     gameEngine->tPerLine = timespec_tpl_with_level(gameEngine->scoreboard.level);
     gameEngine->tNextDrop = TGameEngineZeroTime;
+    gameEngine->tNextFlash = TGameEngineZeroTime;
 }
 
 //
@@ -118,13 +473,16 @@ TGameEngineChooseNextPiece(
     gameEngine->currentSprite = gameEngine->nextSprite;
     
     // ...and we select another new piece:
-    gameEngine->nextTetrominoId = random() % TTetrominosCount;
-    gameEngine->nextSprite = TSpriteMake(TTetrominos[gameEngine->nextTetrominoId], gameEngine->startingPos, 0);
+    gameEngine->nextTetrominoId = TRandomNextInRange(&gameEngine->randomState, TTetrominosCount);
+    gameEngine->nextSprite = TSpriteMake(gameEngine->nextTetrominoId, gameEngine->startingPos, 0, TRandomNextInRange(&gameEngine->randomState, 3));
     
     // To be fair, back the piece up as many rows as necessary to align the
     // next piece with the top of the game grid:
     gameEngine->nextSprite.P.i = (gameEngine->gameBoard->dimensions.w - 4) / 2;
     gameEngine->nextSprite.P.j -= TSpriteGetInitialClearRows(&gameEngine->nextSprite);
+    
+    // Where the new current piece would land:
+    gameEngine->landingRow = __TGameEngineFindLandingRow(gameEngine, &gameEngine->currentSprite);
 }
 
 //
@@ -142,21 +500,28 @@ bool
 TGameEngineCheckForCompleteRowsInRange(
     TGameEngine     *gameEngine,
     bool            shouldTestOnly,
-    unsigned int    startRow,
-    unsigned int    endRow
+    int             startRow,
+    int             endRow
 )
 {
-    TBitGridIterator    *iterator = TBitGridIteratorCreateWithRowRange(gameEngine->gameBoard, 1 << TGameEngineBitGridChannelIsOccupied, startRow, endRow);
-    unsigned int        startFullRow = -1, nRow = 0, currentRow;
-    unsigned int        curLevel = gameEngine->scoreboard.level;
-    bool                didClearRows = false;
-
-    while ( TBitGridIteratorNextFullRow(iterator, &currentRow) ) {
-        if ( nRow == 0 ) {
-            startFullRow = currentRow;
-            nRow = 1;
-        } else {
-            if ( startFullRow + nRow == currentRow ) {
+    int             startFullRow = -1, nRow = 0, currentRow;
+    unsigned int    curLevel = gameEngine->scoreboard.level;
+    bool            didClearRows = false;
+    
+    // Clamp the range to the board (a sprite can hang off the top or
+    // bottom edge):
+    if ( startRow < 0 ) startRow = 0;
+    if ( endRow >= (int)gameEngine->gameBoard->dimensions.h ) endRow = gameEngine->gameBoard->dimensions.h - 1;
+    
+    // The bit grid tracks row fill counts, so a full row is found without
+    // scanning the row's words:
+    currentRow = startRow;
+    while ( currentRow <= endRow ) {
+        if ( TBitGridIsRowFull(gameEngine->gameBoard, currentRow) ) {
+            if ( nRow == 0 ) {
+                startFullRow = currentRow;
+                nRow = 1;
+            } else if ( startFullRow + nRow == currentRow ) {
                 // Extending a multirow match:
                 nRow++;
             } else {
@@ -165,11 +530,12 @@ TGameEngineCheckForCompleteRowsInRange(
                 } else {
                     TBitGridClearLines(gameEngine->gameBoard, startFullRow, startFullRow + nRow - 1);
                     TScoreboardAddLinesOfType(&gameEngine->scoreboard, nRow);
-                    startFullRow = currentRow, nRow = 1;
                 }
+                startFullRow = currentRow, nRow = 1;
                 didClearRows = true;
             }
         }
+        currentRow++;
     }
     if ( nRow > 0 ) {
         if ( shouldTestOnly ) {
@@ -177,7 +543,6 @@ TGameEngineCheckForCompleteRowsInRange(
         } else {
             TBitGridClearLines(gameEngine->gameBoard, startFullRow, startFullRow + nRow - 1);
             TScoreboardAddLinesOfType(&gameEngine->scoreboard, nRow);
-            startFullRow = currentRow, nRow = 1;
         }
         didClearRows = true;
     }
@@ -198,9 +563,16 @@ TGameEngineTick(
 {
     TGameEngineUpdateNotification       updates = 0;
     struct timespec                     t1, dt;
+    TGameEngineState                    startState = gameEngine->gameState;
+    TSprite                             startSprite = gameEngine->currentSprite;
+    int                                 startLandingRow = gameEngine->landingRow;
+    unsigned int                        startFlashIdx = gameEngine->completionFlashIdx;
     
     // Get current absolute cycle time:
-    clock_gettime(CLOCK_REALTIME, &t1);
+    TGameEngineGetTime(gameEngine, &t1);
+    
+    // Board writes made during this tick accumulate from here:
+    TBitGridResetDirtyRect(gameEngine->gameBoard);
     
     switch ( gameEngine->gameState ) {
         
@@ -222,7 +594,7 @@ TGameEngineTick(
                 uint16_t    board4x4, piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
     
                 newP.j++;
-                board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newP);
+                board4x4 = __TGameEngineExtractBoard4x4(gameEngine, newP);
                 if ( (board4x4 & piece4x4) == 0 ) {
                     // The piece can fall another row by itself; revoke extra points and
                     // cancel soft drop:
@@ -253,11 +625,12 @@ TGameEngineTick(
         
                 case TGameEngineEventRotateClockwise: {
                     TSprite         newOrientation = TSpriteMakeRotated(&gameEngine->currentSprite);
-                    uint16_t        board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newOrientation.P);
+                    uint16_t        board4x4 = __TGameEngineExtractBoard4x4(gameEngine, newOrientation.P);
                     uint16_t        piece4x4 = TSpriteGet4x4(&newOrientation);
         
                     if ( (board4x4 & piece4x4) == 0 ) {
                         gameEngine->currentSprite = newOrientation;
+                        gameEngine->landingRow = __TGameEngineFindLandingRow(gameEngine, &gameEngine->currentSprite);
                         updates |= TGameEngineUpdateNotificationGameBoard;
                     }
                     break;
@@ -265,11 +638,12 @@ TGameEngineTick(
         
                 case TGameEngineEventRotateAntiClockwise: {
                     TSprite         newOrientation = TSpriteMakeRotatedAnti(&gameEngine->currentSprite);
-                    uint16_t        board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newOrientation.P);
+                    uint16_t        board4x4 = __TGameEngineExtractBoard4x4(gameEngine, newOrientation.P);
                     uint16_t        piece4x4 = TSpriteGet4x4(&newOrientation);
         
                     if ( (board4x4 & piece4x4) == 0 ) {
                         gameEngine->currentSprite = newOrientation;
+                        gameEngine->landingRow = __TGameEngineFindLandingRow(gameEngine, &gameEngine->currentSprite);
                         updates |= TGameEngineUpdateNotificationGameBoard;
                     }
                     break;
@@ -280,9 +654,10 @@ TGameEngineTick(
                     uint16_t    board4x4, piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
         
                     newP.i--;
-                    board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newP);
+                    board4x4 = __TGameEngineExtractBoard4x4(gameEngine, newP);
                     if ( (board4x4 & piece4x4) == 0 ) {
                         gameEngine->currentSprite.P.i--;
+                        gameEngine->landingRow = __TGameEngineFindLandingRow(gameEngine, &gameEngine->currentSprite);
                         updates |= TGameEngineUpdateNotificationGameBoard;
                     }
                     break;
@@ -293,9 +668,10 @@ TGameEngineTick(
                     uint16_t    board4x4, piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
         
                     newP.i++;
-                    board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newP);
+                    board4x4 = __TGameEngineExtractBoard4x4(gameEngine, newP);
                     if ( (board4x4 & piece4x4) == 0 ) {
                         gameEngine->currentSprite.P.i++;
+                        gameEngine->landingRow = __TGameEngineFindLandingRow(gameEngine, &gameEngine->currentSprite);
                         updates |= TGameEngineUpdateNotificationGameBoard;
                     }
                     break;
@@ -306,7 +682,7 @@ TGameEngineTick(
                     uint16_t    board4x4, piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
         
                     newP.j++;
-                    board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newP);
+                    board4x4 = __TGameEngineExtractBoard4x4(gameEngine, newP);
                     if ( (board4x4 & piece4x4) == 0 ) {
                         gameEngine->currentSprite.P.j++;
                         gameEngine->isInSoftDrop = true;
@@ -320,19 +696,10 @@ TGameEngineTick(
                 }
         
                 case TGameEngineEventHardDrop: {
-                    while ( 1 ) {
-                        // Test for ok:
-                        TGridPos    newP = gameEngine->currentSprite.P;
-                        uint16_t    board4x4, piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
-        
-                        newP.j++;
-                        board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, newP);
-                        if ( (board4x4 & piece4x4) == 0 ) {
-                            gameEngine->currentSprite.P.j++;
-                            gameEngine->extraPoints += 2;
-                        } else {
-                            break;
-                        }
+                    // The landing row is known, no need to test row-by-row:
+                    if ( gameEngine->landingRow > gameEngine->currentSprite.P.j ) {
+                        gameEngine->extraPoints += 2 * (gameEngine->landingRow - gameEngine->currentSprite.P.j);
+                        gameEngine->currentSprite.P.j = gameEngine->landingRow;
                     }
                     shouldStopFalling = true;
                     break;
@@ -341,36 +708,16 @@ TGameEngineTick(
             }
     
             if ( shouldStopFalling ) {
-                uint16_t            board4x4, piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
-            
-                TBitGridSet4x4AtPosition(gameEngine->gameBoard, 0, gameEngine->currentSprite.P, piece4x4);
-                if ( gameEngine->doesUseColor ) {
-                    TBitGridSet4x4AtPosition(gameEngine->gameBoard, 2, gameEngine->currentSprite.P, (gameEngine->currentSprite.colorIdx & 0x1) ? piece4x4 : 0x0000);
-                    TBitGridSet4x4AtPosition(gameEngine->gameBoard, 3, gameEngine->currentSprite.P, (gameEngine->currentSprite.colorIdx & 0x2) ? piece4x4 : 0x0000);
-                }
+                __TGameEngineLockSprite(gameEngine);
                 if ( TGameEngineCheckForCompleteRowsInRange(gameEngine, true, gameEngine->currentSprite.P.j, gameEngine->currentSprite.P.j + 3) ) {
                     gameEngine->gameState = TGameEngineStateHoldClearedLines;
                     gameEngine->completionFlashIdx = 0;
                     timespec_add(&gameEngine->tNextDrop, &t1, &TGameEngine500ms);
+                    timespec_add(&gameEngine->tNextFlash, &t1, &TGameEngineFlashInterval);
                     updates |= TGameEngineUpdateNotificationGameBoard;
                 } else {
-                    gameEngine->scoreboard.score += gameEngine->extraPoints;
-                    gameEngine->extraPoints = 0;
-                    gameEngine->isInSoftDrop = false;
-                    TGameEngineChooseNextPiece(gameEngine);
+                    __TGameEngineSpawnNextPiece(gameEngine);
                     timespec_add(&gameEngine->tNextDrop, &t1, &gameEngine->tPerLine);
-            
-                    // Test for game over:
-                    piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
-                    board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, gameEngine->currentSprite.P);
-                    if ( (board4x4 & piece4x4) == 0 ) {
-                        gameEngine->gameState = TGameEngineStateGameHasStarted;
-                    } else {
-                        gameEngine->gameState = TGameEngineStateCheckHighScore;
-                        memset(&gameEngine->currentSprite, 0, sizeof(gameEngine->currentSprite));
-                        memset(&gameEngine->nextSprite, 0, sizeof(gameEngine->nextSprite));
-                        TBitGridFillCells(gameEngine->gameBoard, 1);
-                    }
                     updates |= TGameEngineUpdateNotificationGameBoard | TGameEngineUpdateNotificationScoreboard | TGameEngineUpdateNotificationNextTetromino;
                 }
             }
@@ -385,32 +732,21 @@ TGameEngineTick(
         
         case TGameEngineStateHoldClearedLines:
             if ( timespec_is_ordered_asc(&gameEngine->tNextDrop, &t1) ) {
-                uint16_t            board4x4, piece4x4;
-                
                 TGameEngineCheckForCompleteRowsInRange(gameEngine, false, gameEngine->currentSprite.P.j, gameEngine->currentSprite.P.j + 3);
-
-                gameEngine->scoreboard.score += gameEngine->extraPoints;
-                gameEngine->extraPoints = 0;
-                gameEngine->isInSoftDrop = false;
-                TGameEngineChooseNextPiece(gameEngine);
+                __TGameEngineSpawnNextPiece(gameEngine);
                 timespec_add(&gameEngine->tNextDrop, &t1, &gameEngine->tPerLine);
-            
-                // Test for game over:
-                piece4x4 = TSpriteGet4x4(&gameEngine->currentSprite);
-                board4x4 = TBitGridExtract4x4AtPosition(gameEngine->gameBoard, 0, gameEngine->currentSprite.P);
-                if ( (board4x4 & piece4x4) == 0 ) {
-                    gameEngine->gameState = TGameEngineStateGameHasStarted;
-                } else {
-                    gameEngine->gameState = TGameEngineStateCheckHighScore;
-                    memset(&gameEngine->currentSprite, 0, sizeof(gameEngine->currentSprite));
-                    memset(&gameEngine->nextSprite, 0, sizeof(gameEngine->nextSprite));
-                    TBitGridFillCells(gameEngine->gameBoard, 1);
+                updates |= TGameEngineUpdateNotificationGameBoard | TGameEngineUpdateNotificationScoreboard | TGameEngineUpdateNotificationNextTetromino;
+            } else if ( ! timespec_is_ordered_asc(&t1, &gameEngine->tNextFlash) ) {
+                // The flash changes phase once per interval; if the engine was
+                // not ticked for several intervals, step through all of them:
+                unsigned int        startFlashIdx = gameEngine->completionFlashIdx;
+                
+                while ( ! timespec_is_ordered_asc(&t1, &gameEngine->tNextFlash) ) {
+                    gameEngine->completionFlashIdx = ! gameEngine->completionFlashIdx;
+                    timespec_add(&gameEngine->tNextFlash, &gameEngine->tNextFlash, &TGameEngineFlashInterval);
                 }
-                updates |= TGameEngineUpdateNotificationScoreboard | TGameEngineUpdateNotificationNextTetromino;
-            } else {
-                gameEngine->completionFlashIdx = ! gameEngine->completionFlashIdx;
+                if ( gameEngine->completionFlashIdx != startFlashIdx ) updates |= TGameEngineUpdateNotificationGameBoard;
             }
-            updates |= TGameEngineUpdateNotificationGameBoard;
             break;
             
         case TGameEngineStateGameHasEnded:
@@ -425,9 +761,139 @@ TGameEngineTick(
             break;
             
     }
+    __TGameEngineUpdateDirtyRect(gameEngine, startState, &startSprite, startLandingRow, startFlashIdx);
 
     gameEngine->tLastTick = t1;
     gameEngine->tickCount++;
     return updates;
 }
 
+//
+
+bool
+TGameEngineApplyPlacement(
+    TGameEngine         *gameEngine,
+    unsigned int        orientation,
+    int                 column
+)
+{
+    TSprite             placed = gameEngine->currentSprite;
+    int                 landingRow;
+    
+    if ( (gameEngine->gameState != TGameEngineStateGameHasStarted) || (orientation > 3) ) return false;
+    if ( ! __TGameEngineRotateAndShiftSpriteTo(gameEngine, &placed, orientation, column, NULL, NULL) ) return false;
+    
+    TBitGridResetDirtyRect(gameEngine->gameBoard);
+    
+    // Hard drop:
+    landingRow = ((placed.orientation == gameEngine->currentSprite.orientation) && (placed.P.i == gameEngine->currentSprite.P.i))
+                        ? gameEngine->landingRow : __TGameEngineFindLandingRow(gameEngine, &placed);
+    if ( landingRow > placed.P.j ) {
+        gameEngine->extraPoints += 2 * (landingRow - placed.P.j);
+        placed.P.j = landingRow;
+    }
+    __TGameEngineLockAndSpawn(gameEngine, &placed);
+    return true;
+}
+
+//
+
+int
+TGameEngineFindPlacementPath(
+    TGameEngine         *gameEngine,
+    unsigned int        orientation,
+    int                 column,
+    int                 *landingRow,
+    TGameEngineEvent    *events,
+    unsigned int        maxEvents
+)
+{
+    TSprite             *from = &gameEngine->currentSprite;
+    TSprite             placed = *from;
+    bool                isShiftFirst, isClockwise;
+    unsigned int        nRotations, nShifts, nFirst, nEvents, n = 0;
+    TGameEngineEvent    rotateEvent, shiftEvent;
+    
+    if ( (gameEngine->gameState != TGameEngineStateGameHasStarted) || (orientation > 3) ) return -1;
+    if ( ! __TGameEngineRotateAndShiftSpriteTo(gameEngine, &placed, orientation, column, &isShiftFirst, &isClockwise) ) return -1;
+    if ( landingRow ) *landingRow = __TGameEngineFindLandingRow(gameEngine, &placed);
+    
+    nRotations = (isClockwise ? (orientation - from->orientation) : (from->orientation - orientation)) & 3;
+    rotateEvent = isClockwise ? TGameEngineEventRotateClockwise : TGameEngineEventRotateAntiClockwise;
+    nShifts = (column < from->P.i) ? (from->P.i - column) : (column - from->P.i);
+    shiftEvent = (column < from->P.i) ? TGameEngineEventMoveLeft : TGameEngineEventMoveRight;
+    nFirst = isShiftFirst ? nShifts : nRotations;
+    nEvents = nRotations + nShifts;
+    while ( (n < nEvents) && (n < maxEvents) ) {
+        events[n] = ((n < nFirst) == isShiftFirst) ? shiftEvent : rotateEvent;
+        n++;
+    }
+    return nEvents;
+}
+
+//
+
+bool
+TGameEngineApplyRestingPlacement(
+    TGameEngine         *gameEngine,
+    TMoveGen            *moveGen,
+    TSprite             *placement
+)
+{
+    TSprite             dropped = gameEngine->currentSprite;
+    uint16_t            piece4x4 = TSpriteGet4x4(placement);
+    TGridPos            belowP = placement->P;
+    
+    if ( (gameEngine->gameState != TGameEngineStateGameHasStarted) || (placement->tetrominoId != gameEngine->currentSprite.tetrominoId) ) return false;
+    belowP.j++;
+    if ( (__TGameEngineExtractBoard4x4(gameEngine, placement->P) & piece4x4) || ! (__TGameEngineExtractBoard4x4(gameEngine, belowP) & piece4x4) ) return false;
+    
+    // Where a rotation, shifts and hard drop get to it score as a hard drop:
+    if ( __TGameEngineRotateAndShiftSpriteTo(gameEngine, &dropped, placement->orientation, placement->P.i, NULL, NULL) && 
+         (__TGameEngineFindLandingRow(gameEngine, &dropped) == placement->P.j)
+    ) return TGameEngineApplyPlacement(gameEngine, placement->orientation, placement->P.i);
+    
+    // Otherwise the tetromino must be able to slide or tuck there from where
+    // it is:
+    if ( ! TMoveGenGeneratePlacements(moveGen, gameEngine->gameBoard, &gameEngine->currentSprite) ||
+         ! TMoveGenCanReach(moveGen, placement->orientation, placement->P)
+    ) return false;
+    
+    // ...and it was soft dropped into place:
+    TBitGridResetDirtyRect(gameEngine->gameBoard);
+    if ( placement->P.j > gameEngine->currentSprite.P.j ) gameEngine->extraPoints += placement->P.j - gameEngine->currentSprite.P.j;
+    dropped = *placement;
+    dropped.colorIdx = gameEngine->currentSprite.colorIdx;
+    __TGameEngineLockAndSpawn(gameEngine, &dropped);
+    return true;
+}
+
+//
+
+bool
+TGameEngineGetNextDeadline(
+    TGameEngine         *gameEngine,
+    struct timespec     *deadline
+)
+{
+    switch ( gameEngine->gameState ) {
+    
+        case TGameEngineStateGameHasStarted:
+            // The drop happens once tNextDrop is strictly in the past:
+            timespec_add(deadline, &gameEngine->tNextDrop, &TGameEngineOneNanosecond);
+            return true;
+            
+        case TGameEngineStateHoldClearedLines:
+            // Wake for each step of the completion flash until the hold
+            // expires:
+            timespec_add(deadline, &gameEngine->tNextDrop, &TGameEngineOneNanosecond);
+            if ( timespec_is_ordered_asc(&gameEngine->tNextFlash, deadline) ) *deadline = gameEngine->tNextFlash;
+            return true;
+        
+        case TGameEngineStateCheckHighScore:
+            TGameEngineGetTime(gameEngine, deadline);
+            return true;
+            
+    }
+    return false;
+}
@@ -13,19 +13,34 @@
 	    - the scoreboard
 	    - the in-play tetromino (as a sprite)
 	    - the next tetromino that will be in-play (as a sprite)
-	    - the state array for the PRNG
+	    - the seed and state of the PRNG
 	    - game timing values (elapsed time, time of last tick, time
 	      tetrominos hang per line, future time when in-play tetromino
 	      should automatically drop)
+	    - the source of time for the engine (the real-time clock or a
+	      virtual clock advanced by the consumer)
 	
 	The most important function in this unit is TGameEngineTick().  It
 	accepts a single game event (e.g. move tetromino left) and handles
 	all state change required to implement that event (or not).  All
-	timers are updated.  The TGameEngineTick() function should be called
-	in a relatively fast loop that watches for user input.
+	timers are updated.  The TGameEngineTick() function must be called
+	whenever user input arrives and whenever the engine's next deadline
+	(see TGameEngineGetNextDeadline()) passes; between those times the
+	consumer can sleep.
 	
 	Game events are the very same events that get associated with keys in
 	the TKeymap unit.
+	
+	An engine using the virtual clock never consults the system clock:  time
+	only passes when the consumer advances it.  This allows the engine to be
+	driven headless (see THeadlessDriver) as fast as TGameEngineTick() can be
+	called.
+	
+	Bots that choose where each tetromino goes rather than which key to press
+	can skip the events altogether:  TGameEngineApplyPlacement() moves the
+	in-play tetromino to a target orientation and column, drops it, and
+	completes the lock, line clears, scoring and next spawn in a single call
+	that never consults the clock.
 */
 
 #ifndef __TGAMEENGINE_H__
@@ -38,10 +53,7 @@
 #include "TTetrominos.h"
 #include "TScoreboard.h"
 #include "TSprite.h"
-
-#ifndef TGAMEENGINE_RANDOM_NSTATE
-#    define TGAMEENGINE_RANDOM_NSTATE 64
-#endif
+#include "TRandom.h"
 
 /*
  * @function timespec_subtract
@@ -248,6 +260,11 @@ typedef uint8_t TGameEngineEvent;
  * is notification of what aspects of the game engine changed
  * state as a result -- and probably need to have their visual
  * representation(s) updated.
+ *
+ * Along with the notification, the engine records the cells of
+ * the game board whose displayed content may have changed (see
+ * TGameEngineGetDirtyRect()) so a consumer can redraw just those
+ * rows.
  */
 enum {
     TGameEngineUpdateNotificationGameBoard = 1 << 0,
@@ -287,7 +304,10 @@ typedef unsigned int TGameEngineUpdateNotification;
  * and the engine enters the TGameEngineStateHoldClearedLines
  * state for 500 ms.  This allows for visual indication of the
  * completed lines before they are cleared (when the 500 ms expires)
- * and the engine returns to TGameEngineStateGameHasStarted.
+ * and the engine returns to TGameEngineStateGameHasStarted.  The
+ * completed lines flash on a fixed 50 ms period during the hold;
+ * a tick reports a game board update only when the flash actually
+ * changes phase.
  *
  * Once the game board has been filled and no new tetromino can
  * be introduced, the engine enters the TGameEngineStateCheckHighScore
@@ -316,6 +336,33 @@ enum {
  */
 typedef unsigned int TGameEngineState;
 
+/*
+ * @enum TGameEngine clock source
+ *
+ * All game timing (automatic drops, the hold on completed lines) is
+ * derived from the engine's clock.  The real-time clock is the system
+ * CLOCK_REALTIME.  The virtual clock starts at zero and only advances
+ * when the consumer calls TGameEngineAdvanceVirtualClock() or
+ * TGameEngineSetVirtualClock().
+ */
+enum {
+    TGameEngineClockSourceRealTime = 0,
+    TGameEngineClockSourceVirtual
+};
+
+/*
+ * @typedef TGameEngineClockSource
+ *
+ * The type of a value from the TGameEngine clock source enumeration.
+ */
+typedef unsigned int TGameEngineClockSource;
+
+/*
+ * The placement generator (TMoveGen.h) builds on the engine, so only its
+ * name is needed here.
+ */
+struct TMoveGen;
+
 /*
  * @typedef TGameEngine
  *
@@ -332,6 +379,9 @@ typedef struct {
     bool                doesUseColor;
     unsigned int        completionFlashIdx;
     
+    // Cells of the game board whose display changed on the last tick:
+    TGridRect           dirtyRect;
+    
     // Starting level for the game(s):
     unsigned int        startingLevel;
     
@@ -347,13 +397,20 @@ typedef struct {
     unsigned int        currentTetrominoId, nextTetrominoId;
     TSprite             currentSprite, nextSprite;
     
+    // The row at which the current tetromino would land if dropped
+    // and whether its ghost (landing) image is part of the board display:
+    int                 landingRow;
+    bool                shouldShowGhost;
+    
     // The map of position in the status list of each tetromino
     // and it's 4x4 representation to display:
     unsigned int        tetrominoIdsForReps[TTetrominosCount];
     uint16_t            terominoRepsForStats[TTetrominosCount];
     
-    // State array for the PRNG:
-    char                randomState[TGAMEENGINE_RANDOM_NSTATE];
+    // The seed with which the current game started and the state
+    // of the engine's PRNG:
+    uint64_t            randomSeed;
+    TRandomState        randomState;
     
     // The different timing variables:
     unsigned long       tickCount;          // number of times the tick function has
@@ -365,6 +422,13 @@ typedef struct {
                                             // (changes by level)
     struct timespec     tNextDrop;          // time at which next automatic line
                                             // drop (or completed line clear) occurs
+    struct timespec     tNextFlash;         // time at which the completed line
+                                            // flash next changes phase
+    
+    // The source of time for the engine and the current time on the
+    // virtual clock:
+    TGameEngineClockSource  clockSource;
+    struct timespec         tVirtual;
 } TGameEngine;
 
 /*
@@ -379,15 +443,89 @@ typedef struct {
  */
 TGameEngine* TGameEngineCreate(TBitGridWordSize wordSize, bool useColor, unsigned int w, unsigned int h, unsigned int startingLevel);
 
+/*
+ * @function TGameEngineSetClockSource
+ *
+ * Select the source of time for the gameEngine.  Selecting the virtual clock
+ * resets it to zero.  The clock source should be chosen before a game is
+ * started; changing it mid-game leaves the engine's timers relative to the
+ * old clock.
+ *
+ * The clock source is not altered by TGameEngineReset().
+ */
+void TGameEngineSetClockSource(TGameEngine *gameEngine, TGameEngineClockSource clockSource);
+
+/*
+ * @function TGameEngineGetTime
+ *
+ * Fill-in *t with the current time according to the gameEngine's clock
+ * source.  Returns t.
+ */
+static inline struct timespec*
+TGameEngineGetTime(
+    TGameEngine         *gameEngine,
+    struct timespec     *t
+)
+{
+    if ( gameEngine->clockSource == TGameEngineClockSourceVirtual )
+        *t = gameEngine->tVirtual;
+    else
+        clock_gettime(CLOCK_REALTIME, t);
+    return t;
+}
+
+/*
+ * @function TGameEngineAdvanceVirtualClock
+ *
+ * Move the gameEngine's virtual clock forward by dt.  Has no effect on
+ * the engine's timing unless it is using the virtual clock source.
+ */
+static inline void
+TGameEngineAdvanceVirtualClock(
+    TGameEngine             *gameEngine,
+    struct timespec const   *dt
+)
+{
+    timespec_add(&gameEngine->tVirtual, &gameEngine->tVirtual, dt);
+}
+
+/*
+ * @function TGameEngineSetVirtualClock
+ *
+ * Set the gameEngine's virtual clock to the absolute time t.  Has no
+ * effect on the engine's timing unless it is using the virtual clock
+ * source.
+ */
+static inline void
+TGameEngineSetVirtualClock(
+    TGameEngine             *gameEngine,
+    struct timespec const   *t
+)
+{
+    gameEngine->tVirtual = *t;
+}
+
 /*
  * @function TGameEngineReset
  *
  * Reset all elements of the gameEngine to their initial starting values.
  * The game board is cleared, new tetromino pieces are selected, timers are
  * reset, etc.
+ *
+ * The engine's PRNG is seeded from the current time; the seed used is
+ * available in the randomSeed field.
  */
 void TGameEngineReset(TGameEngine *gameEngine);
 
+/*
+ * @function TGameEngineResetWithSeed
+ *
+ * Like TGameEngineReset() but the engine's PRNG is seeded with the given
+ * seed.  Two engines reset with the same seed (and the same dimensions)
+ * produce the same sequence of tetrominos and colors.
+ */
+void TGameEngineResetWithSeed(TGameEngine *gameEngine, uint64_t seed);
+
 /*
  * @function TGameEngineChooseNextPiece
  *
@@ -415,7 +553,7 @@ bool TGameEngineCheckForCompleteRows(TGameEngine *gameEngine, bool shouldTestOnl
  * settled.  So it's more optimal to just check the 4 rows the tetromino
  * sprite occupies.
  */
-bool TGameEngineCheckForCompleteRowsInRange(TGameEngine *gameEngine, bool shouldTestOnly, unsigned int startRow, unsigned int endRow);
+bool TGameEngineCheckForCompleteRowsInRange(TGameEngine *gameEngine, bool shouldTestOnly, int startRow, int endRow);
 
 /*
  * @function TGameEngineTick
@@ -426,4 +564,148 @@ bool TGameEngineCheckForCompleteRowsInRange(TGameEngine *gameEngine, bool should
  */
 TGameEngineUpdateNotification TGameEngineTick(TGameEngine *gameEngine, TGameEngineEvent theEvent);
 
+/*
+ * @function TGameEngineApplyPlacement
+ *
+ * Place the in-play tetromino at the given orientation ([0,3]) with its 4x4
+ * cell at grid column column, as if it were rotated and shifted there one
+ * event at a time and hard dropped.  The placement is reachable if those
+ * rotations (clockwise or anti-clockwise) followed by those shifts -- or the
+ * shifts followed by the rotations -- collide with nothing along the way.
+ *
+ * The drop locks the tetromino, clears any completed rows immediately (there
+ * is no hold on them), awards the hard drop and line points, spawns the next
+ * tetromino and checks for game over, leaving the scoreboard exactly as the
+ * equivalent events would.  The engine's timers are not touched.
+ *
+ * Returns false (with the engine unchanged) if the game is not in play or
+ * the placement is not reachable.
+ */
+bool TGameEngineApplyPlacement(TGameEngine *gameEngine, unsigned int orientation, int column);
+
+/*
+ * @function TGameEngineFindPlacementPath
+ *
+ * The events that take the in-play tetromino to the given orientation and
+ * column by the route TGameEngineApplyPlacement() would take:  the
+ * rotations and the shifts, in the order that avoids collisions.  Up to
+ * maxEvents of them are written to events; the hard drop that finishes the
+ * placement is not included.  If landingRow is not NULL it is set to the
+ * row at which the hard drop would lock the tetromino.
+ *
+ * Returns the number of rotations and shifts (zero if the tetromino is
+ * already straight above its landing spot), or -1 if the game is not in
+ * play or the placement is not reachable that way.
+ */
+int TGameEngineFindPlacementPath(TGameEngine *gameEngine, unsigned int orientation, int column, int *landingRow, TGameEngineEvent *events, unsigned int maxEvents);
+
+/*
+ * @function TGameEngineApplyRestingPlacement
+ *
+ * Lock the in-play tetromino at placement, a resting position it can reach
+ * (see TMoveGen.h); slides and tucks under overhangs are allowed.  The
+ * engine checks that placement is the in-play tetromino, that it fits and
+ * cannot drop further, and that it can be reached from where the tetromino
+ * is now:  a placement that rotations, shifts and a hard drop do not reach
+ * is checked by generating the in-play tetromino's placements with
+ * moveGen, a placement generator for the game board's size.
+ *
+ * A placement that TGameEngineApplyPlacement() reaches is applied by it and
+ * scores as a hard drop; any other scores as a soft drop from the current
+ * row.  Lines are cleared and the next tetromino spawned as for
+ * TGameEngineApplyPlacement().
+ *
+ * Returns false (with the engine unchanged) if the game is not in play or
+ * placement fails the checks.
+ */
+bool TGameEngineApplyRestingPlacement(TGameEngine *gameEngine, struct TMoveGen *moveGen, TSprite *placement);
+
+/*
+ * @function TGameEngineGetDirtyRect
+ *
+ * Returns the bounds of the game board cells whose displayed content changed
+ * on the most recent call to TGameEngineTick() (or TGameEngineReset()):  the
+ * cells written to the board (placed pieces, marked or removed rows and the
+ * rows shifted down to replace them), the old and new bounds of the in-play
+ * tetromino (and of its ghost, see TGameEngineSetShowsGhost()), and the
+ * completed rows when their flash toggles.  A change of state that alters
+ * the entire board display (starting, pausing, resuming or ending a game)
+ * covers the whole board.  The rectangle is empty if nothing on the board
+ * changed.
+ *
+ * The bounds are gathered from the writes and sprite moves themselves; no
+ * scan of the board is involved.
+ */
+static inline TGridRect
+TGameEngineGetDirtyRect(
+    TGameEngine     *gameEngine
+)
+{
+    return gameEngine->dirtyRect;
+}
+
+/*
+ * @function TGameEngineGetLandingRow
+ *
+ * Returns the row at which the current tetromino would come to rest if it
+ * were dropped straight down from its present position.  The landing row is
+ * found from the game board's column tops and the tetromino's bottom profile
+ * and is only recomputed when the tetromino moves horizontally, rotates or
+ * is replaced by the next piece.
+ */
+static inline int
+TGameEngineGetLandingRow(
+    TGameEngine     *gameEngine
+)
+{
+    return gameEngine->landingRow;
+}
+
+/*
+ * @function TGameEngineGetGhostSprite
+ *
+ * Returns a copy of the current tetromino moved down to its landing row.
+ */
+static inline TSprite
+TGameEngineGetGhostSprite(
+    TGameEngine     *gameEngine
+)
+{
+    TSprite         ghostSprite = gameEngine->currentSprite;
+    
+    ghostSprite.P.j = gameEngine->landingRow;
+    return ghostSprite;
+}
+
+/*
+ * @function TGameEngineSetShowsGhost
+ *
+ * Set whether the consumer draws the ghost of the current tetromino at its
+ * landing row; if so, the ghost's old and new bounds are included in the
+ * dirty rectangle as it moves.  Not altered by TGameEngineReset().
+ */
+static inline void
+TGameEngineSetShowsGhost(
+    TGameEngine     *gameEngine,
+    bool            shouldShowGhost
+)
+{
+    gameEngine->shouldShowGhost = shouldShowGhost;
+}
+
+/*
+ * @function TGameEngineGetNextDeadline
+ *
+ * Fill-in *deadline with the earliest time (on the gameEngine's clock) at
+ * which a call to TGameEngineTick() with no event will change the engine's
+ * state:  the next automatic drop while in play, the next completion flash
+ * or the end of the hold on completed lines, or "now" if the engine is
+ * waiting on the consumer to check the high score.
+ *
+ * Returns false if nothing will happen until an event arrives (e.g. the
+ * game has not started, is paused, or has ended), in which case *deadline
+ * is not modified.
+ */
+bool TGameEngineGetNextDeadline(TGameEngine *gameEngine, struct timespec *deadline);
+
 #endif /* __TGAMEENGINE_H__ */
@@ -0,0 +1,221 @@
+/*	THeadlessDriver.c
+	Copyright (c) 2024, J T Frey
+*/
+
+#include "THeadlessDriver.h"
+
+#include <limits.h>
+
+static struct timespec THeadlessDriverOneNanosecond = { .tv_sec = 0, .tv_nsec = 1 };
+
+//
+
+void
+THeadlessDriverPlayGame(
+    TGameEngine                     *gameEngine,
+    THeadlessPlayerFn               playerFn,
+    void                            *playerContext,
+    const THeadlessDriverOptions    *options,
+    THeadlessGameResult             *result
+)
+{
+    THeadlessDriverOptions  defaultOptions = THeadlessDriverOptionsMake();
+    unsigned long           nTicks = 0;
+    bool                    isRunning = true, didFinish = false;
+
+    if ( ! options ) options = &defaultOptions;
+
+    if ( gameEngine->clockSource != TGameEngineClockSourceVirtual )
+        TGameEngineSetClockSource(gameEngine, TGameEngineClockSourceVirtual);
+    if ( gameEngine->gameState != TGameEngineStateStartup )
+        TGameEngineReset(gameEngine);
+
+    TGameEngineTick(gameEngine, TGameEngineEventStartGame), nTicks++;
+
+    while ( isRunning ) {
+        switch ( gameEngine->gameState ) {
+
+            case TGameEngineStateGameHasStarted:
+                if ( options->maxPieces && (TScoreboardGetTetrominoCount(&gameEngine->scoreboard) >= options->maxPieces) ) {
+                    isRunning = false;
+                    break;
+                }
+                TGameEngineAdvanceVirtualClock(gameEngine, &options->tickInterval);
+                TGameEngineTick(gameEngine, playerFn(gameEngine, playerContext)), nTicks++;
+                break;
+
+            case TGameEngineStateHoldClearedLines: {
+                // Nothing happens until the hold expires, so jump the clock
+                // just past it:
+                struct timespec     tExpire;
+
+                TGameEngineSetVirtualClock(gameEngine, timespec_add(&tExpire, &gameEngine->tNextDrop, &THeadlessDriverOneNanosecond));
+                TGameEngineTick(gameEngine, TGameEngineEventNoOp), nTicks++;
+                break;
+            }
+
+            case TGameEngineStateGameIsPaused:
+                TGameEngineTick(gameEngine, TGameEngineEventTogglePause), nTicks++;
+                break;
+
+            case TGameEngineStateCheckHighScore:
+                // No high score handling when headless:
+                gameEngine->gameState = TGameEngineStateGameHasEnded;
+                didFinish = true;
+                isRunning = false;
+                break;
+
+            default:
+                isRunning = false;
+                break;
+
+        }
+    }
+    if ( result ) {
+        result->seed = gameEngine->randomSeed;
+        result->scoreboard = gameEngine->scoreboard;
+        result->nPieces = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+        result->nTicks = nTicks;
+        result->tElapsed = gameEngine->tElapsed;
+        result->didFinish = didFinish;
+    }
+}
+
+//
+
+void
+THeadlessDriverPlayGameWithPlacements(
+    TGameEngine                     *gameEngine,
+    THeadlessPlacementFn            placementFn,
+    void                            *placementContext,
+    const THeadlessDriverOptions    *options,
+    THeadlessGameResult             *result
+)
+{
+    THeadlessDriverOptions  defaultOptions = THeadlessDriverOptionsMake();
+    unsigned long           nPlacements = 0;
+    bool                    didFinish = false;
+    TMoveGen                *moveGen = NULL;
+
+    if ( ! options ) options = &defaultOptions;
+
+    if ( gameEngine->clockSource != TGameEngineClockSourceVirtual )
+        TGameEngineSetClockSource(gameEngine, TGameEngineClockSourceVirtual);
+    if ( gameEngine->gameState != TGameEngineStateStartup )
+        TGameEngineReset(gameEngine);
+
+    TGameEngineTick(gameEngine, TGameEngineEventStartGame);
+
+    while ( gameEngine->gameState == TGameEngineStateGameHasStarted ) {
+        TSprite             placement = gameEngine->currentSprite;
+        bool                didPlace;
+
+        if ( options->maxPieces && (TScoreboardGetTetrominoCount(&gameEngine->scoreboard) >= options->maxPieces) ) break;
+        if ( placementFn(gameEngine, placementContext, &placement) ) {
+            // The engine checks a resting position with a generator of
+            // the driver's own:
+            if ( ! moveGen ) moveGen = TMoveGenCreate(gameEngine->gameBoard->dimensions.w, gameEngine->gameBoard->dimensions.h);
+            didPlace = moveGen && TGameEngineApplyRestingPlacement(gameEngine, moveGen, &placement);
+        } else
+            didPlace = TGameEngineApplyPlacement(gameEngine, placement.orientation, placement.P.i);
+        if ( ! didPlace )
+            TGameEngineApplyPlacement(gameEngine, gameEngine->currentSprite.orientation, gameEngine->currentSprite.P.i);
+        nPlacements++;
+    }
+    if ( moveGen ) TMoveGenDestroy(moveGen);
+    if ( gameEngine->gameState == TGameEngineStateCheckHighScore ) {
+        // No high score handling when headless:
+        gameEngine->gameState = TGameEngineStateGameHasEnded;
+        didFinish = true;
+    }
+    if ( result ) {
+        result->seed = gameEngine->randomSeed;
+        result->scoreboard = gameEngine->scoreboard;
+        result->nPieces = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+        result->nTicks = nPlacements;
+        result->tElapsed = gameEngine->tElapsed;
+        result->didFinish = didFinish;
+    }
+}
+
+//
+////
+//
+
+void
+THeadlessRandomPlayerInit(
+    THeadlessRandomPlayer   *thePlayer,
+    uint64_t                seed
+)
+{
+    TRandomSeed(&thePlayer->randomState, seed);
+    thePlayer->pieceCount = ULONG_MAX;
+    thePlayer->nRotations = 0;
+    thePlayer->nShifts = 0;
+    thePlayer->moveGen = NULL;
+}
+
+//
+
+TGameEngineEvent
+THeadlessRandomPlayerNextEvent(
+    TGameEngine     *gameEngine,
+    void            *context
+)
+{
+#define THE_PLAYER ((THeadlessRandomPlayer*)context)
+    unsigned long   pieceCount = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+
+    if ( pieceCount != THE_PLAYER->pieceCount ) {
+        // A new piece is in play; choose its orientation and target column.  The
+        // target is the column of the piece's 4x4 cell, which can extend past the
+        // edges of the board:
+        int         targetI = (int)TRandomNextInRange(&THE_PLAYER->randomState, gameEngine->gameBoard->dimensions.w + 2) - 1;
+
+        THE_PLAYER->pieceCount = pieceCount;
+        THE_PLAYER->nRotations = TRandomNextInRange(&THE_PLAYER->randomState, 4);
+        THE_PLAYER->nShifts = targetI - gameEngine->currentSprite.P.i;
+    }
+    if ( THE_PLAYER->nRotations ) {
+        THE_PLAYER->nRotations--;
+        return TGameEngineEventRotateClockwise;
+    }
+    if ( THE_PLAYER->nShifts < 0 ) {
+        THE_PLAYER->nShifts++;
+        return TGameEngineEventMoveLeft;
+    }
+    if ( THE_PLAYER->nShifts > 0 ) {
+        THE_PLAYER->nShifts--;
+        return TGameEngineEventMoveRight;
+    }
+    // Piece will be locked by the drop, so the next call chooses anew:
+    THE_PLAYER->pieceCount = ULONG_MAX;
+    return TGameEngineEventHardDrop;
+#undef THE_PLAYER
+}
+
+//
+
+bool
+THeadlessRandomPlayerNextPlacement(
+    TGameEngine     *gameEngine,
+    void            *context,
+    TSprite         *placement
+)
+{
+#define THE_PLAYER ((THeadlessRandomPlayer*)context)
+    if ( THE_PLAYER->moveGen ) {
+        unsigned int    nPlacements = TMoveGenGeneratePlacements(THE_PLAYER->moveGen, gameEngine->gameBoard, &gameEngine->currentSprite);
+
+        if ( nPlacements ) {
+            *placement = THE_PLAYER->moveGen->placements[TRandomNextInRange(&THE_PLAYER->randomState, nPlacements)];
+            return true;
+        }
+    }
+    // Same draws as the event player:  the target column of the piece's 4x4
+    // cell, then the number of clockwise rotations:
+    placement->P.i = (int)TRandomNextInRange(&THE_PLAYER->randomState, gameEngine->gameBoard->dimensions.w + 2) - 1;
+    placement->orientation = (gameEngine->currentSprite.orientation + TRandomNextInRange(&THE_PLAYER->randomState, 4)) % 4;
+    return false;
+#undef THE_PLAYER
+}
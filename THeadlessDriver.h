@@ -0,0 +1,185 @@
+/*	THeadlessDriver.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Headless game driver
+	The TUI program drives a TGameEngine from a loop that waits on the
+	keyboard, with the engine's timing derived from the real-time clock.
+	For bot evaluation and regression runs there is no keyboard and no
+	reason to wait:  the headless driver runs a game engine on its virtual
+	clock and asks a player function for each event.
+
+	The virtual clock is only advanced by the driver when the engine is
+	waiting on time (e.g. the hold on completed lines) or by a fixed
+	interval per event if the consumer wants gravity to play a role.
+	Otherwise a game proceeds exactly as fast as the player function and
+	TGameEngineTick() allow.
+
+	A simple random player is included; it rotates each piece a random
+	number of times, shifts it to a random column, and hard drops it.
+
+	Players that decide where each tetromino goes rather than which key
+	to press are driven by THeadlessDriverPlayGameWithPlacements():  each
+	choice is applied with TGameEngineApplyPlacement() (or, for a resting
+	position from the placement generator, TGameEngineApplyRestingPlacement()),
+	so there are no per-event ticks, no clock and no hold on completed
+	lines.  Given a placement generator, the random player chooses among
+	every reachable resting position.
+*/
+
+#ifndef __THEADLESSDRIVER_H__
+#define __THEADLESSDRIVER_H__
+
+#include "tetrominotris_config.h"
+#include "TGameEngine.h"
+#include "TMoveGen.h"
+
+/*
+ * @typedef THeadlessPlayerFn
+ *
+ * The type of a function that chooses the next event to send to the
+ * gameEngine.  The function is only called while the game is in
+ * play (the TGameEngineStateGameHasStarted state).  The context is
+ * the opaque pointer passed to THeadlessDriverPlayGame().
+ */
+typedef TGameEngineEvent (*THeadlessPlayerFn)(TGameEngine *gameEngine, void *context);
+
+/*
+ * @typedef THeadlessPlacementFn
+ *
+ * The type of a function that chooses where the in-play tetromino of
+ * gameEngine should be placed.  On entry *placement is a copy of the
+ * in-play sprite; the function sets its orientation ([0,3]) and the
+ * grid column of its 4x4 cell (P.i).  If the function also sets the
+ * row (P.j) to make *placement one of the resting positions found by
+ * TMoveGenGeneratePlacements() it returns true; it returns false to
+ * have the tetromino dropped from above.  The context is the opaque
+ * pointer passed to THeadlessDriverPlayGameWithPlacements().
+ */
+typedef bool (*THeadlessPlacementFn)(TGameEngine *gameEngine, void *context, TSprite *placement);
+
+/*
+ * @typedef THeadlessDriverOptions
+ *
+ * Options that control a headless game:
+ *
+ * - maxPieces:  stop the game once this many tetrominos have been
+ *       placed (zero for no limit)
+ * - tickInterval:  amount the virtual clock is advanced before each
+ *       event is sent to the engine; a zero interval means the
+ *       in-play tetromino only moves in response to player events
+ */
+typedef struct {
+    unsigned long       maxPieces;
+    struct timespec     tickInterval;
+} THeadlessDriverOptions;
+
+/*
+ * @function THeadlessDriverOptionsMake
+ *
+ * Initialize and return the default headless driver options:  no
+ * piece limit and no gravity.
+ */
+static inline THeadlessDriverOptions
+THeadlessDriverOptionsMake(void)
+{
+    THeadlessDriverOptions  options = {
+                                .maxPieces = 0,
+                                .tickInterval = { .tv_sec = 0, .tv_nsec = 0 }
+                            };
+    return options;
+}
+
+/*
+ * @typedef THeadlessGameResult
+ *
+ * The outcome of a headless game:  the seed of the engine's PRNG
+ * for the game, the final scoreboard, the number
+ * of tetrominos placed, the number of calls made to TGameEngineTick(),
+ * and the amount of (virtual) time the game was in play.  The
+ * didFinish flag is true if the game ended because no new tetromino
+ * could be placed, false if it was stopped by the piece limit.
+ */
+typedef struct {
+    uint64_t            seed;
+    TScoreboard         scoreboard;
+    unsigned long       nPieces;
+    unsigned long       nTicks;
+    struct timespec     tElapsed;
+    bool                didFinish;
+} THeadlessGameResult;
+
+/*
+ * @function THeadlessDriverPlayGame
+ *
+ * Play a single game on gameEngine, which is switched to its virtual
+ * clock and reset if it is not in the startup state.  For a
+ * reproducible game, call TGameEngineResetWithSeed() on the engine
+ * before calling this function.  Events are
+ * chosen by calling playerFn with playerContext.  If options is NULL
+ * the defaults from THeadlessDriverOptionsMake() are used.
+ *
+ * On return the engine is in the TGameEngineStateGameHasEnded state
+ * (or TGameEngineStateGameHasStarted if the piece limit was hit).
+ * If result is not NULL it is filled-in with the outcome of the
+ * game.
+ */
+void THeadlessDriverPlayGame(TGameEngine *gameEngine, THeadlessPlayerFn playerFn, void *playerContext, const THeadlessDriverOptions *options, THeadlessGameResult *result);
+
+/*
+ * @function THeadlessDriverPlayGameWithPlacements
+ *
+ * Play a single game on gameEngine like THeadlessDriverPlayGame(), but
+ * with each tetromino placed where placementFn chooses by a single
+ * call to TGameEngineApplyPlacement() or
+ * TGameEngineApplyRestingPlacement().  A placement that cannot be
+ * reached drops the tetromino where it is instead.  The tickInterval
+ * of options does not apply; result->nTicks counts the placements.
+ */
+void THeadlessDriverPlayGameWithPlacements(TGameEngine *gameEngine, THeadlessPlacementFn placementFn, void *placementContext, const THeadlessDriverOptions *options, THeadlessGameResult *result);
+
+/*
+ * @typedef THeadlessRandomPlayer
+ *
+ * Context for the random player.  Initialize with the
+ * THeadlessRandomPlayerInit() function and pass to
+ * THeadlessDriverPlayGame() along with THeadlessRandomPlayerNextEvent().
+ * For THeadlessRandomPlayerNextPlacement() a placement generator for
+ * the board may be set in moveGen.
+ */
+typedef struct {
+    TRandomState        randomState;
+    unsigned long       pieceCount;
+    unsigned int        nRotations;
+    int                 nShifts;
+    TMoveGen            *moveGen;
+} THeadlessRandomPlayer;
+
+/*
+ * @function THeadlessRandomPlayerInit
+ *
+ * Initialize the random player at thePlayer with the given seed.
+ */
+void THeadlessRandomPlayerInit(THeadlessRandomPlayer *thePlayer, uint64_t seed);
+
+/*
+ * @function THeadlessRandomPlayerNextEvent
+ *
+ * A THeadlessPlayerFn that implements the random player; context must
+ * be a pointer to an initialized THeadlessRandomPlayer.
+ */
+TGameEngineEvent THeadlessRandomPlayerNextEvent(TGameEngine *gameEngine, void *context);
+
+/*
+ * @function THeadlessRandomPlayerNextPlacement
+ *
+ * A THeadlessPlacementFn that chooses the random player's orientation
+ * and column for the in-play tetromino in one go -- or, if the player
+ * has a placement generator, one of the tetromino's resting positions
+ * at random; context must be a pointer to an initialized
+ * THeadlessRandomPlayer.
+ */
+bool THeadlessRandomPlayerNextPlacement(TGameEngine *gameEngine, void *context, TSprite *placement);
+
+#endif /* __THEADLESSDRIVER_H__ */
@@ -0,0 +1,446 @@
+/*	TMoveGen.c
+	Copyright (c) 2024, J T Frey
+*/
+
+#include "TMoveGen.h"
+
+/*
+ * Rows of position masks start at row -3 (the highest a 4x4 cell can
+ * sit with a cell still on the board); bit b of a mask is column b - 3.
+ * The board's row masks run from row -3 to row h + 3 so that every row
+ * a 4x4 cell covers has one.
+ */
+#define TMOVEGEN_ROW_OFFSET     3
+#define TMOVEGEN_COL_OFFSET     3
+
+//
+
+/*
+ * @function __TMoveGenFillUp
+ *
+ * Occluded fill of the bits of seeds toward higher bits through the set
+ * bits of propagators (a Kogge-Stone fill:  six shift steps cover a whole
+ * 64-bit row).
+ */
+static inline uint64_t
+__TMoveGenFillUp(
+    uint64_t        seeds,
+    uint64_t        propagators
+)
+{
+    seeds |= propagators & (seeds << 1);
+    propagators &= propagators << 1;
+    seeds |= propagators & (seeds << 2);
+    propagators &= propagators << 2;
+    seeds |= propagators & (seeds << 4);
+    propagators &= propagators << 4;
+    seeds |= propagators & (seeds << 8);
+    propagators &= propagators << 8;
+    seeds |= propagators & (seeds << 16);
+    propagators &= propagators << 16;
+    seeds |= propagators & (seeds << 32);
+    return seeds;
+}
+
+/*
+ * @function __TMoveGenFillDown
+ *
+ * Occluded fill of the bits of seeds toward lower bits through the set
+ * bits of propagators.
+ */
+static inline uint64_t
+__TMoveGenFillDown(
+    uint64_t        seeds,
+    uint64_t        propagators
+)
+{
+    seeds |= propagators & (seeds >> 1);
+    propagators &= propagators >> 1;
+    seeds |= propagators & (seeds >> 2);
+    propagators &= propagators >> 2;
+    seeds |= propagators & (seeds >> 4);
+    propagators &= propagators >> 4;
+    seeds |= propagators & (seeds >> 8);
+    propagators &= propagators >> 8;
+    seeds |= propagators & (seeds >> 16);
+    propagators &= propagators >> 16;
+    seeds |= propagators & (seeds >> 32);
+    return seeds;
+}
+
+//
+
+TMoveGen*
+TMoveGenCreate(
+    unsigned int    w,
+    unsigned int    h
+)
+{
+    TMoveGen        *newMoveGen = NULL;
+
+    if ( (w > 0) && (w <= TMoveGenMaxWidth) && (h > 0) ) {
+        // Position rows include one past the bottom where nothing fits:
+        unsigned int    nPositionRows = h + TMOVEGEN_ROW_OFFSET + 1;
+        unsigned int    nBoardRows = h + 2 * TMOVEGEN_ROW_OFFSET + 1;
+        unsigned int    nPlacementsMax = 4 * (w + TMOVEGEN_COL_OFFSET) * (h + TMOVEGEN_ROW_OFFSET);
+        size_t          nBytes = sizeof(TMoveGen) + (nBoardRows + 12 * nPositionRows) * sizeof(uint64_t) + nPlacementsMax * (sizeof(TSprite) + sizeof(uint32_t) + sizeof(uint8_t));
+
+        newMoveGen = (TMoveGen*)malloc(nBytes);
+        if ( newMoveGen ) {
+            uint64_t    *rows = (uint64_t*)((uint8_t*)newMoveGen + sizeof(TMoveGen));
+            int         o = 0;
+
+            newMoveGen->w = w;
+            newMoveGen->h = h;
+            newMoveGen->boardRows = rows;
+            rows += nBoardRows;
+            while ( o < 4 ) {
+                newMoveGen->fitsAt[o] = rows;
+                newMoveGen->reaches[o] = rows + nPositionRows;
+                newMoveGen->pending[o] = rows + 2 * nPositionRows;
+                rows += 3 * nPositionRows;
+                o++;
+            }
+            newMoveGen->nPlacements = 0;
+            newMoveGen->placements = (TSprite*)rows;
+            newMoveGen->pathQueue = (uint32_t*)(newMoveGen->placements + nPlacementsMax);
+            newMoveGen->pathMoves = (uint8_t*)(newMoveGen->pathQueue + nPlacementsMax);
+        }
+    }
+    return newMoveGen;
+}
+
+//
+
+void
+TMoveGenDestroy(
+    TMoveGen    *moveGen
+)
+{
+    free((void*)moveGen);
+}
+
+//
+
+unsigned int
+TMoveGenGeneratePlacements(
+    TMoveGen        *moveGen,
+    TBitGrid        *board,
+    TSprite         *sprite
+)
+{
+    unsigned int    w = moveGen->w, h = moveGen->h;
+    unsigned int    nPositionRows = h + TMOVEGEN_ROW_OFFSET;
+    uint64_t        positionMask = ((uint64_t)1 << (w + TMOVEGEN_COL_OFFSET)) - 1;
+    uint64_t        wallMask = ~positionMask | (((uint64_t)1 << TMOVEGEN_COL_OFFSET) - 1);
+    TSprite         orientedSprites[4];
+    uint16_t        shapes[4];
+    int             sameCellsAs[4], sameCellsDI[4], sameCellsDJ[4];
+    unsigned int    dirtyFrom[4], dirtyTo[4];
+    unsigned int    o, r, startO, stackTop;
+
+    moveGen->nPlacements = 0;
+    if ( (board->dimensions.w != w) || (board->dimensions.h != h) || ! TSpriteGet4x4(sprite) ) return 0;
+
+    // Board rows, with everything outside the board occupied; rows above
+    // the highest column top are empty and need not be read:
+    stackTop = h;
+    o = 0;
+    while ( o < w ) {
+        if ( TBitGridGetColumnTop(board, o) < stackTop ) stackTop = TBitGridGetColumnTop(board, o);
+        o++;
+    }
+    r = 0;
+    while ( r < h + 2 * TMOVEGEN_ROW_OFFSET + 1 ) {
+        int         j = (int)r - TMOVEGEN_ROW_OFFSET;
+
+        if ( (j < 0) || (j >= (int)h) ) moveGen->boardRows[r] = ~(uint64_t)0;
+        else if ( j < (int)stackTop ) moveGen->boardRows[r] = wallMask;
+        else moveGen->boardRows[r] = (TBitGridGetRowBits(board, 0, j) << TMOVEGEN_COL_OFFSET) | wallMask;
+        r++;
+    }
+
+    // The sprite in each orientation as rotated from its current one (the
+    // rotations carry its shifts along), and which orientations cover the
+    // same cells as an earlier one:
+    startO = sprite->orientation & 3;
+    orientedSprites[startO] = *sprite;
+    o = (startO + 1) & 3;
+    while ( o != startO ) {
+        orientedSprites[o] = TSpriteMakeRotated(&orientedSprites[(o + 3) & 3]);
+        o = (o + 1) & 3;
+    }
+    o = 0;
+    while ( o < 4 ) {
+        const TTetrominoShapeInfo   *info = TSpriteGetShapeInfo(&orientedSprites[o]);
+        unsigned int                prevO = 0;
+
+        shapes[o] = TSpriteGet4x4(&orientedSprites[o]);
+        sameCellsAs[o] = -1;
+        while ( prevO < o ) {
+            const TTetrominoShapeInfo   *prevInfo = TSpriteGetShapeInfo(&orientedSprites[prevO]);
+
+            if ( (shapes[o] >> (4 * info->jLo + info->iLo)) == (shapes[prevO] >> (4 * prevInfo->jLo + prevInfo->iLo)) ) {
+                sameCellsAs[o] = prevO;
+                sameCellsDI[o] = info->iLo - prevInfo->iLo;
+                sameCellsDJ[o] = info->jLo - prevInfo->jLo;
+                break;
+            }
+            prevO++;
+        }
+        o++;
+    }
+
+    // Where the tetromino fits in each orientation:  position (i,j)
+    // collides if any cell (ci,cj) of the shape lands on an occupied cell,
+    // i.e. bit i + ci of board row j + cj.  Positions whose cells all lie in
+    // the empty rows above the stack fit wherever the walls allow:
+    o = 0;
+    while ( o < 4 ) {
+        uint64_t        *fitsAt = moveGen->fitsAt[o];
+        unsigned int    cellI[4], cellJ[4], nCells = 0, bit = 0;
+        unsigned int    openFrom, openTo;
+        uint64_t        openFits = 0;
+
+        while ( bit < 16 ) {
+            if ( (shapes[o] >> bit) & 1 ) {
+                cellI[nCells] = bit & 3;
+                cellJ[nCells] = bit >> 2;
+                openFits |= wallMask >> cellI[nCells];
+                nCells++;
+            }
+            bit++;
+        }
+        openFits = ~openFits & positionMask;
+        openFrom = TMOVEGEN_ROW_OFFSET - cellJ[0];
+        openTo = stackTop + TMOVEGEN_ROW_OFFSET - cellJ[nCells - 1];
+        r = 0;
+        while ( r < nPositionRows ) {
+            if ( (r >= openFrom) && (r < openTo) ) {
+                fitsAt[r] = openFits;
+            } else {
+                const uint64_t  *rows = moveGen->boardRows + r;
+
+                fitsAt[r] = ~((rows[cellJ[0]] >> cellI[0]) | (rows[cellJ[1]] >> cellI[1]) | (rows[cellJ[2]] >> cellI[2]) | (rows[cellJ[3]] >> cellI[3])) & positionMask;
+            }
+            moveGen->reaches[o][r] = 0;
+            moveGen->pending[o][r] = 0;
+            r++;
+        }
+        // Below the last row nothing fits:
+        fitsAt[r] = 0;
+        moveGen->reaches[o][r] = 0;
+        dirtyFrom[o] = nPositionRows;
+        dirtyTo[o] = 0;
+        o++;
+    }
+
+    // Seed with the sprite's own position:
+    if ( (sprite->P.j < -TMOVEGEN_ROW_OFFSET) || (sprite->P.j >= (int)h) || (sprite->P.i < -TMOVEGEN_COL_OFFSET) || (sprite->P.i >= (int)w) ) return 0;
+    r = sprite->P.j + TMOVEGEN_ROW_OFFSET;
+    moveGen->reaches[startO][r] = moveGen->fitsAt[startO][r] & ((uint64_t)1 << (sprite->P.i + TMOVEGEN_COL_OFFSET));
+    if ( ! moveGen->reaches[startO][r] ) return 0;
+
+    // Flood:  sweep an orientation from the highest row with new positions
+    // downward, sliding along each row and dropping into the next, until a
+    // row adds nothing and no pending positions lie below; positions newly
+    // reached are rotated in place into the neighboring orientations, whose
+    // rows are marked pending.  Continue until no orientation has pending
+    // rows:
+    dirtyFrom[startO] = dirtyTo[startO] = r;
+    moveGen->pending[startO][r] = moveGen->reaches[startO][r];
+    moveGen->reaches[startO][r] = 0;
+    o = startO;
+    while ( 1 ) {
+        uint64_t        *fitsAt = moveGen->fitsAt[o], *reaches = moveGen->reaches[o], *pending = moveGen->pending[o];
+        unsigned int    cwO = (o + 1) & 3, acwO = (o + 3) & 3;
+        uint64_t        *cwFitsAt = moveGen->fitsAt[cwO], *cwReaches = moveGen->reaches[cwO];
+        uint64_t        *acwFitsAt = moveGen->fitsAt[acwO], *acwReaches = moveGen->reaches[acwO];
+        unsigned int    lastR = dirtyTo[o];
+        uint64_t        fromAbove;
+
+        r = dirtyFrom[o];
+        dirtyFrom[o] = nPositionRows;
+        fromAbove = r ? reaches[r - 1] : 0;
+        while ( r < nPositionRows ) {
+            uint64_t    reached = reaches[r] | pending[r] | (fromAbove & fitsAt[r]);
+            uint64_t    newBits;
+
+            pending[r] = 0;
+            if ( reached != reaches[r] ) {
+                uint64_t    fits = fitsAt[r];
+
+                // A single run of fitting positions is reached entirely:
+                if ( (fits & (fits + (fits & -fits))) == 0 ) reached = fits;
+                else reached = __TMoveGenFillUp(reached, fits) | __TMoveGenFillDown(reached, fits);
+            }
+            newBits = reached & ~reaches[r];
+            if ( newBits ) {
+                uint64_t    cw = newBits & cwFitsAt[r] & ~cwReaches[r];
+                uint64_t    acw = newBits & acwFitsAt[r] & ~acwReaches[r];
+
+                reaches[r] = reached;
+                if ( cw ) {
+                    moveGen->pending[cwO][r] |= cw;
+                    if ( r < dirtyFrom[cwO] ) dirtyFrom[cwO] = r;
+                    if ( r > dirtyTo[cwO] ) dirtyTo[cwO] = r;
+                }
+                if ( acw ) {
+                    moveGen->pending[acwO][r] |= acw;
+                    if ( r < dirtyFrom[acwO] ) dirtyFrom[acwO] = r;
+                    if ( r > dirtyTo[acwO] ) dirtyTo[acwO] = r;
+                }
+            } else if ( r >= lastR ) {
+                break;
+            }
+            fromAbove = reached;
+            r++;
+        }
+        dirtyTo[o] = 0;
+
+        // Next orientation with pending rows:
+        cwO = 1;
+        while ( (cwO < 4) && (dirtyFrom[(o + cwO) & 3] == nPositionRows) ) cwO++;
+        if ( cwO == 4 ) break;
+        o = (o + cwO) & 3;
+    }
+
+    // Resting positions are those that cannot drop another row; skip the
+    // ones that duplicate the cells of an earlier orientation's:
+    o = 0;
+    while ( o < 4 ) {
+        uint64_t    *fitsAt = moveGen->fitsAt[o], *reaches = moveGen->reaches[o];
+
+        r = 0;
+        while ( r < nPositionRows ) {
+            uint64_t    rests = reaches[r] & ~fitsAt[r + 1];
+
+            if ( rests && (sameCellsAs[o] >= 0) ) {
+                int         prevR = (int)r + sameCellsDJ[o];
+
+                if ( (prevR >= 0) && (prevR < (int)nPositionRows) ) {
+                    unsigned int    prevO = sameCellsAs[o];
+                    uint64_t        prevRests = moveGen->reaches[prevO][prevR] & ~moveGen->fitsAt[prevO][prevR + 1];
+
+                    rests &= ~((sameCellsDI[o] >= 0) ? (prevRests >> sameCellsDI[o]) : (prevRests << -sameCellsDI[o]));
+                }
+            }
+            while ( rests ) {
+                TSprite     *placement = &moveGen->placements[moveGen->nPlacements++];
+
+                *placement = orientedSprites[o];
+                placement->P.i = __builtin_ctzll(rests) - TMOVEGEN_COL_OFFSET;
+                placement->P.j = (int)r - TMOVEGEN_ROW_OFFSET;
+                rests &= rests - 1;
+            }
+            r++;
+        }
+        o++;
+    }
+    return moveGen->nPlacements;
+}
+
+//
+
+bool
+TMoveGenCanReach(
+    TMoveGen        *moveGen,
+    unsigned int    orientation,
+    TGridPos        P
+)
+{
+    if ( (P.j < -TMOVEGEN_ROW_OFFSET) || (P.j >= (int)moveGen->h) || (P.i < -TMOVEGEN_COL_OFFSET) || (P.i >= (int)moveGen->w) ) return false;
+    return (moveGen->reaches[orientation & 3][P.j + TMOVEGEN_ROW_OFFSET] >> (P.i + TMOVEGEN_COL_OFFSET)) & 1;
+}
+
+//
+
+/*
+ * Moves of the path search, indexed by the value stored for each position
+ * it reaches (zero being "not yet reached"):  the change in orientation,
+ * column and row, and the event that makes it.
+ */
+static const struct {
+    int                 dO, dI, dJ;
+    TGameEngineEvent    event;
+} __TMoveGenPathMoves[] = {
+                { 0,  0, 0, TGameEngineEventNoOp },
+                { 0, -1, 0, TGameEngineEventMoveLeft },
+                { 0,  1, 0, TGameEngineEventMoveRight },
+                { 0,  0, 1, TGameEngineEventSoftDrop },
+                { 1,  0, 0, TGameEngineEventRotateClockwise },
+                { 3,  0, 0, TGameEngineEventRotateAntiClockwise }
+            };
+
+int
+TMoveGenFindPath(
+    TMoveGen            *moveGen,
+    TSprite             *from,
+    TSprite             *to,
+    TGameEngineEvent    *events,
+    unsigned int        maxEvents
+)
+{
+    unsigned int        nCols = moveGen->w + TMOVEGEN_COL_OFFSET, nPositionRows = moveGen->h + TMOVEGEN_ROW_OFFSET;
+    unsigned int        nPositions = nCols * nPositionRows;
+    unsigned int        qHead = 0, qTail = 0, fromIdx, toIdx, idx, nEvents;
+
+    if ( ! TMoveGenCanReach(moveGen, from->orientation, from->P) || ! TMoveGenCanReach(moveGen, to->orientation, to->P) ) return -1;
+
+    // Position (o,i,j) is index (o * nPositionRows + j + 3) * nCols + i + 3:
+    fromIdx = ((from->orientation & 3) * nPositionRows + from->P.j + TMOVEGEN_ROW_OFFSET) * nCols + from->P.i + TMOVEGEN_COL_OFFSET;
+    toIdx = ((to->orientation & 3) * nPositionRows + to->P.j + TMOVEGEN_ROW_OFFSET) * nCols + to->P.i + TMOVEGEN_COL_OFFSET;
+
+    // Breadth-first from the starting position, recording the move that
+    // first reached each position:
+    memset(moveGen->pathMoves, 0, 4 * nPositions);
+    moveGen->pathMoves[fromIdx] = 1;
+    moveGen->pathQueue[qTail++] = fromIdx;
+    while ( (qHead < qTail) && ! (fromIdx != toIdx && moveGen->pathMoves[toIdx]) ) {
+        unsigned int    o, r, b, m = 1;
+
+        idx = moveGen->pathQueue[qHead++];
+        b = idx % nCols;
+        r = (idx / nCols) % nPositionRows;
+        o = idx / nPositions;
+        while ( m < sizeof(__TMoveGenPathMoves) / sizeof(__TMoveGenPathMoves[0]) ) {
+            unsigned int    nextO = (o + __TMoveGenPathMoves[m].dO) & 3;
+            int             nextB = (int)b + __TMoveGenPathMoves[m].dI;
+            unsigned int    nextR = r + __TMoveGenPathMoves[m].dJ;
+
+            if ( (nextB >= 0) && (nextB < (int)nCols) && (nextR < nPositionRows) && ((moveGen->fitsAt[nextO][nextR] >> nextB) & 1) ) {
+                unsigned int    nextIdx = (nextO * nPositionRows + nextR) * nCols + nextB;
+
+                if ( ! moveGen->pathMoves[nextIdx] ) {
+                    moveGen->pathMoves[nextIdx] = m;
+                    moveGen->pathQueue[qTail++] = nextIdx;
+                }
+            }
+            m++;
+        }
+    }
+    if ( fromIdx == toIdx ) return 0;
+    if ( ! moveGen->pathMoves[toIdx] ) return -1;
+
+    // Walk back from the target to count the moves, then again to write
+    // them out in order:
+    nEvents = 0;
+    idx = toIdx;
+    while ( idx != fromIdx ) {
+        unsigned int    m = moveGen->pathMoves[idx];
+        unsigned int    o = idx / nPositions, r = (idx / nCols) % nPositionRows, b = idx % nCols;
+
+        idx = (((o + 4 - __TMoveGenPathMoves[m].dO) & 3) * nPositionRows + r - __TMoveGenPathMoves[m].dJ) * nCols + b - __TMoveGenPathMoves[m].dI;
+        nEvents++;
+    }
+    idx = toIdx;
+    qHead = nEvents;
+    while ( idx != fromIdx ) {
+        unsigned int    m = moveGen->pathMoves[idx];
+        unsigned int    o = idx / nPositions, r = (idx / nCols) % nPositionRows, b = idx % nCols;
+
+        if ( --qHead < maxEvents ) events[qHead] = __TMoveGenPathMoves[m].event;
+        idx = (((o + 4 - __TMoveGenPathMoves[m].dO) & 3) * nPositionRows + r - __TMoveGenPathMoves[m].dJ) * nCols + b - __TMoveGenPathMoves[m].dI;
+    }
+    return (int)nEvents;
+}
@@ -0,0 +1,129 @@
+/*	TMoveGen.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Placement generator
+	A bot chooses where the in-play tetromino should come to rest, so it
+	needs every position the tetromino can reach and lock at:  not only
+	the straight drops from the spawn row but also slides and tucks under
+	overhangs and rotations wedged against the stack.
+
+	Rather than trying event sequences, the generator floods the space of
+	positions (orientation, i, j) with bitboards.  For each orientation
+	and row j a 64-bit mask has a bit for each column i at which the
+	tetromino fits on the board; it is built from the board's row masks
+	with a handful of shifts and ORs per row.  From the spawn position the
+	reachable positions grow by shifting along each row (an occluded fill
+	in both directions), dropping into the row below, and rotating in
+	place into the other orientations, exactly as the game engine's move
+	events do, until nothing new is reached.  A reachable position whose
+	row below is blocked is a resting position.
+
+	Orientations of a tetromino that cover the same cells (e.g. every
+	orientation of the O) would report the same resting cells twice;
+	only the first orientation's copy is kept, so each placement covers a
+	distinct set of cells.
+
+	The board's occupancy is read from channel 0 of the bit grid.  Cells
+	outside the board -- left and right of it, above the top and below
+	the bottom -- are treated as occupied, as the sentinel border of the
+	game engine's board does.  Boards up to TMoveGenMaxWidth columns wide
+	are supported.
+*/
+
+#ifndef __TMOVEGEN_H__
+#define __TMOVEGEN_H__
+
+#include "tetrominotris_config.h"
+#include "TBitGrid.h"
+#include "TSprite.h"
+#include "TGameEngine.h"
+
+/*
+ * @defined TMoveGenMaxWidth
+ *
+ * The widest board supported:  a row of positions of the 4x4 cell runs
+ * from column -3 to column w - 1, and the board row it is tested
+ * against (with three wall columns to either side) must fit in 64 bits.
+ */
+#define TMoveGenMaxWidth 58
+
+/*
+ * @typedef TMoveGen
+ *
+ * A placement generator for boards of a fixed size along with the
+ * placements it last generated.  Each placement is the in-play sprite
+ * rotated and moved to a resting position; there are nPlacements of
+ * them, ordered by orientation, then row, then column.
+ *
+ * The remaining fields are the generator's working storage:  the
+ * board's row masks (with the out-of-board cells set) and for each
+ * orientation the masks of the positions the tetromino fits at, of
+ * those it can reach and of those reached by rotation but not yet
+ * flooded from, plus the move and queue arrays of the path search.
+ */
+typedef struct TMoveGen {
+    unsigned int        w, h;
+
+    unsigned int        nPlacements;
+    TSprite             *placements;
+
+    uint64_t            *boardRows;
+    uint64_t            *fitsAt[4];
+    uint64_t            *reaches[4];
+    uint64_t            *pending[4];
+
+    uint8_t             *pathMoves;
+    uint32_t            *pathQueue;
+} TMoveGen;
+
+/*
+ * @function TMoveGenCreate
+ *
+ * Create a placement generator for w x h boards.  Returns NULL if the
+ * board is wider than TMoveGenMaxWidth or memory could not be
+ * allocated.
+ */
+TMoveGen* TMoveGenCreate(unsigned int w, unsigned int h);
+
+/*
+ * @function TMoveGenDestroy
+ *
+ * Dispose of moveGen.
+ */
+void TMoveGenDestroy(TMoveGen *moveGen);
+
+/*
+ * @function TMoveGenGeneratePlacements
+ *
+ * Find every distinct resting position sprite can reach on board from
+ * where it is now and store them as the placements of moveGen.  Returns
+ * the number of placements; zero if sprite does not fit where it is.
+ */
+unsigned int TMoveGenGeneratePlacements(TMoveGen *moveGen, TBitGrid *board, TSprite *sprite);
+
+/*
+ * @function TMoveGenCanReach
+ *
+ * After TMoveGenGeneratePlacements(), returns true if the sprite could
+ * be moved to position P in the given orientation (whether or not it
+ * would rest there).
+ */
+bool TMoveGenCanReach(TMoveGen *moveGen, unsigned int orientation, TGridPos P);
+
+/*
+ * @function TMoveGenFindPath
+ *
+ * After TMoveGenGeneratePlacements() for the sprite from, find a
+ * shortest sequence of move left, move right, soft drop and rotate
+ * events that brings from to the position and orientation of to
+ * (e.g. one of the generated placements).  Up to maxEvents of them are
+ * written to events.
+ *
+ * Returns the length of the sequence (zero if from is already at to),
+ * or -1 if to cannot be reached.
+ */
+int TMoveGenFindPath(TMoveGen *moveGen, TSprite *from, TSprite *to, TGameEngineEvent *events, unsigned int maxEvents);
+
+#endif /* __TMOVEGEN_H__ */
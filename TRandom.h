@@ -0,0 +1,112 @@
+/*	TRandom.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Pseudo-random number generator
+	A small, fast, reentrant PRNG.  The state is held entirely by
+	the caller, so each game engine owns its own sequence and no
+	process-global state (e.g. that of random()) is touched.  Two
+	engines seeded identically produce identical sequences regardless
+	of what other engines or threads are doing.
+
+	The generator is xoshiro256** (Blackman and Vigna); the 64-bit
+	seed is expanded to the 256-bit state using splitmix64, which
+	guarantees the state is never all zeroes.
+
+	All functions are very simple and are declared for static
+	inlining to avoid function calls as much as possible.
+*/
+
+#ifndef __TRANDOM_H__
+#define __TRANDOM_H__
+
+#include "tetrominotris_config.h"
+
+/*
+ * @typedef TRandomState
+ *
+ * The state of a PRNG sequence.
+ */
+typedef struct {
+    uint64_t    s[4];
+} TRandomState;
+
+/*
+ * @function __TRandomRotl
+ *
+ * Rotate the 64-bit word x left by k bits.
+ */
+static inline uint64_t
+__TRandomRotl(
+    uint64_t    x,
+    int         k
+)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/*
+ * @function TRandomSeed
+ *
+ * Initialize the PRNG state at randomState from the given seed.
+ */
+static inline void
+TRandomSeed(
+    TRandomState    *randomState,
+    uint64_t        seed
+)
+{
+    int             i = 0;
+
+    while ( i < 4 ) {
+        uint64_t    z = (seed += 0x9E3779B97F4A7C15ULL);
+
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        randomState->s[i++] = z ^ (z >> 31);
+    }
+}
+
+/*
+ * @function TRandomNext
+ *
+ * Return the next 64-bit value in the sequence and advance the
+ * state at randomState.
+ */
+static inline uint64_t
+TRandomNext(
+    TRandomState    *randomState
+)
+{
+    uint64_t        *s = randomState->s;
+    uint64_t        result = __TRandomRotl(s[1] * 5, 7) * 9;
+    uint64_t        t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = __TRandomRotl(s[3], 45);
+    return result;
+}
+
+/*
+ * @function TRandomNextInRange
+ *
+ * Return the next value in the sequence reduced to the range
+ * [0, n).  The reduction uses the high bits of the 64-bit value
+ * (multiply-shift) rather than a modulus; the bias for the small
+ * ranges used by the game is negligible.
+ */
+static inline unsigned int
+TRandomNextInRange(
+    TRandomState    *randomState,
+    unsigned int    n
+)
+{
+    return (unsigned int)(((TRandomNext(randomState) >> 32) * (uint64_t)n) >> 32);
+}
+
+#endif /* __TRANDOM_H__ */
@@ -0,0 +1,1215 @@
+/*	TReplay.c
+	Copyright (c) 2024, J T Frey
+*/
+
+#include "TReplay.h"
+
+#include <limits.h>
+
+/*
+ * Replay file magic, format versions and keyframe index footer magic:
+ */
+static const char TReplayMagic[4] = { 'T', 'T', 'R', 'P' };
+#define TREPLAY_VERSION_NO_KEYFRAMES    1
+#define TREPLAY_VERSION                 2
+static const char TReplayFooterMagic[4] = { 'T', 'T', 'R', 'K' };
+#define TREPLAY_FOOTER_BYTES            8
+
+/*
+ * Each tick is a varint holding the zig-zag encoded nanoseconds since
+ * the previous tick above the event value in the low bits:
+ */
+#define TREPLAY_EVENT_BITS          4
+#define TREPLAY_EVENT_MASK          ((1 << TREPLAY_EVENT_BITS) - 1)
+
+#define TREPLAY_NSEC_PER_SEC        1000000000LL
+
+//
+
+static inline uint64_t
+__TReplayZigZagEncode(
+    int64_t     v
+)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t
+__TReplayZigZagDecode(
+    uint64_t    v
+)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+//
+
+/*
+ * Ensure the growable byte array *bytes has room for nMore bytes past
+ * its current length.
+ */
+static bool
+__TReplayReserveBytes(
+    uint8_t     **bytes,
+    size_t      *nBytes,
+    size_t      *capacity,
+    size_t      nMore
+)
+{
+    if ( *nBytes + nMore > *capacity ) {
+        size_t      newCapacity = *capacity ? 2 * *capacity : 256;
+        uint8_t     *newBytes;
+
+        while ( newCapacity < *nBytes + nMore ) newCapacity *= 2;
+        newBytes = (uint8_t*)realloc(*bytes, newCapacity);
+        if ( ! newBytes ) return false;
+        *bytes = newBytes;
+        *capacity = newCapacity;
+    }
+    return true;
+}
+
+/*
+ * Append the LEB128 encoding of v to the growable byte array *bytes.
+ */
+static bool
+__TReplayAppendVarint(
+    uint8_t     **bytes,
+    size_t      *nBytes,
+    size_t      *capacity,
+    uint64_t    v
+)
+{
+    if ( ! __TReplayReserveBytes(bytes, nBytes, capacity, 10) ) return false;
+    while ( v >= 0x80 ) {
+        (*bytes)[(*nBytes)++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    (*bytes)[(*nBytes)++] = (uint8_t)v;
+    return true;
+}
+
+//
+
+/*
+ * Decode a LEB128 varint at *p (not reading at or beyond end) into *v
+ * and advance *p past it.  Returns false if the varint is truncated or
+ * too long for 64 bits.
+ */
+static inline bool
+__TReplayGetVarint(
+    const uint8_t   **p,
+    const uint8_t   *end,
+    uint64_t        *v
+)
+{
+    const uint8_t   *s = *p;
+    uint64_t        value = 0;
+    unsigned int    shift = 0;
+
+    while ( s < end ) {
+        uint8_t     b = *s++;
+
+        value |= (uint64_t)(b & 0x7F) << shift;
+        if ( ! (b & 0x80) ) {
+            *v = value;
+            *p = s;
+            return true;
+        }
+        shift += 7;
+        if ( shift >= 64 ) break;
+    }
+    return false;
+}
+
+/*
+ * Decode a varint that must fit in an unsigned int no greater than
+ * maxValue.
+ */
+static bool
+__TReplayGetUInt(
+    const uint8_t   **p,
+    const uint8_t   *end,
+    unsigned int    maxValue,
+    unsigned int    *v
+)
+{
+    uint64_t        value;
+
+    if ( ! __TReplayGetVarint(p, end, &value) || (value > maxValue) ) return false;
+    *v = (unsigned int)value;
+    return true;
+}
+
+//
+
+static inline int64_t
+__TReplayTimeToNanoseconds(
+    const struct timespec   *t
+)
+{
+    return (int64_t)t->tv_sec * TREPLAY_NSEC_PER_SEC + t->tv_nsec;
+}
+
+static inline struct timespec
+__TReplayNanosecondsToTime(
+    int64_t     t
+)
+{
+    struct timespec     ts = { .tv_sec = t / TREPLAY_NSEC_PER_SEC, .tv_nsec = t % TREPLAY_NSEC_PER_SEC };
+    return ts;
+}
+
+//
+
+/*
+ * Append the low nBits bits of value to the bit string that ends the
+ * growable byte array *bytes; *bitIdx counts the bits of the string
+ * written so far.
+ */
+static bool
+__TReplayAppendBits(
+    uint8_t         **bytes,
+    size_t          *nBytes,
+    size_t          *capacity,
+    size_t          *bitIdx,
+    unsigned int    value,
+    unsigned int    nBits
+)
+{
+    while ( nBits-- ) {
+        if ( (*bitIdx % 8) == 0 ) {
+            if ( ! __TReplayReserveBytes(bytes, nBytes, capacity, 1) ) return false;
+            (*bytes)[(*nBytes)++] = 0;
+        }
+        if ( value & 1 ) (*bytes)[*nBytes - 1] |= 1 << (*bitIdx % 8);
+        value >>= 1;
+        (*bitIdx)++;
+    }
+    return true;
+}
+
+/*
+ * Read nBits bits from the bit string at bits (which ends at end) starting
+ * at bit *bitIdx.
+ */
+static bool
+__TReplayGetBits(
+    const uint8_t   *bits,
+    const uint8_t   *end,
+    size_t          *bitIdx,
+    unsigned int    nBits,
+    unsigned int    *value
+)
+{
+    unsigned int    b = 0;
+
+    *value = 0;
+    while ( b < nBits ) {
+        if ( bits + *bitIdx / 8 >= end ) return false;
+        if ( bits[*bitIdx / 8] & (1 << (*bitIdx % 8)) ) *value |= 1 << b;
+        (*bitIdx)++;
+        b++;
+    }
+    return true;
+}
+
+//
+
+static bool
+__TReplayAppendTime(
+    uint8_t                 **bytes,
+    size_t                  *nBytes,
+    size_t                  *capacity,
+    const struct timespec   *t
+)
+{
+    return __TReplayAppendVarint(bytes, nBytes, capacity, __TReplayZigZagEncode(t->tv_sec))
+            && __TReplayAppendVarint(bytes, nBytes, capacity, t->tv_nsec);
+}
+
+static bool
+__TReplayGetTime(
+    const uint8_t   **p,
+    const uint8_t   *end,
+    struct timespec *t
+)
+{
+    uint64_t        sec, nsec;
+
+    if ( ! __TReplayGetVarint(p, end, &sec) || ! __TReplayGetVarint(p, end, &nsec) || (nsec > TREPLAY_NSEC_PER_SEC) ) return false;
+    t->tv_sec = (time_t)__TReplayZigZagDecode(sec);
+    t->tv_nsec = (long)nsec;
+    return true;
+}
+
+//
+
+static bool
+__TReplayAppendSprite(
+    uint8_t         **bytes,
+    size_t          *nBytes,
+    size_t          *capacity,
+    const TSprite   *sprite
+)
+{
+    return __TReplayAppendVarint(bytes, nBytes, capacity, sprite->tetrominoId)
+            && __TReplayAppendVarint(bytes, nBytes, capacity, __TReplayZigZagEncode(sprite->P.i))
+            && __TReplayAppendVarint(bytes, nBytes, capacity, __TReplayZigZagEncode(sprite->P.j))
+            && __TReplayAppendVarint(bytes, nBytes, capacity, sprite->orientation)
+            && __TReplayAppendVarint(bytes, nBytes, capacity, __TReplayZigZagEncode(sprite->shiftI))
+            && __TReplayAppendVarint(bytes, nBytes, capacity, __TReplayZigZagEncode(sprite->shiftJ))
+            && __TReplayAppendVarint(bytes, nBytes, capacity, sprite->colorIdx);
+}
+
+static bool
+__TReplayGetInt(
+    const uint8_t   **p,
+    const uint8_t   *end,
+    int             minValue,
+    int             maxValue,
+    int             *v
+)
+{
+    uint64_t        value;
+    int64_t         signedValue;
+
+    if ( ! __TReplayGetVarint(p, end, &value) ) return false;
+    signedValue = __TReplayZigZagDecode(value);
+    if ( (signedValue < minValue) || (signedValue > maxValue) ) return false;
+    *v = (int)signedValue;
+    return true;
+}
+
+static bool
+__TReplayGetSprite(
+    const uint8_t   **p,
+    const uint8_t   *end,
+    TSprite         *sprite
+)
+{
+    return __TReplayGetUInt(p, end, TTetrominoIdNone, &sprite->tetrominoId)
+            && __TReplayGetInt(p, end, INT16_MIN, INT16_MAX, &sprite->P.i)
+            && __TReplayGetInt(p, end, INT16_MIN, INT16_MAX, &sprite->P.j)
+            && __TReplayGetUInt(p, end, 3, &sprite->orientation)
+            && __TReplayGetInt(p, end, -TTetrominoShiftMax, TTetrominoShiftMax, &sprite->shiftI)
+            && __TReplayGetInt(p, end, -TTetrominoShiftMax, TTetrominoShiftMax, &sprite->shiftJ)
+            && __TReplayGetUInt(p, end, 3, &sprite->colorIdx);
+}
+
+//
+
+/*
+ * Append a snapshot of gameEngine to the growable byte array *bytes:  the
+ * engine state fields in declaration order, then the board.  The board is
+ * the first row with an occupied cell, the rows flagged completed, and a
+ * bit string with the occupancy of each cell from that first row down
+ * (followed by the cell's two color index bits if it is occupied and the
+ * board has color).
+ */
+static bool
+__TReplayAppendSnapshot(
+    uint8_t         **bytes,
+    size_t          *nBytes,
+    size_t          *capacity,
+    TGameEngine     *gameEngine
+)
+{
+#define APPEND_VARINT(V)    __TReplayAppendVarint(bytes, nBytes, capacity, (uint64_t)(V))
+#define APPEND_SIGNED(V)    __TReplayAppendVarint(bytes, nBytes, capacity, __TReplayZigZagEncode((int64_t)(V)))
+    TBitGrid            *gameBoard = gameEngine->gameBoard;
+    const TScoreboard   *scoreboard = &gameEngine->scoreboard;
+    unsigned int        w = gameBoard->dimensions.w, h = gameBoard->dimensions.h;
+    unsigned int        i, j, firstRow, nCompletedRows;
+    size_t              bitIdx = 0;
+    bool                isOkay;
+
+    isOkay = APPEND_VARINT(gameEngine->gameState)
+                && APPEND_VARINT(gameEngine->isInSoftDrop)
+                && APPEND_VARINT(gameEngine->completionFlashIdx)
+                && APPEND_VARINT(gameEngine->extraPoints)
+                && APPEND_VARINT(gameEngine->currentTetrominoId)
+                && APPEND_VARINT(gameEngine->nextTetrominoId)
+                && __TReplayAppendSprite(bytes, nBytes, capacity, &gameEngine->currentSprite)
+                && __TReplayAppendSprite(bytes, nBytes, capacity, &gameEngine->nextSprite)
+                && APPEND_SIGNED(gameEngine->landingRow)
+                && APPEND_VARINT(gameEngine->randomState.s[0])
+                && APPEND_VARINT(gameEngine->randomState.s[1])
+                && APPEND_VARINT(gameEngine->randomState.s[2])
+                && APPEND_VARINT(gameEngine->randomState.s[3])
+                && APPEND_VARINT(gameEngine->tickCount)
+                && __TReplayAppendTime(bytes, nBytes, capacity, &gameEngine->tLastTick)
+                && __TReplayAppendTime(bytes, nBytes, capacity, &gameEngine->tElapsed)
+                && __TReplayAppendTime(bytes, nBytes, capacity, &gameEngine->tPerLine)
+                && __TReplayAppendTime(bytes, nBytes, capacity, &gameEngine->tNextDrop)
+                && __TReplayAppendTime(bytes, nBytes, capacity, &gameEngine->tNextFlash);
+    i = 0;
+    while ( isOkay && (i < TTetrominosCount) ) isOkay = APPEND_VARINT(scoreboard->tetrominosOfType[i++]);
+    i = 0;
+    while ( isOkay && (i < TScoreboardLineCountTypeListLength) ) isOkay = APPEND_VARINT(scoreboard->pointsAwarded[i++]);
+    i = 0;
+    while ( isOkay && (i < TScoreboardLineCountTypeListLength) ) isOkay = APPEND_VARINT(scoreboard->nLinesOfType[i++]);
+    isOkay = isOkay && APPEND_VARINT(scoreboard->nLinesTotal)
+                && APPEND_VARINT(scoreboard->level)
+                && APPEND_VARINT(scoreboard->nextLevelUp)
+                && APPEND_VARINT(scoreboard->nLinesPerLevel)
+                && APPEND_VARINT(scoreboard->score);
+    if ( ! isOkay ) return false;
+
+    // The board; completed rows are always marked whole, so only the first
+    // cell of each row need be checked:
+    firstRow = 0;
+    while ( (firstRow < h) && (TBitGridGetRowFillCount(gameBoard, firstRow) == 0) ) firstRow++;
+    nCompletedRows = 0;
+    j = 0;
+    while ( j < h ) nCompletedRows += TCellGetIsCompleted(TBitGridGetValueAtPosition(gameBoard, TGridPosMake(0, j++)));
+    if ( ! APPEND_VARINT(firstRow) || ! APPEND_VARINT(nCompletedRows) ) return false;
+    j = 0;
+    while ( j < h ) {
+        if ( TCellGetIsCompleted(TBitGridGetValueAtPosition(gameBoard, TGridPosMake(0, j))) && ! APPEND_VARINT(j) ) return false;
+        j++;
+    }
+    j = firstRow;
+    while ( j < h ) {
+        i = 0;
+        while ( i < w ) {
+            TCell       cellValue = TBitGridGetValueAtPosition(gameBoard, TGridPosMake(i, j));
+
+            if ( ! __TReplayAppendBits(bytes, nBytes, capacity, &bitIdx, TCellGetIsOccupied(cellValue), 1) ) return false;
+            if ( gameEngine->doesUseColor && TCellGetIsOccupied(cellValue) &&
+                 ! __TReplayAppendBits(bytes, nBytes, capacity, &bitIdx, TCellGetColorIndex(cellValue), 2) ) return false;
+            i++;
+        }
+        j++;
+    }
+    return true;
+#undef APPEND_SIGNED
+#undef APPEND_VARINT
+}
+
+//
+
+/*
+ * Restore gameEngine from the snapshot at p (which ends at end).  The
+ * engine must already be reset with the replay's seed and starting
+ * level; the fields not present in the snapshot are fixed for a game.
+ */
+static bool
+__TReplayRestoreSnapshot(
+    const uint8_t   *p,
+    const uint8_t   *end,
+    TGameEngine     *gameEngine
+)
+{
+    TBitGrid            *gameBoard = gameEngine->gameBoard;
+    TScoreboard         *scoreboard = &gameEngine->scoreboard;
+    unsigned int        w = gameBoard->dimensions.w, h = gameBoard->dimensions.h;
+    unsigned int        gameState, isInSoftDrop, i, j, firstRow, nCompletedRows;
+    int                 landingRow;
+    uint64_t            tickCount;
+    size_t              bitIdx = 0;
+    bool                isOkay;
+
+    isOkay = __TReplayGetUInt(&p, end, TGameEngineStateMax - 1, &gameState)
+                && __TReplayGetUInt(&p, end, 1, &isInSoftDrop)
+                && __TReplayGetUInt(&p, end, 1, &gameEngine->completionFlashIdx)
+                && __TReplayGetUInt(&p, end, UINT_MAX, &gameEngine->extraPoints)
+                && __TReplayGetUInt(&p, end, TTetrominosCount - 1, &gameEngine->currentTetrominoId)
+                && __TReplayGetUInt(&p, end, TTetrominosCount - 1, &gameEngine->nextTetrominoId)
+                && __TReplayGetSprite(&p, end, &gameEngine->currentSprite)
+                && __TReplayGetSprite(&p, end, &gameEngine->nextSprite)
+                && __TReplayGetInt(&p, end, INT16_MIN, INT16_MAX, &landingRow)
+                && __TReplayGetVarint(&p, end, &gameEngine->randomState.s[0])
+                && __TReplayGetVarint(&p, end, &gameEngine->randomState.s[1])
+                && __TReplayGetVarint(&p, end, &gameEngine->randomState.s[2])
+                && __TReplayGetVarint(&p, end, &gameEngine->randomState.s[3])
+                && __TReplayGetVarint(&p, end, &tickCount)
+                && __TReplayGetTime(&p, end, &gameEngine->tLastTick)
+                && __TReplayGetTime(&p, end, &gameEngine->tElapsed)
+                && __TReplayGetTime(&p, end, &gameEngine->tPerLine)
+                && __TReplayGetTime(&p, end, &gameEngine->tNextDrop)
+                && __TReplayGetTime(&p, end, &gameEngine->tNextFlash);
+    i = 0;
+    while ( isOkay && (i < TTetrominosCount) ) isOkay = __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->tetrominosOfType[i++]);
+    i = 0;
+    while ( isOkay && (i < TScoreboardLineCountTypeListLength) ) isOkay = __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->pointsAwarded[i++]);
+    i = 0;
+    while ( isOkay && (i < TScoreboardLineCountTypeListLength) ) isOkay = __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->nLinesOfType[i++]);
+    isOkay = isOkay && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->nLinesTotal)
+                && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->level)
+                && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->nextLevelUp)
+                && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->nLinesPerLevel)
+                && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->score)
+                && __TReplayGetUInt(&p, end, h, &firstRow)
+                && __TReplayGetUInt(&p, end, h, &nCompletedRows);
+    if ( ! isOkay ) return false;
+    gameEngine->gameState = gameState;
+    gameEngine->isInSoftDrop = isInSoftDrop;
+    gameEngine->landingRow = landingRow;
+    gameEngine->tickCount = tickCount;
+
+    TBitGridFillCells(gameBoard, 0);
+    while ( nCompletedRows-- ) {
+        if ( ! __TReplayGetUInt(&p, end, h - 1, &j) ) return false;
+        TBitGridSetChannelInRowRange(gameBoard, 1, j, j, true);
+    }
+    j = firstRow;
+    while ( j < h ) {
+        i = 0;
+        while ( i < w ) {
+            unsigned int    isOccupied, colorIdx = 0;
+
+            if ( ! __TReplayGetBits(p, end, &bitIdx, 1, &isOccupied) ) return false;
+            if ( isOccupied ) {
+                TGridPos    P = TGridPosMake(i, j);
+
+                if ( gameEngine->doesUseColor && ! __TReplayGetBits(p, end, &bitIdx, 2, &colorIdx) ) return false;
+                TBitGridSetValueAtPosition(gameBoard, P, TCellMake4Bit(true, TCellGetIsCompleted(TBitGridGetValueAtPosition(gameBoard, P)), colorIdx));
+            }
+            i++;
+        }
+        j++;
+    }
+    if ( p + (bitIdx + 7) / 8 != end ) return false;
+    gameEngine->dirtyRect = TBitGridGetDirtyRect(gameBoard);
+    return true;
+}
+
+//
+////
+//
+
+TReplay*
+TReplayCreateWithGameEngine(
+    TGameEngine             *gameEngine,
+    const struct timespec   *tStart
+)
+{
+    TReplay     *newReplay = (TReplay*)malloc(sizeof(TReplay));
+
+    if ( newReplay ) {
+        newReplay->seed = gameEngine->randomSeed;
+        newReplay->nBitsPerWord = gameEngine->gameBoard->dimensions.nBitsPerWord;
+        newReplay->doesUseColor = gameEngine->doesUseColor;
+        newReplay->w = gameEngine->gameBoard->dimensions.w;
+        newReplay->h = gameEngine->gameBoard->dimensions.h;
+        newReplay->startingLevel = gameEngine->startingLevel;
+        newReplay->tStart = newReplay->tLast = *tStart;
+        newReplay->nTicks = 0;
+        newReplay->nTickBytes = newReplay->tickBytesCapacity = 0;
+        newReplay->tickBytes = NULL;
+        newReplay->didFinish = false;
+        newReplay->finalScoreboard = TScoreboardMake();
+        newReplay->keyframeInterval = 0;
+        newReplay->nKeyframes = newReplay->keyframesCapacity = 0;
+        newReplay->keyframes = NULL;
+        newReplay->nKeyframeBytes = newReplay->keyframeBytesCapacity = 0;
+        newReplay->keyframeBytes = NULL;
+    }
+    return newReplay;
+}
+
+//
+
+/*
+ * Read the keyframe section of a replay file (whose bytes start at
+ * fileBytes) at *p into replay.  Each index entry must refer to a tick
+ * and a snapshot within the replay, in order of piece count, and the
+ * footer must locate the index.
+ */
+static bool
+__TReplayGetKeyframes(
+    TReplay         *replay,
+    const uint8_t   *fileBytes,
+    const uint8_t   **p,
+    const uint8_t   *end,
+    uint64_t        nTicks
+)
+{
+    uint64_t        nKeyframeBytes, nKeyframes, v[5];
+    const uint8_t   *indexStart;
+    unsigned long   keyframeIdx = 0;
+    uint32_t        indexOffset;
+
+    if ( ! __TReplayGetUInt(p, end, UINT_MAX, &replay->keyframeInterval)
+         || ! __TReplayGetVarint(p, end, &nKeyframeBytes) || (nKeyframeBytes > (uint64_t)(end - *p)) ) return false;
+    if ( nKeyframeBytes ) {
+        replay->keyframeBytes = (uint8_t*)malloc(nKeyframeBytes);
+        if ( ! replay->keyframeBytes ) return false;
+        memcpy(replay->keyframeBytes, *p, nKeyframeBytes);
+        replay->nKeyframeBytes = replay->keyframeBytesCapacity = nKeyframeBytes;
+        *p += nKeyframeBytes;
+    }
+    indexStart = *p;
+    if ( ! __TReplayGetVarint(p, end, &nKeyframes) || (nKeyframes > (uint64_t)(end - *p)) ) return false;
+    if ( nKeyframes ) {
+        replay->keyframes = (TReplayKeyframe*)malloc(nKeyframes * sizeof(TReplayKeyframe));
+        if ( ! replay->keyframes ) return false;
+        replay->keyframesCapacity = nKeyframes;
+    }
+    while ( keyframeIdx < nKeyframes ) {
+        TReplayKeyframe *keyframe = &replay->keyframes[keyframeIdx];
+        unsigned int    i = 0;
+
+        while ( i < 5 ) if ( ! __TReplayGetVarint(p, end, &v[i++]) ) return false;
+        if ( (keyframeIdx > 0) && (v[0] <= keyframe[-1].pieceCount) ) return false;
+        if ( (v[1] > nTicks) || (v[2] > replay->nTickBytes) || (v[3] > nKeyframeBytes) || (v[4] > nKeyframeBytes - v[3]) ) return false;
+        keyframe->pieceCount = v[0];
+        keyframe->tickIdx = v[1];
+        keyframe->tickByteOffset = v[2];
+        keyframe->byteOffset = v[3];
+        keyframe->nBytes = v[4];
+        replay->nKeyframes = ++keyframeIdx;
+    }
+    if ( (end - *p) < TREPLAY_FOOTER_BYTES ) return false;
+    indexOffset = (uint32_t)(*p)[0] | ((uint32_t)(*p)[1] << 8) | ((uint32_t)(*p)[2] << 16) | ((uint32_t)(*p)[3] << 24);
+    if ( (fileBytes + indexOffset != indexStart) || (memcmp(*p + 4, TReplayFooterMagic, sizeof(TReplayFooterMagic)) != 0) ) return false;
+    *p += TREPLAY_FOOTER_BYTES;
+    return true;
+}
+
+//
+
+TReplay*
+TReplayCreateWithFile(
+    const char  *filepath
+)
+{
+    TReplay         *newReplay = NULL;
+    FILE            *fptr = fopen(filepath, "r");
+    uint8_t         *fileBytes = NULL;
+    long            fileSize;
+
+    if ( ! fptr ) return NULL;
+    if ( (fseek(fptr, 0, SEEK_END) == 0) && ((fileSize = ftell(fptr)) > 0) && (fseek(fptr, 0, SEEK_SET) == 0) ) {
+        fileBytes = (uint8_t*)malloc(fileSize);
+        if ( fileBytes && (fread(fileBytes, 1, fileSize, fptr) != (size_t)fileSize) ) {
+            free((void*)fileBytes);
+            fileBytes = NULL;
+        }
+    }
+    fclose(fptr);
+    if ( ! fileBytes ) return NULL;
+
+    newReplay = (TReplay*)malloc(sizeof(TReplay));
+    if ( newReplay ) {
+        const uint8_t   *p = fileBytes, *end = fileBytes + fileSize;
+        unsigned int    version, useColor, didFinish, i;
+        uint64_t        tStartSec, tStartNsec, nTicks, nTickBytes;
+        bool            isValid = false;
+
+        newReplay->tickBytes = NULL;
+        newReplay->nTickBytes = newReplay->tickBytesCapacity = 0;
+        newReplay->finalScoreboard = TScoreboardMake();
+        newReplay->keyframeInterval = 0;
+        newReplay->nKeyframes = newReplay->keyframesCapacity = 0;
+        newReplay->keyframes = NULL;
+        newReplay->nKeyframeBytes = newReplay->keyframeBytesCapacity = 0;
+        newReplay->keyframeBytes = NULL;
+
+        if ( (fileSize > (long)sizeof(TReplayMagic)) && (memcmp(p, TReplayMagic, sizeof(TReplayMagic)) == 0) ) {
+            p += sizeof(TReplayMagic);
+            isValid = __TReplayGetUInt(&p, end, TREPLAY_VERSION, &version) && (version >= TREPLAY_VERSION_NO_KEYFRAMES)
+                        && __TReplayGetVarint(&p, end, &newReplay->seed)
+                        && __TReplayGetUInt(&p, end, 64, &newReplay->nBitsPerWord)
+                        && __TReplayGetUInt(&p, end, 1, &useColor)
+                        && __TReplayGetUInt(&p, end, UINT16_MAX, &newReplay->w)
+                        && __TReplayGetUInt(&p, end, UINT16_MAX, &newReplay->h)
+                        && __TReplayGetUInt(&p, end, 9, &newReplay->startingLevel)
+                        && __TReplayGetVarint(&p, end, &tStartSec) && (tStartSec < (uint64_t)(INT64_MAX / TREPLAY_NSEC_PER_SEC))
+                        && __TReplayGetVarint(&p, end, &tStartNsec) && (tStartNsec < TREPLAY_NSEC_PER_SEC)
+                        && __TReplayGetVarint(&p, end, &nTicks)
+                        && __TReplayGetVarint(&p, end, &nTickBytes) && (nTickBytes <= (uint64_t)(end - p))
+                        && (nTicks <= nTickBytes);
+            if ( isValid ) {
+                switch ( newReplay->nBitsPerWord ) {
+                    case 8:
+                    case 16:
+                    case 32:
+                    case 64:
+                        break;
+                    default:
+                        isValid = false;
+                        break;
+                }
+            }
+            if ( isValid && nTickBytes ) {
+                newReplay->tickBytes = (uint8_t*)malloc(nTickBytes);
+                if ( newReplay->tickBytes ) {
+                    memcpy(newReplay->tickBytes, p, nTickBytes);
+                    newReplay->nTickBytes = newReplay->tickBytesCapacity = nTickBytes;
+                    p += nTickBytes;
+                } else {
+                    isValid = false;
+                }
+            }
+            if ( isValid ) {
+                TScoreboard     *scoreboard = &newReplay->finalScoreboard;
+
+                isValid = __TReplayGetUInt(&p, end, 1, &didFinish)
+                            && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->score)
+                            && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->level)
+                            && __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->nLinesTotal);
+                i = 0;
+                while ( isValid && (i < TScoreboardLineCountTypeListLength) )
+                    isValid = __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->nLinesOfType[i++]);
+                i = 0;
+                while ( isValid && (i < TTetrominosCount) )
+                    isValid = __TReplayGetUInt(&p, end, UINT_MAX, &scoreboard->tetrominosOfType[i++]);
+            }
+            if ( isValid && (version > TREPLAY_VERSION_NO_KEYFRAMES) )
+                isValid = __TReplayGetKeyframes(newReplay, fileBytes, &p, end, nTicks);
+            if ( isValid && (p != end) ) isValid = false;
+            if ( isValid ) {
+                newReplay->doesUseColor = useColor;
+                newReplay->tStart.tv_sec = (time_t)tStartSec;
+                newReplay->tStart.tv_nsec = (long)tStartNsec;
+                newReplay->tLast = newReplay->tStart;
+                newReplay->nTicks = nTicks;
+                newReplay->didFinish = didFinish;
+            }
+        }
+        if ( ! isValid ) {
+            TReplayDestroy(newReplay);
+            newReplay = NULL;
+        }
+    }
+    free((void*)fileBytes);
+    return newReplay;
+}
+
+//
+
+void
+TReplayDestroy(
+    TReplay     *replay
+)
+{
+    if ( replay->tickBytes ) free((void*)replay->tickBytes);
+    if ( replay->keyframes ) free((void*)replay->keyframes);
+    if ( replay->keyframeBytes ) free((void*)replay->keyframeBytes);
+    free((void*)replay);
+}
+
+//
+
+bool
+TReplayWriteToFile(
+    TReplay     *replay,
+    const char  *filepath
+)
+{
+    uint8_t     *header = NULL, *trailer = NULL, *index = NULL;
+    size_t      nHeader = 0, headerCapacity = 0, nTrailer = 0, trailerCapacity = 0, nIndex = 0, indexCapacity = 0;
+    size_t      indexOffset;
+    uint8_t     footer[TREPLAY_FOOTER_BYTES];
+    bool        isOkay;
+    unsigned long   i;
+    FILE        *fptr;
+
+    isOkay = __TReplayAppendVarint(&header, &nHeader, &headerCapacity, TREPLAY_VERSION)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->seed)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->nBitsPerWord)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->doesUseColor)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->w)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->h)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->startingLevel)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->tStart.tv_sec)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->tStart.tv_nsec)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->nTicks)
+                && __TReplayAppendVarint(&header, &nHeader, &headerCapacity, replay->nTickBytes)
+                && __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->didFinish)
+                && __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->finalScoreboard.score)
+                && __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->finalScoreboard.level)
+                && __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->finalScoreboard.nLinesTotal);
+    i = 0;
+    while ( isOkay && (i < TScoreboardLineCountTypeListLength) )
+        isOkay = __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->finalScoreboard.nLinesOfType[i++]);
+    i = 0;
+    while ( isOkay && (i < TTetrominosCount) )
+        isOkay = __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->finalScoreboard.tetrominosOfType[i++]);
+    isOkay = isOkay && __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->keyframeInterval)
+                && __TReplayAppendVarint(&trailer, &nTrailer, &trailerCapacity, replay->nKeyframeBytes)
+                && __TReplayAppendVarint(&index, &nIndex, &indexCapacity, replay->nKeyframes);
+    i = 0;
+    while ( isOkay && (i < replay->nKeyframes) ) {
+        TReplayKeyframe *keyframe = &replay->keyframes[i++];
+
+        isOkay = __TReplayAppendVarint(&index, &nIndex, &indexCapacity, keyframe->pieceCount)
+                    && __TReplayAppendVarint(&index, &nIndex, &indexCapacity, keyframe->tickIdx)
+                    && __TReplayAppendVarint(&index, &nIndex, &indexCapacity, keyframe->tickByteOffset)
+                    && __TReplayAppendVarint(&index, &nIndex, &indexCapacity, keyframe->byteOffset)
+                    && __TReplayAppendVarint(&index, &nIndex, &indexCapacity, keyframe->nBytes);
+    }
+
+    // The footer locates the index:
+    indexOffset = sizeof(TReplayMagic) + nHeader + replay->nTickBytes + nTrailer + replay->nKeyframeBytes;
+    if ( indexOffset > UINT32_MAX ) isOkay = false;
+    footer[0] = indexOffset & 0xFF;
+    footer[1] = (indexOffset >> 8) & 0xFF;
+    footer[2] = (indexOffset >> 16) & 0xFF;
+    footer[3] = (indexOffset >> 24) & 0xFF;
+    memcpy(&footer[4], TReplayFooterMagic, sizeof(TReplayFooterMagic));
+
+    if ( isOkay ) {
+        fptr = fopen(filepath, "w");
+        if ( fptr ) {
+            isOkay = (fwrite(TReplayMagic, sizeof(TReplayMagic), 1, fptr) == 1)
+                        && (fwrite(header, 1, nHeader, fptr) == nHeader)
+                        && (fwrite(replay->tickBytes, 1, replay->nTickBytes, fptr) == replay->nTickBytes)
+                        && (fwrite(trailer, 1, nTrailer, fptr) == nTrailer)
+                        && (! replay->nKeyframeBytes || (fwrite(replay->keyframeBytes, 1, replay->nKeyframeBytes, fptr) == replay->nKeyframeBytes))
+                        && (fwrite(index, 1, nIndex, fptr) == nIndex)
+                        && (fwrite(footer, 1, sizeof(footer), fptr) == sizeof(footer));
+            if ( fclose(fptr) != 0 ) isOkay = false;
+        } else {
+            isOkay = false;
+        }
+    }
+    if ( header ) free((void*)header);
+    if ( trailer ) free((void*)trailer);
+    if ( index ) free((void*)index);
+    return isOkay;
+}
+
+//
+
+bool
+TReplayAppendTick(
+    TReplay                 *replay,
+    const struct timespec   *t,
+    TGameEngineEvent        theEvent
+)
+{
+    int64_t     dt = __TReplayTimeToNanoseconds(t) - __TReplayTimeToNanoseconds(&replay->tLast);
+
+    if ( ! __TReplayAppendVarint(&replay->tickBytes, &replay->nTickBytes, &replay->tickBytesCapacity,
+                (__TReplayZigZagEncode(dt) << TREPLAY_EVENT_BITS) | (theEvent & TREPLAY_EVENT_MASK)) ) return false;
+    replay->tLast = *t;
+    replay->nTicks++;
+    return true;
+}
+
+//
+
+bool
+TReplayAppendKeyframe(
+    TReplay     *replay,
+    TGameEngine *gameEngine
+)
+{
+    TReplayKeyframe *keyframe;
+    size_t          byteOffset = replay->nKeyframeBytes;
+
+    if ( replay->nKeyframes == replay->keyframesCapacity ) {
+        unsigned long   newCapacity = replay->keyframesCapacity ? 2 * replay->keyframesCapacity : 16;
+        TReplayKeyframe *newKeyframes = (TReplayKeyframe*)realloc(replay->keyframes, newCapacity * sizeof(TReplayKeyframe));
+
+        if ( ! newKeyframes ) return false;
+        replay->keyframes = newKeyframes;
+        replay->keyframesCapacity = newCapacity;
+    }
+    if ( ! __TReplayAppendSnapshot(&replay->keyframeBytes, &replay->nKeyframeBytes, &replay->keyframeBytesCapacity, gameEngine) ) {
+        replay->nKeyframeBytes = byteOffset;
+        return false;
+    }
+    keyframe = &replay->keyframes[replay->nKeyframes++];
+    keyframe->pieceCount = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+    keyframe->tickIdx = replay->nTicks;
+    keyframe->tickByteOffset = replay->nTickBytes;
+    keyframe->byteOffset = byteOffset;
+    keyframe->nBytes = replay->nKeyframeBytes - byteOffset;
+    return true;
+}
+
+//
+
+bool
+TReplayUpdateKeyframes(
+    TReplay     *replay,
+    TGameEngine *gameEngine
+)
+{
+    unsigned long   pieceCount, lastPieceCount;
+
+    if ( ! replay->keyframeInterval ) return true;
+    if ( (gameEngine->gameState == TGameEngineStateCheckHighScore) || (gameEngine->gameState == TGameEngineStateGameHasEnded) ) return true;
+    pieceCount = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+    lastPieceCount = replay->nKeyframes ? replay->keyframes[replay->nKeyframes - 1].pieceCount : 0;
+    if ( pieceCount < lastPieceCount + replay->keyframeInterval ) return true;
+    return TReplayAppendKeyframe(replay, gameEngine);
+}
+
+//
+
+long
+TReplayFindKeyframe(
+    TReplay         *replay,
+    unsigned long   pieceCount
+)
+{
+    unsigned long   lo = 0, hi = replay->nKeyframes;
+
+    // Find the first keyframe past pieceCount; the one before it is it:
+    while ( lo < hi ) {
+        unsigned long   mid = lo + (hi - lo) / 2;
+
+        if ( replay->keyframes[mid].pieceCount <= pieceCount )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (long)lo - 1;
+}
+
+//
+
+void
+TReplaySetOutcome(
+    TReplay     *replay,
+    TGameEngine *gameEngine
+)
+{
+    replay->didFinish = (gameEngine->gameState == TGameEngineStateCheckHighScore) || (gameEngine->gameState == TGameEngineStateGameHasEnded);
+    replay->finalScoreboard = gameEngine->scoreboard;
+}
+
+//
+
+TBitGridWordSize
+TReplayGetWordSize(
+    TReplay     *replay
+)
+{
+    switch ( replay->nBitsPerWord ) {
+        case 8:
+            return TBitGridWordSizeForce8Bit;
+        case 16:
+            return TBitGridWordSizeForce16Bit;
+        case 32:
+            return TBitGridWordSizeForce32Bit;
+        case 64:
+            return TBitGridWordSizeForce64Bit;
+    }
+    return TBitGridWordSizeDefault;
+}
+
+//
+
+bool
+TReplayIsCompatibleWithGameEngine(
+    TReplay     *replay,
+    TGameEngine *gameEngine
+)
+{
+    return (gameEngine->gameBoard->dimensions.nBitsPerWord == replay->nBitsPerWord)
+            && (gameEngine->doesUseColor == replay->doesUseColor)
+            && (gameEngine->gameBoard->dimensions.w == replay->w)
+            && (gameEngine->gameBoard->dimensions.h == replay->h);
+}
+
+//
+
+bool
+TReplayCursorInit(
+    TReplayCursor   *cursor,
+    TReplay         *replay,
+    TGameEngine     *gameEngine
+)
+{
+    if ( ! TReplayIsCompatibleWithGameEngine(replay, gameEngine) ) return false;
+
+    gameEngine->startingLevel = replay->startingLevel;
+    if ( gameEngine->clockSource != TGameEngineClockSourceVirtual )
+        TGameEngineSetClockSource(gameEngine, TGameEngineClockSourceVirtual);
+    TGameEngineResetWithSeed(gameEngine, replay->seed);
+
+    cursor->replay = replay;
+    cursor->gameEngine = gameEngine;
+    cursor->tickIdx = 0;
+    cursor->tickByteOffset = 0;
+    cursor->tNow = __TReplayTimeToNanoseconds(&replay->tStart);
+    return true;
+}
+
+//
+
+bool
+TReplayCursorStep(
+    TReplayCursor   *cursor
+)
+{
+    const uint8_t       *p = cursor->replay->tickBytes + cursor->tickByteOffset;
+    const uint8_t       *end = cursor->replay->tickBytes + cursor->replay->nTickBytes;
+    uint64_t            tick;
+    TGameEngineEvent    theEvent;
+    int64_t             tNow;
+    struct timespec     t;
+
+    if ( TReplayCursorIsAtEnd(cursor) ) return false;
+    if ( ! __TReplayGetVarint(&p, end, &tick) ) return false;
+    theEvent = tick & TREPLAY_EVENT_MASK;
+    if ( theEvent > TGameEngineEventReset ) return false;
+    tNow = cursor->tNow + __TReplayZigZagDecode(tick >> TREPLAY_EVENT_BITS);
+    if ( tNow < 0 ) return false;
+
+    // Reproduce the exact time of the original tick:
+    t = __TReplayNanosecondsToTime(tNow);
+    TGameEngineSetVirtualClock(cursor->gameEngine, &t);
+    TGameEngineTick(cursor->gameEngine, theEvent);
+
+    cursor->tickIdx++;
+    cursor->tickByteOffset = p - cursor->replay->tickBytes;
+    cursor->tNow = tNow;
+    return true;
+}
+
+//
+
+bool
+TReplayCursorSeekToKeyframe(
+    TReplayCursor   *cursor,
+    unsigned long   keyframeIdx
+)
+{
+    TReplay         *replay = cursor->replay;
+    TGameEngine     *gameEngine = cursor->gameEngine;
+    TReplayKeyframe *keyframe;
+    const uint8_t   *snapshot;
+
+    if ( keyframeIdx >= replay->nKeyframes ) return false;
+    keyframe = &replay->keyframes[keyframeIdx];
+    snapshot = replay->keyframeBytes + keyframe->byteOffset;
+
+    // Start from a reset engine so everything fixed for the game is in place:
+    if ( ! TReplayCursorInit(cursor, replay, gameEngine) ) return false;
+    if ( ! __TReplayRestoreSnapshot(snapshot, snapshot + keyframe->nBytes, gameEngine) ) return false;
+    TGameEngineSetVirtualClock(gameEngine, &gameEngine->tLastTick);
+
+    cursor->tickIdx = keyframe->tickIdx;
+    cursor->tickByteOffset = keyframe->tickByteOffset;
+    cursor->tNow = __TReplayTimeToNanoseconds(&gameEngine->tLastTick);
+    return true;
+}
+
+//
+
+bool
+TReplayCursorSeekToPiece(
+    TReplayCursor   *cursor,
+    unsigned long   pieceCount
+)
+{
+    TReplay         *replay = cursor->replay;
+    long            keyframeIdx = TReplayFindKeyframe(replay, pieceCount);
+    unsigned long   currentPieceCount = TScoreboardGetTetrominoCount(&cursor->gameEngine->scoreboard);
+
+    // Restore the keyframe unless the cursor is already between it and the
+    // target:
+    if ( (currentPieceCount > pieceCount) || ((keyframeIdx >= 0) && (cursor->tickIdx < replay->keyframes[keyframeIdx].tickIdx)) ) {
+        if ( keyframeIdx >= 0 ) {
+            if ( ! TReplayCursorSeekToKeyframe(cursor, keyframeIdx) ) return false;
+        } else if ( ! TReplayCursorInit(cursor, replay, cursor->gameEngine) ) {
+            return false;
+        }
+    }
+    while ( TScoreboardGetTetrominoCount(&cursor->gameEngine->scoreboard) < pieceCount ) {
+        if ( ! TReplayCursorStep(cursor) ) return false;
+    }
+    return true;
+}
+
+//
+
+bool
+TReplayCursorPlayToEnd(
+    TReplayCursor       *cursor,
+    THeadlessGameResult *result
+)
+{
+    TGameEngine         *gameEngine = cursor->gameEngine;
+    unsigned long       nTicks = 0;
+
+    while ( ! TReplayCursorIsAtEnd(cursor) ) {
+        if ( ! TReplayCursorStep(cursor) ) return false;
+        nTicks++;
+    }
+    if ( cursor->tickByteOffset != cursor->replay->nTickBytes ) return false;
+
+    if ( result ) {
+        result->seed = gameEngine->randomSeed;
+        result->scoreboard = gameEngine->scoreboard;
+        result->nPieces = TScoreboardGetTetrominoCount(&gameEngine->scoreboard);
+        result->nTicks = nTicks;
+        result->tElapsed = gameEngine->tElapsed;
+        result->didFinish = (gameEngine->gameState == TGameEngineStateCheckHighScore);
+    }
+    return true;
+}
+
+//
+
+bool
+TReplayPlay(
+    TReplay             *replay,
+    TGameEngine         *gameEngine,
+    THeadlessGameResult *result
+)
+{
+    TReplayCursor       cursor;
+
+    return TReplayCursorInit(&cursor, replay, gameEngine) && TReplayCursorPlayToEnd(&cursor, result);
+}
+
+//
+
+bool
+TReplayDoesMatchResult(
+    TReplay                     *replay,
+    const THeadlessGameResult   *result
+)
+{
+    const TScoreboard   *expected = &replay->finalScoreboard, *actual = &result->scoreboard;
+
+    return (result->didFinish == replay->didFinish)
+            && (actual->score == expected->score)
+            && (actual->level == expected->level)
+            && (actual->nLinesTotal == expected->nLinesTotal)
+            && (memcmp(actual->nLinesOfType, expected->nLinesOfType, sizeof(expected->nLinesOfType)) == 0)
+            && (memcmp(actual->tetrominosOfType, expected->tetrominosOfType, sizeof(expected->tetrominosOfType)) == 0);
+}
+
+//
+////
+//
+
+TReplayRecorder*
+TReplayRecorderCreate(
+    const char  *directory
+)
+{
+    TReplayRecorder *newRecorder = (TReplayRecorder*)malloc(sizeof(TReplayRecorder));
+
+    if ( newRecorder ) {
+        newRecorder->directory = strdup(directory);
+        if ( newRecorder->directory ) {
+            newRecorder->keyframeInterval = TReplayDefaultKeyframeInterval;
+            newRecorder->replay = NULL;
+            newRecorder->nWritten = newRecorder->nFailed = 0;
+        } else {
+            free((void*)newRecorder);
+            newRecorder = NULL;
+        }
+    }
+    return newRecorder;
+}
+
+//
+
+/*
+ * Write the recorder's replay to <directory>/<seed>.replay and dispose
+ * of it.
+ */
+static void
+__TReplayRecorderWriteReplay(
+    TReplayRecorder *recorder
+)
+{
+    size_t          filepathLen = strlen(recorder->directory) + 32;
+    char            *filepath = (char*)malloc(filepathLen);
+
+    if ( filepath ) {
+        snprintf(filepath, filepathLen, "%s/%016llx.replay", recorder->directory, (unsigned long long)recorder->replay->seed);
+        if ( TReplayWriteToFile(recorder->replay, filepath) )
+            recorder->nWritten++;
+        else
+            recorder->nFailed++;
+        free((void*)filepath);
+    } else {
+        recorder->nFailed++;
+    }
+    TReplayDestroy(recorder->replay);
+    recorder->replay = NULL;
+}
+
+//
+
+void
+TReplayRecorderDestroy(
+    TReplayRecorder *recorder
+)
+{
+    if ( recorder->replay ) TReplayDestroy(recorder->replay);
+    free((void*)recorder->directory);
+    free((void*)recorder);
+}
+
+//
+
+void
+TReplayRecorderFinish(
+    TReplayRecorder *recorder,
+    TGameEngine     *gameEngine
+)
+{
+    if ( recorder->replay ) {
+        TReplaySetOutcome(recorder->replay, gameEngine);
+        __TReplayRecorderWriteReplay(recorder);
+    }
+}
+
+//
+
+TGameEngineUpdateNotification
+TReplayRecorderTick(
+    TReplayRecorder     *recorder,
+    TGameEngine         *gameEngine,
+    TGameEngineEvent    theEvent
+)
+{
+    TGameEngineUpdateNotification   updates;
+    TGameEngineState                startState = gameEngine->gameState;
+    uint64_t                        startSeed = gameEngine->randomSeed;
+    unsigned long                   startTickCount = gameEngine->tickCount;
+    bool                            isRestarted;
+
+    if ( ! recorder ) return TGameEngineTick(gameEngine, theEvent);
+
+    // The engine may ignore a reset (e.g. while completed lines are held),
+    // so the game in progress is only abandoned if the engine really was
+    // reset; its outcome must be taken before the tick, though:
+    if ( recorder->replay && (theEvent == TGameEngineEventReset) ) TReplaySetOutcome(recorder->replay, gameEngine);
+
+    updates = TGameEngineTick(gameEngine, theEvent);
+
+    // A reset reseeds the engine and restarts its tick count:
+    isRestarted = (gameEngine->randomSeed != startSeed) || (gameEngine->tickCount <= startTickCount);
+    if ( recorder->replay && isRestarted ) __TReplayRecorderWriteReplay(recorder);
+
+    if ( (gameEngine->gameState == TGameEngineStateGameHasStarted) && ((startState == TGameEngineStateStartup) || isRestarted) ) {
+        // A new game has started; it replays from a freshly-reset engine, so
+        // the first tick is always a start event:
+        if ( recorder->replay ) TReplayDestroy(recorder->replay);
+        recorder->replay = TReplayCreateWithGameEngine(gameEngine, &gameEngine->tLastTick);
+        if ( recorder->replay ) {
+            recorder->replay->keyframeInterval = recorder->keyframeInterval;
+            if ( ! TReplayAppendTick(recorder->replay, &gameEngine->tLastTick, TGameEngineEventStartGame) ) {
+                TReplayDestroy(recorder->replay);
+                recorder->replay = NULL;
+            }
+        }
+        if ( ! recorder->replay ) recorder->nFailed++;
+    } else if ( recorder->replay ) {
+        if ( TReplayAppendTick(recorder->replay, &gameEngine->tLastTick, theEvent) && TReplayUpdateKeyframes(recorder->replay, gameEngine) ) {
+            if ( gameEngine->gameState == TGameEngineStateCheckHighScore ) {
+                TReplaySetOutcome(recorder->replay, gameEngine);
+                __TReplayRecorderWriteReplay(recorder);
+            }
+        } else {
+            TReplayDestroy(recorder->replay);
+            recorder->replay = NULL;
+            recorder->nFailed++;
+        }
+    }
+    return updates;
+}
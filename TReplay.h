@@ -0,0 +1,365 @@
+/*	TReplay.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Game replays
+	A game is entirely determined by the seed of the engine's PRNG,
+	the board configuration, the starting level and the sequence of
+	events passed to TGameEngineTick() along with the time at which
+	each tick happened.  A replay records exactly that, so a game can
+	be played again on a virtual clock -- e.g. to audit a high score or
+	reproduce a bug report -- and its final scoreboard checked.
+
+	The events are stored as a compact stream of LEB128 varints, one
+	per tick:  the zig-zag encoded number of nanoseconds since the
+	previous tick shifted left past the event value.  Times are kept to
+	the nanosecond so that replayed drop deadlines compare exactly as
+	they did in the original game.
+
+	Reaching a late position by playing every tick from the start is
+	slow for a long game, so every keyframeInterval locked tetrominos
+	a keyframe -- a snapshot of the engine's state -- is added.  A
+	TReplayCursor seeks to a piece number by restoring the nearest
+	keyframe at or before it and playing at most keyframeInterval
+	pieces' worth of ticks from there.  The board is packed as a single
+	occupancy bit per cell from the first occupied row down, with the
+	two color index bits following each occupied cell of a color board
+	and the completed-line channel (whole rows only) as a list of rows.
+
+	A file holds a single replay:
+
+	    "TTRP"                          magic
+	    version                         (varint)
+	    seed                            (varint)
+	    nBitsPerWord, useColor          (varint each)
+	    w, h, startingLevel             (varint each)
+	    tStart seconds, nanoseconds     (varint each)
+	    nTicks, nTickBytes              (varint each)
+	    tick stream                     (nTickBytes bytes)
+	    didFinish                       (varint)
+	    score, level, nLinesTotal       (varint each)
+	    nLinesOfType[]                  (varint each)
+	    tetrominosOfType[]              (varint each)
+	    keyframeInterval                (varint)
+	    nKeyframeBytes                  (varint)
+	    keyframe snapshots              (nKeyframeBytes bytes)
+	    nKeyframes                      (varint)    <- index
+	    pieceCount, tickIdx,            (varint each, per keyframe)
+	        tickByteOffset, byteOffset,
+	        nBytes
+	    index offset                    (32-bit little-endian)
+	    "TTRK"                          footer magic
+
+	The fixed-size footer locates the keyframe index from the end of
+	the file.  Version 1 files (no keyframe section) are still read.
+
+	A TReplayRecorder sits between the consumer and TGameEngineTick()
+	and writes a replay file for each game played.
+*/
+
+#ifndef __TREPLAY_H__
+#define __TREPLAY_H__
+
+#include "tetrominotris_config.h"
+#include "TGameEngine.h"
+#include "THeadlessDriver.h"
+
+/*
+ * @typedef TReplayKeyframe
+ *
+ * Index entry for a keyframe:  the number of tetrominos locked when
+ * the snapshot was taken, the number of ticks (and bytes of the tick
+ * stream) that preceded it, and the location of its snapshot in the
+ * replay's keyframe bytes.
+ */
+typedef struct {
+    unsigned long       pieceCount;
+    unsigned long       tickIdx;
+    size_t              tickByteOffset;
+    size_t              byteOffset, nBytes;
+} TReplayKeyframe;
+
+/*
+ * @const TReplayDefaultKeyframeInterval
+ *
+ * Number of locked tetrominos between the keyframes of a recorded
+ * replay.
+ */
+#define TReplayDefaultKeyframeInterval 50
+
+/*
+ * @typedef TReplay
+ *
+ * A recorded game:  the parameters needed to reproduce the engine's
+ * initial state, the absolute time of the first tick (tStart), the
+ * encoded tick stream, and the outcome of the game at the end of
+ * the recording.  The didFinish flag is true if the recording ended
+ * because the game was over (rather than abandoned).  Keyframes are
+ * added every keyframeInterval locked tetrominos (never if zero).
+ */
+typedef struct {
+    uint64_t            seed;
+    unsigned int        nBitsPerWord;
+    bool                doesUseColor;
+    unsigned int        w, h;
+    unsigned int        startingLevel;
+    struct timespec     tStart, tLast;
+    unsigned long       nTicks;
+    size_t              nTickBytes, tickBytesCapacity;
+    uint8_t             *tickBytes;
+    bool                didFinish;
+    TScoreboard         finalScoreboard;
+    unsigned int        keyframeInterval;
+    unsigned long       nKeyframes, keyframesCapacity;
+    TReplayKeyframe     *keyframes;
+    size_t              nKeyframeBytes, keyframeBytesCapacity;
+    uint8_t             *keyframeBytes;
+} TReplay;
+
+/*
+ * @function TReplayCreateWithGameEngine
+ *
+ * Create an empty replay of the game that is about to be (or was just)
+ * started on gameEngine, with its first tick at time tStart.  The
+ * replay has no keyframes until its keyframeInterval is set.
+ *
+ * Returns NULL if memory could not be allocated.
+ */
+TReplay* TReplayCreateWithGameEngine(TGameEngine *gameEngine, const struct timespec *tStart);
+
+/*
+ * @function TReplayCreateWithFile
+ *
+ * Read a replay from the file at filepath.  Returns NULL if the
+ * file could not be read or is not a valid replay.
+ */
+TReplay* TReplayCreateWithFile(const char *filepath);
+
+/*
+ * @function TReplayDestroy
+ *
+ * Deallocate replay.
+ */
+void TReplayDestroy(TReplay *replay);
+
+/*
+ * @function TReplayWriteToFile
+ *
+ * Write replay to the file at filepath.  Returns false if the
+ * file could not be written.
+ */
+bool TReplayWriteToFile(TReplay *replay, const char *filepath);
+
+/*
+ * @function TReplayAppendTick
+ *
+ * Append to replay a tick at time t with the given event.  Returns
+ * false if memory could not be allocated.
+ */
+bool TReplayAppendTick(TReplay *replay, const struct timespec *t, TGameEngineEvent theEvent);
+
+/*
+ * @function TReplayAppendKeyframe
+ *
+ * Append to replay a snapshot of gameEngine as of the last tick
+ * appended.  Returns false if memory could not be allocated.
+ */
+bool TReplayAppendKeyframe(TReplay *replay, TGameEngine *gameEngine);
+
+/*
+ * @function TReplayUpdateKeyframes
+ *
+ * Append a keyframe (see TReplayAppendKeyframe()) if keyframeInterval
+ * tetrominos have been locked on gameEngine since the previous one and
+ * the game is not over.  Returns false if memory could not be allocated.
+ */
+bool TReplayUpdateKeyframes(TReplay *replay, TGameEngine *gameEngine);
+
+/*
+ * @function TReplayFindKeyframe
+ *
+ * Returns the index of the last keyframe of replay at or before
+ * pieceCount locked tetrominos, or -1 if there is none.
+ */
+long TReplayFindKeyframe(TReplay *replay, unsigned long pieceCount);
+
+/*
+ * @function TReplaySetOutcome
+ *
+ * Record the state of gameEngine at the end of the recording as the
+ * outcome of replay.
+ */
+void TReplaySetOutcome(TReplay *replay, TGameEngine *gameEngine);
+
+/*
+ * @function TReplayGetWordSize
+ *
+ * Returns the TBitGridWordSize that reproduces the board word size
+ * of replay.
+ */
+TBitGridWordSize TReplayGetWordSize(TReplay *replay);
+
+/*
+ * @function TReplayIsCompatibleWithGameEngine
+ *
+ * Returns true if gameEngine has the board configuration (word size,
+ * color channels, dimensions) under which replay was recorded.
+ */
+bool TReplayIsCompatibleWithGameEngine(TReplay *replay, TGameEngine *gameEngine);
+
+/*
+ * @typedef TReplayCursor
+ *
+ * A position in a replay being played on a game engine:  the number
+ * of ticks (and bytes of the tick stream) already sent to the engine
+ * and the time of the last of them in nanoseconds.
+ */
+typedef struct {
+    TReplay             *replay;
+    TGameEngine         *gameEngine;
+    unsigned long       tickIdx;
+    size_t              tickByteOffset;
+    int64_t             tNow;
+} TReplayCursor;
+
+/*
+ * @function TReplayCursorInit
+ *
+ * Position cursor at the start of replay:  gameEngine is switched to its
+ * virtual clock and reset with the replay's seed and starting level.
+ *
+ * Returns false if gameEngine is not compatible with replay.
+ */
+bool TReplayCursorInit(TReplayCursor *cursor, TReplay *replay, TGameEngine *gameEngine);
+
+/*
+ * @function TReplayCursorIsAtEnd
+ *
+ * Returns true if every tick of the replay has been played.
+ */
+static inline bool
+TReplayCursorIsAtEnd(
+    TReplayCursor   *cursor
+)
+{
+    return (cursor->tickIdx >= cursor->replay->nTicks);
+}
+
+/*
+ * @function TReplayCursorStep
+ *
+ * Send the next tick of the replay to the engine.  Returns false if the
+ * cursor is at the end of the replay or the tick stream is corrupt.
+ */
+bool TReplayCursorStep(TReplayCursor *cursor);
+
+/*
+ * @function TReplayCursorSeekToKeyframe
+ *
+ * Restore the engine from keyframe keyframeIdx of the replay and
+ * position cursor just after the tick at which it was taken.  Returns
+ * false if there is no such keyframe or its snapshot is corrupt.
+ */
+bool TReplayCursorSeekToKeyframe(TReplayCursor *cursor, unsigned long keyframeIdx);
+
+/*
+ * @function TReplayCursorSeekToPiece
+ *
+ * Position cursor at the first tick at which pieceCount tetrominos have
+ * been locked.  Play continues from the cursor's position if that is
+ * no further from the target than the nearest keyframe at or before it;
+ * otherwise the keyframe is restored (or play starts over if there is
+ * none).  Returns false if the replay ends (or is corrupt) before
+ * reaching pieceCount.
+ */
+bool TReplayCursorSeekToPiece(TReplayCursor *cursor, unsigned long pieceCount);
+
+/*
+ * @function TReplayCursorPlayToEnd
+ *
+ * Send every remaining tick of the replay to the engine.  The outcome is
+ * written to *result (if not NULL); didFinish is true if the game was
+ * over at the end of the replay and nTicks counts only the ticks played
+ * by this call.
+ *
+ * Returns false if the tick stream is corrupt.
+ */
+bool TReplayCursorPlayToEnd(TReplayCursor *cursor, THeadlessGameResult *result);
+
+/*
+ * @function TReplayPlay
+ *
+ * Reset gameEngine with the replay's seed and starting level and send it
+ * every recorded tick on its virtual clock (TReplayCursorInit() and
+ * TReplayCursorPlayToEnd()).  The outcome is written to *result (if not
+ * NULL).
+ *
+ * Returns false if gameEngine is not compatible with replay or the tick
+ * stream is corrupt.
+ */
+bool TReplayPlay(TReplay *replay, TGameEngine *gameEngine, THeadlessGameResult *result);
+
+/*
+ * @function TReplayDoesMatchResult
+ *
+ * Returns true if the outcome in result (from TReplayPlay()) matches
+ * the outcome recorded in replay.
+ */
+bool TReplayDoesMatchResult(TReplay *replay, const THeadlessGameResult *result);
+
+/*
+ * @typedef TReplayRecorder
+ *
+ * Records each game played through TReplayRecorderTick() and writes
+ * it to a file in directory when it ends.  Replays get a keyframe every
+ * keyframeInterval locked tetrominos.  The counts of replay files
+ * written and of those that could not be written are kept.
+ */
+typedef struct {
+    char                *directory;
+    unsigned int        keyframeInterval;
+    TReplay             *replay;
+    unsigned long       nWritten, nFailed;
+} TReplayRecorder;
+
+/*
+ * @function TReplayRecorderCreate
+ *
+ * Create a recorder that writes replay files to directory, with
+ * keyframes every TReplayDefaultKeyframeInterval tetrominos.  Returns
+ * NULL if memory could not be allocated.
+ */
+TReplayRecorder* TReplayRecorderCreate(const char *directory);
+
+/*
+ * @function TReplayRecorderDestroy
+ *
+ * Deallocate recorder.  A game in progress is discarded; call
+ * TReplayRecorderFinish() first to keep it.
+ */
+void TReplayRecorderDestroy(TReplayRecorder *recorder);
+
+/*
+ * @function TReplayRecorderFinish
+ *
+ * Write the game in progress (if any) on gameEngine as an unfinished
+ * replay.
+ */
+void TReplayRecorderFinish(TReplayRecorder *recorder, TGameEngine *gameEngine);
+
+/*
+ * @function TReplayRecorderTick
+ *
+ * Pass theEvent to TGameEngineTick() and record the tick.  A tick that
+ * starts a game (from the startup state or by a reset of the engine) begins
+ * a new replay; a game abandoned by a reset is written unfinished.  A reset
+ * event the engine ignores is recorded like any other event.  When the
+ * game ends its replay file is written.
+ *
+ * If recorder is NULL the event is simply passed to TGameEngineTick().
+ * Returns the engine's update notifications.
+ */
+TGameEngineUpdateNotification TReplayRecorderTick(TReplayRecorder *recorder, TGameEngine *gameEngine, TGameEngineEvent theEvent);
+
+#endif /* __TREPLAY_H__ */
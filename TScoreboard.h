@@ -94,6 +94,24 @@ TScoreboardMake(void)
     return newScoreboard;
 }
 
+/*
+ * @function TScoreboardGetTetrominoCount
+ *
+ * Returns the total number of tetrominos (of all types) that have
+ * been placed on the board.
+ */
+static inline unsigned long
+TScoreboardGetTetrominoCount(
+    TScoreboard     *scoreboard
+)
+{
+    unsigned long   count = 0;
+    unsigned int    tIdx = 0;
+    
+    while ( tIdx < TTetrominosCount ) count += scoreboard->tetrominosOfType[tIdx++];
+    return count;
+}
+
 /*
  * @function TScoreboardAddLinesOfType
  *
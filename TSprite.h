@@ -4,17 +4,21 @@
 
 /*!
 	@header Sprites
-	In this game a sprite is the encapsulation of a tetromino (as a
-	64-bit value comprising all four 16-bit orientations); the
-	chosen orientation of the tetromino; the grid position at which to
-	start rendering the tetromino; horizontal and vertical shifts of
-	the tetromino inside its bounding box; and the color index that
+	In this game a sprite is the encapsulation of a tetromino (by its
+	index in the TTetrominos array); the chosen orientation of the
+	tetromino; the grid position at which to start rendering the
+	tetromino; horizontal and vertical shifts of the tetromino inside
+	its bounding box; and the color index that
 	should be used when rendering the tetromino.
 	
 	The API includes functions that honor side-effects of altering the
 	orientation of the tetromino (like rotation of the shift values).
 	A funtion that determines how many leading rows of the selected
 	orientation are blank.
+	
+	The bitmap and properties of every shifted orientation of every
+	tetromino are precomputed at build time (see TTetrominoShapes),
+	so each query is a single table lookup.
 */
 
 #ifndef __TSPRITE_H__
@@ -39,35 +43,51 @@ typedef struct {
     unsigned int    orientation;
     int             shiftI, shiftJ;
     unsigned int    colorIdx;
-    uint64_t        tetromino;
+    unsigned int    tetrominoId;
 } TSprite;
 
 /*
  * @function TSpriteMake
  *
- * Initializes and returns a TSprite containing the provided
- * 4-orientation tetromino associated with grid position P.
+ * Initializes and returns a TSprite containing the tetromino
+ * at index tetrominoId of the TTetrominos array associated with
+ * grid position P.
  * The sprite starts in the given orientation with no
- * shifting and a random color index.
+ * shifting and the given color index (modulo 3).  Callers
+ * choosing a random color should draw it from their own
+ * PRNG (see TRandom.h).
  */
 static inline TSprite
 TSpriteMake(
-    uint64_t        tetromino,
+    unsigned int    tetrominoId,
     TGridPos        P,
-    unsigned int    orientation
+    unsigned int    orientation,
+    unsigned int    colorIdx
 )
 {
     TSprite     theSprite = {
                     .P = P,
                     .orientation = (orientation % 4),
                     .shiftI = 0, .shiftJ = 0,
-                    .colorIdx = random() % 3,
-                    .tetromino = tetromino
+                    .colorIdx = (colorIdx % 3),
+                    .tetrominoId = tetrominoId
                 };
     
     return theSprite;
 }
 
+/*
+ * @function TSpriteMakeEmpty
+ *
+ * Initializes and returns a TSprite with no cells (the
+ * TTetrominoIdNone tetromino) at the origin.
+ */
+static inline TSprite
+TSpriteMakeEmpty(void)
+{
+    return TSpriteMake(TTetrominoIdNone, TGridPosMake(0, 0), 0, 0);
+}
+
 /*
  * @function TSpriteMakeRotated
  *
@@ -83,7 +103,7 @@ TSpriteMakeRotated(
                     .orientation = (sprite->orientation + 1) % 4,
                     .shiftI = -sprite->shiftJ, .shiftJ = -sprite->shiftI,
                     .colorIdx = sprite->colorIdx,
-                    .tetromino = sprite->tetromino
+                    .tetrominoId = sprite->tetrominoId
                 };
     return newSprite;
 }
@@ -103,7 +123,7 @@ TSpriteMakeRotatedAnti(
                     .orientation = (sprite->orientation - 1) % 4,
                     .shiftI = -sprite->shiftJ, .shiftJ = -sprite->shiftI,
                     .colorIdx = sprite->colorIdx,
-                    .tetromino = sprite->tetromino
+                    .tetrominoId = sprite->tetrominoId
                 };
     return newSprite;
 }
@@ -120,11 +140,37 @@ TSpriteGet4x4(
     TSprite     *sprite
 )
 {
-    uint16_t    T = TTetrominoExtractOrientation(sprite->tetromino, sprite->orientation);
+    return TTetrominoGetShape(sprite->tetrominoId, sprite->orientation, sprite->shiftI, sprite->shiftJ);
+}
+
+/*
+ * @function TSpriteGetShapeInfo
+ *
+ * Returns the precomputed bounds, leading blank rows and column
+ * bottom profile of the bitmap returned by TSpriteGet4x4().
+ */
+static inline const TTetrominoShapeInfo*
+TSpriteGetShapeInfo(
+    TSprite     *sprite
+)
+{
+    return TTetrominoGetShapeInfo(sprite->tetrominoId, sprite->orientation, sprite->shiftI, sprite->shiftJ);
+}
+
+/*
+ * @function TSpriteGetRect
+ *
+ * Returns the grid rectangle covered by the set cells of the
+ * sprite (empty for the empty sprite).
+ */
+static inline TGridRect
+TSpriteGetRect(
+    TSprite     *sprite
+)
+{
+    const TTetrominoShapeInfo   *info = TSpriteGetShapeInfo(sprite);
     
-    if ( ! sprite->shiftJ ) T = TTetrominoOrientationShiftVertical(T, sprite->shiftJ);
-    if ( ! sprite->shiftI ) T = TTetrominoOrientationShiftHorizontal(T, sprite->shiftI);
-    return T;
+    return TGridRectMake(sprite->P.i + info->iLo, sprite->P.j + info->jLo, sprite->P.i + info->iHi, sprite->P.j + info->jHi);
 }
 
 /*
@@ -183,13 +229,7 @@ TSpriteGetInitialClearRows(
     TSprite     *sprite
 )
 {
-    uint16_t        T = TSpriteGet4x4(sprite);
-    
-    if ( (T == 0) || (T & 0x000F) ) return 0;
-    if ( T & 0x00F0 ) return 1;
-    if ( T & 0x0F00 ) return 2;
-    if ( T & 0xF000 ) return 3;
-    return 0;
+    return TSpriteGetShapeInfo(sprite)->initialClearRows;
 }
     
 #endif /* __TSPRITE_H__ */
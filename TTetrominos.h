@@ -44,6 +44,123 @@
  */
 extern const uint64_t  TTetrominos[TTetrominosCount];
 
+/*
+ * @defined TTetrominoIdNone
+ *
+ * Tetromino id of the empty piece:  it has no cells in any
+ * orientation.  The shape tables include it as their final
+ * tetromino.
+ */
+#define TTetrominoIdNone TTetrominosCount
+
+/*
+ * @defined TTetrominoShiftMax
+ *
+ * Shifting an orientation more than three steps in any direction
+ * is the same as shifting it three steps (a shifted piece stops at
+ * the edge of its unit cell).  The shape tables are indexed by
+ * shifts in the range [-TTetrominoShiftMax,TTetrominoShiftMax].
+ */
+#define TTetrominoShiftMax 3
+
+/*
+ * @defined TTetrominoShiftCount
+ *
+ * The number of distinct shifts in each direction.
+ */
+#define TTetrominoShiftCount (2 * TTetrominoShiftMax + 1)
+
+/*
+ * @typedef TTetrominoShapeInfo
+ *
+ * Precomputed properties of a shifted orientation of a tetromino
+ * within its 4x4 unit cell:
+ *
+ *   - the bounds of its set bits (columns iLo through iHi, rows
+ *     jLo through jHi; iLo > iHi for the empty piece)
+ *   - the number of leading blank rows (zero for the empty piece)
+ *   - the lowest occupied row of each column (-1 if the column
+ *     is empty)
+ */
+typedef struct {
+    int8_t          iLo, jLo, iHi, jHi;
+    uint8_t         initialClearRows;
+    int8_t          columnBottom[4];
+} TTetrominoShapeInfo;
+
+/*
+ * @const TTetrominoShapes
+ *
+ * The 4x4 bitmap of every tetromino (including TTetrominoIdNone)
+ * in every orientation, shifted vertically then horizontally by
+ * every shift in [-TTetrominoShiftMax,TTetrominoShiftMax]:  indexed
+ * by [tetrominoId][orientation][shiftJ + 3][shiftI + 3].
+ *
+ * The table is generated at build time by tetrominotris-tablegen.
+ */
+extern const uint16_t TTetrominoShapes[TTetrominosCount + 1][4][TTetrominoShiftCount][TTetrominoShiftCount];
+
+/*
+ * @const TTetrominoShapeInfos
+ *
+ * The TTetrominoShapeInfo for each entry of TTetrominoShapes, with
+ * the same indexing.
+ *
+ * The table is generated at build time by tetrominotris-tablegen.
+ */
+extern const TTetrominoShapeInfo TTetrominoShapeInfos[TTetrominosCount + 1][4][TTetrominoShiftCount][TTetrominoShiftCount];
+
+/*
+ * @function TTetrominoShiftIndex
+ *
+ * Map a shift to its index in the shape tables; shifts beyond
+ * TTetrominoShiftMax steps are clamped.
+ */
+static inline unsigned int
+TTetrominoShiftIndex(
+    int             shift
+)
+{
+    if ( shift < -TTetrominoShiftMax ) shift = -TTetrominoShiftMax;
+    else if ( shift > TTetrominoShiftMax ) shift = TTetrominoShiftMax;
+    return (unsigned int)(shift + TTetrominoShiftMax);
+}
+
+/*
+ * @function TTetrominoGetShape
+ *
+ * Returns the 4x4 bitmap of tetromino tetrominoId in the given
+ * orientation ([0,3]) shifted left/right by shiftI and up/down by
+ * shiftJ.
+ */
+static inline uint16_t
+TTetrominoGetShape(
+    unsigned int    tetrominoId,
+    unsigned int    orientation,
+    int             shiftI,
+    int             shiftJ
+)
+{
+    return TTetrominoShapes[tetrominoId][orientation & 3][TTetrominoShiftIndex(shiftJ)][TTetrominoShiftIndex(shiftI)];
+}
+
+/*
+ * @function TTetrominoGetShapeInfo
+ *
+ * Returns the precomputed properties of the 4x4 bitmap returned by
+ * TTetrominoGetShape() for the same arguments.
+ */
+static inline const TTetrominoShapeInfo*
+TTetrominoGetShapeInfo(
+    unsigned int    tetrominoId,
+    unsigned int    orientation,
+    int             shiftI,
+    int             shiftJ
+)
+{
+    return &TTetrominoShapeInfos[tetrominoId][orientation & 3][TTetrominoShiftIndex(shiftJ)][TTetrominoShiftIndex(shiftI)];
+}
+
 /*
  * @function TTetrominosExtractOrientation
  *
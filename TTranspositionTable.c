@@ -0,0 +1,182 @@
+/*	TTranspositionTable.c
+	Copyright (c) 2024, J T Frey
+*/
+
+#include "TTranspositionTable.h"
+
+#include <stdatomic.h>
+
+/*
+ * A slot's info word:  the caller's data in the high 32 bits, the
+ * generation of the search that stored it in the next 16 and the depth in
+ * the low 16.  Generation zero marks an empty slot.
+ */
+#define TTRANSPOSITIONTABLE_INFO_MAKE(D, G, H)  (((uint64_t)(D) << 32) | ((uint64_t)(G) << 16) | (uint64_t)(H))
+#define TTRANSPOSITIONTABLE_INFO_DATA(I)        ((uint32_t)((I) >> 32))
+#define TTRANSPOSITIONTABLE_INFO_GENERATION(I)  ((uint16_t)((I) >> 16))
+#define TTRANSPOSITIONTABLE_INFO_DEPTH(I)       ((uint16_t)(I))
+
+/*
+ * Each slot is padded out to 32 bytes so a slot never straddles a cache
+ * line.
+ */
+typedef struct {
+    _Atomic uint64_t    check;
+    _Atomic uint64_t    value;
+    _Atomic uint64_t    info;
+    uint64_t            unused;
+} __attribute__((aligned(32))) TTranspositionSlot;
+
+struct TTranspositionTable {
+    size_t              nSlots;
+    uint64_t            slotMask;
+    _Atomic uint16_t    generation;
+    TTranspositionSlot  *slots;
+};
+
+//
+
+/*
+ * @function __TTranspositionTableGetSlot
+ *
+ * Returns the slot for key.  Board hashes are weakest in their low bits,
+ * so the key is put through the SplitMix64 finalizer first.
+ */
+static inline TTranspositionSlot*
+__TTranspositionTableGetSlot(
+    TTranspositionTable *table,
+    uint64_t            key
+)
+{
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return &table->slots[(key ^ (key >> 31)) & table->slotMask];
+}
+
+//
+
+TTranspositionTable*
+TTranspositionTableCreate(
+    size_t              nEntries
+)
+{
+    TTranspositionTable *newTable = (TTranspositionTable*)malloc(sizeof(TTranspositionTable));
+
+    if ( newTable ) {
+        size_t          nSlots = 2;
+
+        while ( nSlots < nEntries ) nSlots <<= 1;
+        newTable->slots = (TTranspositionSlot*)aligned_alloc(64, nSlots * sizeof(TTranspositionSlot));
+        if ( ! newTable->slots ) {
+            free((void*)newTable);
+            return NULL;
+        }
+        newTable->nSlots = nSlots;
+        newTable->slotMask = nSlots - 1;
+        atomic_init(&newTable->generation, 1);
+        TTranspositionTableClear(newTable);
+    }
+    return newTable;
+}
+
+//
+
+void
+TTranspositionTableDestroy(
+    TTranspositionTable *table
+)
+{
+    free((void*)table->slots);
+    free((void*)table);
+}
+
+//
+
+size_t
+TTranspositionTableGetEntryCount(
+    TTranspositionTable *table
+)
+{
+    return table->nSlots;
+}
+
+//
+
+void
+TTranspositionTableClear(
+    TTranspositionTable *table
+)
+{
+    size_t              slotIdx = 0;
+
+    while ( slotIdx < table->nSlots ) {
+        TTranspositionSlot  *slot = &table->slots[slotIdx++];
+
+        atomic_store_explicit(&slot->check, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->value, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->info, 0, memory_order_relaxed);
+    }
+}
+
+//
+
+void
+TTranspositionTableNewSearch(
+    TTranspositionTable *table
+)
+{
+    uint16_t            generation = atomic_load_explicit(&table->generation, memory_order_relaxed) + 1;
+
+    // Generation zero is reserved for empty slots:
+    if ( generation == 0 ) generation = 1;
+    atomic_store_explicit(&table->generation, generation, memory_order_relaxed);
+}
+
+//
+
+bool
+TTranspositionTableProbe(
+    TTranspositionTable *table,
+    uint64_t            key,
+    TTranspositionEntry *entry
+)
+{
+    TTranspositionSlot  *slot = __TTranspositionTableGetSlot(table, key);
+    uint64_t            check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    uint64_t            value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+    uint64_t            info = atomic_load_explicit(&slot->info, memory_order_relaxed);
+
+    if ( ((check ^ value ^ info) != key) || (TTRANSPOSITIONTABLE_INFO_GENERATION(info) == 0) ) return false;
+    memcpy(&entry->value, &value, sizeof(entry->value));
+    entry->data = TTRANSPOSITIONTABLE_INFO_DATA(info);
+    entry->depth = TTRANSPOSITIONTABLE_INFO_DEPTH(info);
+    return true;
+}
+
+//
+
+void
+TTranspositionTableStore(
+    TTranspositionTable *table,
+    uint64_t            key,
+    const TTranspositionEntry *entry
+)
+{
+    TTranspositionSlot  *slot = __TTranspositionTableGetSlot(table, key);
+    uint16_t            generation = atomic_load_explicit(&table->generation, memory_order_relaxed);
+    uint64_t            oldCheck = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    uint64_t            oldValue = atomic_load_explicit(&slot->value, memory_order_relaxed);
+    uint64_t            oldInfo = atomic_load_explicit(&slot->info, memory_order_relaxed);
+    uint64_t            value, info;
+
+    // A deeper entry for another board from this search stays put (a torn
+    // read of the slot only makes this decision wrong, never the entry):
+    if ( ((oldCheck ^ oldValue ^ oldInfo) != key) && (TTRANSPOSITIONTABLE_INFO_GENERATION(oldInfo) == generation)
+            && (TTRANSPOSITIONTABLE_INFO_DEPTH(oldInfo) > entry->depth) ) return;
+
+    memcpy(&value, &entry->value, sizeof(value));
+    info = TTRANSPOSITIONTABLE_INFO_MAKE(entry->data, generation, entry->depth);
+    atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+    atomic_store_explicit(&slot->info, info, memory_order_relaxed);
+    atomic_store_explicit(&slot->check, key ^ value ^ info, memory_order_relaxed);
+}
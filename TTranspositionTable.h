@@ -0,0 +1,107 @@
+/*	TTranspositionTable.h
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	@header Transposition table
+	A search that looks two or more tetrominos ahead reaches the same
+	board by many orders of placements.  A transposition table remembers
+	the evaluation of each board it is given, keyed by a 64-bit hash of
+	the board (see TBitGridGetHash()), so a board reached again is not
+	evaluated again.
+
+	The table is a fixed-size array of entries indexed by the (mixed)
+	key; a new entry replaces the one in its slot unless that one was
+	stored by the current search and at a greater depth.  Nothing is ever
+	allocated after the table is created.
+
+	Threads searching in parallel share one table without locks.  Each
+	slot is three 64-bit atomic words -- the value, the depth and
+	caller data, and a check word that is the exclusive OR of the key
+	and the other two -- written and read with relaxed atomic stores and
+	loads.  A reader that sees a slot being rewritten gets words from
+	two different entries, which fail the check and read as a miss, so
+	a torn entry is never returned.
+*/
+
+#ifndef __TTRANSPOSITIONTABLE_H__
+#define __TTRANSPOSITIONTABLE_H__
+
+#include "tetrominotris_config.h"
+
+/*
+ * @typedef TTranspositionEntry
+ *
+ * What the table remembers about a board:  its value, the depth of the
+ * search that produced it, and 32 bits of data for the caller (e.g. the
+ * best placement found).
+ */
+typedef struct {
+    double      value;
+    uint32_t    data;
+    uint16_t    depth;
+} TTranspositionEntry;
+
+/*
+ * @typedef TTranspositionTable
+ *
+ * Opaque type of a transposition table.
+ */
+typedef struct TTranspositionTable TTranspositionTable;
+
+/*
+ * @function TTranspositionTableCreate
+ *
+ * Create an empty table with room for nEntries entries (rounded up to a
+ * power of two, at least 2).  Returns NULL if memory could not be
+ * allocated.
+ */
+TTranspositionTable* TTranspositionTableCreate(size_t nEntries);
+
+/*
+ * @function TTranspositionTableDestroy
+ *
+ * Dispose of table.
+ */
+void TTranspositionTableDestroy(TTranspositionTable *table);
+
+/*
+ * @function TTranspositionTableGetEntryCount
+ *
+ * Returns the number of entries table has room for.
+ */
+size_t TTranspositionTableGetEntryCount(TTranspositionTable *table);
+
+/*
+ * @function TTranspositionTableClear
+ *
+ * Remove every entry from table.  No other thread may be using the table.
+ */
+void TTranspositionTableClear(TTranspositionTable *table);
+
+/*
+ * @function TTranspositionTableNewSearch
+ *
+ * Start a new search:  entries stored by earlier searches can still be
+ * found but are replaced by any new entry for their slot.  No other thread
+ * may be using the table.
+ */
+void TTranspositionTableNewSearch(TTranspositionTable *table);
+
+/*
+ * @function TTranspositionTableProbe
+ *
+ * Look up key in table.  Returns true and fills-in *entry if an entry with
+ * that key is present.
+ */
+bool TTranspositionTableProbe(TTranspositionTable *table, uint64_t key, TTranspositionEntry *entry);
+
+/*
+ * @function TTranspositionTableStore
+ *
+ * Store entry under key in table, unless the slot holds an entry for
+ * another key from the current search with a greater depth.
+ */
+void TTranspositionTableStore(TTranspositionTable *table, uint64_t key, const TTranspositionEntry *entry);
+
+#endif /* __TTRANSPOSITIONTABLE_H__ */
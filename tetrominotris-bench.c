@@ -0,0 +1,462 @@
+/*	tetrominotris-bench.c
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	Bit grid micro-benchmark
+
+	Times TBitGridExtract4x4AtPosition() with each of the extraction
+	kernels available on this processor, for each grid word size.  The
+	grid is filled with a random pattern and the same sequence of random
+	positions (including positions hanging off every edge of the grid) is
+	extracted by every kernel; the kernels' results are checked against
+	each other as they are timed.
+
+	Whole-board feature computation (TBitGridComputeFeatures()) is timed
+	with each of the features kernels available on this processor; the
+	kernels' features are checked against each other and against the
+	grid's feature cache.
+
+	Finally a trial placement on a snapshot of the grid's channel 0 (see
+	TBitGridSnapshotPoolPush()) is timed:  the snapshot, a 4x4 merged into
+	it, and its release.  The hashes of those trial boards (see
+	TBitGridGetHash()) are then looked up in a transposition table, each
+	one stored if it is missing, and the lookups are timed.
+*/
+
+#include "TBitGrid.h"
+#include "TTranspositionTable.h"
+#include "TRandom.h"
+
+#include <getopt.h>
+#include <strings.h>
+
+static struct option cliArgOpts[] = {
+    { "help",           no_argument,        NULL,       'h' },
+    { "iterations",     required_argument,  NULL,       'n' },
+    { "seed",           required_argument,  NULL,       's' },
+    { "word-size",      required_argument,  NULL,       'S' },
+    { "width",          required_argument,  NULL,       'w' },
+    { "height",         required_argument,  NULL,       'H' },
+    { "border",         no_argument,        NULL,       'B' },
+    { NULL,             0,                  NULL,        0  }
+};
+
+static const char *cliArgOptsStr = "hn:s:S:w:H:B";
+
+void
+usage(
+    const char  *exe
+)
+{
+    printf(
+        "\n"
+        "usage:\n"
+        "\n"
+        "    %s {options}\n"
+        "\n"
+        "  options:\n"
+        "\n"
+        "    --help/-h                      show this information\n"
+        "    --iterations/-n #              number of extractions per kernel and\n"
+        "                                   word size (default: 10000000); one in\n"
+        "                                   100 as many feature computations and\n"
+        "                                   one in 10 as many snapshot trials and\n"
+        "                                   transposition table lookups\n"
+        "    --seed/-s #                    seed for the grid pattern and positions\n"
+        "                                   (default: 1)\n"
+        "    --word-size/-S <word-size>     benchmark only this word size (default:\n"
+        "                                   all)\n"
+        "    --width/-w #                   grid width (default: 10)\n"
+        "    --height/-H #                  grid height (default: 20)\n"
+        "    --border/-B                    create the grids with a sentinel border\n"
+        "\n"
+        "    <word-size> = 8b | 16b | 32b | 64b\n"
+        "\n"
+        "version: " TETROMINOTRIS_VERSION "\n"
+        "\n",
+        exe
+    );
+}
+
+/*
+ * @function parseUnsignedLong
+ *
+ * Parse a non-negative integer from the command line.  Returns true
+ * if the string was parsed successfully and *value is set.
+ */
+bool
+parseUnsignedLong(
+    const char      *optstr,
+    const char      *what,
+    unsigned long   *value
+)
+{
+    char            *endptr = NULL;
+    long long       v = strtoll(optstr, &endptr, 0);
+
+    if ( (endptr > optstr) && (*endptr == '\0') && (v >= 0) ) {
+        *value = (unsigned long)v;
+        return true;
+    }
+    fprintf(stderr, "ERROR:  invalid %s: %s\n", what, optstr);
+    return false;
+}
+
+/*
+ * @function parseWordSize
+ *
+ * Parse an explicit word size from the command line.  Returns true
+ * if the string was parsed successfully and *wordSize is set to the
+ * desired value.
+ */
+bool
+parseWordSize(
+    const char          *optstr,
+    TBitGridWordSize    *wordSize
+)
+{
+    if ( ! strcasecmp(optstr, "8b") ) *wordSize = TBitGridWordSizeForce8Bit;
+    else if ( ! strcasecmp(optstr, "16b") ) *wordSize = TBitGridWordSizeForce16Bit;
+    else if ( ! strcasecmp(optstr, "32b") ) *wordSize = TBitGridWordSizeForce32Bit;
+    else if ( ! strcasecmp(optstr, "64b") ) *wordSize = TBitGridWordSizeForce64Bit;
+    else {
+        fprintf(stderr, "ERROR:  invalid word size: %s\n", optstr);
+        return false;
+    }
+    return true;
+}
+
+//
+
+static const char *kernelNames[] = { "default", "portable", "bmi2" };
+static const char *featuresKernelNames[] = { "default", "portable", "avx2" };
+
+/*
+ * @function benchmarkKernel
+ *
+ * Extract the 4x4 at each of the nPositions positions (a power of two),
+ * nIterations times in total, with the given kernel.  Returns the mean
+ * time per extraction in nanoseconds and sets *checksum to a digest of
+ * the extracted values.
+ */
+double
+benchmarkKernel(
+    TBitGrid                *bitGrid,
+    TBitGridExtractKernel   kernel,
+    const TGridPos          *positions,
+    unsigned long           nPositions,
+    unsigned long           nIterations,
+    uint64_t                *checksum
+)
+{
+    unsigned long           n = 0;
+    uint64_t                digest = 0;
+    struct timespec         t0, t1;
+
+    TBitGridSetExtractKernel(bitGrid, kernel);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while ( n < nIterations ) {
+        digest = (digest * 31) + TBitGridExtract4x4AtPosition(bitGrid, 0, positions[n & (nPositions - 1)]);
+        n++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *checksum = digest;
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (double)nIterations;
+}
+
+/*
+ * @function benchmarkFeaturesKernel
+ *
+ * Compute the board features of channel 0 nIterations times with the given
+ * features kernel.  Returns the mean time per computation in nanoseconds and
+ * sets *features and *columnTransitions to the result.
+ */
+double
+benchmarkFeaturesKernel(
+    TBitGrid                *bitGrid,
+    TBitGridFeaturesKernel  kernel,
+    unsigned long           nIterations,
+    TBitGridFeatures        *features,
+    unsigned int            *columnTransitions
+)
+{
+    unsigned long           n = 0;
+    struct timespec         t0, t1;
+
+    TBitGridSetFeaturesKernel(bitGrid, kernel);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while ( n < nIterations ) {
+        TBitGridComputeFeatures(bitGrid, 0, features, columnTransitions, NULL);
+        __asm__ __volatile__("" : : "r"(features) : "memory");
+        n++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (double)nIterations;
+}
+
+/*
+ * @function benchmarkSnapshot
+ *
+ * Take a snapshot of channel 0 of bitGrid, merge a T tetromino into it at
+ * the next of the nPositions positions (a power of two) and release it,
+ * nIterations times.  Returns the mean time per trial in nanoseconds and
+ * sets *checksum to a digest of the snapshots' hole counts, or returns a
+ * negative value if the snapshot pool could not be created.
+ */
+double
+benchmarkSnapshot(
+    TBitGrid                *bitGrid,
+    const TGridPos          *positions,
+    unsigned long           nPositions,
+    unsigned long           nIterations,
+    uint64_t                *checksum
+)
+{
+    TBitGridSnapshotPool    *pool = TBitGridSnapshotPoolCreate(bitGrid, 0x1, 1);
+    unsigned long           n = 0;
+    uint64_t                digest = 0;
+    struct timespec         t0, t1;
+
+    if ( ! pool ) return -1.0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while ( n < nIterations ) {
+        TBitGrid            *snapshot = TBitGridSnapshotPoolPush(pool, bitGrid);
+
+        TBitGridSet4x4AtPosition(snapshot, 0, positions[n & (nPositions - 1)], 0x0072);
+        digest = (digest * 31) + snapshot->nHoles;
+        TBitGridSnapshotPoolPop(pool, NULL);
+        n++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TBitGridSnapshotPoolDestroy(pool);
+    *checksum = digest;
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (double)nIterations;
+}
+
+/*
+ * @function benchmarkTranspositionTable
+ *
+ * Hash the board left by merging a T tetromino into a snapshot of channel 0
+ * of bitGrid at each of the nPositions positions (a power of two), then
+ * look up the next of those hashes in a transposition table with room for
+ * nPositions entries, storing it if it is missing, nIterations times.
+ * Returns the mean time per lookup in nanoseconds and sets *nHits to the
+ * number of lookups that found their entry, or returns a negative value if
+ * the table or snapshot pool could not be created.
+ */
+double
+benchmarkTranspositionTable(
+    TBitGrid                *bitGrid,
+    const TGridPos          *positions,
+    unsigned long           nPositions,
+    unsigned long           nIterations,
+    unsigned long           *nHits
+)
+{
+    TTranspositionTable     *table = TTranspositionTableCreate(nPositions);
+    TBitGridSnapshotPool    *pool = TBitGridSnapshotPoolCreate(bitGrid, 0x1, 1);
+    uint64_t                *keys = (uint64_t*)malloc(nPositions * sizeof(uint64_t));
+    unsigned long           n = 0, hits = 0;
+    struct timespec         t0, t1;
+
+    if ( ! table || ! pool || ! keys ) {
+        if ( table ) TTranspositionTableDestroy(table);
+        if ( pool ) TBitGridSnapshotPoolDestroy(pool);
+        if ( keys ) free((void*)keys);
+        return -1.0;
+    }
+    while ( n < nPositions ) {
+        TBitGrid            *snapshot = TBitGridSnapshotPoolPush(pool, bitGrid);
+
+        TBitGridSet4x4AtPosition(snapshot, 0, positions[n], 0x0072);
+        keys[n++] = TBitGridGetHash(snapshot);
+        TBitGridSnapshotPoolPop(pool, NULL);
+    }
+    TBitGridSnapshotPoolDestroy(pool);
+
+    n = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while ( n < nIterations ) {
+        uint64_t            key = keys[n & (nPositions - 1)];
+        TTranspositionEntry entry;
+
+        if ( TTranspositionTableProbe(table, key, &entry) ) {
+            hits++;
+        } else {
+            entry.value = (double)n;
+            entry.data = (uint32_t)n;
+            entry.depth = 1;
+            TTranspositionTableStore(table, key, &entry);
+        }
+        n++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TTranspositionTableDestroy(table);
+    free((void*)keys);
+    *nHits = hits;
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (double)nIterations;
+}
+
+//
+
+int
+main(
+    int                 argc,
+    char * const        argv[]
+)
+{
+    int                 optCh, rc = 0;
+    unsigned long       nIterations = 10000000, seed = 1, width = 10, height = 20;
+    TBitGridWordSize    wordSizes[4] = { TBitGridWordSizeForce8Bit, TBitGridWordSizeForce16Bit, TBitGridWordSizeForce32Bit, TBitGridWordSizeForce64Bit };
+    unsigned int        wordSizeIdx = 0, nWordSizes = 4;
+    unsigned long       nPositions = 4096, i;
+    TGridPos            *positions;
+    TBitGridOptions     options = TBitGridOptionNone;
+    TRandomState        randomState;
+
+    // Parse CLI arguments:
+    while ( (optCh = getopt_long(argc, argv, cliArgOptsStr, cliArgOpts, NULL)) != -1 ) {
+        switch ( optCh ) {
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            case 'n':
+                if ( ! parseUnsignedLong(optarg, "iteration count", &nIterations) ) exit(EINVAL);
+                if ( nIterations == 0 ) nIterations = 1;
+                break;
+            case 's':
+                if ( ! parseUnsignedLong(optarg, "seed", &seed) ) exit(EINVAL);
+                break;
+            case 'S':
+                if ( ! parseWordSize(optarg, &wordSizes[0]) ) exit(EINVAL);
+                nWordSizes = 1;
+                break;
+            case 'w':
+                if ( ! parseUnsignedLong(optarg, "width", &width) ) exit(EINVAL);
+                break;
+            case 'H':
+                if ( ! parseUnsignedLong(optarg, "height", &height) ) exit(EINVAL);
+                break;
+            case 'B':
+                options |= TBitGridOptionSentinelBorder;
+                break;
+        }
+    }
+
+    // The positions are shared by all grids and kernels:
+    positions = (TGridPos*)malloc(nPositions * sizeof(TGridPos));
+    if ( ! positions ) {
+        fprintf(stderr, "ERROR:  unable to allocate positions\n");
+        exit(ENOMEM);
+    }
+    TRandomSeed(&randomState, seed);
+    for ( i = 0; i < nPositions; i++ ) {
+        positions[i].i = (int)TRandomNextInRange(&randomState, width + 3) - 3;
+        positions[i].j = (int)TRandomNextInRange(&randomState, height + 3) - 3;
+    }
+
+    while ( wordSizeIdx < nWordSizes ) {
+        TBitGrid                *bitGrid = TBitGridCreateWithOptions(wordSizes[wordSizeIdx], 2, width, height, options);
+        TBitGridExtractKernel   kernel = TBitGridExtractKernelPortable;
+        uint64_t                referenceChecksum = 0;
+        unsigned int            j;
+
+        if ( ! bitGrid ) {
+            fprintf(stderr, "ERROR:  unable to create %lu x %lu bit grid\n", width, height);
+            exit(EINVAL);
+        }
+
+        // Random pattern, denser toward the bottom like a game in progress:
+        TRandomSeed(&randomState, seed + wordSizeIdx);
+        for ( j = 0; j < height; j++ ) {
+            unsigned int    i;
+
+            for ( i = 0; i < width; i++ )
+                if ( TRandomNextInRange(&randomState, height) < j ) TBitGridSetValueAtPosition(bitGrid, TGridPosMake(i, j), 1);
+        }
+
+        while ( kernel <= TBitGridExtractKernelBMI2 ) {
+            if ( TBitGridSetExtractKernel(bitGrid, kernel) ) {
+                uint64_t        checksum;
+                double          nsPerCall = benchmarkKernel(bitGrid, kernel, positions, nPositions, nIterations, &checksum);
+
+                printf("%3ub words %4lu x %-4lu %-8s  %-8s  %7.3f ns/extract  checksum %016llX",
+                        bitGrid->dimensions.nBitsPerWord, width, height, bitGrid->dimensions.nBorderCols ? "bordered" : "",
+                        kernelNames[kernel], nsPerCall, (unsigned long long)checksum
+                    );
+                if ( kernel == TBitGridExtractKernelPortable ) {
+                    referenceChecksum = checksum;
+                } else if ( checksum != referenceChecksum ) {
+                    printf("  MISMATCH");
+                    rc = 1;
+                }
+                printf("\n");
+            }
+            kernel++;
+        }
+
+        // Feature computation, checked against the grid's feature cache:
+        {
+            TBitGridFeaturesKernel  featuresKernel = TBitGridFeaturesKernelPortable;
+            TBitGridFeatures        cachedFeatures;
+
+            TBitGridGetFeatures(bitGrid, &cachedFeatures);
+            while ( featuresKernel <= TBitGridFeaturesKernelAVX2 ) {
+                if ( TBitGridSetFeaturesKernel(bitGrid, featuresKernel) ) {
+                    TBitGridFeatures    features;
+                    unsigned int        columnTransitions;
+                    double              nsPerCall = benchmarkFeaturesKernel(bitGrid, featuresKernel, nIterations / 100 + 1, &features, &columnTransitions);
+
+                    printf("%3ub words %4lu x %-4lu %-8s  %-8s  %7.3f ns/features  height %u holes %u bumps %u rows %u cols %u wells %u",
+                            bitGrid->dimensions.nBitsPerWord, width, height, bitGrid->dimensions.nBorderCols ? "bordered" : "",
+                            featuresKernelNames[featuresKernel], nsPerCall,
+                            features.aggregateHeight, features.holes, features.bumpiness,
+                            features.rowTransitions, columnTransitions, features.wellDepths
+                        );
+                    if ( memcmp(&features, &cachedFeatures, sizeof(features)) ) {
+                        printf("  MISMATCH");
+                        rc = 1;
+                    }
+                    printf("\n");
+                }
+                featuresKernel++;
+            }
+        }
+
+        // Trial placements on snapshots:
+        {
+            uint64_t        checksum;
+            double          nsPerCall = benchmarkSnapshot(bitGrid, positions, nPositions, nIterations / 10 + 1, &checksum);
+
+            if ( nsPerCall < 0.0 ) {
+                fprintf(stderr, "ERROR:  unable to create snapshot pool\n");
+                exit(ENOMEM);
+            }
+            printf("%3ub words %4lu x %-4lu %-8s  %-8s  %7.3f ns/trial    checksum %016llX\n",
+                    bitGrid->dimensions.nBitsPerWord, width, height, bitGrid->dimensions.nBorderCols ? "bordered" : "",
+                    "snapshot", nsPerCall, (unsigned long long)checksum
+                );
+        }
+
+        // Transposition table lookups of the trial boards:
+        {
+            unsigned long   nHits;
+            double          nsPerCall = benchmarkTranspositionTable(bitGrid, positions, nPositions, nIterations / 10 + 1, &nHits);
+
+            if ( nsPerCall < 0.0 ) {
+                fprintf(stderr, "ERROR:  unable to create transposition table\n");
+                exit(ENOMEM);
+            }
+            printf("%3ub words %4lu x %-4lu %-8s  %-8s  %7.3f ns/lookup   hits %lu\n",
+                    bitGrid->dimensions.nBitsPerWord, width, height, bitGrid->dimensions.nBorderCols ? "bordered" : "",
+                    "ttable", nsPerCall, nHits
+                );
+        }
+
+        TBitGridDestroy(bitGrid);
+        wordSizeIdx++;
+    }
+    free((void*)positions);
+    return rc;
+}
@@ -0,0 +1,327 @@
+/*	tetrominotris-replay.c
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	Replay verifier
+
+	Loads the replay files named on the command line and plays each
+	of them again on a TGameEngine using its virtual clock and no curses
+	display.  The outcome of each replayed game is checked against the
+	final scoreboard recorded in the file.
+	Replays are spread across a pool of worker threads; replays with
+	different board configurations are played in separate batches.
+	A line is written per replay (failures always, successes if
+	requested) and the aggregate throughput (replays verified per
+	second of wall time) is written at the end.  The exit status is
+	non-zero if any replay could not be read or did not verify.
+	Optionally, each replay is also resumed from every one of its
+	keyframes and played to the end, which must produce the same
+	outcome as playing it from the start.
+*/
+
+#include "TGameEngine.h"
+#include "THeadlessDriver.h"
+#include "TEnginePool.h"
+#include "TReplay.h"
+
+#include <getopt.h>
+
+static struct option cliArgOpts[] = {
+    { "help",           no_argument,        NULL,       'h' },
+    { "verbose",        no_argument,        NULL,       'v' },
+    { "threads",        required_argument,  NULL,       't' },
+    { "repeat",         required_argument,  NULL,       'n' },
+    { "keyframes",      no_argument,        NULL,       'K' },
+    { NULL,             0,                  NULL,        0  }
+};
+
+static const char *cliArgOptsStr = "hvt:n:K";
+
+void
+usage(
+    const char  *exe
+)
+{
+    printf(
+        "\n"
+        "usage:\n"
+        "\n"
+        "    %s {options} <replay-file> {<replay-file> ..}\n"
+        "\n"
+        "  options:\n"
+        "\n"
+        "    --help/-h                      show this information\n"
+        "    --verbose/-v                   show the outcome of every replay, not\n"
+        "                                   just the failures\n"
+        "    --threads/-t #                 number of worker threads; 0 for one per\n"
+        "                                   online processor (default: 0)\n"
+        "    --repeat/-n #                  play each replay this many times (for\n"
+        "                                   timing; default: 1)\n"
+        "    --keyframes/-K                 also resume each replay from every one\n"
+        "                                   of its keyframes and check the outcome\n"
+        "\n"
+        "version: " TETROMINOTRIS_VERSION "\n"
+        "\n",
+        exe
+    );
+}
+
+/*
+ * @function parseUnsignedLong
+ *
+ * Parse a non-negative integer from the command line.  Returns true
+ * if the string was parsed successfully and *value is set.
+ */
+bool
+parseUnsignedLong(
+    const char      *optstr,
+    const char      *what,
+    unsigned long   *value
+)
+{
+    char            *endptr = NULL;
+    long long       v = strtoll(optstr, &endptr, 0);
+
+    if ( (endptr > optstr) && (*endptr == '\0') && (v >= 0) ) {
+        *value = (unsigned long)v;
+        return true;
+    }
+    fprintf(stderr, "ERROR:  invalid %s: %s\n", what, optstr);
+    return false;
+}
+
+/*
+ * @typedef TReplayBatch
+ *
+ * A batch of replays sharing a board configuration; game i of the
+ * batch is replay replays[i % nReplays].
+ */
+typedef struct {
+    TReplay             **replays;
+    unsigned long       nReplays;
+    bool                *didPlay;
+    bool                shouldCheckKeyframes;
+    unsigned long       *nKeyframesChecked;
+    long                *badKeyframeIdx;
+} TReplayBatch;
+
+/*
+ * @function replayBatchGame
+ *
+ * Engine pool game function that plays a replay from the batch in
+ * context.
+ */
+void
+replayBatchGame(
+    TGameEngine         *gameEngine,
+    unsigned long       gameIdx,
+    void                *context,
+    THeadlessGameResult *result
+)
+{
+#define REPLAY_BATCH ((TReplayBatch*)context)
+    TReplay             *replay = REPLAY_BATCH->replays[gameIdx % REPLAY_BATCH->nReplays];
+    TReplayCursor       cursor;
+    THeadlessGameResult keyframeResult;
+    unsigned long       keyframeIdx = 0;
+
+    REPLAY_BATCH->didPlay[gameIdx] = TReplayPlay(replay, gameEngine, result);
+    REPLAY_BATCH->nKeyframesChecked[gameIdx] = 0;
+    REPLAY_BATCH->badKeyframeIdx[gameIdx] = -1;
+    if ( ! REPLAY_BATCH->didPlay[gameIdx] || ! REPLAY_BATCH->shouldCheckKeyframes ) return;
+
+    // Resume from each keyframe; the outcome must match the recorded one:
+    while ( keyframeIdx < replay->nKeyframes ) {
+        if ( ! TReplayCursorInit(&cursor, replay, gameEngine) || ! TReplayCursorSeekToKeyframe(&cursor, keyframeIdx)
+             || ! TReplayCursorPlayToEnd(&cursor, &keyframeResult) || ! TReplayDoesMatchResult(replay, &keyframeResult) ) {
+            REPLAY_BATCH->badKeyframeIdx[gameIdx] = keyframeIdx;
+            break;
+        }
+        REPLAY_BATCH->nKeyframesChecked[gameIdx]++;
+        keyframeIdx++;
+    }
+#undef REPLAY_BATCH
+}
+
+//
+
+int
+main(
+    int                 argc,
+    char * const        argv[]
+)
+{
+    int                     optCh, argIdx;
+    bool                    isVerbose = false, shouldCheckKeyframes = false;
+    unsigned long           nThreads = 0, nRepeat = 1;
+    unsigned long           nReplays = 0, nUnreadable = 0, nVerified = 0, nFailed = 0, nPlayed = 0, nKeyframes = 0;
+    unsigned long           replayIdx, batchIdx, gameIdx;
+    unsigned int            nThreadsUsed = 0;
+    TReplay                 **replays;
+    const char              **replayPaths;
+    bool                    *isBatched;
+    struct timespec         tPlaying = { 0, 0 };
+
+    // Parse CLI arguments:
+    while ( (optCh = getopt_long(argc, argv, cliArgOptsStr, cliArgOpts, NULL)) != -1 ) {
+        switch ( optCh ) {
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            case 'v':
+                isVerbose = true;
+                break;
+            case 't':
+                if ( ! parseUnsignedLong(optarg, "thread count", &nThreads) ) exit(EINVAL);
+                break;
+            case 'n':
+                if ( ! parseUnsignedLong(optarg, "repeat count", &nRepeat) ) exit(EINVAL);
+                if ( nRepeat == 0 ) {
+                    fprintf(stderr, "ERROR:  repeat count must be at least 1\n");
+                    exit(EINVAL);
+                }
+                break;
+            case 'K':
+                shouldCheckKeyframes = true;
+                break;
+        }
+    }
+    if ( optind >= argc ) {
+        usage(argv[0]);
+        exit(EINVAL);
+    }
+
+    // Load every replay:
+    replays = (TReplay**)malloc((argc - optind) * sizeof(TReplay*));
+    replayPaths = (const char**)malloc((argc - optind) * sizeof(const char*));
+    isBatched = (bool*)malloc((argc - optind) * sizeof(bool));
+    if ( ! replays || ! replayPaths || ! isBatched ) {
+        fprintf(stderr, "ERROR:  unable to allocate %d replays\n", argc - optind);
+        exit(ENOMEM);
+    }
+    for ( argIdx = optind; argIdx < argc; argIdx++ ) {
+        TReplay     *replay = TReplayCreateWithFile(argv[argIdx]);
+
+        if ( replay ) {
+            replayPaths[nReplays] = argv[argIdx];
+            isBatched[nReplays] = false;
+            replays[nReplays++] = replay;
+        } else {
+            printf("ERROR     %s : unable to read replay\n", argv[argIdx]);
+            nUnreadable++;
+        }
+    }
+
+    // Play the replays in batches by board configuration:
+    for ( batchIdx = 0; batchIdx < nReplays; batchIdx++ ) {
+        TReplay             *first = replays[batchIdx];
+        TReplayBatch        batch;
+        TReplay             **batchReplays;
+        unsigned long       *batchIndices, nGames;
+        THeadlessGameResult *results;
+        TEnginePool         *enginePool;
+        struct timespec     t0, t1, dt;
+
+        if ( isBatched[batchIdx] ) continue;
+
+        batchReplays = (TReplay**)malloc(nReplays * sizeof(TReplay*));
+        batchIndices = (unsigned long*)malloc(nReplays * sizeof(unsigned long));
+        if ( ! batchReplays || ! batchIndices ) {
+            fprintf(stderr, "ERROR:  unable to allocate a batch of %lu replays\n", nReplays);
+            exit(ENOMEM);
+        }
+        batch.replays = batchReplays;
+        batch.nReplays = 0;
+        batch.shouldCheckKeyframes = shouldCheckKeyframes;
+        for ( replayIdx = batchIdx; replayIdx < nReplays; replayIdx++ ) {
+            TReplay         *replay = replays[replayIdx];
+
+            if ( ! isBatched[replayIdx] && (replay->nBitsPerWord == first->nBitsPerWord) && (replay->doesUseColor == first->doesUseColor)
+                        && (replay->w == first->w) && (replay->h == first->h) ) {
+                isBatched[replayIdx] = true;
+                batchIndices[batch.nReplays] = replayIdx;
+                batchReplays[batch.nReplays++] = replay;
+            }
+        }
+        nGames = batch.nReplays * nRepeat;
+
+        enginePool = TEnginePoolCreate(nThreads, TReplayGetWordSize(first), first->doesUseColor, first->w, first->h, first->startingLevel);
+        if ( ! enginePool ) {
+            fprintf(stderr, "ERROR:  unable to create %u x %u game engines\n", first->w, first->h);
+            exit(EINVAL);
+        }
+        if ( TEnginePoolGetThreadCount(enginePool) > nThreadsUsed ) nThreadsUsed = TEnginePoolGetThreadCount(enginePool);
+        results = (THeadlessGameResult*)malloc(nGames * sizeof(THeadlessGameResult));
+        batch.didPlay = (bool*)malloc(nGames * sizeof(bool));
+        batch.nKeyframesChecked = (unsigned long*)malloc(nGames * sizeof(unsigned long));
+        batch.badKeyframeIdx = (long*)malloc(nGames * sizeof(long));
+        if ( ! results || ! batch.didPlay || ! batch.nKeyframesChecked || ! batch.badKeyframeIdx ) {
+            fprintf(stderr, "ERROR:  unable to allocate results for %lu replays\n", nGames);
+            exit(ENOMEM);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if ( ! TEnginePoolRun(enginePool, nGames, replayBatchGame, &batch, results) ) {
+            fprintf(stderr, "ERROR:  too many replays: %lu\n", nGames);
+            exit(EINVAL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        timespec_add(&tPlaying, &tPlaying, timespec_subtract(&dt, &t1, &t0));
+        nPlayed += nGames;
+
+        for ( gameIdx = 0; gameIdx < nGames; gameIdx++ ) {
+            TReplay             *replay = batchReplays[gameIdx % batch.nReplays];
+            const char          *replayPath = replayPaths[batchIndices[gameIdx % batch.nReplays]];
+            THeadlessGameResult *result = &results[gameIdx];
+
+            nKeyframes += batch.nKeyframesChecked[gameIdx];
+            if ( ! batch.didPlay[gameIdx] ) {
+                printf("ERROR     %s : corrupt tick stream\n", replayPath);
+                nFailed++;
+            } else if ( batch.badKeyframeIdx[gameIdx] >= 0 ) {
+                printf("KEYFRAME  %s : resuming from keyframe %ld (piece %lu) did not reproduce the recorded outcome\n",
+                        replayPath, batch.badKeyframeIdx[gameIdx], replay->keyframes[batch.badKeyframeIdx[gameIdx]].pieceCount
+                    );
+                nFailed++;
+            } else if ( TReplayDoesMatchResult(replay, result) ) {
+                if ( isVerbose && (gameIdx < batch.nReplays) ) {
+                    printf("OK        %s : score %u, level %u, lines %u, pieces %lu, ticks %lu%s\n",
+                            replayPath, result->scoreboard.score, result->scoreboard.level, result->scoreboard.nLinesTotal,
+                            result->nPieces, result->nTicks, result->didFinish ? "" : " (unfinished)"
+                        );
+                }
+                nVerified++;
+            } else {
+                printf("MISMATCH  %s : recorded score %u, level %u, lines %u, pieces %lu%s; replayed score %u, level %u, lines %u, pieces %lu%s\n",
+                        replayPath,
+                        replay->finalScoreboard.score, replay->finalScoreboard.level, replay->finalScoreboard.nLinesTotal,
+                        TScoreboardGetTetrominoCount(&replay->finalScoreboard), replay->didFinish ? "" : " (unfinished)",
+                        result->scoreboard.score, result->scoreboard.level, result->scoreboard.nLinesTotal,
+                        result->nPieces, result->didFinish ? "" : " (unfinished)"
+                    );
+                nFailed++;
+            }
+        }
+
+        free((void*)batch.badKeyframeIdx);
+        free((void*)batch.nKeyframesChecked);
+        free((void*)batch.didPlay);
+        free((void*)results);
+        TEnginePoolDestroy(enginePool);
+        free((void*)batchIndices);
+        free((void*)batchReplays);
+    }
+
+    if ( shouldCheckKeyframes ) printf("%lu keyframes resumed and verified\n", nKeyframes);
+    printf("%lu replays played, %lu verified, %lu failed, %lu unreadable on %u thread(s) in %.3f s (%.0f replays/s)\n",
+            nPlayed, nVerified, nFailed, nUnreadable, nThreadsUsed, timespec_to_double(&tPlaying),
+            (timespec_to_double(&tPlaying) > 0.0) ? (double)nPlayed / timespec_to_double(&tPlaying) : 0.0
+        );
+
+    for ( replayIdx = 0; replayIdx < nReplays; replayIdx++ ) TReplayDestroy(replays[replayIdx]);
+    free((void*)isBatched);
+    free((void*)replayPaths);
+    free((void*)replays);
+    return (nFailed || nUnreadable) ? 1 : 0;
+}
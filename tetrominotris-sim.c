@@ -0,0 +1,299 @@
+/*	tetrominotris-sim.c
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	Headless simulator
+
+	Plays games on a TGameEngine using its virtual clock and no curses
+	display.  Games are spread across a pool of worker threads, each
+	driven by the headless driver's random player or the built-in bot --
+	one event per tick, or optionally one placement call per tetromino.
+	A summary line is written per game (if requested) and the aggregate
+	throughput (pieces placed per second of wall time) is written at the
+	end.
+*/
+
+#include "TGameEngine.h"
+#include "THeadlessDriver.h"
+#include "TEnginePool.h"
+#include "TBot.h"
+
+#include <getopt.h>
+#include <strings.h>
+
+static struct option cliArgOpts[] = {
+    { "help",           no_argument,        NULL,       'h' },
+    { "verbose",        no_argument,        NULL,       'v' },
+    { "games",          required_argument,  NULL,       'n' },
+    { "threads",        required_argument,  NULL,       't' },
+    { "pieces",         required_argument,  NULL,       'p' },
+    { "seed",           required_argument,  NULL,       's' },
+    { "gravity",        required_argument,  NULL,       'g' },
+    { "word-size",      required_argument,  NULL,       'S' },
+    { "width",          required_argument,  NULL,       'w' },
+    { "height",         required_argument,  NULL,       'H' },
+    { "level",          required_argument,  NULL,       'l' },
+    { "color",          no_argument,        NULL,       'C' },
+    { "placements",     no_argument,        NULL,       'P' },
+    { "movegen",        no_argument,        NULL,       'M' },
+    { "bot",            no_argument,        NULL,       'b' },
+    { "weights",        required_argument,  NULL,       'W' },
+    { NULL,             0,                  NULL,        0  }
+};
+
+static const char *cliArgOptsStr = "hvn:t:p:s:g:S:w:H:l:CPMbW:";
+
+void
+usage(
+    const char  *exe
+)
+{
+    printf(
+        "\n"
+        "usage:\n"
+        "\n"
+        "    %s {options}\n"
+        "\n"
+        "  options:\n"
+        "\n"
+        "    --help/-h                      show this information\n"
+        "    --verbose/-v                   show a summary of each game\n"
+        "    --games/-n #                   number of games to play (default: 1)\n"
+        "    --threads/-t #                 number of worker threads; 0 for one per\n"
+        "                                   online processor (default: 1)\n"
+        "    --pieces/-p #                  stop each game after this many pieces\n"
+        "                                   have been placed (default: no limit,\n"
+        "                                   or 10000 with --bot)\n"
+        "    --seed/-s #                    base seed for the games; game N uses\n"
+        "                                   seed + N for the engine and the random\n"
+        "                                   player (default: current time)\n"
+        "    --gravity/-g #                 advance the virtual clock by this many\n"
+        "                                   milliseconds per event (default: 0)\n"
+        "    --word-size/-S <word-size>     choose the word size used by the game\n"
+        "                                   engine's bit grid (default: opt)\n"
+        "    --width/-w #                   choose the game board width (default: 10)\n"
+        "    --height/-H #                  choose the game board height (default: 20)\n"
+        "    --level/-l #                   start the game at this level (0 and\n"
+        "                                   up)\n"
+        "    --color/-C                     use a color game board\n"
+        "    --placements/-P                place each tetromino with a single\n"
+        "                                   placement call instead of a tick per\n"
+        "                                   event (ticks then count placements)\n"
+        "    --movegen/-M                   like --placements, but choose at random\n"
+        "                                   from every reachable resting position\n"
+        "                                   found by the placement generator\n"
+        "    --bot/-b                       play the built-in bot rather than the\n"
+        "                                   random player\n"
+        "    --weights/-W <filepath>        play the bot with the evaluation\n"
+        "                                   weights in the given file\n"
+        "\n"
+        "    <word-size> = opt | 8b | 16b | 32b | 64b\n"
+        "\n"
+        "version: " TETROMINOTRIS_VERSION "\n"
+        "\n",
+        exe
+    );
+}
+
+/*
+ * @function parseUnsignedLong
+ *
+ * Parse a non-negative integer from the command line.  Returns true
+ * if the string was parsed successfully and *value is set.
+ */
+bool
+parseUnsignedLong(
+    const char      *optstr,
+    const char      *what,
+    unsigned long   *value
+)
+{
+    char            *endptr = NULL;
+    long long       v = strtoll(optstr, &endptr, 0);
+
+    if ( (endptr > optstr) && (*endptr == '\0') && (v >= 0) ) {
+        *value = (unsigned long)v;
+        return true;
+    }
+    fprintf(stderr, "ERROR:  invalid %s: %s\n", what, optstr);
+    return false;
+}
+
+/*
+ * @function parseWordSize
+ *
+ * Parse a word size from the command line.  Returns true is
+ * the string was parsed successfully and *wordSize is set
+ * to the desired value.
+ */
+bool
+parseWordSize(
+    const char          *optstr,
+    TBitGridWordSize    *wordSize
+)
+{
+    if ( ! strcasecmp(optstr, "opt") ) *wordSize = TBitGridWordSizeDefault;
+    else if ( ! strcasecmp(optstr, "8b") ) *wordSize = TBitGridWordSizeForce8Bit;
+    else if ( ! strcasecmp(optstr, "16b") ) *wordSize = TBitGridWordSizeForce16Bit;
+    else if ( ! strcasecmp(optstr, "32b") ) *wordSize = TBitGridWordSizeForce32Bit;
+    else if ( ! strcasecmp(optstr, "64b") ) *wordSize = TBitGridWordSizeForce64Bit;
+    else {
+        fprintf(stderr, "ERROR:  invalid word size: %s\n", optstr);
+        return false;
+    }
+    return true;
+}
+
+//
+
+int
+main(
+    int                 argc,
+    char * const        argv[]
+)
+{
+    int                     optCh;
+    bool                    isVerbose = false, wantsColor = false, shouldUsePlacements = false, shouldUseMoveGen = false, shouldUseBot = false;
+    unsigned long           nGames = 1, gameIdx, seed = time(NULL), gravityMs = 0;
+    unsigned long           width = 10, height = 20, startingLevel = 0;
+    TBitGridWordSize        wantWordSize = TBitGridWordSizeDefault;
+    THeadlessDriverOptions  options = THeadlessDriverOptionsMake();
+    unsigned long           nThreads = 1;
+    TEnginePoolRandomGameContext gameContext;
+    TEnginePoolBotGameContext botGameContext;
+    TEnginePool             *enginePool;
+    THeadlessGameResult     *results;
+    unsigned long           nPiecesTotal = 0, nLinesTotal = 0, nTicksTotal = 0;
+    struct timespec         t0, t1, dt;
+
+    TBotWeightsInit(&botGameContext.weights);
+
+    // Parse CLI arguments:
+    while ( (optCh = getopt_long(argc, argv, cliArgOptsStr, cliArgOpts, NULL)) != -1 ) {
+        switch ( optCh ) {
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            case 'v':
+                isVerbose = true;
+                break;
+            case 'n':
+                if ( ! parseUnsignedLong(optarg, "game count", &nGames) ) exit(EINVAL);
+                break;
+            case 't':
+                if ( ! parseUnsignedLong(optarg, "thread count", &nThreads) ) exit(EINVAL);
+                break;
+            case 'p':
+                if ( ! parseUnsignedLong(optarg, "piece count", &options.maxPieces) ) exit(EINVAL);
+                break;
+            case 's':
+                if ( ! parseUnsignedLong(optarg, "seed", &seed) ) exit(EINVAL);
+                break;
+            case 'g':
+                if ( ! parseUnsignedLong(optarg, "gravity interval", &gravityMs) ) exit(EINVAL);
+                break;
+            case 'S':
+                if ( ! parseWordSize(optarg, &wantWordSize) ) exit(EINVAL);
+                break;
+            case 'w':
+                if ( ! parseUnsignedLong(optarg, "width", &width) ) exit(EINVAL);
+                break;
+            case 'H':
+                if ( ! parseUnsignedLong(optarg, "height", &height) ) exit(EINVAL);
+                break;
+            case 'l':
+                if ( ! parseUnsignedLong(optarg, "level", &startingLevel) ) exit(EINVAL);
+                if ( startingLevel > 9 ) {
+                    fprintf(stderr, "ERROR:  level number must be between 0 and 9: %lu\n", startingLevel);
+                    exit(EINVAL);
+                }
+                break;
+            case 'C':
+                wantsColor = true;
+                break;
+            case 'P':
+                shouldUsePlacements = true;
+                break;
+            case 'M':
+                shouldUsePlacements = shouldUseMoveGen = true;
+                break;
+            case 'b':
+                shouldUseBot = true;
+                break;
+            case 'W':
+                TBotWeightsInitWithFile(&botGameContext.weights, optarg);
+                shouldUseBot = true;
+                break;
+        }
+    }
+    if ( shouldUseBot ) {
+        if ( width > TMoveGenMaxWidth ) {
+            fprintf(stderr, "ERROR:  the bot cannot play boards wider than %u\n", TMoveGenMaxWidth);
+            exit(EINVAL);
+        }
+        // A decent bot may never top out:
+        if ( ! options.maxPieces ) options.maxPieces = 10000;
+    }
+    options.tickInterval.tv_sec = gravityMs / 1000;
+    options.tickInterval.tv_nsec = (gravityMs % 1000) * 1000000;
+
+    enginePool = TEnginePoolCreate(nThreads, wantWordSize, wantsColor, width, height, startingLevel);
+    if ( ! enginePool ) {
+        fprintf(stderr, "ERROR:  unable to create %lu x %lu game engines\n", width, height);
+        exit(EINVAL);
+    }
+    results = (THeadlessGameResult*)malloc(nGames * sizeof(THeadlessGameResult));
+    if ( ! results ) {
+        fprintf(stderr, "ERROR:  unable to allocate results for %lu games\n", nGames);
+        exit(ENOMEM);
+    }
+    gameContext.baseSeed = seed;
+    gameContext.options = options;
+    gameContext.shouldUsePlacements = shouldUsePlacements;
+    gameContext.shouldUseMoveGen = shouldUseMoveGen;
+    botGameContext.baseSeed = seed;
+    botGameContext.options = options;
+    botGameContext.shouldUsePlacements = shouldUsePlacements;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if ( ! (shouldUseBot ? TEnginePoolRun(enginePool, nGames, TEnginePoolBotGame, &botGameContext, results)
+                         : TEnginePoolRun(enginePool, nGames, TEnginePoolRandomGame, &gameContext, results)) ) {
+        fprintf(stderr, "ERROR:  too many games: %lu\n", nGames);
+        exit(EINVAL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    timespec_subtract(&dt, &t1, &t0);
+
+    for ( gameIdx = 0; gameIdx < nGames; gameIdx++ ) {
+        THeadlessGameResult     *result = &results[gameIdx];
+        
+        nPiecesTotal += result->nPieces;
+        nLinesTotal += result->scoreboard.nLinesTotal;
+        nTicksTotal += result->nTicks;
+        if ( isVerbose ) {
+            printf("game %6lu : seed %20llu, score %8u, level %2u, lines %6u (%u/%u/%u/%u), pieces %8lu (%u/%u/%u/%u/%u/%u/%u), ticks %10lu%s\n",
+                    gameIdx, (unsigned long long)result->seed, result->scoreboard.score, result->scoreboard.level, result->scoreboard.nLinesTotal,
+                    result->scoreboard.nLinesOfType[TScoreboardLineCountTypeSingle],
+                    result->scoreboard.nLinesOfType[TScoreboardLineCountTypeDouble],
+                    result->scoreboard.nLinesOfType[TScoreboardLineCountTypeTriple],
+                    result->scoreboard.nLinesOfType[TScoreboardLineCountTypeQuadruple],
+                    result->nPieces,
+                    result->scoreboard.tetrominosOfType[0], result->scoreboard.tetrominosOfType[1],
+                    result->scoreboard.tetrominosOfType[2], result->scoreboard.tetrominosOfType[3],
+                    result->scoreboard.tetrominosOfType[4], result->scoreboard.tetrominosOfType[5],
+                    result->scoreboard.tetrominosOfType[6],
+                    result->nTicks, result->didFinish ? "" : " (piece limit)"
+                );
+        }
+    }
+
+    printf("%lu games, %lu pieces, %lu lines, %lu ticks on %u thread(s) in %.3f s (%.0f pieces/s)\n",
+            nGames, nPiecesTotal, nLinesTotal, nTicksTotal, TEnginePoolGetThreadCount(enginePool), timespec_to_double(&dt),
+            (timespec_to_double(&dt) > 0.0) ? (double)nPiecesTotal / timespec_to_double(&dt) : 0.0
+        );
+
+    free((void*)results);
+    TEnginePoolDestroy(enginePool);
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*	tetrominotris-tablegen.c
+	Copyright (c) 2024, J T Frey
+*/
+
+/*!
+	Tetromino table generator
+
+	Run as a build step to produce the C source for the constant
+	tetromino shape tables declared in TTetrominos.h.  For every
+	tetromino (plus the "none" tetromino), orientation and pair of
+	horizontal/vertical shifts the 4x4 bitmap is computed once with
+	the step-at-a-time shift functions, along with the bounds of its
+	set bits, the number of leading blank rows and the lowest occupied
+	row of each column.  Sprite queries at runtime are then a single
+	table load.
+*/
+
+#include "TTetrominos.h"
+
+//
+
+static uint16_t
+__TTetrominoTablegenShape(
+    unsigned int    tetrominoId,
+    unsigned int    orientation,
+    int             shiftI,
+    int             shiftJ
+)
+{
+    uint16_t        T;
+
+    if ( tetrominoId >= TTetrominosCount ) return 0;
+    T = TTetrominosExtractOrientation(tetrominoId, orientation);
+    T = TTetrominoOrientationShiftVertical(T, shiftJ);
+    T = TTetrominoOrientationShiftHorizontal(T, shiftI);
+    return T;
+}
+
+//
+
+static TTetrominoShapeInfo
+__TTetrominoTablegenShapeInfo(
+    uint16_t        T
+)
+{
+    TTetrominoShapeInfo info = { .iLo = 0, .jLo = 0, .iHi = -1, .jHi = -1, .initialClearRows = 0,
+                                 .columnBottom = { -1, -1, -1, -1 } };
+    int                 i, j;
+
+    if ( T == 0 ) return info;
+    info.iLo = info.jLo = 4;
+    j = 0;
+    while ( j < 4 ) {
+        i = 0;
+        while ( i < 4 ) {
+            if ( T & (1 << (4 * j + i)) ) {
+                if ( i < info.iLo ) info.iLo = i;
+                if ( i > info.iHi ) info.iHi = i;
+                if ( j < info.jLo ) info.jLo = j;
+                if ( j > info.jHi ) info.jHi = j;
+                info.columnBottom[i] = j;
+            }
+            i++;
+        }
+        j++;
+    }
+    info.initialClearRows = info.jLo;
+    return info;
+}
+
+//
+
+int
+main(
+    int                 argc,
+    char*               argv[]
+)
+{
+    FILE                *fptr = stdout;
+    unsigned int        tetrominoId, orientation;
+    int                 shiftI, shiftJ;
+
+    if ( argc > 2 ) {
+        fprintf(stderr, "usage:  %s {<output-file>}\n", argv[0]);
+        exit(EINVAL);
+    }
+    if ( argc == 2 ) {
+        fptr = fopen(argv[1], "w");
+        if ( ! fptr ) {
+            fprintf(stderr, "ERROR:  unable to open %s for writing (errno = %d)\n", argv[1], errno);
+            exit(errno);
+        }
+    }
+
+    fprintf(fptr,
+            "/*\tTTetrominoTables.c\n"
+            "\tGenerated by tetrominotris-tablegen -- do not edit.\n"
+            "*/\n"
+            "\n"
+            "#include \"TTetrominos.h\"\n"
+            "\n"
+            "const uint16_t TTetrominoShapes[TTetrominosCount + 1][4][TTetrominoShiftCount][TTetrominoShiftCount] = {\n"
+        );
+    tetrominoId = 0;
+    while ( tetrominoId <= TTetrominosCount ) {
+        fprintf(fptr, "    {\n");
+        orientation = 0;
+        while ( orientation < 4 ) {
+            fprintf(fptr, "        {\n");
+            shiftJ = -TTetrominoShiftMax;
+            while ( shiftJ <= TTetrominoShiftMax ) {
+                fprintf(fptr, "            {");
+                shiftI = -TTetrominoShiftMax;
+                while ( shiftI <= TTetrominoShiftMax ) {
+                    fprintf(fptr, " 0x%04hX%s", __TTetrominoTablegenShape(tetrominoId, orientation, shiftI, shiftJ), (shiftI < TTetrominoShiftMax) ? "," : " ");
+                    shiftI++;
+                }
+                fprintf(fptr, "}%s\n", (shiftJ < TTetrominoShiftMax) ? "," : "");
+                shiftJ++;
+            }
+            fprintf(fptr, "        }%s\n", (orientation < 3) ? "," : "");
+            orientation++;
+        }
+        fprintf(fptr, "    }%s\n", (tetrominoId < TTetrominosCount) ? "," : "");
+        tetrominoId++;
+    }
+    fprintf(fptr,
+            "};\n"
+            "\n"
+            "const TTetrominoShapeInfo TTetrominoShapeInfos[TTetrominosCount + 1][4][TTetrominoShiftCount][TTetrominoShiftCount] = {\n"
+        );
+    tetrominoId = 0;
+    while ( tetrominoId <= TTetrominosCount ) {
+        fprintf(fptr, "    {\n");
+        orientation = 0;
+        while ( orientation < 4 ) {
+            fprintf(fptr, "        {\n");
+            shiftJ = -TTetrominoShiftMax;
+            while ( shiftJ <= TTetrominoShiftMax ) {
+                fprintf(fptr, "            {\n");
+                shiftI = -TTetrominoShiftMax;
+                while ( shiftI <= TTetrominoShiftMax ) {
+                    TTetrominoShapeInfo info = __TTetrominoTablegenShapeInfo(__TTetrominoTablegenShape(tetrominoId, orientation, shiftI, shiftJ));
+
+                    fprintf(fptr, "                { %2d, %2d, %2d, %2d, %d, { %2d, %2d, %2d, %2d } }%s\n",
+                            info.iLo, info.jLo, info.iHi, info.jHi, info.initialClearRows,
+                            info.columnBottom[0], info.columnBottom[1], info.columnBottom[2], info.columnBottom[3],
+                            (shiftI < TTetrominoShiftMax) ? "," : "");
+                    shiftI++;
+                }
+                fprintf(fptr, "            }%s\n", (shiftJ < TTetrominoShiftMax) ? "," : "");
+                shiftJ++;
+            }
+            fprintf(fptr, "        }%s\n", (orientation < 3) ? "," : "");
+            orientation++;
+        }
+        fprintf(fptr, "    }%s\n", (tetrominoId < TTetrominosCount) ? "," : "");
+        tetrominoId++;
+    }
+    fprintf(fptr, "};\n");
+
+    if ( fptr != stdout ) {
+        if ( fclose(fptr) != 0 ) {
+            fprintf(stderr, "ERROR:  unable to write %s (errno = %d)\n", argv[1], errno);
+            exit(errno);
+        }
+    }
+    return 0;
+}
@@ -7,8 +7,13 @@
 	
 	The source file contains the main program logic for the game.  In short, a
 	TKeymap is setup, a TGameEngine is created, and a loop that monitors for
-	keypresses calls the TGameEngineTick() function repeatedly to advance game
-	state.
+	keypresses calls the TGameEngineTick() function to advance game state.
+	When no keys are waiting the loop sleeps until input arrives or the
+	engine's next deadline passes, so an idle game uses no CPU.
+	
+	In demo mode the built-in bot (TBot) supplies the events instead of the
+	keyboard, one move every TDemoMoveInterval, and a new game starts a
+	little while after each one ends.
 	
 	All tui_window content-drawing callback functions are implemented herein,
 	as well.  In some cases there are two variants -- with "_BW" and "_COLOR"
@@ -25,11 +30,17 @@
 #include "TGameEngine.h"
 #include "TKeymap.h"
 #include "THighScores.h"
+#include "TReplay.h"
+#include "TBot.h"
 #include "tui_window.h"
 
 #include <ctype.h>
 #include <locale.h>
 #include <langinfo.h>
+#include <poll.h>
+#ifdef HAVE_SYS_TIMERFD_H
+#   include <sys/timerfd.h>
+#endif
 
 //
 
@@ -43,6 +54,11 @@ static struct option cliArgOpts[] = {
     { "level",          required_argument,  NULL,       'l' },
     { "keymap",         required_argument,  NULL,       'k' },
     { "utf8",           no_argument,        NULL,       'U' },
+    { "ghost",          no_argument,        NULL,       'g' },
+    { "record",         required_argument,  NULL,       'r' },
+    { "render-bench",   required_argument,  NULL,       'R' },
+    { "demo",           no_argument,        NULL,       'd' },
+    { "weights",        required_argument,  NULL,       'W' },
 #ifdef ENABLE_COLOR_DISPLAY
     { "color",          no_argument,        NULL,       'C' },
     { "basic-colors",   no_argument,        NULL,       'B' },
@@ -54,7 +70,7 @@ static struct option cliArgOpts[] = {
  * options are concatenated with the common options -- so don't end the next
  * line with a semicolon!
  */
-static const char *cliArgOptsStr = "hS:w:H:l:k:U"
+static const char *cliArgOptsStr = "hS:w:H:l:k:Ugr:R:dW:"
 #ifdef ENABLE_COLOR_DISPLAY
             "CB"
 #endif
@@ -88,6 +104,17 @@ usage(
         "    --keymap/-k <filepath>         initialize the key mapping from the\n"
         "                                   given file\n"
         "    --utf8/-U                      allow UTF-8 characters to be displayed\n"
+        "    --ghost/-g                     show where the falling tetromino will\n"
+        "                                   land\n"
+        "    --record/-r <directory>        write a replay of each game played to\n"
+        "                                   a file in the given directory\n"
+        "    --render-bench/-R #            rather than playing, redraw the game\n"
+        "                                   board for # frames of random moves and\n"
+        "                                   report the time spent per frame\n"
+        "    --demo/-d                      let the built-in bot play, starting a\n"
+        "                                   new game after each one ends\n"
+        "    --weights/-W <filepath>        read the bot's board evaluation weights\n"
+        "                                   from the given file\n"
         "\n"
         "    <dimension> = # | default | fit\n"
         "              # = a positive integer value\n"
@@ -629,6 +656,158 @@ static const char* gameOverStrings[5] = {
                     };
 static unsigned int gameOverStringsLen = 21;
 
+/*
+ * @typedef TGameBoardView
+ *
+ * The game board window's drawing context:  the game engine being drawn and a
+ * shadow of what was last drawn in each cell of the board.  A cell's entry is
+ * the first character of the cell's top line (which determines the rest of
+ * the cell), or zero if the cell's on-screen content is unknown.
+ *
+ * Once every row has been drawn, only the rows the engine reports as dirty
+ * (see TGameEngineGetDirtyRect()) are revisited; the board window must be
+ * redrawn after every tick that notifies a game board update.
+ */
+typedef struct {
+    TGameEngine     *gameEngine;
+    unsigned int    w, h;
+    bool            shouldDrawAllRows;
+    chtype          *drawnCells;
+} TGameBoardView;
+
+/*
+ * @function TGameBoardViewCreate
+ *
+ * Allocate a drawing context for gameEngine's board; all cells start out
+ * unknown.
+ */
+TGameBoardView*
+TGameBoardViewCreate(
+    TGameEngine     *gameEngine
+)
+{
+    unsigned int    w = gameEngine->gameBoard->dimensions.w, h = gameEngine->gameBoard->dimensions.h;
+    TGameBoardView  *newView = (TGameBoardView*)malloc(sizeof(TGameBoardView) + w * h * sizeof(chtype));
+    
+    if ( newView ) {
+        newView->gameEngine = gameEngine;
+        newView->w = w;
+        newView->h = h;
+        newView->shouldDrawAllRows = true;
+        newView->drawnCells = (chtype*)((void*)newView + sizeof(TGameBoardView));
+        memset(newView->drawnCells, 0, w * h * sizeof(chtype));
+    }
+    return newView;
+}
+
+/*
+ * @function TGameBoardViewDestroy
+ *
+ * Dispose of a drawing context.
+ */
+void
+TGameBoardViewDestroy(
+    TGameBoardView  *boardView
+)
+{
+    free((void*)boardView);
+}
+
+/*
+ * @function TGameBoardViewInvalidate
+ *
+ * Forget what was last drawn in every cell, e.g. because something else was
+ * drawn over the board.  The next call to TGameBoardViewDrawRow() for each row
+ * redraws all of its cells.
+ */
+static inline void
+TGameBoardViewInvalidate(
+    TGameBoardView  *boardView
+)
+{
+    memset(boardView->drawnCells, 0, boardView->w * boardView->h * sizeof(chtype));
+    boardView->shouldDrawAllRows = true;
+}
+
+/*
+ * @function TGameBoardViewGetRowsToDraw
+ *
+ * Fill-in the range of rows [*jLo,*jHi] that the next draw of the board
+ * should visit:  every row if the view has been invalidated, otherwise the
+ * rows the engine's last tick reported as dirty.  Returns false if no row
+ * needs to be drawn.
+ */
+static inline bool
+TGameBoardViewGetRowsToDraw(
+    TGameBoardView  *boardView,
+    int             *jLo,
+    int             *jHi
+)
+{
+    if ( boardView->shouldDrawAllRows ) {
+        *jLo = 0;
+        *jHi = boardView->h - 1;
+        boardView->shouldDrawAllRows = false;
+    } else {
+        TGridRect   dirtyRect = TGameEngineGetDirtyRect(boardView->gameEngine);
+        
+        if ( TGridRectIsEmpty(dirtyRect) ) return false;
+        *jLo = dirtyRect.jLo;
+        *jHi = dirtyRect.jHi;
+    }
+    return true;
+}
+
+/*
+ * @function TGameBoardViewDrawRow
+ *
+ * Given the desired content of each cell of row j of the board -- the first
+ * character of the cell's top line, either a blank, a '|' for a block or a
+ * ':' for a ghost cell, with the cell's attributes -- draw the span from the first through the last cell that
+ * differs from what is on-screen and note the new content in the shadow.
+ * Each of the row's two lines is written with a single waddchnstr() call.
+ */
+void
+TGameBoardViewDrawRow(
+    TGameBoardView  *boardView,
+    WINDOW          *window_ptr,
+    unsigned int    j,
+    const chtype    *cells
+)
+{
+    chtype          *drawnCells = boardView->drawnCells + j * boardView->w;
+    chtype          line1[4 * boardView->w], *line1Ptr = line1;
+    chtype          line2[4 * boardView->w], *line2Ptr = line2;
+    unsigned int    i, iStart = 0, iEnd = boardView->w;
+    
+    // Find the span of changed cells:
+    while ( (iStart < iEnd) && (drawnCells[iStart] == cells[iStart]) ) iStart++;
+    if ( iStart == iEnd ) return;
+    while ( drawnCells[iEnd - 1] == cells[iEnd - 1] ) iEnd--;
+    
+    // Unchanged cells inside the span are rewritten as they are; curses
+    // only sends the terminal what differs:
+    for ( i = iStart; i < iEnd; i++ ) {
+        chtype      modifier = cells[i] & ~A_CHARTEXT;
+        
+        drawnCells[i] = cells[i];
+        if ( cells[i] == ' ' ) {
+            *line1Ptr++ = ' '; *line1Ptr++ = ' '; *line1Ptr++ = ' '; *line1Ptr++ = ' ';
+            *line2Ptr++ = ' '; *line2Ptr++ = ' '; *line2Ptr++ = ' '; *line2Ptr++ = ' ';
+        } else if ( (cells[i] & A_CHARTEXT) == ':' ) {
+            *line1Ptr++ = cells[i]; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' ';
+            *line2Ptr++ = cells[i]; *line2Ptr++ = modifier | '.'; *line2Ptr++ = modifier | '.'; *line2Ptr++ = modifier | '.';
+        } else {
+            *line1Ptr++ = cells[i]; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' ';
+            *line2Ptr++ = cells[i]; *line2Ptr++ = modifier | '_'; *line2Ptr++ = modifier | '_'; *line2Ptr++ = modifier | '_';
+        }
+    }
+    mvwaddchnstr(window_ptr, 1 + 2 * j, 2 + 4 * iStart, line1, line1Ptr - line1);
+    mvwaddchnstr(window_ptr, 2 + 2 * j, 2 + 4 * iStart, line2, line2Ptr - line2);
+}
+
+//
+
 void
 gameBoardDraw_BW(
     tui_window_ref  the_window,
@@ -636,7 +815,8 @@ gameBoardDraw_BW(
     const void      *context
 )
 { 
-#define GAME_ENGINE ((TGameEngine*)context)
+#define BOARD_VIEW  ((TGameBoardView*)context)
+#define GAME_ENGINE BOARD_VIEW->gameEngine
 #define THE_BOARD   GAME_ENGINE->gameBoard
 #define THE_PIECE   GAME_ENGINE->currentSprite
 
@@ -646,6 +826,7 @@ gameBoardDraw_BW(
             int     x = 2 + (4 * THE_BOARD->dimensions.w - awaitingStartStringsLen) / 2;
             int     y = THE_BOARD->dimensions.h - 4;
     
+            TGameBoardViewInvalidate(BOARD_VIEW);
             mvwprintw(window_ptr, y++, x, "%s", awaitingStartStrings[0]);
             mvwprintw(window_ptr, y++, x, "%s", awaitingStartStrings[1]);
             mvwprintw(window_ptr, y++, x, "%s", awaitingStartStrings[2]);
@@ -655,25 +836,23 @@ gameBoardDraw_BW(
         case TGameEngineStateGameIsPaused:
         case TGameEngineStateCheckHighScore:
         case TGameEngineStateGameHasEnded: {
-            int             i, j;
-            chtype          line1[THE_BOARD->dimensions.w * 4 + 1];
-            chtype          line2[THE_BOARD->dimensions.w * 4 + 1];
+            int             i, j, n = THE_BOARD->dimensions.w * 4;
+            chtype          line1[THE_BOARD->dimensions.w * 4];
+            chtype          line2[THE_BOARD->dimensions.w * 4];
         
+            TGameBoardViewInvalidate(BOARD_VIEW);
+            
+            // Every row is the same, so build it once:
+            i = 0;
+            while ( i < n ) {
+                line1[i] = A_REVERSE | ' ';
+                line2[i] = A_REVERSE | '_';
+                i++;
+            }
             j = 0;
             while ( j < THE_BOARD->dimensions.h ) {
-                chtype          *line1Ptr = line1, *line2Ptr = line2;
-        
-                i = 0;
-                while ( i++ < THE_BOARD->dimensions.w ) {
-                    *line1Ptr++ = A_REVERSE | ' '; *line1Ptr++ = A_REVERSE | ' '; *line1Ptr++ = A_REVERSE | ' '; *line1Ptr++ = A_REVERSE | ' ';
-                    *line2Ptr++ = A_REVERSE | '_'; *line2Ptr++ = A_REVERSE | '_'; *line2Ptr++ = A_REVERSE | '_'; *line2Ptr++ = A_REVERSE | '_';
-                }
-                wmove(window_ptr, 1 + 2 * j, 2);
-                i = (line1Ptr - line1); line1Ptr = line1;
-                while ( i-- ) waddch(window_ptr, *line1Ptr++);
-                wmove(window_ptr, 2 + 2 * j, 2);
-                i = (line2Ptr - line2); line2Ptr = line2;
-                while ( i-- ) waddch(window_ptr, *line2Ptr++);
+                mvwaddchnstr(window_ptr, 1 + 2 * j, 2, line1, n);
+                mvwaddchnstr(window_ptr, 2 + 2 * j, 2, line2, n);
                 j++;
             }
             if ( GAME_ENGINE->gameState >= TGameEngineStateCheckHighScore ) {
@@ -703,12 +882,17 @@ gameBoardDraw_BW(
         
         case TGameEngineStateGameHasStarted:
         case TGameEngineStateHoldClearedLines: {
-            int                 i, j, spriteILo, spriteIHi, spriteJLo, spriteJHi, extraIShift = 0;
-            chtype              line1[THE_BOARD->dimensions.w * 4 + 1];
-            chtype              line2[THE_BOARD->dimensions.w * 4 + 1];
-            TBitGridIterator    *gridScanner = TBitGridIteratorCreate(THE_BOARD, 0b11);
+            int                 i, j, jLo, jHi, spriteILo, spriteIHi, spriteJLo, spriteJHi, extraIShift = 0;
+            chtype              cells[THE_BOARD->dimensions.w];
+            TBitGridIterator    gridScanner;
             TGridPos            P;
-            uint16_t            spriteBits = TSpriteGet4x4(&THE_PIECE);
+            uint16_t            spriteBits = TSpriteGet4x4(&THE_PIECE), ghostBits = spriteBits;
+            TSprite             ghost = TGameEngineGetGhostSprite(GAME_ENGINE);
+            bool                shouldDrawGhost = GAME_ENGINE->shouldShowGhost && (GAME_ENGINE->gameState == TGameEngineStateGameHasStarted);
+    
+            // Only the rows that changed need to be visited:
+            if ( ! TGameBoardViewGetRowsToDraw(BOARD_VIEW, &jLo, &jHi) ) break;
+            TBitGridIteratorInitWithRowRange(&gridScanner, THE_BOARD, 0b11, jLo, jHi);
     
             // Skip any lines that are off-screen above the board:
             if ( THE_PIECE.P.j < 0 ) {
@@ -735,15 +919,20 @@ gameBoardDraw_BW(
                 spriteIHi = 4 + spriteILo;
                 extraIShift = (spriteIHi > THE_BOARD->dimensions.w) ? (spriteIHi - THE_BOARD->dimensions.w) : 0;
             }
+            
+            // Each on-board row of the sprite occupies 4 bits; drop those
+            // of rows above the first one drawn:
+            if ( jLo > spriteJLo ) {
+                spriteBits = (jLo < spriteJHi) ? (spriteBits >> (4 * (jLo - spriteJLo))) : 0;
+                spriteJLo = jLo;
+            }
     
-            j = 0;
-            while ( j < THE_BOARD->dimensions.h ) {
-                chtype          *line1Ptr = line1, *line2Ptr = line2;
-        
+            j = jLo;
+            while ( j <= jHi ) {
                 i = 0;
                 while ( i < THE_BOARD->dimensions.w ) {
                     TCell       cellValue;
-                    bool        spriteBit = false, gridBit = TBitGridIteratorNext(gridScanner, &P, &cellValue);
+                    bool        spriteBit = false, gridBit = TBitGridIteratorNext(&gridScanner, &P, &cellValue);
             
                     // Sprite?
                     if ((j >= spriteJLo) && (j < spriteJHi) && (i >= spriteILo) && (i < spriteIHi)) {
@@ -751,33 +940,31 @@ gameBoardDraw_BW(
                         spriteBits >>= 1;
                     }
                     if ( (GAME_ENGINE->gameState != TGameEngineStateHoldClearedLines) && spriteBit ) {
-                        *line1Ptr++ = A_REVERSE | '|'; *line1Ptr++ = A_REVERSE | ' '; *line1Ptr++ = A_REVERSE | ' '; *line1Ptr++ = A_REVERSE | ' ';
-                        *line2Ptr++ = A_REVERSE | '|'; *line2Ptr++ = A_REVERSE | '_'; *line2Ptr++ = A_REVERSE | '_'; *line2Ptr++ = A_REVERSE | '_';
+                        cells[i] = A_REVERSE | '|';
                     }
                     else if ( (gridBit && TCellGetIsOccupied(cellValue)) ) {
                         int         modifier = A_REVERSE;
             
                         if ( TCellGetIsCompleted(cellValue) && ! GAME_ENGINE->completionFlashIdx ) modifier = 0;
                 
-                        *line1Ptr++ = modifier | '|'; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' ';
-                        *line2Ptr++ = modifier | '|'; *line2Ptr++ = modifier | '_'; *line2Ptr++ = modifier | '_'; *line2Ptr++ = modifier | '_';
+                        cells[i] = modifier | '|';
+                    }
+                    else if ( shouldDrawGhost && ((unsigned int)(j - ghost.P.j) < 4) && ((unsigned int)(i - ghost.P.i) < 4) &&
+                              (ghostBits & (1 << (4 * (j - ghost.P.j) + (i - ghost.P.i))))
+                    ) {
+                        cells[i] = A_DIM | ':';
                     }
                     else {
-                        *line1Ptr++ = ' '; *line1Ptr++ = ' '; *line1Ptr++ = ' '; *line1Ptr++ = ' ';
-                        *line2Ptr++ = ' '; *line2Ptr++ = ' '; *line2Ptr++ = ' '; *line2Ptr++ = ' ';
+                        cells[i] = ' ';
                     }
                     i++;
                 }
                 if ( (j >= spriteJLo) && (j < spriteJHi) && extraIShift ) spriteBits >>= extraIShift;
-                wmove(window_ptr, 1 + 2 * j, 2);
-                i = (line1Ptr - line1); line1Ptr = line1;
-                while ( i-- ) waddch(window_ptr, *line1Ptr++);
-                wmove(window_ptr, 2 + 2 * j, 2);
-                i = (line2Ptr - line2); line2Ptr = line2;
-                while ( i-- ) waddch(window_ptr, *line2Ptr++);
+                
+                // Only the cells that changed are drawn:
+                TGameBoardViewDrawRow(BOARD_VIEW, window_ptr, j, cells);
                 j++;
             }
-            TBitGridIteratorDestroy(gridScanner);
             break;
         }
     }
@@ -785,6 +972,7 @@ gameBoardDraw_BW(
 #undef THE_PIECE
 #undef THE_BOARD
 #undef GAME_ENGINE
+#undef BOARD_VIEW
 }
 
 //
@@ -933,17 +1121,13 @@ nextTetrominoDraw_BW(
                 }
                 mask <<= 1;
             }
-            wmove(window_ptr, 2 + 2 * j, 3);
-            count = line1Ptr - line1; line1Ptr = line1;
-            while ( count-- ) waddch(window_ptr, *line1Ptr++);
-            wmove(window_ptr, 3 + 2 * j, 3);
-            count = line2Ptr - line2; line2Ptr = line2;
-            while ( count-- ) waddch(window_ptr, *line2Ptr++);
+            mvwaddchnstr(window_ptr, 2 + 2 * j, 3, line1, line1Ptr - line1);
+            mvwaddchnstr(window_ptr, 3 + 2 * j, 3, line2, line2Ptr - line2);
         
             j++;
         }
     }
-#define GAME_ENGINE ((TGameEngine*)context)
+#undef GAME_ENGINE
 }
 
 //
@@ -959,7 +1143,8 @@ gameBoardDraw_COLOR(
     const void      *context
 )
 { 
-#define GAME_ENGINE ((TGameEngine*)context)
+#define BOARD_VIEW  ((TGameBoardView*)context)
+#define GAME_ENGINE BOARD_VIEW->gameEngine
 #define THE_BOARD   GAME_ENGINE->gameBoard
 #define THE_PIECE   GAME_ENGINE->currentSprite
 
@@ -969,6 +1154,7 @@ gameBoardDraw_COLOR(
             int     x = 2 + (4 * THE_BOARD->dimensions.w - awaitingStartStringsLen) / 2;
             int     y = THE_BOARD->dimensions.h - 4;
     
+            TGameBoardViewInvalidate(BOARD_VIEW);
             mvwprintw(window_ptr, y++, x, "%s", awaitingStartStrings[0]);
             mvwprintw(window_ptr, y++, x, "%s", awaitingStartStrings[1]);
             mvwprintw(window_ptr, y++, x, "%s", awaitingStartStrings[2]);
@@ -978,25 +1164,23 @@ gameBoardDraw_COLOR(
         case TGameEngineStateGameIsPaused:
         case TGameEngineStateCheckHighScore:
         case TGameEngineStateGameHasEnded: {
-            int             i, j;
-            chtype          line1[THE_BOARD->dimensions.w * 4 + 1];
-            chtype          line2[THE_BOARD->dimensions.w * 4 + 1];
+            int             i, j, n = THE_BOARD->dimensions.w * 4;
+            chtype          line1[3][THE_BOARD->dimensions.w * 4];
+            chtype          line2[3][THE_BOARD->dimensions.w * 4];
         
+            TGameBoardViewInvalidate(BOARD_VIEW);
+            
+            // Rows cycle through the three colors, so build each once:
+            i = 0;
+            while ( i < n ) {
+                line1[0][i] = COLOR_PAIR(1) | ' '; line1[1][i] = COLOR_PAIR(2) | ' '; line1[2][i] = COLOR_PAIR(3) | ' ';
+                line2[0][i] = COLOR_PAIR(1) | '_'; line2[1][i] = COLOR_PAIR(2) | '_'; line2[2][i] = COLOR_PAIR(3) | '_';
+                i++;
+            }
             j = 0;
             while ( j < THE_BOARD->dimensions.h ) {
-                chtype          *line1Ptr = line1, *line2Ptr = line2;
-        
-                i = 0;
-                while ( i++ < THE_BOARD->dimensions.w ) {
-                    *line1Ptr++ = COLOR_PAIR(1 + (j %3)) | ' '; *line1Ptr++ = COLOR_PAIR(1 + (j %3)) | ' '; *line1Ptr++ = COLOR_PAIR(1 + (j %3)) | ' '; *line1Ptr++ = COLOR_PAIR(1 + (j %3)) | ' ';
-                    *line2Ptr++ = COLOR_PAIR(1 + (j %3)) | '_'; *line2Ptr++ = COLOR_PAIR(1 + (j %3)) | '_'; *line2Ptr++ = COLOR_PAIR(1 + (j %3)) | '_'; *line2Ptr++ = COLOR_PAIR(1 + (j %3)) | '_';
-                }
-                wmove(window_ptr, 1 + 2 * j, 2);
-                i = (line1Ptr - line1); line1Ptr = line1;
-                while ( i-- ) waddch(window_ptr, *line1Ptr++);
-                wmove(window_ptr, 2 + 2 * j, 2);
-                i = (line2Ptr - line2); line2Ptr = line2;
-                while ( i-- ) waddch(window_ptr, *line2Ptr++);
+                mvwaddchnstr(window_ptr, 1 + 2 * j, 2, line1[j % 3], n);
+                mvwaddchnstr(window_ptr, 2 + 2 * j, 2, line2[j % 3], n);
                 j++;
             }
             if ( GAME_ENGINE->gameState >= TGameEngineStateCheckHighScore ) {
@@ -1026,13 +1210,18 @@ gameBoardDraw_COLOR(
         
         case TGameEngineStateGameHasStarted:
         case TGameEngineStateHoldClearedLines: {
-            int                 i, j, spriteILo, spriteIHi, spriteJLo, spriteJHi, extraIShift = 0;
-            chtype              line1[THE_BOARD->dimensions.w * 4 + 1];
-            chtype              line2[THE_BOARD->dimensions.w * 4 + 1];
-            TBitGridIterator    *gridScanner = TBitGridIteratorCreate(THE_BOARD, 0b1111);
+            int                 i, j, jLo, jHi, spriteILo, spriteIHi, spriteJLo, spriteJHi, extraIShift = 0;
+            chtype              cells[THE_BOARD->dimensions.w];
+            TBitGridIterator    gridScanner;
             TGridPos            P;
-            uint16_t            spriteBits = TSpriteGet4x4(&THE_PIECE);
+            uint16_t            spriteBits = TSpriteGet4x4(&THE_PIECE), ghostBits = spriteBits;
             int                 spriteColorIdx = 1 + THE_PIECE.colorIdx;
+            TSprite             ghost = TGameEngineGetGhostSprite(GAME_ENGINE);
+            bool                shouldDrawGhost = GAME_ENGINE->shouldShowGhost && (GAME_ENGINE->gameState == TGameEngineStateGameHasStarted);
+    
+            // Only the rows that changed need to be visited:
+            if ( ! TGameBoardViewGetRowsToDraw(BOARD_VIEW, &jLo, &jHi) ) break;
+            TBitGridIteratorInitWithRowRange(&gridScanner, THE_BOARD, 0b1111, jLo, jHi);
     
             // Skip any lines that are off-screen above the board:
             if ( THE_PIECE.P.j < 0 ) {
@@ -1059,15 +1248,20 @@ gameBoardDraw_COLOR(
                 spriteIHi = 4 + spriteILo;
                 extraIShift = (spriteIHi > THE_BOARD->dimensions.w) ? (spriteIHi - THE_BOARD->dimensions.w) : 0;
             }
+            
+            // Each on-board row of the sprite occupies 4 bits; drop those
+            // of rows above the first one drawn:
+            if ( jLo > spriteJLo ) {
+                spriteBits = (jLo < spriteJHi) ? (spriteBits >> (4 * (jLo - spriteJLo))) : 0;
+                spriteJLo = jLo;
+            }
     
-            j = 0;
-            while ( j < THE_BOARD->dimensions.h ) {
-                chtype          *line1Ptr = line1, *line2Ptr = line2;
-        
+            j = jLo;
+            while ( j <= jHi ) {
                 i = 0;
                 while ( i < THE_BOARD->dimensions.w ) {
                     TCell       cellValue;
-                    bool        spriteBit = false, gridBit = TBitGridIteratorNext(gridScanner, &P, &cellValue);
+                    bool        spriteBit = false, gridBit = TBitGridIteratorNext(&gridScanner, &P, &cellValue);
             
                     // If the sprite is in-range, decompose its bits:
                     if ((j >= spriteJLo) && (j < spriteJHi) && (i >= spriteILo) && (i < spriteIHi)) {
@@ -1076,8 +1270,7 @@ gameBoardDraw_COLOR(
                     }
                     // If we're clearing lines we don't draw the sprite bit:
                     if ( (GAME_ENGINE->gameState != TGameEngineStateHoldClearedLines) && spriteBit ) {
-                        *line1Ptr++ = COLOR_PAIR(spriteColorIdx) | '|'; *line1Ptr++ = COLOR_PAIR(spriteColorIdx) | ' '; *line1Ptr++ = COLOR_PAIR(spriteColorIdx) | ' '; *line1Ptr++ = COLOR_PAIR(spriteColorIdx) | ' ';
-                        *line2Ptr++ = COLOR_PAIR(spriteColorIdx) | '|'; *line2Ptr++ = COLOR_PAIR(spriteColorIdx) | '_'; *line2Ptr++ = COLOR_PAIR(spriteColorIdx) | '_'; *line2Ptr++ = COLOR_PAIR(spriteColorIdx) | '_';
+                        cells[i] = COLOR_PAIR(spriteColorIdx) | '|';
                     }
                     else if ( (gridBit && TCellGetIsOccupied(cellValue)) ) {
                         // Occupied cell, draw the tetromino box:
@@ -1086,26 +1279,26 @@ gameBoardDraw_COLOR(
             
                         if ( TCellGetIsCompleted(cellValue) && GAME_ENGINE->completionFlashIdx ) modifier |= A_REVERSE;
             
-                        *line1Ptr++ = modifier | '|'; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' '; *line1Ptr++ = modifier | ' ';
-                        *line2Ptr++ = modifier | '|'; *line2Ptr++ = modifier | '_'; *line2Ptr++ = modifier | '_'; *line2Ptr++ = modifier | '_';
+                        cells[i] = modifier | '|';
+                    }
+                    else if ( shouldDrawGhost && ((unsigned int)(j - ghost.P.j) < 4) && ((unsigned int)(i - ghost.P.i) < 4) &&
+                              (ghostBits & (1 << (4 * (j - ghost.P.j) + (i - ghost.P.i))))
+                    ) {
+                        // The landing spot of the falling piece:
+                        cells[i] = COLOR_PAIR(spriteColorIdx) | A_DIM | ':';
                     }
                     else {
                         // Nothing there...
-                        *line1Ptr++ = ' '; *line1Ptr++ = ' '; *line1Ptr++ = ' '; *line1Ptr++ = ' ';
-                        *line2Ptr++ = ' '; *line2Ptr++ = ' '; *line2Ptr++ = ' '; *line2Ptr++ = ' ';
+                        cells[i] = ' ';
                     }
                     i++;
                 }
                 if ( (j >= spriteJLo) && (j < spriteJHi) && extraIShift ) spriteBits >>= extraIShift;
-                wmove(window_ptr, 1 + 2 * j, 2);
-                i = (line1Ptr - line1); line1Ptr = line1;
-                while ( i-- ) waddch(window_ptr, *line1Ptr++);
-                wmove(window_ptr, 2 + 2 * j, 2);
-                i = (line2Ptr - line2); line2Ptr = line2;
-                while ( i-- ) waddch(window_ptr, *line2Ptr++);
+                
+                // Only the cells that changed are drawn:
+                TGameBoardViewDrawRow(BOARD_VIEW, window_ptr, j, cells);
                 j++;
             }
-            TBitGridIteratorDestroy(gridScanner);
             break;
         }
     }
@@ -1113,6 +1306,7 @@ gameBoardDraw_COLOR(
 #undef THE_PIECE
 #undef THE_BOARD
 #undef GAME_ENGINE
+#undef BOARD_VIEW
 }
 
 //
@@ -1253,17 +1447,13 @@ nextTetrominoDraw_COLOR(
                 }
                 mask <<= 1;
             }
-            wmove(window_ptr, 2 + 2 * j, 3);
-            count = line1Ptr - line1; line1Ptr = line1;
-            while ( count-- ) waddch(window_ptr, *line1Ptr++);
-            wmove(window_ptr, 3 + 2 * j, 3);
-            count = line2Ptr - line2; line2Ptr = line2;
-            while ( count-- ) waddch(window_ptr, *line2Ptr++);
+            mvwaddchnstr(window_ptr, 2 + 2 * j, 3, line1, line1Ptr - line1);
+            mvwaddchnstr(window_ptr, 3 + 2 * j, 3, line2, line2Ptr - line2);
         
             j++;
         }
     }
-#define GAME_ENGINE ((TGameEngine*)context)
+#undef GAME_ENGINE
 }
 
 #endif /* ENABLE_COLOR_DISPLAY */
@@ -1513,6 +1703,155 @@ doHighScoreWindow(
 ////
 //
 
+/*
+ * @function waitForInputOrDeadline
+ *
+ * Block until stdin is readable or the gameEngine's next deadline
+ * has passed -- or otherDeadline, if it is not NULL and comes sooner.
+ * If there is no deadline, wait only on stdin.
+ *
+ * If timerFd is a valid timerfd descriptor it is armed with the
+ * absolute deadline, otherwise the deadline is converted to a poll()
+ * timeout rounded up to the next millisecond.  Signals (e.g. the
+ * SIGWINCH of a terminal resize) also end the wait.
+ */
+void
+waitForInputOrDeadline(
+    TGameEngine             *gameEngine,
+    int                     timerFd,
+    const struct timespec   *otherDeadline
+)
+{
+    struct pollfd   fds[2] = {
+                        { .fd = STDIN_FILENO, .events = POLLIN, .revents = 0 },
+                        { .fd = -1, .events = POLLIN, .revents = 0 }
+                    };
+    struct timespec deadline;
+    int             timeoutMs = -1;
+    bool            hasDeadline = TGameEngineGetNextDeadline(gameEngine, &deadline);
+    
+    if ( otherDeadline && (! hasDeadline || timespec_is_ordered_asc(otherDeadline, &deadline)) ) {
+        deadline = *otherDeadline;
+        hasDeadline = true;
+    }
+    if ( hasDeadline ) {
+#ifdef HAVE_SYS_TIMERFD_H
+        if ( timerFd >= 0 ) {
+            struct itimerspec   timerValue = {
+                                    .it_interval = { .tv_sec = 0, .tv_nsec = 0 },
+                                    .it_value = deadline
+                                };
+            
+            if ( timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &timerValue, NULL) == 0 ) {
+                fds[1].fd = timerFd;
+            } else {
+                timerFd = -1;
+            }
+        }
+        if ( timerFd < 0 )
+#endif
+        {
+            struct timespec     now, dt;
+            
+            TGameEngineGetTime(gameEngine, &now);
+            if ( ! timespec_is_ordered_asc(&now, &deadline) ) return;
+            timespec_subtract(&dt, &deadline, &now);
+            timeoutMs = dt.tv_sec * 1000 + (dt.tv_nsec + 999999) / 1000000;
+        }
+    }
+    if ( poll(fds, 2, timeoutMs) > 0 ) {
+#ifdef HAVE_SYS_TIMERFD_H
+        if ( fds[1].revents & POLLIN ) {
+            uint64_t    nExpirations;
+            ssize_t     nBytes;
+            
+            // Drain the expiration count so the descriptor is no longer readable:
+            nBytes = read(timerFd, &nExpirations, sizeof(nExpirations));
+            (void)nBytes;
+        }
+#endif
+    }
+}
+
+//
+
+/*
+ * @function renderBenchmark
+ *
+ * Play random moves on gameEngine (using its virtual clock) and redraw the
+ * boardWindow after every tick that changes the game board until nFrames
+ * frames have been drawn.  The time spent drawing into the curses window
+ * and the time spent updating the terminal are added to *tDraw and
+ * *tUpdate, respectively.
+ */
+void
+renderBenchmark(
+    TGameEngine         *gameEngine,
+    tui_window_ref      boardWindow,
+    unsigned long       nFrames,
+    struct timespec     *tDraw,
+    struct timespec     *tUpdate
+)
+{
+    static const TGameEngineEvent   events[] = {
+                                        TGameEngineEventNoOp,
+                                        TGameEngineEventMoveLeft,
+                                        TGameEngineEventMoveRight,
+                                        TGameEngineEventRotateClockwise,
+                                        TGameEngineEventRotateAntiClockwise,
+                                        TGameEngineEventSoftDrop,
+                                        TGameEngineEventSoftDrop,
+                                        TGameEngineEventHardDrop
+                                    };
+    struct timespec                 tTick = { .tv_sec = 0, .tv_nsec = 50000000 }, t0, t1, t2, dt;
+    TRandomState                    randomState;
+    
+    TRandomSeed(&randomState, 1);
+    TGameEngineSetClockSource(gameEngine, TGameEngineClockSourceVirtual);
+    TGameEngineResetWithSeed(gameEngine, 1);
+    TGameEngineTick(gameEngine, TGameEngineEventStartGame);
+    while ( nFrames ) {
+        TGameEngineUpdateNotification   updateNotifications;
+        
+        TGameEngineAdvanceVirtualClock(gameEngine, &tTick);
+        if ( gameEngine->gameState == TGameEngineStateCheckHighScore ) {
+            gameEngine->gameState = TGameEngineStateGameHasEnded;
+            updateNotifications = TGameEngineTick(gameEngine, TGameEngineEventReset);
+        } else {
+            updateNotifications = TGameEngineTick(gameEngine, events[TRandomNextInRange(&randomState, sizeof(events) / sizeof(events[0]))]);
+        }
+        if ( updateNotifications & TGameEngineUpdateNotificationGameBoard ) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            tui_window_refresh(boardWindow, 1);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            doupdate();
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            timespec_add(tDraw, tDraw, timespec_subtract(&dt, &t1, &t0));
+            timespec_add(tUpdate, tUpdate, timespec_subtract(&dt, &t2, &t1));
+            nFrames--;
+        }
+    }
+}
+
+//
+
+/*
+ * @constant TDemoMoveInterval
+ *
+ * Time between the bot's moves in demo mode.
+ */
+static const struct timespec TDemoMoveInterval = { .tv_sec = 0, .tv_nsec = 60000000 };
+
+/*
+ * @constant TDemoRestartInterval
+ *
+ * Time the end of a game stays on-screen in demo mode before the next
+ * game is started.
+ */
+static const struct timespec TDemoRestartInterval = { .tv_sec = 3, .tv_nsec = 0 };
+
+//
+
 enum {
     TWindowIndexGameBoard = 0,
     TWindowIndexStats,
@@ -1531,6 +1870,7 @@ main(
     unsigned int        idx;
     
     TGameEngine         *gameEngine = NULL;
+    TGameBoardView      *gameBoardView = NULL;
     TKeymap             gameKeymap;
     
     WINDOW              *mainWindow = NULL;
@@ -1544,12 +1884,23 @@ main(
     unsigned int        gameWindowsEnabled = 0;
     bool                haveRetriedWidth = false, haveRetriedHeight = false, doDimensionRetry = false;
     TBitGridWordSize    wantWordSize = TBitGridWordSizeDefault;
+    bool                wantsGhost = false;
+    const char          *recordDirectory = NULL;
+    TReplayRecorder     *gameRecorder = NULL;
+    unsigned long       nReplaysFailed = 0;
+    bool                wantsDemo = false;
+    TBotWeights         botWeights;
+    TBot                *gameBot = NULL;
+    struct timespec     tNextBotMove = { 0, 0 }, tNow;
 
 #ifdef ENABLE_COLOR_DISPLAY
     bool                wantsColor = false;
 #endif
 
     unsigned int        startingLevel = 0, savedLevel;
+    int                 timerFd = -1;
+    unsigned long       renderBenchFrames = 0;
+    struct timespec     tRenderDraw = { 0, 0 }, tRenderUpdate = { 0, 0 };
     
     setlocale(LC_ALL, "");
     
@@ -1557,6 +1908,7 @@ main(
     setenv("NCURSES_NO_HARD_TABS", "1", 0);
     
     TKeymapInit(&gameKeymap);
+    TBotWeightsInit(&botWeights);
     
     // Parse CLI arguments:
     while ( (keyCh = getopt_long(argc, argv, cliArgOptsStr, cliArgOpts, NULL)) != -1 ) {
@@ -1611,6 +1963,38 @@ main(
             case 'U':
                 gAllowUTF8 = true;
                 break;
+            
+            case 'g':
+                wantsGhost = true;
+                break;
+            
+            case 'r':
+                if ( access(optarg, W_OK | X_OK) != 0 ) {
+                    fprintf(stderr, "ERROR:  unable to write replays to directory %s (errno = %d)\n", optarg, errno);
+                    exit(EINVAL);
+                }
+                recordDirectory = optarg;
+                break;
+            
+            case 'R': {
+                char    *endptr = NULL;
+                long    v = strtol(optarg, &endptr, 0);
+                
+                if ( endptr == optarg || v <= 0 ) {
+                    fprintf(stderr, "ERROR:  invalid frame count: %s\n", optarg);
+                    exit(EINVAL);
+                }
+                renderBenchFrames = v;
+                break;
+            }
+            
+            case 'd':
+                wantsDemo = true;
+                break;
+            
+            case 'W':
+                TBotWeightsInitWithFile(&botWeights, optarg);
+                break;
         }
     }
     
@@ -1754,6 +2138,30 @@ retry_board_dims:
 #endif
     // Create the game engine:
     gameEngine = TGameEngineCreate(wantWordSize, 1, gameBoardWidth, gameBoardHeight, startingLevel);
+    if ( gameEngine ) TGameEngineSetShowsGhost(gameEngine, wantsGhost);
+    
+    // In demo mode the bot plays:
+    if ( wantsDemo ) {
+        gameBot = TBotCreate(&botWeights, gameBoardWidth, gameBoardHeight);
+        if ( ! gameBot ) {
+            delwin(mainWindow);
+            endwin();
+            refresh();
+            fprintf(stderr, "ERROR:  unable to create the bot for a %d x %d game board\n", gameBoardWidth, gameBoardHeight);
+            exit(1);
+        }
+    }
+    
+    // The game board window draws through a view that remembers what is
+    // on-screen:
+    gameBoardView = TGameBoardViewCreate(gameEngine);
+    if ( ! gameBoardView ) {
+        delwin(mainWindow);
+        endwin();
+        refresh();
+        fprintf(stderr, "ERROR:  unable to create game board view\n");
+        exit(1);
+    }
     
     //
     // Initialize game windows:
@@ -1765,13 +2173,13 @@ retry_board_dims:
         gameWindows[TWindowIndexGameBoard] = tui_window_alloc(
                                                     gameWindowsBounds[TWindowIndexGameBoard], 0,
                                                     NULL, 0,
-                                                    gameBoardDraw_COLOR, (const void*)gameEngine);
+                                                    gameBoardDraw_COLOR, (const void*)gameBoardView);
     else
 #endif
     gameWindows[TWindowIndexGameBoard] = tui_window_alloc(
                                                 gameWindowsBounds[TWindowIndexGameBoard], 0,
                                                 NULL, 0,
-                                                gameBoardDraw_BW, (const void*)gameEngine);
+                                                gameBoardDraw_BW, (const void*)gameBoardView);
     if ( ! gameWindows[TWindowIndexGameBoard] ) {
         delwin(mainWindow);
         endwin();
@@ -1878,13 +2286,24 @@ retry_board_dims:
     for ( idx = 0; idx < TWindowIndexMax; idx++ ) if (gameWindowsEnabled & (1 << idx)) tui_window_refresh(gameWindows[idx], 1);
     doupdate();
     
-    // Key checks should be non-blocking:
+    // Key checks should be non-blocking; the loop sleeps in
+    // waitForInputOrDeadline() when no keys are waiting:
     timeout(0);
+#ifdef HAVE_SYS_TIMERFD_H
+    timerFd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+#endif
     
     savedLevel = gameEngine->scoreboard.level;
     
+    if ( renderBenchFrames ) {
+        renderBenchmark(gameEngine, gameWindows[TWindowIndexGameBoard], renderBenchFrames, &tRenderDraw, &tRenderUpdate);
+        goto exit_game;
+    }
+    
+    if ( recordDirectory ) gameRecorder = TReplayRecorderCreate(recordDirectory);
+    
     while ( true ) {
-        TGameEngineUpdateNotification   updateNotifications;
+        TGameEngineUpdateNotification   updateNotifications = 0;
         TGameEngineEvent                gameEngineEvent = TGameEngineEventNoOp;
         
         keyCh = getch();
@@ -1896,17 +2315,40 @@ retry_board_dims:
         switch ( gameEngine->gameState ) {
         
             case TGameEngineStateStartup:
-                if ( keyCh != ERR ) TGameEngineTick(gameEngine, TGameEngineEventStartGame);
+                if ( (keyCh != ERR) || gameBot ) {
+                    TReplayRecorderTick(gameRecorder, gameEngine, TGameEngineEventStartGame);
+                    if ( gameBot ) {
+                        TGameEngineGetTime(gameEngine, &tNow);
+                        timespec_add(&tNextBotMove, &tNow, &TDemoMoveInterval);
+                    }
+                }
                 break;
                 
             case TGameEngineStateGameHasEnded:
-                if ( TKeymapEventForKey(&gameKeymap, keyCh) == TGameEngineEventReset ) updateNotifications = TGameEngineTick(gameEngine, TGameEngineEventReset);
+                if ( TKeymapEventForKey(&gameKeymap, keyCh) == TGameEngineEventReset ) {
+                    updateNotifications = TReplayRecorderTick(gameRecorder, gameEngine, TGameEngineEventReset);
+                } else if ( gameBot ) {
+                    TGameEngineGetTime(gameEngine, &tNow);
+                    if ( ! timespec_is_ordered_asc(&tNow, &tNextBotMove) ) {
+                        updateNotifications = TReplayRecorderTick(gameRecorder, gameEngine, TGameEngineEventReset);
+                        timespec_add(&tNextBotMove, &tNow, &TDemoMoveInterval);
+                    }
+                }
                 break;
             
             case TGameEngineStateCheckHighScore: {
-                THighScoresRef      highScores = THighScoresLoad(THighScoresFilePath);
+                THighScoresRef      highScores;
                 unsigned int        highScoreRank;
     
+                // The bot's games do not go on the high scores list:
+                if ( gameBot ) {
+                    gameEngine->gameState = TGameEngineStateGameHasEnded;
+                    TGameEngineGetTime(gameEngine, &tNow);
+                    timespec_add(&tNextBotMove, &tNow, &TDemoRestartInterval);
+                    break;
+                }
+                
+                highScores = THighScoresLoad(THighScoresFilePath);
                 if ( ! highScores ) highScores = THighScoresCreate();
                 if ( THighScoresDoesQualify(highScores, gameEngine->scoreboard.score, &highScoreRank) ) {
                     doHighScoreWindow(
@@ -1950,7 +2392,7 @@ retry_board_dims:
             }
             
             case TGameEngineStateHoldClearedLines:
-                updateNotifications = TGameEngineTick(gameEngine, gameEngineEvent);
+                updateNotifications = TReplayRecorderTick(gameRecorder, gameEngine, gameEngineEvent);
                 break;
             
             default: {
@@ -1974,8 +2416,21 @@ retry_board_dims:
                         gameEngineEvent = TKeymapEventForKey(&gameKeymap, keyCh);
                         break;
                 }
+                
+                // In demo mode the keyboard can only pause or reset; the bot
+                // makes the moves:
+                if ( gameBot ) {
+                    if ( (gameEngineEvent != TGameEngineEventTogglePause) && (gameEngineEvent != TGameEngineEventReset) ) gameEngineEvent = TGameEngineEventNoOp;
+                    if ( (gameEngineEvent == TGameEngineEventNoOp) && (gameEngine->gameState == TGameEngineStateGameHasStarted) ) {
+                        TGameEngineGetTime(gameEngine, &tNow);
+                        if ( ! timespec_is_ordered_asc(&tNow, &tNextBotMove) ) {
+                            gameEngineEvent = TBotNextEvent(gameEngine, gameBot);
+                            timespec_add(&tNextBotMove, &tNow, &TDemoMoveInterval);
+                        }
+                    }
+                }
         
-                updateNotifications = TGameEngineTick(gameEngine, gameEngineEvent);
+                updateNotifications = TReplayRecorderTick(gameRecorder, gameEngine, gameEngineEvent);
                 break;
             }
         }        
@@ -2002,14 +2457,44 @@ retry_board_dims:
             }
             doupdate();
         }
+        
+        // If there was no key waiting, sleep until there is one or until
+        // the engine (or the bot) has something to do:
+        if ( keyCh == ERR ) {
+            bool    isBotWaiting = gameBot && ((gameEngine->gameState == TGameEngineStateGameHasStarted) || (gameEngine->gameState == TGameEngineStateGameHasEnded));
+            
+            waitForInputOrDeadline(gameEngine, timerFd, isBotWaiting ? &tNextBotMove : NULL);
+        }
+    }
+    
+exit_game:
+    // Write the game in progress (if any) and note how the replays fared:
+    if ( gameRecorder ) {
+        TReplayRecorderFinish(gameRecorder, gameEngine);
+        nReplaysFailed = gameRecorder->nFailed;
+        TReplayRecorderDestroy(gameRecorder);
     }
     
+#ifdef HAVE_SYS_TIMERFD_H
+    if ( timerFd >= 0 ) close(timerFd);
+#endif
+    
     // Dispose of all windows:
     for ( idx = 0; idx < TWindowIndexMax; idx++ ) if (gameWindowsEnabled & (1 << idx)) tui_window_free(gameWindows[idx]);
+    TGameBoardViewDestroy(gameBoardView);
+    if ( gameBot ) TBotDestroy(gameBot);
     delwin(mainWindow);
     refresh();    
     endwin();
     refresh();
     
+    if ( nReplaysFailed ) fprintf(stderr, "WARNING:  %lu replay(s) could not be written to %s\n", nReplaysFailed, recordDirectory);
+    if ( renderBenchFrames ) {
+        printf("%lu frames:  %.2f us drawing + %.2f us updating the terminal per frame\n",
+                renderBenchFrames,
+                1e6 * timespec_to_double(&tRenderDraw) / renderBenchFrames,
+                1e6 * timespec_to_double(&tRenderUpdate) / renderBenchFrames
+            );
+    }
     return 0;
 }